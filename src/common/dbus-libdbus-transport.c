@@ -48,6 +48,7 @@
 #define TRANSPORT_MESSAGE    "DeliverMessage"
 #define TRANSPORT_DATA       "DeliverData"
 #define TRANSPORT_RAW        "DeliverRaw"
+#define TRANSPORT_NATIVE     "DeliverNative"
 #define TRANSPORT_METHOD     "DeliverMessage"
 
 #define ANY_ADDRESS          "any"
@@ -68,6 +69,8 @@ static uint32_t nauto;                   /* for autobinding */
 static int dbus_msg_cb(mrp_dbus_t *dbus, mrp_dbus_msg_t *msg, void *user_data);
 static int dbus_data_cb(mrp_dbus_t *dbus, mrp_dbus_msg_t *msg, void *user_data);
 static int dbus_raw_cb(mrp_dbus_t *dbus, mrp_dbus_msg_t *msg, void *user_data);
+static int dbus_native_cb(mrp_dbus_t *dbus, mrp_dbus_msg_t *msg,
+                          void *user_data);
 
 static void peer_state_cb(mrp_dbus_t *dbus, const char *name, int up,
                           const char *owner, void *user_data);
@@ -268,6 +271,8 @@ static size_t peer_address(mrp_sockaddr_t *addrp, const char *sender,
     char           *q;
     int             l, n;
 
+    addr->db_family = MRP_AF_DBUS;
+
     q = addr->db_fqa;
     l = sizeof(addr->db_fqa) - 1;
     p = ANY_ADDRESS;
@@ -392,6 +397,10 @@ static int dbus_bind(mrp_transport_t *mt, mrp_sockaddr_t *addrp,
         method = TRANSPORT_RAW;
         cb     = dbus_raw_cb;
         break;
+    case MRP_TRANSPORT_MODE_NATIVE:
+        method = TRANSPORT_NATIVE;
+        cb     = dbus_native_cb;
+        break;
     case MRP_TRANSPORT_MODE_MSG:
         method = TRANSPORT_MESSAGE;
         cb     = dbus_msg_cb;
@@ -456,6 +465,10 @@ static void dbus_close(mrp_transport_t *mt)
             method = TRANSPORT_RAW;
             cb     = dbus_raw_cb;
             break;
+        case MRP_TRANSPORT_MODE_NATIVE:
+            method = TRANSPORT_NATIVE;
+            cb     = dbus_native_cb;
+            break;
         default:
         case MRP_TRANSPORT_MODE_MSG:
             method = TRANSPORT_MESSAGE;
@@ -604,6 +617,57 @@ static int dbus_raw_cb(mrp_dbus_t *dbus, mrp_dbus_msg_t *dmsg, void *user_data)
 }
 
 
+static int dbus_native_cb(mrp_dbus_t *dbus, mrp_dbus_msg_t *dmsg,
+                          void *user_data)
+{
+    mrp_transport_t *mt = (mrp_transport_t *)user_data;
+    dbus_t          *t  = (dbus_t *)mt;
+    mrp_sockaddr_t   addr;
+    socklen_t        alen;
+    const char      *sender, *sender_path;
+    void            *data;
+    size_t           size;
+    int              status;
+
+    MRP_UNUSED(dbus);
+
+    /* native messages travel as a byte array of the native wire format */
+    data = raw_decode(dmsg, &size, &sender_path);
+
+    if (data != NULL) {
+        sender = mrp_dbus_msg_sender(dmsg);
+
+        if (mt->connected) {
+            if (t->peer_resolved && strcmp(t->remote.db_addr, sender)) {
+                mrp_free(data);
+                return TRUE;
+            }
+
+            status = mt->recv_data(mt, data, size, NULL, 0);
+        }
+        else {
+            peer_address(&addr, sender, sender_path);
+            alen = sizeof(addr);
+
+            status = mt->recv_data(mt, data, size, &addr, alen);
+        }
+
+        mrp_free(data);
+
+        if (status < 0)
+            mrp_log_error("Failed to decode native message (%d: %s).",
+                          -status, strerror(-status));
+
+        mt->check_destroy(mt);
+    }
+    else {
+        mrp_log_error("Failed to decode native message.");
+    }
+
+    return TRUE;
+}
+
+
 static void peer_state_cb(mrp_dbus_t *dbus, const char *name, int up,
                           const char *owner, void *user_data)
 {
@@ -840,6 +904,61 @@ static int dbus_senddata(mrp_transport_t *mt, void *data, uint16_t tag)
 }
 
 
+static int dbus_sendnativeto(mrp_transport_t *mt, void *data, uint32_t type_id,
+                             mrp_sockaddr_t *addrp, socklen_t addrlen)
+{
+    dbus_t         *t    = (dbus_t *)mt;
+    mrp_dbusaddr_t *addr = (mrp_dbusaddr_t *)addrp;
+    mrp_dbus_msg_t *m;
+    void           *buf;
+    size_t          size;
+    int             success;
+
+    if (check_address(addrp, addrlen)) {
+        if (t->dbus == NULL && !dbus_autobind(mt, addrp))
+            return FALSE;
+
+        if (mrp_encode_native(data, type_id, 0, &buf, &size, t->map) < 0)
+            return FALSE;
+
+        m = raw_encode(t->dbus, addr->db_addr, addr->db_path,
+                       TRANSPORT_INTERFACE, TRANSPORT_NATIVE,
+                       t->local.db_path, buf, size);
+
+        mrp_free(buf);
+
+        if (m != NULL) {
+            if (mrp_dbus_send_msg(t->dbus, m))
+                success = TRUE;
+            else {
+                errno   = ECOMM;
+                success = FALSE;
+            }
+
+            mrp_dbus_msg_unref(m);
+        }
+        else
+            success = FALSE;
+    }
+    else {
+        errno   = EINVAL;
+        success = FALSE;
+    }
+
+    return success;
+}
+
+
+static int dbus_sendnative(mrp_transport_t *mt, void *data, uint32_t type_id)
+{
+    dbus_t         *t    = (dbus_t *)mt;
+    mrp_sockaddr_t *addr = (mrp_sockaddr_t *)&t->remote;
+    socklen_t       alen = sizeof(t->remote);
+
+    return dbus_sendnativeto(mt, data, type_id, addr, alen);
+}
+
+
 static const char *get_array_signature(uint16_t type)
 {
 #define MAP(from, to)                                 \
@@ -1741,5 +1860,5 @@ MRP_REGISTER_TRANSPORT(dbus, DBUS, dbus_t, dbus_resolve,
                        dbus_sendraw, dbus_sendrawto,
                        dbus_senddata, dbus_senddatato,
                        NULL, NULL,
-                       NULL, NULL,
+                       dbus_sendnative, dbus_sendnativeto,
                        NULL, NULL);
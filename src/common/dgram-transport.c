@@ -55,6 +55,7 @@
 
 
 #define DEFAULT_SIZE 1024                /* default input buffer size */
+#define RECV_BUDGET  32                  /* max. datagrams per wakeup */
 
 typedef struct {
     MRP_TRANSPORT_PUBLIC_FIELDS;         /* common transport fields */
@@ -284,11 +285,13 @@ static int dgrm_createfrom(mrp_transport_t *mu, void *conn)
             fcntl(u->sock, F_SETFL, O_NONBLOCK, on);
         }
 
-        events = MRP_IO_EVENT_IN | MRP_IO_EVENT_HUP;
+        events = MRP_IO_EVENT_IN | MRP_IO_EVENT_HUP | MRP_IO_TRIGGER_EDGE;
         u->iow = mrp_add_io_watch(u->ml, u->sock, events, dgrm_recv_cb, u);
 
-        if (u->iow != NULL)
+        if (u->iow != NULL) {
+            mrp_set_io_watch_budget(u->iow, RECV_BUDGET);
             return TRUE;
+        }
     }
 
     return FALSE;
@@ -345,13 +348,11 @@ static void dgrm_recv_cb(mrp_io_watch_t *w, int fd, mrp_io_event_t events,
     mrp_transport_t *mu = (mrp_transport_t *)u;
     mrp_sockaddr_t   addr;
     socklen_t        addrlen;
-    uint32_t         size;
+    uint32_t         size, budget, cnt;
     ssize_t          n;
     void            *data;
     int              old, error;
 
-    MRP_UNUSED(w);
-
     if (events & MRP_IO_EVENT_IN) {
         if (u->idata == u->isize) {
             if (u->isize != 0) {
@@ -378,39 +379,68 @@ static void dgrm_recv_cb(mrp_io_watch_t *w, int fd, mrp_io_event_t events,
             }
         }
 
-        if (recv(fd, &size, sizeof(size), MSG_PEEK) != sizeof(size)) {
-            error = EIO;
-            goto fatal_error;
-        }
+        /*
+         * The socket is edge-triggered, so keep reading until it would
+         * block, otherwise we won't get woken up for what is left. Deliver
+         * at most budget datagrams per wakeup, though, and yield the watch
+         * to get called again in the next mainloop iteration instead of
+         * starving others. Any pending hangup is kept in the yielded events.
+         */
+
+        budget = mrp_get_io_watch_budget(w);
+        cnt    = 0;
+
+        for (;;) {
+            n = recv(fd, &size, sizeof(size), MSG_PEEK | MSG_DONTWAIT);
+
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                if (errno == EINTR)
+                    continue;
+            }
+
+            if (n != sizeof(size)) {
+                error = EIO;
+                goto fatal_error;
+            }
 
-        size = ntohl(size);
+            size = ntohl(size);
 
-        if (u->isize < size + sizeof(size)) {
-            old      = u->isize;
-            u->isize = size + sizeof(size);
+            if (u->isize < size + sizeof(size)) {
+                old      = u->isize;
+                u->isize = size + sizeof(size);
 
-            if (!mrp_reallocz(u->ibuf, old, u->isize)) {
-                error = ENOMEM;
-                goto fatal_error;
+                if (!mrp_reallocz(u->ibuf, old, u->isize)) {
+                    error = ENOMEM;
+                    goto fatal_error;
+                }
             }
-        }
 
-        addrlen = sizeof(addr);
-        n = recvfrom(fd, u->ibuf, size + sizeof(size), 0, &addr.any, &addrlen);
+            addrlen = sizeof(addr);
+            n = recvfrom(fd, u->ibuf, size + sizeof(size), 0,
+                         &addr.any, &addrlen);
 
-        if (n != (ssize_t)(size + sizeof(size))) {
-            error = n < 0 ? EIO : EPROTO;
-            goto fatal_error;
-        }
+            if (n != (ssize_t)(size + sizeof(size))) {
+                error = n < 0 ? EIO : EPROTO;
+                goto fatal_error;
+            }
 
-        data  = u->ibuf + sizeof(size);
-        error = mu->recv_data(mu, data, size, &addr, addrlen);
+            data  = u->ibuf + sizeof(size);
+            error = mu->recv_data(mu, data, size, &addr, addrlen);
 
-        if (error)
-            goto fatal_error;
+            if (error)
+                goto fatal_error;
 
-        if (u->check_destroy(mu))
-            return;
+            if (u->check_destroy(mu) || u->iow != w)
+                return;
+
+            if (budget && ++cnt >= budget) {
+                mrp_debug("transport %p used up its budget, yielding", mu);
+                mrp_yield_io_watch(w, events);
+                return;
+            }
+        }
     }
 
     if (events & MRP_IO_EVENT_HUP) {
@@ -442,11 +472,13 @@ static int open_socket(dgrm_t *u, int family)
             fcntl(u->sock, F_SETFL, O_CLOEXEC, on);
         }
 
-        events = MRP_IO_EVENT_IN | MRP_IO_EVENT_HUP;
+        events = MRP_IO_EVENT_IN | MRP_IO_EVENT_HUP | MRP_IO_TRIGGER_EDGE;
         u->iow = mrp_add_io_watch(u->ml, u->sock, events, dgrm_recv_cb, u);
 
-        if (u->iow != NULL)
+        if (u->iow != NULL) {
+            mrp_set_io_watch_budget(u->iow, RECV_BUDGET);
             return TRUE;
+        }
         else {
             close(u->sock);
             u->sock = -1;
@@ -722,7 +754,7 @@ static int sendnativeto(mrp_transport_t *mu, void *data, uint32_t type_id,
 
     reserve = sizeof(*lenp);
 
-    if (mrp_encode_native(data, type_id, reserve, &buf, &size, map) > 0) {
+    if (mrp_encode_native(data, type_id, reserve, &buf, &size, map) == 0) {
         lenp  = buf;
         *lenp = htobe32(size - sizeof(*lenp));
 
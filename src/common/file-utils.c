@@ -34,14 +34,65 @@
 #include <stdbool.h>
 #include <dirent.h>
 #include <sys/types.h>
+#include <time.h>
 #include <sys/stat.h>
 
 #include <murphy/config.h>
 #include <murphy/common/macros.h>
+#include <murphy/common/mm.h>
+#include <murphy/common/list.h>
 #include <murphy/common/debug.h>
 #include <murphy/common/regexp.h>
 #include <murphy/common/file-utils.h>
 
+/*
+ * Compiled patterns and directory listings are cached, so that repeated
+ * scans of the same directories with the same patterns (plugin and config
+ * discovery during startup and reload) don't need to recompile the pattern
+ * or reread the directory. A cached listing is validated against the
+ * modification time of the directory on every scan. Since the resolution
+ * of modification times is coarse on some filesystems, a listing is only
+ * cached once its directory has been left untouched for a while.
+ */
+
+#define SCAN_CACHE_REGEXPS 8             /* max. cached patterns */
+#define SCAN_CACHE_DIRS    8             /* max. cached listings */
+#define SCAN_CACHE_SLACK   2             /* mtime slack, seconds */
+
+typedef struct {
+    mrp_list_hook_t  hook;               /* to LRU list of patterns */
+    int              refcnt;             /* reference count */
+    char            *pattern;            /* pattern as given */
+    int              flags;              /* compilation flags */
+    mrp_regexp_t    *re;                 /* compiled pattern */
+} regexp_cache_t;
+
+typedef struct {
+    char              *name;             /* entry name */
+    mrp_dirent_type_t  type;             /* entry type, links not followed */
+} dir_entry_t;
+
+typedef struct {
+    mrp_list_hook_t  hook;               /* to LRU list of listings */
+    int              refcnt;             /* reference count */
+    char            *path;               /* directory path */
+    dev_t            dev;                /* device of the directory */
+    ino_t            ino;                /* inode of the directory */
+    struct timespec  mtime;              /* mtime when listed */
+    dir_entry_t     *entries;            /* directory entries */
+    int              nentry;             /* number of entries */
+} dir_cache_t;
+
+static struct {
+    bool disabled;                       /* whether caching is disabled */
+    int  nregexp;                        /* number of cached patterns */
+    int  ndir;                           /* number of cached listings */
+} cache;
+
+static MRP_LIST_HOOK(regexps);
+static MRP_LIST_HOOK(dirs);
+
+
 static inline mrp_dirent_type_t dirent_type(mode_t mode)
 {
 #define MAP_TYPE(x, y) if (S_IS##x(mode)) return MRP_DIRENT_##y
@@ -60,41 +111,300 @@ static inline mrp_dirent_type_t dirent_type(mode_t mode)
 }
 
 
-int mrp_scan_dir(const char *path, const char *pattern, mrp_dirent_type_t mask,
-                 mrp_scan_dir_cb_t cb, void *user_data)
+static inline mrp_dirent_type_t dtype_type(unsigned char type)
 {
-    DIR               *dp;
-    mrp_regexp_t      *re;
-    struct dirent     *de;
-    struct stat        st;
-    char               glob[1024], file[PATH_MAX];
-    int                status, flags;
-    int              (*statfn)(const char *, struct stat *);
-    mrp_dirent_type_t  type;
+    switch (type) {
+    case DT_REG:  return MRP_DIRENT_REG;
+    case DT_DIR:  return MRP_DIRENT_DIR;
+    case DT_LNK:  return MRP_DIRENT_LNK;
+    case DT_CHR:  return MRP_DIRENT_CHR;
+    case DT_BLK:  return MRP_DIRENT_BLK;
+    case DT_FIFO: return MRP_DIRENT_FIFO;
+    case DT_SOCK: return MRP_DIRENT_SOCK;
+    default:      return MRP_DIRENT_UNKNOWN;
+    }
+}
+
+
+static mrp_regexp_t *compile_pattern(const char *pattern, int flags)
+{
+    char glob[1024];
+
+    /* convert globs to regexp */
+    if (strstr(pattern, MRP_PATTERN_GLOB) == pattern) {
+        pattern += sizeof(MRP_PATTERN_GLOB) - 1;
+
+        if (mrp_regexp_glob(pattern, glob, sizeof(glob)) < 0)
+            return NULL;
+
+        pattern = glob;
+    }
+    else {
+        if (strstr(pattern, MRP_PATTERN_REGEX) == pattern)
+            pattern += sizeof(MRP_PATTERN_REGEX) - 1;
+    }
+
+    return mrp_regexp_compile(pattern, flags);
+}
+
+
+static void unref_regexp(regexp_cache_t *rc)
+{
+    if (--rc->refcnt > 0)
+        return;
+
+    mrp_regexp_free(rc->re);
+    mrp_free(rc->pattern);
+    mrp_free(rc);
+}
+
+
+static void drop_regexp(regexp_cache_t *rc)
+{
+    mrp_list_delete(&rc->hook);
+    cache.nregexp--;
+
+    unref_regexp(rc);
+}
+
+
+static regexp_cache_t *lookup_pattern(const char *pattern, int flags)
+{
+    mrp_list_hook_t *p, *n;
+    regexp_cache_t  *rc;
+
+    mrp_list_foreach(&regexps, p, n) {
+        rc = mrp_list_entry(p, typeof(*rc), hook);
+
+        if (rc->flags == flags && !strcmp(rc->pattern, pattern)) {
+            mrp_list_delete(&rc->hook);
+            mrp_list_prepend(&regexps, &rc->hook);
+            rc->refcnt++;
+
+            return rc;
+        }
+    }
+
+    if ((rc = mrp_allocz(sizeof(*rc))) == NULL)
+        return NULL;
+
+    mrp_list_init(&rc->hook);
+    rc->refcnt  = 1;
+    rc->pattern = mrp_strdup(pattern);
+    rc->flags   = flags;
+    rc->re      = compile_pattern(pattern, flags);
+
+    if (rc->pattern == NULL || rc->re == NULL) {
+        mrp_regexp_free(rc->re);
+        mrp_free(rc->pattern);
+        mrp_free(rc);
+
+        return NULL;
+    }
+
+    if (cache.disabled)
+        return rc;
+
+    mrp_list_prepend(&regexps, &rc->hook);
+    rc->refcnt++;
+    cache.nregexp++;
+
+    if (cache.nregexp > SCAN_CACHE_REGEXPS)
+        drop_regexp(mrp_list_entry(regexps.prev, regexp_cache_t, hook));
+
+    return rc;
+}
+
+
+static void unref_listing(dir_cache_t *d)
+{
+    int i;
+
+    if (--d->refcnt > 0)
+        return;
+
+    for (i = 0; i < d->nentry; i++)
+        mrp_free(d->entries[i].name);
+
+    mrp_free(d->entries);
+    mrp_free(d->path);
+    mrp_free(d);
+}
+
+
+static void drop_listing(dir_cache_t *d)
+{
+    mrp_list_delete(&d->hook);
+    cache.ndir--;
+
+    unref_listing(d);
+}
+
+
+static dir_cache_t *read_listing(const char *path, struct stat *st)
+{
+    DIR           *dp;
+    struct dirent *de;
+    struct stat    lst;
+    dir_cache_t   *d;
+    dir_entry_t   *e;
+    char           file[PATH_MAX];
+    int            size;
 
     if ((dp = opendir(path)) == NULL)
-        return -1;
+        return NULL;
 
-    /* compile pattern if given (converting globs to regexp) */
-    re = NULL;
-    if (pattern != NULL) {
-        if (strstr(pattern, MRP_PATTERN_GLOB) == pattern) {
-            pattern += sizeof(MRP_PATTERN_GLOB) - 1;
+    if ((d = mrp_allocz(sizeof(*d))) == NULL)
+        goto fail;
+
+    mrp_list_init(&d->hook);
+    d->refcnt = 1;
+    d->path   = mrp_strdup(path);
+    d->dev    = st->st_dev;
+    d->ino    = st->st_ino;
+    d->mtime  = st->st_mtim;
+    size      = 0;
 
-            if (mrp_regexp_glob(pattern, glob, sizeof(glob)) < 0)
+    if (d->path == NULL)
+        goto fail;
+
+    while ((de = readdir(dp)) != NULL) {
+        if (d->nentry >= size) {
+            if (!mrp_reallocz(d->entries, size, size ? 2 * size : 32))
                 goto fail;
+            size = size ? 2 * size : 32;
+        }
 
-            pattern = glob;
+        e = d->entries + d->nentry;
+
+        if ((e->name = mrp_strdup(de->d_name)) == NULL)
+            goto fail;
+
+        d->nentry++;
+
+        if ((e->type = dtype_type(de->d_type)) == MRP_DIRENT_UNKNOWN) {
+            snprintf(file, sizeof(file), "%s/%s", path, de->d_name);
+
+            if (lstat(file, &lst) == 0)
+                e->type = dirent_type(lst.st_mode);
         }
-        else {
-            if (strstr(pattern, MRP_PATTERN_REGEX) == pattern)
-                pattern += sizeof(MRP_PATTERN_REGEX) - 1;
+    }
+
+    closedir(dp);
+
+    return d;
+
+ fail:
+    closedir(dp);
+
+    if (d != NULL)
+        unref_listing(d);
+
+    errno = ENOMEM;
+    return NULL;
+}
+
+
+static dir_cache_t *lookup_listing(const char *path)
+{
+    mrp_list_hook_t *p, *n;
+    dir_cache_t     *d;
+    struct stat      st;
+    struct timespec  now;
+
+    if (stat(path, &st) < 0)
+        return NULL;
+
+    mrp_list_foreach(&dirs, p, n) {
+        d = mrp_list_entry(p, typeof(*d), hook);
+
+        if (strcmp(d->path, path))
+            continue;
+
+        if (d->dev == st.st_dev && d->ino == st.st_ino &&
+            d->mtime.tv_sec  == st.st_mtim.tv_sec &&
+            d->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+            mrp_list_delete(&d->hook);
+            mrp_list_prepend(&dirs, &d->hook);
+            d->refcnt++;
+
+            return d;
         }
 
+        mrp_debug("cached listing of '%s' is stale", path);
+        drop_listing(d);
+        break;
+    }
+
+    if ((d = read_listing(path, &st)) == NULL)
+        return NULL;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    if (cache.disabled || st.st_mtim.tv_sec + SCAN_CACHE_SLACK > now.tv_sec)
+        return d;
+
+    mrp_list_prepend(&dirs, &d->hook);
+    d->refcnt++;
+    cache.ndir++;
+
+    if (cache.ndir > SCAN_CACHE_DIRS)
+        drop_listing(mrp_list_entry(dirs.prev, dir_cache_t, hook));
+
+    return d;
+}
+
+
+bool mrp_scan_dir_cache(bool enable)
+{
+    bool enabled = !cache.disabled;
+
+    if (!enable)
+        mrp_scan_dir_flush();
+
+    cache.disabled = !enable;
+
+    return enabled;
+}
+
+
+void mrp_scan_dir_flush(void)
+{
+    mrp_list_hook_t *p, *n;
+
+    mrp_list_foreach(&regexps, p, n)
+        drop_regexp(mrp_list_entry(p, regexp_cache_t, hook));
+
+    mrp_list_foreach(&dirs, p, n)
+        drop_listing(mrp_list_entry(p, dir_cache_t, hook));
+}
+
+
+int mrp_scan_dir(const char *path, const char *pattern, mrp_dirent_type_t mask,
+                 mrp_scan_dir_cb_t cb, void *user_data)
+{
+    dir_cache_t       *d;
+    dir_entry_t       *e;
+    regexp_cache_t    *rc;
+    struct stat        st;
+    char               file[PATH_MAX];
+    int                status, flags, i;
+    bool               follow;
+    mrp_dirent_type_t  type;
+
+    if ((d = lookup_listing(path)) == NULL)
+        return -1;
+
+    /*
+     * compile pattern if given (converting globs to regexp), holding a
+     * reference to it so that it stays around even if the callback
+     * flushes or disables the cache, or evicts it by scanning
+     */
+    rc = NULL;
+    if (pattern != NULL) {
         flags = MRP_REGEXP_EXTENDED | MRP_REGEXP_NOSUB;
-        re    = mrp_regexp_compile(pattern, flags);
 
-        if (re == NULL)
+        if ((rc = lookup_pattern(pattern, flags)) == NULL)
             goto fail;
     }
 
@@ -106,27 +416,30 @@ int mrp_scan_dir(const char *path, const char *pattern, mrp_dirent_type_t mask,
     else if (mask & MRP_DIRENT_IGNORE_LNK)
         mask &= ~MRP_DIRENT_LNK;
 
-    /* lstat instead of stat if we ignore or pass on symlinks */
-    if (mask & (MRP_DIRENT_ACTUAL_LNK | MRP_DIRENT_IGNORE_LNK))
-        statfn = lstat;
-    else
-        statfn = stat;
+    /* dereference symlinks unless we ignore or pass them on */
+    follow = !(mask & (MRP_DIRENT_ACTUAL_LNK | MRP_DIRENT_IGNORE_LNK));
 
-    while ((de = readdir(dp)) != NULL) {
-        if (pattern != NULL && !mrp_regexp_matches(re, de->d_name, 0))
+    for (i = 0; i < d->nentry; i++) {
+        e = d->entries + i;
+
+        if (rc != NULL && !mrp_regexp_matches(rc->re, e->name, 0))
             continue;
 
-        snprintf(file, sizeof(file), "%s/%s", path, de->d_name);
+        type = e->type;
 
-        if (statfn(file, &st) != 0)
-            continue;
+        if (type == MRP_DIRENT_LNK && follow) {
+            snprintf(file, sizeof(file), "%s/%s", path, e->name);
 
-        type = dirent_type(st.st_mode);
+            if (stat(file, &st) != 0)
+                continue;
+
+            type = dirent_type(st.st_mode);
+        }
 
         if (!(type & mask))
             continue;
 
-        status = cb(path, de->d_name, type, user_data);
+        status = cb(path, e->name, type, user_data);
 
         if (status == 0)
             break;
@@ -135,14 +448,16 @@ int mrp_scan_dir(const char *path, const char *pattern, mrp_dirent_type_t mask,
             goto fail;
     }
 
-    closedir(dp);
-    mrp_regexp_free(re);
+    if (rc != NULL)
+        unref_regexp(rc);
+    unref_listing(d);
 
     return 0;
 
  fail:
-    closedir(dp);
-    mrp_regexp_free(re);
+    if (rc != NULL)
+        unref_regexp(rc);
+    unref_listing(d);
 
     return -1;
 }
@@ -30,6 +30,7 @@
 #ifndef __MRP_FILEUTILS_H__
 #define __MRP_FILEUTILS_H__
 
+#include <stdbool.h>
 #include <dirent.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -133,6 +134,28 @@ typedef int (*mrp_scan_dir_cb_t)(const char *dir, const char *entry,
 int mrp_scan_dir(const char *path, const char *pattern, mrp_dirent_type_t mask,
                  mrp_scan_dir_cb_t cb, void *user_data);
 
+/**
+ * @brief Enable or disable caching for directory scans.
+ *
+ * By default @mrp_scan_dir caches compiled patterns and the listings of
+ * directories which have not been modified recently. Cached listings are
+ * revalidated against the modification time of the directory on every
+ * scan. Disabling caching also flushes the caches. This function must not
+ * be called from a scanning callback.
+ *
+ * @param [in] enable  whether to enable caching
+ *
+ * @return Returns whether caching was enabled before the call.
+ */
+bool mrp_scan_dir_cache(bool enable);
+
+/**
+ * @brief Flush all cached patterns and directory listings.
+ *
+ * This function must not be called from a scanning callback.
+ */
+void mrp_scan_dir_flush(void);
+
 /**
  * @brief Search for a file in multiple directories.
  *
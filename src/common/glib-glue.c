@@ -41,32 +41,23 @@ typedef struct {
 } glib_glue_t;
 
 
-typedef struct {
-    GIOChannel        *gl_ioc;
-    guint              gl_iow;
-    void             (*cb)(void *glue_data,
-                           void *id, int fd, mrp_io_event_t events,
-                           void *user_data);
-    mrp_io_event_t     mask;
-    void              *user_data;
-    void              *glue_data;
-} io_t;
-
-
-typedef struct {
-    guint        gl_t;
-    void       (*cb)(void *glue_data, void *id, void *user_data);
-    void        *user_data;
-    void        *glue_data;
-} tmr_t;
-
+/*
+ * Notes:
+ *
+ *     Instead of mapping our I/O watch, timer and deferred callback
+ *     primitives one by one to glib sources we pump our mainloop from
+ *     a single custom GSource. Its prepare, check and dispatch wrap
+ *     the prepare, poll and dispatch phases of our mainloop around our
+ *     epoll fd and it tracks our next timeout using the ready time of
+ *     the source. This way we never need to destroy and recreate glib
+ *     sources when our next deadline changes.
+ */
 
 typedef struct {
-    guint        gl_t;
-    void       (*cb)(void *glue_data, void *id, void *user_data);
-    void        *user_data;
-    void        *glue_data;
-} dfr_t;
+    GSource         source;                  /* glib source, must be first */
+    mrp_mainloop_t *ml;                      /* murphy mainloop we pump */
+    gpointer        tag;                     /* tag for our epoll fd */
+} glib_source_t;
 
 
 #define D(fmt, args...) do {                                     \
@@ -74,222 +65,96 @@ typedef struct {
     } while (0)
 
 
-static void *add_io(void *glue_data, int fd, mrp_io_event_t events,
-                    void (*cb)(void *glue_data, void *id, int fd,
-                               mrp_io_event_t events, void *user_data),
-                    void *user_data);
-static void  del_io(void *glue_data, void *id);
-
-static void *add_timer(void *glue_data, unsigned int msecs,
-                       void (*cb)(void *glue_data, void *id, void *user_data),
-                       void *user_data);
-static void  del_timer(void *glue_data, void *id);
-static void  mod_timer(void *glue_data, void *id, unsigned int msecs);
-
-static void *add_defer(void *glue_data,
-                       void (*cb)(void *glue_data, void *id, void *user_data),
-                       void *user_data);
-static void  del_defer(void *glue_data, void *id);
-static void  mod_defer(void *glue_data, void *id, int enabled);
-
-
-static gboolean io_cb(GIOChannel *ioc, GIOCondition cond, gpointer user_data)
-{
-    io_t           *io     = (io_t *)user_data;
-    mrp_io_event_t  events = MRP_IO_EVENT_NONE;
-    int             fd     = g_io_channel_unix_get_fd(ioc);
-
-    if (cond & G_IO_IN)
-        events |= MRP_IO_EVENT_IN;
-    if (cond & G_IO_OUT)
-        events |= MRP_IO_EVENT_OUT;
-    if (cond & G_IO_ERR)
-        events |= MRP_IO_EVENT_ERR;
-    if (cond & G_IO_HUP)
-        events |= MRP_IO_EVENT_HUP;
-
-    io->cb(io->glue_data, io, fd, events, io->user_data);
-
-    return TRUE;
-}
-
-
-static void *add_io(void *glue_data, int fd, mrp_io_event_t events,
-                    void (*cb)(void *glue_data, void *id, int fd,
-                               mrp_io_event_t events, void *user_data),
-                    void *user_data)
+static gboolean source_prepare(GSource *source, gint *timeout)
 {
-    GIOCondition  mask = 0;
-    GIOChannel   *ioc;
-    io_t         *io;
-
-    ioc = g_io_channel_unix_new(fd);
+    glib_source_t *src = (glib_source_t *)source;
+    int            msecs;
 
-    if (ioc == NULL)
-        return NULL;
-
-    io = mrp_allocz(sizeof(*io));
+    mrp_mainloop_prepare(src->ml);
+    msecs = mrp_mainloop_get_timeout(src->ml);
 
-    if (io != NULL) {
-        if (events & MRP_IO_EVENT_IN ) mask |= G_IO_IN;
-        if (events & MRP_IO_EVENT_OUT) mask |= G_IO_OUT;
-        if (events & MRP_IO_EVENT_HUP) mask |= G_IO_HUP;
-        if (events & MRP_IO_EVENT_ERR) mask |= G_IO_ERR;
+    *timeout = -1;
 
-        io->mask   = events;
-        io->gl_ioc = ioc;
-        io->gl_iow = g_io_add_watch(ioc, mask, io_cb, io);
+    if (msecs == 0)
+        return TRUE;
 
-        if (io->gl_iow != 0) {
-            io->cb        = cb;
-            io->user_data = user_data;
-            io->glue_data = glue_data;
+    if (msecs < 0)
+        g_source_set_ready_time(source, -1);
+    else
+        g_source_set_ready_time(source, g_source_get_time(source) +
+                                1000 * (gint64)msecs);
 
-            return io;
-        }
-        else {
-            g_io_channel_unref(ioc);
-            mrp_free(io);
-        }
-    }
-
-    return NULL;
-}
-
-
-static void del_io(void *glue_data, void *id)
-{
-    io_t *io = (io_t *)id;
-
-    MRP_UNUSED(glue_data);
-
-    g_source_remove(io->gl_iow);
-    g_io_channel_unref(io->gl_ioc);
-    mrp_free(io);
+    return FALSE;
 }
 
 
-static gboolean timer_cb(gpointer user_data)
+static gboolean source_check(GSource *source)
 {
-    tmr_t *t = (tmr_t *)user_data;
+    glib_source_t *src = (glib_source_t *)source;
+    GIOCondition   cond;
 
-    t->cb(t->glue_data, t, t->user_data);
+    cond = g_source_query_unix_fd(source, src->tag);
 
-    return TRUE;
+    return (cond & (G_IO_IN | G_IO_HUP | G_IO_ERR)) ? TRUE : FALSE;
 }
 
 
-static void *add_timer(void *glue_data, unsigned int msecs,
-                       void (*cb)(void *glue_data, void *id, void *user_data),
-                       void *user_data)
+static gboolean source_dispatch(GSource *source, GSourceFunc cb,
+                                gpointer user_data)
 {
-    tmr_t *t;
-
-    t = mrp_allocz(sizeof(*t));
+    glib_source_t *src = (glib_source_t *)source;
 
-    if (t != NULL) {
-        t->gl_t = g_timeout_add(msecs, timer_cb, t);
+    MRP_UNUSED(cb);
+    MRP_UNUSED(user_data);
 
-        if (t->gl_t != 0) {
-            t->cb        = cb;
-            t->user_data = user_data;
-            t->glue_data = glue_data;
+    mrp_mainloop_poll(src->ml, FALSE);
 
-            return t;
-        }
-        else
-            mrp_free(t);
-    }
-
-    return NULL;
+    return mrp_mainloop_dispatch(src->ml) ? TRUE : FALSE;
 }
 
 
-static void del_timer(void *glue_data, void *id)
-{
-    tmr_t *t = (tmr_t *)id;
-
-    MRP_UNUSED(glue_data);
-
-    g_source_remove(t->gl_t);
-    mrp_free(t);
-}
-
-
-static void mod_timer(void *glue_data, void *id, unsigned int msecs)
-{
-    tmr_t  *t = (tmr_t *)id;
-
-    MRP_UNUSED(glue_data);
-
-    if (t != NULL) {
-        g_source_remove(t->gl_t);
-        t->gl_t = g_timeout_add(msecs, timer_cb, t);
-    }
-}
+static GSourceFuncs source_funcs = {
+    .prepare  = source_prepare,
+    .check    = source_check,
+    .dispatch = source_dispatch,
+    .finalize = NULL,
+};
 
 
-static gboolean defer_cb(void *user_data)
+static void *add_source(void *glue_data, mrp_mainloop_t *ml, int fd)
 {
-    dfr_t *d = (dfr_t *)user_data;
-
-    d->cb(d->glue_data, d, d->user_data);
+    glib_glue_t   *glue = (glib_glue_t *)glue_data;
+    GSource       *source;
+    glib_source_t *src;
 
-    return TRUE;
-}
+    source = g_source_new(&source_funcs, sizeof(*src));
 
+    if (source == NULL)
+        return NULL;
 
-static void *add_defer(void *glue_data,
-                       void (*cb)(void *glue_data, void *id, void *user_data),
-                       void *user_data)
-{
-    dfr_t *d;
-
-    d = mrp_allocz(sizeof(*d));
+    src      = (glib_source_t *)source;
+    src->ml  = ml;
+    src->tag = g_source_add_unix_fd(source, fd, G_IO_IN | G_IO_HUP | G_IO_ERR);
 
-    if (d != NULL) {
-        d->gl_t = g_timeout_add(0, defer_cb, d);
+    g_source_set_can_recurse(source, FALSE);
 
-        if (d->gl_t != 0) {
-            d->cb        = cb;
-            d->user_data = user_data;
-            d->glue_data = glue_data;
+    if (g_source_attach(source, g_main_loop_get_context(glue->gml)) != 0)
+        return src;
 
-            return d;
-        }
-        else
-            mrp_free(d);
-    }
+    g_source_unref(source);
 
     return NULL;
 }
 
 
-static void del_defer(void *glue_data, void *id)
+static void del_source(void *glue_data, void *id)
 {
-    dfr_t *d = (dfr_t *)id;
+    GSource *source = (GSource *)id;
 
     MRP_UNUSED(glue_data);
 
-    if (d->gl_t != 0)
-        g_source_remove(d->gl_t);
-
-    mrp_free(d);
-}
-
-
-static void mod_defer(void *glue_data, void *id, int enabled)
-{
-    dfr_t *d = (dfr_t *)id;
-
-    MRP_UNUSED(glue_data);
-
-    if (enabled && !d->gl_t)
-        d->gl_t = g_timeout_add(0, defer_cb, d);
-    else if (!enabled && d->gl_t) {
-        g_source_remove(d->gl_t);
-        d->gl_t = 0;
-    }
+    g_source_destroy(source);
+    g_source_unref(source);
 }
 
 
@@ -304,14 +169,8 @@ static void unregister(void *data)
 
 
 static mrp_superloop_ops_t glib_ops = {
-    .add_io     = add_io,
-    .del_io     = del_io,
-    .add_timer  = add_timer,
-    .del_timer  = del_timer,
-    .mod_timer  = mod_timer,
-    .add_defer  = add_defer,
-    .del_defer  = del_defer,
-    .mod_defer  = mod_defer,
+    .add_source = add_source,
+    .del_source = del_source,
     .unregister = unregister,
 };
 
@@ -571,6 +571,64 @@ static int internal_senddata(mrp_transport_t *mu, void *data, uint16_t tag)
 }
 
 
+static int internal_sendnativeto(mrp_transport_t *mu, void *data,
+                                 uint32_t type_id, mrp_sockaddr_t *addr,
+                                 socklen_t addrlen)
+{
+    internal_t *u = (internal_t *)mu;
+    internal_message_t *msg;
+    void *buf;
+    size_t size;
+
+    /*
+     * The sender keeps ownership of data while the receiver gets to own
+     * (and mrp_free_native) whatever it is handed. Since delivery is also
+     * deferred, we need a private copy of the object. Take it in its
+     * native wire format, it is the cheapest one we can decode from.
+     */
+
+    if (mrp_encode_native(data, type_id, 0, &buf, &size, mu->map) < 0) {
+        mrp_log_error("native data encoding failed");
+        return FALSE;
+    }
+
+    msg = mrp_allocz(sizeof(internal_message_t));
+
+    if (!msg) {
+        mrp_free(buf);
+        return FALSE;
+    }
+
+    msg->addr = addr;
+    msg->addrlen = addrlen;
+    msg->data = buf;
+    msg->free_data = TRUE;
+    msg->offset = 0;
+    msg->size = size;
+    msg->u = u;
+    msg->custom = TRUE;
+    msg->tag = 0;
+
+    mrp_list_init(&msg->hook);
+    mrp_list_append(&msg_queue, &msg->hook);
+
+    mrp_enable_deferred(d);
+
+    return TRUE;
+}
+
+
+static int internal_sendnative(mrp_transport_t *mu, void *data,
+                               uint32_t type_id)
+{
+    if (!mu->connected) {
+        return FALSE;
+    }
+
+    return internal_sendnativeto(mu, data, type_id, NULL, 0);
+}
+
+
 
 
 MRP_REGISTER_TRANSPORT(internal, INTERNAL, internal_t, internal_resolve,
@@ -581,5 +639,5 @@ MRP_REGISTER_TRANSPORT(internal, INTERNAL, internal_t, internal_resolve,
                        internal_sendraw, internal_sendrawto,
                        internal_senddata, internal_senddatato,
                        NULL, NULL,
-                       NULL, NULL,
+                       internal_sendnative, internal_sendnativeto,
                        NULL, NULL);
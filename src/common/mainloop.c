@@ -66,6 +66,21 @@ struct mrp_io_watch_s {
     struct pollfd     *pollfd;                   /* associated pollfd */
     mrp_list_hook_t    slave;                    /* watches with the same fd */
     int                wrhup;                    /* EPOLLHUPs delivered */
+    int                prio;                     /* dispatch priority class */
+    uint32_t           budget;                   /* per-dispatch budget */
+    mrp_list_hook_t    yield;                    /* to list of yielded watches */
+    mrp_io_event_t     yevents;                  /* events to dispatch yielded */
+};
+
+/*
+ * I/O watch dispatch priority classes
+ */
+
+enum {
+    IO_PRIO_HIGH = 0,
+    IO_PRIO_NORMAL,
+    IO_PRIO_LOW,
+    IO_PRIO_MAX
 };
 
 #define is_master(w) !mrp_list_empty(&(w)->hook)
@@ -83,6 +98,7 @@ struct mrp_timer_s {
     mrp_mainloop_t  *ml;                         /* mainloop */
     unsigned int     msecs;                      /* timer interval */
     uint64_t         expire;                     /* next expiration time */
+    unsigned int     slack;                      /* allowed delay, msecs */
     mrp_timer_cb_t   cb;                         /* user callback */
     void            *user_data;                  /* opaque user data */
 };
@@ -261,9 +277,11 @@ struct mrp_mainloop_s {
     mrp_list_hook_t      iowatches;              /* list of I/O watches */
     int                  niowatch;               /* number of I/O watches */
     mrp_io_event_t       iomode;                 /* default event trigger mode */
+    mrp_list_hook_t      yielded;                /* yielded I/O watches */
 
     mrp_list_hook_t      timers;                 /* list of timers */
     mrp_timer_t         *next_timer;             /* next expiring timer */
+    unsigned int         timer_slack;            /* default timer slack */
 
     mrp_list_hook_t      deferred;               /* list of deferred cbs */
     mrp_list_hook_t      inactive_deferred;      /* inactive defferred cbs */
@@ -288,6 +306,7 @@ struct mrp_mainloop_s {
     void                *super_data;             /* superloop glue data */
     void                *iow;                    /* superloop epollfd watch */
     void                *timer;                  /* superloop timer */
+    uint64_t             super_deadline;         /* superloop timer deadline */
     void                *work;                   /* superloop deferred work */
 
     mrp_list_hook_t      busses;                 /* known event busses */
@@ -303,6 +322,7 @@ static MRP_LIST_HOOK   (ewatches);               /* global, synchronous 'bus' */
 
 static void dump_pollfds(const char *prefix, struct pollfd *fds, int nfd);
 static void adjust_superloop_timer(mrp_mainloop_t *ml);
+static void rearm_superloop_timer(mrp_mainloop_t *ml, int timeout);
 static size_t poll_events(void *id, mrp_mainloop_t *ml, void **bufp);
 static void pump_events(mrp_deferred_t *d, void *user_data);
 
@@ -552,12 +572,25 @@ static int free_io_watch(void *ptr)
     }
 
     mrp_list_delete(&w->slave);
+    mrp_list_delete(&w->yield);
     mrp_free(w);
 
     return TRUE;
 }
 
 
+static int io_priority_class(mrp_io_event_t priority, int *prio)
+{
+    switch (priority & MRP_IO_PRIORITY_MASK) {
+    case MRP_IO_PRIORITY_HIGH:   *prio = IO_PRIO_HIGH;   return TRUE;
+    case MRP_IO_PRIORITY_NORMAL: *prio = IO_PRIO_NORMAL; return TRUE;
+    case MRP_IO_PRIORITY_LOW:    *prio = IO_PRIO_LOW;    return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+
 mrp_io_watch_t *mrp_add_io_watch(mrp_mainloop_t *ml, int fd,
                                  mrp_io_event_t events,
                                  mrp_io_watch_cb_t cb, void *user_data)
@@ -571,6 +604,7 @@ mrp_io_watch_t *mrp_add_io_watch(mrp_mainloop_t *ml, int fd,
         mrp_list_init(&w->hook);
         mrp_list_init(&w->deleted);
         mrp_list_init(&w->slave);
+        mrp_list_init(&w->yield);
         w->ml        = ml;
         w->fd        = fd;
         w->events    = events & MRP_IO_EVENT_ALL;
@@ -591,6 +625,12 @@ mrp_io_watch_t *mrp_add_io_watch(mrp_mainloop_t *ml, int fd,
             break;
         }
 
+        if (!io_priority_class(events, &w->prio)) {
+            mrp_log_warning("Invalid I/O watch priority 0x%x.",
+                            events & MRP_IO_PRIORITY_MASK);
+            w->prio = IO_PRIO_NORMAL;
+        }
+
         w->cb        = cb;
         w->user_data = user_data;
         w->free      = free_io_watch;
@@ -620,7 +660,9 @@ void mrp_del_io_watch(mrp_io_watch_t *w)
         mrp_debug("marking I/O watch %p (fd %d) deleted", w, w->fd);
 
         mark_deleted(w);
-        w->events = 0;
+        w->events  = 0;
+        w->yevents = 0;
+        mrp_list_delete(&w->yield);
 
         epoll_del(w);
     }
@@ -633,6 +675,47 @@ mrp_mainloop_t *mrp_get_io_watch_mainloop(mrp_io_watch_t *w)
 }
 
 
+int mrp_set_io_watch_priority(mrp_io_watch_t *w, mrp_io_event_t priority)
+{
+    if (w == NULL || is_deleted(w))
+        return FALSE;
+
+    if (!io_priority_class(priority, &w->prio)) {
+        mrp_log_error("Invalid I/O watch priority 0x%x.", priority);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+void mrp_set_io_watch_budget(mrp_io_watch_t *w, uint32_t budget)
+{
+    if (w != NULL)
+        w->budget = budget;
+}
+
+
+uint32_t mrp_get_io_watch_budget(mrp_io_watch_t *w)
+{
+    return w ? w->budget : 0;
+}
+
+
+void mrp_yield_io_watch(mrp_io_watch_t *w, mrp_io_event_t events)
+{
+    if (w == NULL || is_deleted(w))
+        return;
+
+    w->yevents |= events & (MRP_IO_EVENT_ALL | MRP_IO_EVENT_WRHUP);
+
+    if (mrp_list_empty(&w->yield)) {
+        mrp_debug("I/O watch %p (fd %d) yielded", w, w->fd);
+        mrp_list_append(&w->ml->yielded, &w->yield);
+    }
+}
+
+
 int mrp_set_io_event_mode(mrp_mainloop_t *ml, mrp_io_event_t mode)
 {
     if (mode == MRP_IO_TRIGGER_LEVEL || mode == MRP_IO_TRIGGER_EDGE) {
@@ -759,8 +842,63 @@ static int free_timer(void *ptr)
 
 
 
+static inline uint64_t timer_latest(mrp_timer_t *t)
+{
+    unsigned int slack;
+
+    slack = t->slack != MRP_TIMER_SLACK_DEFAULT ? t->slack : t->ml->timer_slack;
+
+    return t->expire + (uint64_t)slack * USECS_PER_MSEC;
+}
+
+
+static uint64_t next_timer_wakeup(mrp_mainloop_t *ml)
+{
+    mrp_list_hook_t *p, *n;
+    mrp_timer_t     *t;
+    uint64_t         wakeup, latest;
+
+    /*
+     * Notes:
+     *     We need to wake up by the earliest latest allowed firing time
+     *     of all timers. The list is sorted by expiration time, so any
+     *     timer expiring after the best wakeup found so far can't give
+     *     us an earlier one and we can stop looking there. Without any
+     *     slack this is just the first live timer.
+     */
+
+    wakeup = UINT64_MAX;
+
+    mrp_list_foreach(&ml->timers, p, n) {
+        t = mrp_list_entry(p, typeof(*t), hook);
+
+        if (is_deleted(t))
+            continue;
+
+        if (t->expire >= wakeup)
+            break;
+
+        latest = timer_latest(t);
+
+        if (latest < wakeup)
+            wakeup = latest;
+    }
+
+    return wakeup;
+}
+
+
 mrp_timer_t *mrp_add_timer(mrp_mainloop_t *ml, unsigned int msecs,
                            mrp_timer_cb_t cb, void *user_data)
+{
+    return mrp_add_timer_full(ml, msecs, MRP_TIMER_SLACK_DEFAULT,
+                              cb, user_data);
+}
+
+
+mrp_timer_t *mrp_add_timer_full(mrp_mainloop_t *ml, unsigned int msecs,
+                                unsigned int slack, mrp_timer_cb_t cb,
+                                void *user_data)
 {
     mrp_timer_t *t;
 
@@ -773,6 +911,7 @@ mrp_timer_t *mrp_add_timer(mrp_mainloop_t *ml, unsigned int msecs,
         t->ml        = ml;
         t->expire    = time_now() + msecs * USECS_PER_MSEC;
         t->msecs     = msecs;
+        t->slack     = slack;
         t->cb        = cb;
         t->user_data = user_data;
         t->free      = free_timer;
@@ -795,6 +934,40 @@ void mrp_mod_timer(mrp_timer_t *t, unsigned int msecs)
 }
 
 
+void mrp_set_timer_slack(mrp_timer_t *t, unsigned int slack)
+{
+    if (t != NULL && !is_deleted(t)) {
+        t->slack = slack;
+        adjust_superloop_timer(t->ml);
+    }
+}
+
+
+unsigned int mrp_get_timer_slack(mrp_timer_t *t)
+{
+    if (t == NULL)
+        return 0;
+
+    return t->slack != MRP_TIMER_SLACK_DEFAULT ? t->slack : t->ml->timer_slack;
+}
+
+
+void mrp_set_timer_default_slack(mrp_mainloop_t *ml, unsigned int slack)
+{
+    if (slack == MRP_TIMER_SLACK_DEFAULT)
+        slack = 0;
+
+    ml->timer_slack = slack;
+    adjust_superloop_timer(ml);
+}
+
+
+unsigned int mrp_get_timer_default_slack(mrp_mainloop_t *ml)
+{
+    return ml->timer_slack;
+}
+
+
 void mrp_del_timer(mrp_timer_t *t)
 {
     /*
@@ -937,6 +1110,8 @@ static void dispatch_signals(mrp_io_watch_t *w, int fd,
 
 static int setup_sighandlers(mrp_mainloop_t *ml)
 {
+    mrp_io_event_t events;
+
     if (ml->sigfd == -1) {
         sigemptyset(&ml->sigmask);
 
@@ -945,7 +1120,8 @@ static int setup_sighandlers(mrp_mainloop_t *ml)
         if (ml->sigfd == -1)
             return FALSE;
 
-        ml->sigwatch = mrp_add_io_watch(ml, ml->sigfd, MRP_IO_EVENT_IN,
+        events       = MRP_IO_EVENT_IN | MRP_IO_PRIORITY_HIGH;
+        ml->sigwatch = mrp_add_io_watch(ml, ml->sigfd, events,
                                         dispatch_signals, NULL);
 
         if (ml->sigwatch == NULL) {
@@ -1253,6 +1429,7 @@ static void super_timer_cb(void *super_data, void *id, void *user_data)
     MRP_UNUSED(super_data);
     MRP_UNUSED(id);
 
+    ml->super_deadline = 0;
     ops->mod_defer(ml->super_data, ml->work, TRUE);
 }
 
@@ -1287,7 +1464,7 @@ static void super_work_cb(void *super_data, void *id, void *user_data)
          */
 
         timeout = mrp_list_empty(&ml->deferred) ? ml->poll_timeout : 0;
-        ops->mod_timer(ml->super_data, ml->timer, timeout);
+        rearm_superloop_timer(ml, timeout);
         ops->mod_defer(ml->super_data, ml->work, FALSE);
     }
     else {
@@ -1302,6 +1479,34 @@ static void super_work_cb(void *super_data, void *id, void *user_data)
 }
 
 
+static void rearm_superloop_timer(mrp_mainloop_t *ml, int timeout)
+{
+    mrp_superloop_ops_t *ops = ml->super_ops;
+    uint64_t             deadline;
+
+    /*
+     * Notes:
+     *
+     *     Restarting a timer is not free for most superloops (for
+     *     instance, with glib it used to mean destroying and allocating
+     *     a GSource). Since we get here on every iteration, avoid the
+     *     restart if our next deadline has not changed since we last
+     *     armed the timer.
+     */
+
+    if (timeout < 0)
+        deadline = UINT64_MAX;
+    else
+        deadline = time_now() / USECS_PER_MSEC + timeout;
+
+    if (deadline == ml->super_deadline)
+        return;
+
+    ml->super_deadline = deadline;
+    ops->mod_timer(ml->super_data, ml->timer, timeout);
+}
+
+
 static void adjust_superloop_timer(mrp_mainloop_t *ml)
 {
     mrp_superloop_ops_t *ops = ml->super_ops;
@@ -1310,9 +1515,15 @@ static void adjust_superloop_timer(mrp_mainloop_t *ml)
     if (ops == NULL)
         return;
 
+    if (ops->add_source != NULL) {
+        if (ops->mod_source != NULL && ml->iow != NULL)
+            ops->mod_source(ml->super_data, ml->iow);
+        return;
+    }
+
     mrp_mainloop_prepare(ml);
     timeout = mrp_list_empty(&ml->deferred) ? ml->poll_timeout : 0;
-    ops->mod_timer(ml->super_data, ml->timer, timeout);
+    rearm_superloop_timer(ml, timeout);
 }
 
 
@@ -1329,6 +1540,16 @@ int mrp_set_superloop(mrp_mainloop_t *ml, mrp_superloop_ops_t *ops,
         ml->super_ops  = ops;
         ml->super_data = loop_data;
 
+        if (ops->add_source != NULL) {
+            ml->iow = ops->add_source(ml->super_data, ml, ml->epollfd);
+
+            if (ml->iow != NULL)
+                return TRUE;
+
+            mrp_clear_superloop(ml);
+            return FALSE;
+        }
+
         mrp_mainloop_prepare(ml);
 
         events    = MRP_IO_EVENT_IN | MRP_IO_EVENT_OUT | MRP_IO_EVENT_HUP;
@@ -1352,6 +1573,8 @@ int mrp_set_superloop(mrp_mainloop_t *ml, mrp_superloop_ops_t *ops,
 
         timeout   = mrp_list_empty(&ml->deferred) ? ml->poll_timeout : 0;
         ml->timer = ops->add_timer(ml->super_data, timeout, super_timer_cb, ml);
+        ml->super_deadline = timeout < 0 ?
+            UINT64_MAX : time_now() / USECS_PER_MSEC + timeout;
 
         if (ml->iow != NULL && ml->timer != NULL && ml->work != NULL)
             return TRUE;
@@ -1370,7 +1593,10 @@ int mrp_clear_superloop(mrp_mainloop_t *ml)
 
     if (ops != NULL) {
         if (ml->iow != NULL) {
-            ops->del_io(data, ml->iow);
+            if (ops->del_source != NULL)
+                ops->del_source(data, ml->iow);
+            else
+                ops->del_io(data, ml->iow);
             ml->iow = NULL;
         }
 
@@ -1384,8 +1610,9 @@ int mrp_clear_superloop(mrp_mainloop_t *ml)
             ml->timer = NULL;
         }
 
-        ml->super_ops  = NULL;
-        ml->super_data = NULL;
+        ml->super_ops      = NULL;
+        ml->super_data     = NULL;
+        ml->super_deadline = 0;
 
         ops->unregister(data);
 
@@ -1415,10 +1642,12 @@ static void purge_io_watches(mrp_mainloop_t *ml)
         w = mrp_list_entry(p, typeof(*w), hook);
         mrp_list_delete(&w->hook);
         mrp_list_delete(&w->deleted);
+        mrp_list_delete(&w->yield);
 
         mrp_list_foreach(&w->slave, sp, sn) {
             s = mrp_list_entry(sp, typeof(*s), slave);
             mrp_list_delete(&s->slave);
+            mrp_list_delete(&s->yield);
             mrp_free(s);
         }
 
@@ -1539,6 +1768,7 @@ mrp_mainloop_t *mrp_mainloop_create(void)
 
         if (ml->epollfd >= 0 && ml->fdtbl != NULL) {
             mrp_list_init(&ml->iowatches);
+            mrp_list_init(&ml->yielded);
             mrp_list_init(&ml->timers);
             mrp_list_init(&ml->deferred);
             mrp_list_init(&ml->inactive_deferred);
@@ -1797,24 +2027,25 @@ static inline void dump_timers(mrp_mainloop_t *ml)
 
 int mrp_mainloop_prepare(mrp_mainloop_t *ml)
 {
-    mrp_timer_t *next_timer;
     int          timeout, ext_timeout;
-    uint64_t     now;
+    uint64_t     now, wakeup;
 
-    if (!mrp_list_empty(&ml->deferred)) {
+    if (!mrp_list_empty(&ml->deferred) || !mrp_list_empty(&ml->yielded)) {
         timeout = 0;
     }
     else {
-        next_timer = ml->next_timer;
-
-        if (next_timer == NULL)
+        if (ml->next_timer == NULL)
             timeout = -1;
         else {
-            now = time_now();
-            if (MRP_UNLIKELY(next_timer->expire <= now))
+            now    = time_now();
+            wakeup = next_timer_wakeup(ml);
+
+            if (MRP_UNLIKELY(wakeup == UINT64_MAX))
+                timeout = -1;
+            else if (MRP_UNLIKELY(wakeup <= now))
                 timeout = 0;
             else
-                timeout = usecs_to_msecs(next_timer->expire - now);
+                timeout = usecs_to_msecs(wakeup - now);
         }
     }
 
@@ -1841,6 +2072,12 @@ int mrp_mainloop_prepare(mrp_mainloop_t *ml)
 }
 
 
+int mrp_mainloop_get_timeout(mrp_mainloop_t *ml)
+{
+    return ml->poll_timeout;
+}
+
+
 static size_t poll_events(void *id, mrp_mainloop_t *ml, void **bufp)
 {
     void *buf;
@@ -1873,7 +2110,8 @@ int mrp_mainloop_poll(mrp_mainloop_t *ml, int may_block)
 {
     int n, timeout;
 
-    timeout = may_block && mrp_list_empty(&ml->deferred) ? ml->poll_timeout : 0;
+    timeout = may_block && mrp_list_empty(&ml->deferred) &&
+        mrp_list_empty(&ml->yielded) ? ml->poll_timeout : 0;
 
     if (ml->nevent > 0) {
         if (ml->super_ops == NULL || ml->super_ops->poll_io == NULL) {
@@ -2075,6 +2313,45 @@ static void dispatch_subloops(mrp_mainloop_t *ml)
 }
 
 
+static void dispatch_io_watch(mrp_io_watch_t *w, mrp_io_event_t events)
+{
+    /*
+     * Notes:
+     *     A watch which has yielded and is waiting to be dispatched
+     *     in a lower or the current priority class only gets these
+     *     events merged to its pending ones. This way it never gets
+     *     called twice within the same iteration.
+     */
+
+    if (!mrp_list_empty(&w->yield)) {
+        mrp_debug("merging events 0x%x to yielded I/O watch %p (fd %d)",
+                  events, w, w->fd);
+        w->yevents |= events;
+    }
+    else
+        w->cb(w, w->fd, events, w->user_data);
+}
+
+
+static int io_event_class(mrp_io_watch_t *w)
+{
+    mrp_list_hook_t *p, *n;
+    mrp_io_watch_t  *s;
+    int              prio;
+
+    prio = w->prio;
+
+    mrp_list_foreach(&w->slave, p, n) {
+        s = mrp_list_entry(p, typeof(*s), slave);
+
+        if (s->prio < prio)
+            prio = s->prio;
+    }
+
+    return prio;
+}
+
+
 static void dispatch_slaves(mrp_io_watch_t *w, struct epoll_event *e)
 {
     mrp_io_watch_t  *s;
@@ -2091,7 +2368,7 @@ static void dispatch_slaves(mrp_io_watch_t *w, struct epoll_event *e)
 
         if (!is_deleted(s)) {
             mrp_debug("dispatching slave I/O watch %p (fd %d)", s, s->fd);
-            s->cb(s, s->fd, events, s->user_data);
+            dispatch_io_watch(s, events);
         }
         else
             mrp_debug("skipping slave I/O watch %p (fd %d)", s, s->fd);
@@ -2101,70 +2378,143 @@ static void dispatch_slaves(mrp_io_watch_t *w, struct epoll_event *e)
 }
 
 
-static void dispatch_poll_events(mrp_mainloop_t *ml)
+static void dispatch_epoll_event(mrp_mainloop_t *ml, struct epoll_event *e,
+                                 mrp_io_watch_t *w)
 {
-    struct epoll_event *e;
-    mrp_io_watch_t     *w, *tblw;
-    int                 i, fd;
+    mrp_io_watch_t *tblw;
+    int             fd;
 
-    for (i = 0, e = ml->events; i < ml->poll_result; i++, e++) {
-        fd = e->data.fd;
-        w  = fdtbl_lookup(ml->fdtbl, fd);
+    fd = w->fd;
 
-        if (w == NULL) {
-            mrp_debug("ignoring event for deleted fd %d", fd);
-            continue;
+    if (!is_deleted(w)) {
+        mrp_debug("dispatching I/O watch %p (fd %d)", w, fd);
+        dispatch_io_watch(w, e->events);
+    }
+    else
+        mrp_debug("skipping deleted I/O watch %p (fd %d)", w, fd);
+
+    if (!mrp_list_empty(&w->slave))
+        dispatch_slaves(w, e);
+
+    if (e->events & EPOLLRDHUP) {
+        tblw = fdtbl_lookup(ml->fdtbl, w->fd);
+
+        if (tblw == w) {
+            mrp_debug("forcibly stop polling fd %d for watch %p", w->fd, w);
+            epoll_del(w);
+        }
+        else if (tblw != NULL)
+            mrp_debug("don't stop polling reused fd %d of watch %p",
+                      w->fd, w);
+    }
+    else {
+        if ((e->events & EPOLLHUP) && !is_deleted(w)) {
+            /*
+             * Notes:
+             *
+             *    If the user does not react to EPOLLHUPs delivered
+             *    we stop monitoring the fd to avoid sitting in an
+             *    infinite busy loop just delivering more EPOLLHUP
+             *    notifications...
+             */
+
+            if (w->wrhup++ > 5) {
+                tblw = fdtbl_lookup(ml->fdtbl, w->fd);
+
+                if (tblw == w) {
+                    mrp_debug("forcibly stop polling fd %d for watch %p",
+                              w->fd, w);
+                    epoll_del(w);
+                }
+                else if (tblw != NULL)
+                    mrp_debug("don't stop polling reused fd %d of watch %p",
+                              w->fd, w);
+            }
         }
+    }
+}
+
+
+static void dispatch_yielded(mrp_mainloop_t *ml, mrp_list_hook_t *yielded)
+{
+    mrp_io_watch_t *w;
+    mrp_io_event_t  events;
+
+    while (!mrp_list_empty(yielded) && !ml->quit) {
+        w = mrp_list_entry(yielded->next, typeof(*w), yield);
+        mrp_list_delete(&w->yield);
+
+        events     = w->yevents;
+        w->yevents = 0;
 
         if (!is_deleted(w)) {
-            mrp_debug("dispatching I/O watch %p (fd %d)", w, fd);
-            w->cb(w, w->fd, e->events, w->user_data);
+            mrp_debug("dispatching yielded I/O watch %p (fd %d)", w, w->fd);
+            w->cb(w, w->fd, events, w->user_data);
         }
-        else
-            mrp_debug("skipping deleted I/O watch %p (fd %d)", w, fd);
+    }
+}
+
 
-        if (!mrp_list_empty(&w->slave))
-            dispatch_slaves(w, e);
+static void dispatch_poll_events(mrp_mainloop_t *ml)
+{
+    mrp_list_hook_t     yielded[IO_PRIO_MAX], *p, *n;
+    struct epoll_event *e;
+    mrp_io_watch_t     *w;
+    int                 prio, i, fd;
 
-        if (e->events & EPOLLRDHUP) {
-            tblw = fdtbl_lookup(ml->fdtbl, w->fd);
+    /*
+     * Notes:
+     *     Events are dispatched in priority class order. Within a class
+     *     fresh epoll events are dispatched first, followed by watches
+     *     which yielded in the previous iteration. Watches yielding now
+     *     end up on ml->yielded and only get dispatched the next time
+     *     around, so a callback can't monopolize a single iteration.
+     */
 
-            if (tblw == w) {
-                mrp_debug("forcibly stop polling fd %d for watch %p", w->fd, w);
-                epoll_del(w);
-            }
-            else if (tblw != NULL)
-                mrp_debug("don't stop polling reused fd %d of watch %p",
-                          w->fd, w);
-        }
-        else {
-            if ((e->events & EPOLLHUP) && !is_deleted(w)) {
-                /*
-                 * Notes:
-                 *
-                 *    If the user does not react to EPOLLHUPs delivered
-                 *    we stop monitoring the fd to avoid sitting in an
-                 *    infinite busy loop just delivering more EPOLLHUP
-                 *    notifications...
-                 */
-
-                if (w->wrhup++ > 5) {
-                    tblw = fdtbl_lookup(ml->fdtbl, w->fd);
-
-                    if (tblw == w) {
-                        mrp_debug("forcibly stop polling fd %d for watch %p",
-                                  w->fd, w);
-                        epoll_del(w);
-                    }
-                    else if (tblw != NULL)
-                        mrp_debug("don't stop polling reused fd %d of watch %p",
-                                  w->fd, w);
-                }
+    for (prio = 0; prio < IO_PRIO_MAX; prio++)
+        mrp_list_init(yielded + prio);
+
+    mrp_list_foreach(&ml->yielded, p, n) {
+        w = mrp_list_entry(p, typeof(*w), yield);
+        mrp_list_delete(&w->yield);
+        mrp_list_append(yielded + w->prio, &w->yield);
+    }
+
+    for (prio = 0; prio < IO_PRIO_MAX && !ml->quit; prio++) {
+        for (i = 0, e = ml->events; i < ml->poll_result; i++, e++) {
+            fd = e->data.fd;
+
+            if (fd < 0)
+                continue;
+
+            w = fdtbl_lookup(ml->fdtbl, fd);
+
+            if (w == NULL) {
+                mrp_debug("ignoring event for deleted fd %d", fd);
+                e->data.fd = -1;
+                continue;
             }
+
+            if (io_event_class(w) != prio)
+                continue;
+
+            e->data.fd = -1;
+            dispatch_epoll_event(ml, e, w);
+
+            if (ml->quit)
+                break;
         }
 
-        if (ml->quit)
-            break;
+        dispatch_yielded(ml, yielded + prio);
+    }
+
+    /* put back anything left undispatched if we're quitting */
+    for (prio = 0; prio < IO_PRIO_MAX; prio++) {
+        mrp_list_foreach(yielded + prio, p, n) {
+            w = mrp_list_entry(p, typeof(*w), yield);
+            mrp_list_delete(&w->yield);
+            mrp_list_append(&ml->yielded, &w->yield);
+        }
     }
 
     if (ml->quit)
@@ -149,7 +149,12 @@ typedef enum {
     /* event trigger modes */
     MRP_IO_TRIGGER_LEVEL = 0x1U << 25,
     MRP_IO_TRIGGER_EDGE  = EPOLLET,
-    MRP_IO_TRIGGER_MASK  = MRP_IO_TRIGGER_LEVEL|MRP_IO_TRIGGER_EDGE
+    MRP_IO_TRIGGER_MASK  = MRP_IO_TRIGGER_LEVEL|MRP_IO_TRIGGER_EDGE,
+    /* dispatch priority classes */
+    MRP_IO_PRIORITY_HIGH   = 0x1U << 26,
+    MRP_IO_PRIORITY_NORMAL = 0x0,
+    MRP_IO_PRIORITY_LOW    = 0x1U << 27,
+    MRP_IO_PRIORITY_MASK   = MRP_IO_PRIORITY_HIGH|MRP_IO_PRIORITY_LOW
 } mrp_io_event_t;
 
 /**
@@ -171,7 +176,12 @@ typedef void (*mrp_io_watch_cb_t)(mrp_io_watch_t *w, int fd,
  * @brief Register a new file descriptor to watch.
  *
  * Creates an I/O watch for the given file descriptor and the specified set
- * (bitmask) of events.
+ * (bitmask) of events. The events can be or'd with one of the priority
+ * classes @MRP_IO_PRIORITY_HIGH or @MRP_IO_PRIORITY_LOW. Within a single
+ * mainloop iteration all pending high priority watches are dispatched
+ * before normal priority ones which in turn are dispatched before low
+ * priority ones. If several watches share a file descriptor, the events
+ * for that descriptor are dispatched in the highest class among them.
  *
  * @param [in] ml         mainloop to add I/O watch to
  * @param [in] fd         file descriptor to watch
@@ -207,6 +217,56 @@ void mrp_del_io_watch(mrp_io_watch_t *w);
  */
 mrp_mainloop_t *mrp_get_io_watch_mainloop(mrp_io_watch_t *w);
 
+/**
+ * @brief Change the dispatch priority class of an I/O watch.
+ *
+ * @param [in] w         I/O watch to change the priority of
+ * @param [in] priority  @MRP_IO_PRIORITY_HIGH, @MRP_IO_PRIORITY_NORMAL,
+ *                       or @MRP_IO_PRIORITY_LOW
+ *
+ * @return Returns @TRUE upon success, @FALSE otherwise.
+ */
+int mrp_set_io_watch_priority(mrp_io_watch_t *w, mrp_io_event_t priority);
+
+/**
+ * @brief Set the per-dispatch budget of an I/O watch.
+ *
+ * The budget is an advisory limit on the amount of work (for instance
+ * messages processed) the callback of the watch should do for a single
+ * dispatch. The mainloop itself only stores it, enforcing it is up to
+ * the callback, which can use @mrp_yield_io_watch to get called again
+ * with the rest of the work in the next iteration.
+ *
+ * @param [in] w       I/O watch to set the budget for
+ * @param [in] budget  budget to set, 0 for unlimited
+ */
+void mrp_set_io_watch_budget(mrp_io_watch_t *w, uint32_t budget);
+
+/**
+ * @brief Get the per-dispatch budget of an I/O watch.
+ *
+ * @param [in] w  I/O watch to get the budget for
+ *
+ * @return Returns the budget of @w, 0 meaning unlimited.
+ */
+uint32_t mrp_get_io_watch_budget(mrp_io_watch_t *w);
+
+/**
+ * @brief Yield an I/O watch to the next mainloop iteration.
+ *
+ * Re-queue the watch to be dispatched again with the given events in
+ * the next mainloop iteration, regardless of whether its file descriptor
+ * gets any new events. This lets a callback which has used up its budget
+ * return while it still has buffered input without losing readiness. Any
+ * events delivered for the descriptor in the meantime are merged into the
+ * yielded ones. While a watch has yielded the mainloop will not block in
+ * poll. Typically called from the callback of the watch itself.
+ *
+ * @param [in] w       I/O watch to yield
+ * @param [in] events  events to dispatch the watch with next time
+ */
+void mrp_yield_io_watch(mrp_io_watch_t *w, mrp_io_event_t events);
+
 /**
  * @brief Sets the default I/O watch trigger mode for the mainloop.
  *
@@ -242,6 +302,10 @@ mrp_io_event_t mrp_get_io_event_mode(mrp_mainloop_t *ml);
 #define mrp_io_watch_add mrp_add_io_watch
 #define mrp_io_watch_del mrp_del_io_watch
 #define mrp_io_watch_get_mainloop mrp_get_io_watch_mainloop
+#define mrp_io_watch_set_priority mrp_set_io_watch_priority
+#define mrp_io_watch_set_budget mrp_set_io_watch_budget
+#define mrp_io_watch_get_budget mrp_get_io_watch_budget
+#define mrp_io_watch_yield mrp_yield_io_watch
 #define mrp_io_event_mode_set mrp_set_io_event_mode
 #define mrp_io_event_mode_get mrp_get_io_event_mode
 
@@ -258,6 +322,13 @@ mrp_io_event_t mrp_get_io_event_mode(mrp_mainloop_t *ml);
  *
  * Timers can be dynamically stopped and restarted and the timer interval can
  * be dynamically changed. The timer interval resolution is 1 millisecond.
+ *
+ * Timers can also be given a slack, an amount of time by which the mainloop
+ * is allowed to delay triggering the timer. A timer is never triggered
+ * before its nominal expiration time. The mainloop wakes up at the latest
+ * allowed time of the most urgent timer and triggers all timers which have
+ * expired by then. This lets timers with nearby expiration times share a
+ * single wakeup.
  */
 
 /**
@@ -291,6 +362,69 @@ typedef void (*mrp_timer_cb_t)(mrp_timer_t *t, void *user_data);
 mrp_timer_t *mrp_add_timer(mrp_mainloop_t *ml, unsigned int msecs,
                            mrp_timer_cb_t cb, void *user_data);
 
+/**
+ * @brief Create a new Murphy timer with the given slack.
+ *
+ * Create a new timer like @mrp_add_timer does, but allow the mainloop to
+ * delay triggering the timer by at most @slack milliseconds if that lets
+ * it handle several timers with a single wakeup. Timers created with
+ * @mrp_add_timer use the default slack of their mainloop.
+ *
+ * @param [in] ml         mainloop to add the timer to
+ * @param [in] msecs      timer interval, trigger @cb this often
+ * @param [in] slack      allowed delay, or @MRP_TIMER_SLACK_DEFAULT
+ * @param [in] cb         callback to trigger
+ * @param [in] user_data  opaque user data to pass to @cb
+ *
+ * @return Returns the newly created timer, or @NULL upon failure.
+ */
+mrp_timer_t *mrp_add_timer_full(mrp_mainloop_t *ml, unsigned int msecs,
+                                unsigned int slack, mrp_timer_cb_t cb,
+                                void *user_data);
+
+/**
+ * @brief Macro to use the default mainloop slack for a timer.
+ */
+#define MRP_TIMER_SLACK_DEFAULT (unsigned int)-1
+
+/**
+ * @brief Set the slack of the given timer.
+ *
+ * @param [in] t      timer to set slack for
+ * @param [in] slack  allowed delay in milliseconds, or
+ *                    @MRP_TIMER_SLACK_DEFAULT to use the mainloop default
+ */
+void mrp_set_timer_slack(mrp_timer_t *t, unsigned int slack);
+
+/**
+ * @brief Get the effective slack of the given timer.
+ *
+ * @param [in] t  timer to get slack for
+ *
+ * @return Returns the slack of @t in milliseconds.
+ */
+unsigned int mrp_get_timer_slack(mrp_timer_t *t);
+
+/**
+ * @brief Set the default timer slack for the given mainloop.
+ *
+ * Sets the slack used by all timers of @ml which have not been given an
+ * explicit one. The default slack is initially 0.
+ *
+ * @param [in] ml     mainloop to set default slack for
+ * @param [in] slack  default slack in milliseconds
+ */
+void mrp_set_timer_default_slack(mrp_mainloop_t *ml, unsigned int slack);
+
+/**
+ * @brief Get the default timer slack of the given mainloop.
+ *
+ * @param [in] ml  mainloop to get default slack for
+ *
+ * @return Returns the default timer slack of @ml in milliseconds.
+ */
+unsigned int mrp_get_timer_default_slack(mrp_mainloop_t *ml);
+
 /**
  * @brief Modify the interval of the given timer.
  *
@@ -340,6 +474,9 @@ mrp_mainloop_t *mrp_get_timer_mainloop(mrp_timer_t *t);
 #define mrp_timer_del mrp_del_timer
 #define mrp_timer_mod mrp_mod_timer
 #define mrp_timer_get_mainloop mrp_get_timer_mainloop
+#define mrp_timer_add_full mrp_add_timer_full
+#define mrp_timer_set_slack mrp_set_timer_slack
+#define mrp_timer_get_slack mrp_get_timer_slack
 
 
 /**
@@ -784,6 +921,29 @@ typedef struct {
      */
     size_t (*poll_events)(void *id, mrp_mainloop_t *ml, void **events);
     size_t (*poll_io)(void *glue_data, void *id, void *buf, size_t size);
+
+    /*
+     * Notes:
+     *
+     *     Superloops which can natively wrap our prepare-poll-dispatch
+     *     cycle around our epoll fd (for instance GMainLoop with a custom
+     *     GSource) should provide add_source and del_source instead of the
+     *     generic I/O watch, timer and deferred callback primitives above.
+     *     In that case we only ask for a single event source and never
+     *     rearm it from our side. The source is expected to call
+     *     mrp_mainloop_prepare, mrp_mainloop_poll and mrp_mainloop_dispatch
+     *     itself and use mrp_mainloop_get_timeout to calculate its next
+     *     wakeup deadline.
+     *
+     *     mod_source is called whenever our next deadline might have
+     *     changed outside of the sources own dispatch cycle, for instance
+     *     when a timer is added from a superloop callback. It can be left
+     *     NULL if the superloop always prepares its sources before going
+     *     to sleep.
+     */
+    void *(*add_source)(void *glue_data, mrp_mainloop_t *ml, int fd);
+    void  (*mod_source)(void *glue_data, void *id);
+    void  (*del_source)(void *glue_data, void *id);
 } mrp_superloop_ops_t;
 
 /**
@@ -880,6 +1040,21 @@ int mrp_mainloop_run(mrp_mainloop_t *ml);
  */
 int mrp_mainloop_prepare(mrp_mainloop_t *ml);
 
+/**
+ * @brief Get the poll timeout of a prepared mainloop.
+ *
+ * Get the timeout the given mainloop would block for in its next poll, as
+ * calculated by the last call to @mrp_mainloop_prepare. This is primarily
+ * meant for superloop glue code which drives the prepare-poll-dispatch cycle
+ * of a mainloop natively.
+ *
+ * @param [in] ml  mainloop to query
+ *
+ * @return Returns the poll timeout in milliseconds, or -1 if the mainloop
+ *         would block indefinitely.
+ */
+int mrp_mainloop_get_timeout(mrp_mainloop_t *ml);
+
 /**
  * @brief Poll a mainloop.
  *
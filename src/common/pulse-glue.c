@@ -42,248 +42,161 @@ typedef struct {
 } pulse_glue_t;
 
 
-typedef struct {
-    pa_io_event  *pa_io;
-    void        (*cb)(void *glue_data,
-                      void *id, int fd, mrp_io_event_t events,
-                      void *user_data);
-    void         *user_data;
-    void         *glue_data;
-} io_t;
-
-
-typedef struct {
-    pa_time_event  *pa_t;
-    void          (*cb)(void *glue_data, void *id, void *user_data);
-    void           *user_data;
-    void           *glue_data;
-} tmr_t;
-
+/*
+ * Notes:
+ *
+ *     The PulseAudio mainloop API has no notion of prepare/check hooks,
+ *     so we cannot wrap our prepare-poll-dispatch cycle into a single
+ *     native source the way we do with glib. Instead, we pump our mainloop
+ *     from a single I/O event for our epoll fd and a single one-shot time
+ *     event for our next deadline. We dispatch directly from these events
+ *     (no deferred events which PulseAudio would starve everything else
+ *     for) and we only restart the time event if our deadline has actually
+ *     changed since it was last armed.
+ */
 
 typedef struct {
-    pa_defer_event  *pa_d;
-    void           (*cb)(void *glue_data, void *id, void *user_data);
-    void            *user_data;
-    void            *glue_data;
-} dfr_t;
-
-
-static void *add_io(void *glue_data, int fd, mrp_io_event_t events,
-                    void (*cb)(void *glue_data, void *id, int fd,
-                               mrp_io_event_t events, void *user_data),
-                    void *user_data);
-static void  del_io(void *glue_data, void *id);
-
-static void *add_timer(void *glue_data, unsigned int msecs,
-                       void (*cb)(void *glue_data, void *id, void *user_data),
-                       void *user_data);
-static void  del_timer(void *glue_data, void *id);
-static void  mod_timer(void *glue_data, void *id, unsigned int msecs);
+    pulse_glue_t    *glue;                   /* pulse glue */
+    mrp_mainloop_t  *ml;                     /* murphy mainloop we pump */
+    pa_io_event     *pa_io;                  /* I/O event for our epoll fd */
+    pa_time_event   *pa_t;                   /* time event for our deadline */
+    pa_usec_t        deadline;               /* armed deadline (msec), or 0 */
+    int              busy;                   /* whether dispatching */
+} src_t;
 
-static void *add_defer(void *glue_data,
-                       void (*cb)(void *glue_data, void *id, void *user_data),
-                       void *user_data);
-static void  del_defer(void *glue_data, void *id);
-static void  mod_defer(void *glue_data, void *id, int enabled);
 
-
-static void io_cb(pa_mainloop_api *pa, pa_io_event *e, int fd,
-                  pa_io_event_flags_t mask, void *user_data)
+static void rearm_source(src_t *src)
 {
-    io_t           *io     = (io_t *)user_data;
-    mrp_io_event_t  events = MRP_IO_EVENT_NONE;
+    pa_mainloop_api *pa = src->glue->pa;
+    struct timeval   tv;
+    pa_usec_t        deadline;
+    int              msecs;
 
-    MRP_UNUSED(pa);
-    MRP_UNUSED(e);
+    mrp_mainloop_prepare(src->ml);
+    msecs = mrp_mainloop_get_timeout(src->ml);
 
-    if (mask & PA_IO_EVENT_INPUT)  events |= MRP_IO_EVENT_IN;
-    if (mask & PA_IO_EVENT_OUTPUT) events |= MRP_IO_EVENT_OUT;
-    if (mask & PA_IO_EVENT_HANGUP) events |= MRP_IO_EVENT_HUP;
-    if (mask & PA_IO_EVENT_ERROR)  events |= MRP_IO_EVENT_ERR;
+    if (msecs < 0) {
+        if (src->deadline != 0) {
+            pa->time_restart(src->pa_t, NULL);
+            src->deadline = 0;
+        }
+        return;
+    }
 
-    io->cb(io->glue_data, io, fd, events, io->user_data);
+    pa_gettimeofday(&tv);
+    pa_timeval_add(&tv, (pa_usec_t)msecs * PA_USEC_PER_MSEC);
+    deadline = pa_timeval_load(&tv) / PA_USEC_PER_MSEC;
+
+    if (deadline != src->deadline) {
+        pa->time_restart(src->pa_t, &tv);
+        src->deadline = deadline;
+    }
 }
 
 
-static void *add_io(void *glue_data, int fd, mrp_io_event_t events,
-                    void (*cb)(void *glue_data, void *id, int fd,
-                               mrp_io_event_t events, void *user_data),
-                    void *user_data)
+static void pump_source(src_t *src)
 {
-    pulse_glue_t        *glue = (pulse_glue_t *)glue_data;
-    pa_mainloop_api     *pa   = glue->pa;
-    pa_io_event_flags_t  mask = PA_IO_EVENT_NULL;
-    io_t                *io;
-
-    io = mrp_allocz(sizeof(*io));
+    pa_mainloop_api *pa = src->glue->pa;
 
-    if (io != NULL) {
-        if (events & MRP_IO_EVENT_IN)  mask |= PA_IO_EVENT_INPUT;
-        if (events & MRP_IO_EVENT_OUT) mask |= PA_IO_EVENT_OUTPUT;
-        if (events & MRP_IO_EVENT_HUP) mask |= PA_IO_EVENT_HANGUP;
-        if (events & MRP_IO_EVENT_ERR) mask |= PA_IO_EVENT_ERROR;
+    src->busy = TRUE;
+    mrp_mainloop_poll(src->ml, FALSE);
 
-        io->pa_io = pa->io_new(pa, fd, mask, io_cb, io);
-
-        if (io->pa_io != NULL) {
-            io->cb        = cb;
-            io->user_data = user_data;
-            io->glue_data = glue_data;
-
-            return io;
-        }
-        else
-            mrp_free(io);
+    if (mrp_mainloop_dispatch(src->ml)) {
+        src->busy = FALSE;
+        rearm_source(src);
+    }
+    else {
+        pa->io_enable(src->pa_io, PA_IO_EVENT_NULL);
+        pa->time_restart(src->pa_t, NULL);
+        src->deadline = 0;
     }
-
-    return NULL;
 }
 
 
-static void del_io(void *glue_data, void *id)
+static void io_cb(pa_mainloop_api *pa, pa_io_event *e, int fd,
+                  pa_io_event_flags_t mask, void *user_data)
 {
-    pulse_glue_t    *glue = (pulse_glue_t *)glue_data;
-    pa_mainloop_api *pa   = glue->pa;
-    io_t            *io   = (io_t *)id;
+    src_t *src = (src_t *)user_data;
+
+    MRP_UNUSED(pa);
+    MRP_UNUSED(e);
+    MRP_UNUSED(fd);
+    MRP_UNUSED(mask);
 
-    pa->io_free(io->pa_io);
-    mrp_free(io);
+    pump_source(src);
 }
 
 
 static void timer_cb(pa_mainloop_api *pa, pa_time_event *e,
                      const struct timeval *tv, void *user_data)
 {
-    tmr_t *t = (tmr_t *)user_data;
+    src_t *src = (src_t *)user_data;
 
     MRP_UNUSED(pa);
     MRP_UNUSED(e);
     MRP_UNUSED(tv);
 
-    t->cb(t->glue_data, t, t->user_data);
+    src->deadline = 0;                   /* time events are one-shot */
+    pump_source(src);
 }
 
 
-static void *add_timer(void *glue_data, unsigned int msecs,
-                       void (*cb)(void *glue_data, void *id, void *user_data),
-                       void *user_data)
+static void *add_source(void *glue_data, mrp_mainloop_t *ml, int fd)
 {
-    pulse_glue_t    *glue = (pulse_glue_t *)glue_data;
-    pa_mainloop_api *pa   = glue->pa;
-    struct timeval   tv;
-    tmr_t           *t;
-
-    t = mrp_allocz(sizeof(*t));
-
-    if (t != NULL) {
-        pa_gettimeofday(&tv);
-
-        tv.tv_sec  += msecs / 1000;
-        tv.tv_usec += 1000 * (msecs % 1000);
-
-        t->pa_t = pa->time_new(pa, &tv, timer_cb, t);
-
-        if (t->pa_t != NULL) {
-            t->cb        = cb;
-            t->user_data = user_data;
-            t->glue_data = glue_data;
-
-            return t;
-        }
-        else
-            mrp_free(t);
-    }
-
-    return NULL;
-}
-
+    pulse_glue_t        *glue = (pulse_glue_t *)glue_data;
+    pa_mainloop_api     *pa   = glue->pa;
+    pa_io_event_flags_t  mask;
+    src_t               *src;
 
-static void del_timer(void *glue_data, void *id)
-{
-    pulse_glue_t    *glue = (pulse_glue_t *)glue_data;
-    pa_mainloop_api *pa   = glue->pa;
-    tmr_t           *t    = (tmr_t *)id;
+    src = mrp_allocz(sizeof(*src));
 
-    pa->time_free(t->pa_t);
-    mrp_free(t);
-}
+    if (src == NULL)
+        return NULL;
 
+    src->glue = glue;
+    src->ml   = ml;
 
-static void mod_timer(void *glue_data, void *id, unsigned int msecs)
-{
-    pulse_glue_t    *glue = (pulse_glue_t *)glue_data;
-    pa_mainloop_api *pa   = glue->pa;
-    tmr_t           *t    = (tmr_t *)id;
-    struct timeval   tv;
+    mask       = PA_IO_EVENT_INPUT | PA_IO_EVENT_HANGUP | PA_IO_EVENT_ERROR;
+    src->pa_io = pa->io_new(pa, fd, mask, io_cb, src);
+    src->pa_t  = pa->time_new(pa, NULL, timer_cb, src);
 
-    if (t != NULL) {
-        pa_gettimeofday(&tv);
+    if (src->pa_io == NULL || src->pa_t == NULL) {
+        if (src->pa_io != NULL)
+            pa->io_free(src->pa_io);
+        if (src->pa_t != NULL)
+            pa->time_free(src->pa_t);
 
-        tv.tv_sec  += msecs / 1000;
-        tv.tv_usec += 1000 * (msecs % 1000);
+        mrp_free(src);
 
-        pa->time_restart(t->pa_t, &tv);
+        return NULL;
     }
-}
 
+    rearm_source(src);
 
-static void defer_cb(pa_mainloop_api *pa, pa_defer_event *e, void *user_data)
-{
-    dfr_t *d = (dfr_t *)user_data;
-
-    MRP_UNUSED(pa);
-    MRP_UNUSED(e);
-
-    d->cb(d->glue_data, d, d->user_data);
+    return src;
 }
 
 
-static void *add_defer(void *glue_data,
-                       void (*cb)(void *glue_data, void *id, void *user_data),
-                       void *user_data)
+static void mod_source(void *glue_data, void *id)
 {
-    pulse_glue_t    *glue = (pulse_glue_t *)glue_data;
-    pa_mainloop_api *pa   = glue->pa;
-    dfr_t           *d;
-
-    d = mrp_allocz(sizeof(*d));
-
-    if (d != NULL) {
-        d->pa_d = pa->defer_new(pa, defer_cb, d);
-
-        if (d->pa_d != NULL) {
-            d->cb        = cb;
-            d->user_data = user_data;
-            d->glue_data = glue_data;
+    src_t *src = (src_t *)id;
 
-            return d;
-        }
-        else
-            mrp_free(d);
-    }
-
-    return NULL;
-}
-
-
-static void del_defer(void *glue_data, void *id)
-{
-    pulse_glue_t    *glue = (pulse_glue_t *)glue_data;
-    pa_mainloop_api *pa   = glue->pa;
-    dfr_t           *d    = (dfr_t *)id;
+    MRP_UNUSED(glue_data);
 
-    pa->defer_free(d->pa_d);
-    mrp_free(d);
+    if (!src->busy)
+        rearm_source(src);
 }
 
 
-static void mod_defer(void *glue_data, void *id, int enabled)
+static void del_source(void *glue_data, void *id)
 {
     pulse_glue_t    *glue = (pulse_glue_t *)glue_data;
     pa_mainloop_api *pa   = glue->pa;
-    dfr_t           *d    = (dfr_t *)id;
+    src_t           *src  = (src_t *)id;
 
-    pa->defer_enable(d->pa_d, !!enabled);
+    pa->io_free(src->pa_io);
+    pa->time_free(src->pa_t);
+    mrp_free(src);
 }
 
 
@@ -296,14 +209,9 @@ static void unregister(void *data)
 
 
 static mrp_superloop_ops_t pa_ops = {
-    .add_io     = add_io,
-    .del_io     = del_io,
-    .add_timer  = add_timer,
-    .del_timer  = del_timer,
-    .mod_timer  = mod_timer,
-    .add_defer  = add_defer,
-    .del_defer  = del_defer,
-    .mod_defer  = mod_defer,
+    .add_source = add_source,
+    .mod_source = mod_source,
+    .del_source = del_source,
     .unregister = unregister,
 };
 
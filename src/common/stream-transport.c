@@ -27,11 +27,13 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define _GNU_SOURCE
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
 #include <netdb.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
@@ -42,6 +44,7 @@
 #include <murphy/common/macros.h>
 #include <murphy/common/mm.h>
 #include <murphy/common/log.h>
+#include <murphy/common/mainloop.h>
 #include <murphy/common/msg.h>
 #include <murphy/common/fragbuf.h>
 #include <murphy/common/socket-utils.h>
@@ -59,12 +62,18 @@
 #define UNXSL 4
 
 #define DEFAULT_SIZE 128                 /* default input buffer size */
+#define ACCEPT_BATCH 16                  /* max. connections per wakeup */
+#define ACCEPT_PAUSE 250                 /* listener pause on EMFILE, msecs */
+#define ACCEPT_SLACK 50                  /* listener pause timer slack */
+#define RECV_BUDGET  32                  /* max. messages per wakeup */
+#define RECV_MAXBUF  (64 * 1024)         /* max. buffered input, bytes */
 
 typedef struct {
     MRP_TRANSPORT_PUBLIC_FIELDS;         /* common transport fields */
     int             sock;                /* TCP socket */
     mrp_io_watch_t *iow;                 /* socket I/O watch */
     mrp_fragbuf_t  *buf;                 /* fragment buffer */
+    mrp_timer_t    *resume;              /* paused listener resume timer */
 } strm_t;
 
 
@@ -307,11 +316,19 @@ static int strm_createfrom(mrp_transport_t *mt, void *conn)
             if (!t->connected ||
                 (t->buf = mrp_fragbuf_create(TRUE, 0)) != NULL) {
                 events = MRP_IO_EVENT_IN | MRP_IO_EVENT_HUP;
+                if (t->listened)
+                    events |= MRP_IO_PRIORITY_HIGH;
+                else
+                    events |= MRP_IO_TRIGGER_EDGE;
+
                 t->iow = mrp_add_io_watch(t->ml, t->sock, events,
                                           strm_recv_cb, t);
 
-                if (t->iow != NULL)
+                if (t->iow != NULL) {
+                    if (t->connected)
+                        mrp_set_io_watch_budget(t->iow, RECV_BUDGET);
                     return TRUE;
+                }
 
                 mrp_fragbuf_destroy(t->buf);
                 t->buf = NULL;
@@ -332,6 +349,9 @@ static void strm_close(mrp_transport_t *mt)
     mrp_del_io_watch(t->iow);
     t->iow = NULL;
 
+    mrp_del_timer(t->resume);
+    t->resume = NULL;
+
     mrp_fragbuf_destroy(t->buf);
     t->buf = NULL;
 
@@ -367,9 +387,13 @@ static int strm_listen(mrp_transport_t *mt, int backlog)
         if (set_nonblocking(t->sock, true) < 0)
             return FALSE;
 
+        if (backlog <= 0)
+            backlog = SOMAXCONN;
+
         if (listen(t->sock, backlog) == 0) {
             mrp_debug("transport %p listening", mt);
             t->listened = TRUE;
+            mrp_set_io_watch_priority(t->iow, MRP_IO_PRIORITY_HIGH);
             return TRUE;
         }
     }
@@ -379,12 +403,58 @@ static int strm_listen(mrp_transport_t *mt, int backlog)
 }
 
 
+static void resume_listener(mrp_timer_t *timer, void *user_data)
+{
+    strm_t         *t = (strm_t *)user_data;
+    mrp_io_event_t  events;
+
+    mrp_del_timer(timer);
+    t->resume = NULL;
+
+    events = MRP_IO_EVENT_IN | MRP_IO_EVENT_HUP | MRP_IO_PRIORITY_HIGH;
+    t->iow = mrp_add_io_watch(t->ml, t->sock, events, strm_recv_cb, t);
+
+    if (t->iow != NULL)
+        mrp_debug("transport %p: resumed accepting connections", t);
+    else
+        mrp_log_error("transport %p: failed to resume accepting connections",
+                      t);
+}
+
+
+static void pause_listener(strm_t *t)
+{
+    /*
+     * We have run out of file descriptors (or some other resource needed
+     * for accepting). Stop watching the listening socket for a while so
+     * that we don't end up busy-looping on it. Pending connections stay
+     * in the backlog until we have recovered.
+     */
+
+    if (t->resume != NULL)
+        return;
+
+    t->resume = mrp_add_timer_full(t->ml, ACCEPT_PAUSE, ACCEPT_SLACK,
+                                   resume_listener, t);
+
+    if (t->resume != NULL) {
+        mrp_del_io_watch(t->iow);
+        t->iow = NULL;
+
+        mrp_log_warning("transport %p: paused accepting connections for "
+                        "%d msecs (%d: %s)", t, ACCEPT_PAUSE,
+                        errno, strerror(errno));
+    }
+}
+
+
 static int strm_accept(mrp_transport_t *mt, mrp_transport_t *mlt)
 {
     strm_t         *t, *lt;
     mrp_sockaddr_t  addr;
     socklen_t       addrlen;
     mrp_io_event_t  events;
+    int             flags, error;
 
     t  = (strm_t *)mt;
     lt = (strm_t *)mlt;
@@ -395,91 +465,147 @@ static int strm_accept(mrp_transport_t *mt, mrp_transport_t *mlt)
         return FALSE;
     }
 
+    flags  = (mt->flags & MRP_TRANSPORT_NONBLOCK) ? SOCK_NONBLOCK : 0;
+    flags |= (mt->flags & MRP_TRANSPORT_CLOEXEC)  ? SOCK_CLOEXEC  : 0;
+
     addrlen = sizeof(addr);
-    t->sock = accept(lt->sock, &addr.any, &addrlen);
+    t->sock = accept4(lt->sock, &addr.any, &addrlen, flags);
 
-    if (t->sock >= 0) {
-        if (mt->flags & MRP_TRANSPORT_REUSEADDR)
-            if (set_reuseaddr(t->sock, true) < 0)
-                goto reject;
+    if (t->sock < 0) {
+        error = errno;
 
-        if (mt->flags & MRP_TRANSPORT_NONBLOCK)
-            if (set_nonblocking(t->sock, true) < 0)
-                goto reject;
+        switch (error) {
+        case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+        case EWOULDBLOCK:
+#endif
+            break;
+
+        case EMFILE:
+        case ENFILE:
+        case ENOBUFS:
+        case ENOMEM:
+            pause_listener(lt);
+            break;
+
+        default:
+            mrp_log_error("%s(): accept failed on transport %p (%d: %s).",
+                          __FUNCTION__, mlt, error, strerror(error));
+        }
 
-        if (mt->flags & MRP_TRANSPORT_CLOEXEC)
-            if (set_cloexec(t->sock, true) < 0)
-                goto reject;
+        errno = error;
+        return FALSE;
+    }
 
-        t->buf = mrp_fragbuf_create(TRUE, 0);
-        events = MRP_IO_EVENT_IN | MRP_IO_EVENT_HUP;
-        t->iow = mrp_add_io_watch(t->ml, t->sock, events, strm_recv_cb, t);
+    if (mt->flags & MRP_TRANSPORT_REUSEADDR)
+        if (set_reuseaddr(t->sock, true) < 0)
+            goto reject;
 
-        if (t->iow != NULL && t->buf != NULL) {
-            mrp_debug("accepted connection on transport %p/%p", mlt, mt);
-            return TRUE;
-        }
-        else {
-            mrp_fragbuf_destroy(t->buf);
-            t->buf = NULL;
-            close(t->sock);
-            t->sock = -1;
-        }
-    }
-    else {
-    reject:
-        if (mrp_reject_connection(lt->sock, NULL, 0) < 0) {
-            mrp_log_error("%s(): accept failed, closing transport %p (%d: %s).",
-                          __FUNCTION__, mlt, errno, strerror(errno));
-            strm_close(mlt);
-
-            /* Notes:
-             *     Unfortunately we cannot safely emit a closed event here.
-             *     The closed event is semantically attached to an accepted
-             *     tranport being closed and there is no equivalent for a
-             *     listening transport (we should have had a generic error
-             *     event). There for the transport owner expects and treats
-             *     (IOW casts) the associated user_data accordingly. That
-             *     would end up in a disaster... Once we cleanup/rework the
-             *     transport infra, this needs to be done better.
-             */
-        }
-        else
-            mrp_log_error("%s(): rejected connection for transport %p (%d: %s).",
-                          __FUNCTION__, mlt, errno, strerror(errno));
+    t->buf = mrp_fragbuf_create(TRUE, 0);
+    events = MRP_IO_EVENT_IN | MRP_IO_EVENT_HUP | MRP_IO_TRIGGER_EDGE;
+    t->iow = mrp_add_io_watch(t->ml, t->sock, events, strm_recv_cb, t);
+
+    if (t->iow != NULL && t->buf != NULL) {
+        mrp_debug("accepted connection on transport %p/%p", mlt, mt);
+        mrp_set_io_watch_budget(t->iow, RECV_BUDGET);
+        return TRUE;
     }
 
+    mrp_del_io_watch(t->iow);
+    t->iow = NULL;
+    mrp_fragbuf_destroy(t->buf);
+    t->buf = NULL;
+
+ reject:
+    error = errno;
+    close(t->sock);
+    t->sock = -1;
+
+    mrp_log_error("%s(): rejected connection for transport %p (%d: %s).",
+                  __FUNCTION__, mlt, error, strerror(error));
+
+    errno = error;
     return FALSE;
 }
 
 
+static int connection_pending(int fd)
+{
+    struct pollfd pfd;
+
+    pfd.fd      = fd;
+    pfd.events  = POLLIN;
+    pfd.revents = 0;
+
+    return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN);
+}
+
+
 static void strm_recv_cb(mrp_io_watch_t *w, int fd, mrp_io_event_t events,
                          void *user_data)
 {
     strm_t          *t  = (strm_t *)user_data;
     mrp_transport_t *mt = (mrp_transport_t *)t;
     void            *data, *buf;
-    uint32_t         pending;
+    uint32_t         pending, budget, cnt;
     size_t           size;
     ssize_t          n;
     int              error;
-
-    MRP_UNUSED(w);
+    bool             drained, partial;
 
     mrp_debug("event 0x%x for transport %p", events, t);
 
     if (events & MRP_IO_EVENT_IN) {
         if (MRP_UNLIKELY(mt->listened != 0)) {
-            MRP_TRANSPORT_BUSY(mt, {
-                    mrp_debug("connection event on transport %p", mt);
-                    mt->evt.connection(mt, mt->user_data);
-                });
+            int n = 0;
+
+            /*
+             * Let the owner accept a bounded batch of connections per
+             * wakeup. This cuts down on wakeups under a connection burst
+             * without letting the listener starve everybody else.
+             */
+
+            do {
+                MRP_TRANSPORT_BUSY(mt, {
+                        mrp_debug("connection event on transport %p", mt);
+                        mt->evt.connection(mt, mt->user_data);
+                    });
+
+                if (t->check_destroy(mt))
+                    return;
+            } while (++n < ACCEPT_BATCH && t->iow != NULL &&
+                     connection_pending(fd));
 
-            t->check_destroy(mt);
             return;
         }
 
-        while (ioctl(fd, FIONREAD, &pending) == 0 && pending > 0) {
+        /*
+         * Connected sockets are edge-triggered, so we need to keep
+         * reading until the socket is drained. However, to keep a fast
+         * peer from growing our buffer without bounds, we only buffer up
+         * to RECV_MAXBUF bytes at a time (or a single message if it is
+         * larger than that) and deliver at most budget messages per
+         * wakeup. Whatever is left over, buffered or still unread in the
+         * socket, gets picked up once we're redispatched.
+         */
+
+        data    = NULL;
+        size    = 0;
+        budget  = mrp_get_io_watch_budget(w);
+        cnt     = 0;
+        drained = false;
+        partial = false;
+
+    receive:
+        while (!drained && (partial || mrp_fragbuf_used(t->buf) < RECV_MAXBUF)) {
+            if (ioctl(fd, FIONREAD, &pending) < 0 || pending == 0) {
+                drained = true;
+                break;
+            }
+
+            if (!partial && pending > RECV_MAXBUF - mrp_fragbuf_used(t->buf))
+                pending = RECV_MAXBUF - mrp_fragbuf_used(t->buf);
+
             buf = mrp_fragbuf_alloc(t->buf, pending);
 
             if (buf == NULL) {
@@ -500,19 +626,27 @@ static void strm_recv_cb(mrp_io_watch_t *w, int fd, mrp_io_event_t events,
 
             n = read(fd, buf, pending);
 
-            if (n >= 0) {
-                if (n < (ssize_t)pending)
-                    mrp_fragbuf_trim(t->buf, buf, pending, n);
-            }
-
             if (n < 0 && errno != EAGAIN) {
                 error = EIO;
                 goto fatal_error;
             }
+
+            if (n < (ssize_t)pending)
+                mrp_fragbuf_trim(t->buf, buf, pending, n < 0 ? 0 : n);
+
+            if (n <= 0)
+                drained = true;
+
+            partial = false;
         }
 
-        data = NULL;
-        size = 0;
+        /*
+         * Deliver at most budget messages per wakeup. If there is more
+         * input left, yield the watch to get called again in the next
+         * mainloop iteration instead of starving others. Any pending
+         * hangup is kept in the yielded events.
+         */
+
         while (mrp_fragbuf_pull(t->buf, &data, &size)) {
             if (t->mode != MRP_TRANSPORT_MODE_JSON)
                 error = t->recv_data(mt, data, size, NULL, 0);
@@ -532,6 +666,19 @@ static void strm_recv_cb(mrp_io_watch_t *w, int fd, mrp_io_event_t events,
 
             if (t->check_destroy(mt))
                 return;
+
+            if (budget && ++cnt >= budget && t->iow == w &&
+                (mrp_fragbuf_used(t->buf) > 0 || !drained)) {
+                mrp_debug("transport %p used up its budget, yielding", mt);
+                mrp_yield_io_watch(w, events);
+                return;
+            }
+        }
+
+        /* no complete message buffered, read more if there is any */
+        if (!drained) {
+            partial = true;
+            goto receive;
         }
     }
 
@@ -597,11 +744,12 @@ static int strm_connect(mrp_transport_t *mt, mrp_sockaddr_t *addr,
         t->buf = mrp_fragbuf_create(TRUE, 0);
 
         if (t->buf != NULL) {
-            events = MRP_IO_EVENT_IN | MRP_IO_EVENT_HUP;
+            events = MRP_IO_EVENT_IN | MRP_IO_EVENT_HUP | MRP_IO_TRIGGER_EDGE;
             t->iow = mrp_add_io_watch(t->ml, t->sock, events, strm_recv_cb, t);
 
             if (t->iow != NULL) {
                 mrp_debug("connected transport %p", mt);
+                mrp_set_io_watch_budget(t->iow, RECV_BUDGET);
 
                 return TRUE;
             }
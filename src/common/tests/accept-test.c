@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Stream listener overload test.
+ *
+ * Lowers RLIMIT_NOFILE, then opens more connections to a stream
+ * listener from a child process than the server can have file
+ * descriptors for. The server must pause accepting when it runs out of
+ * descriptors instead of closing the listener. Once it has dropped the
+ * connections it holds, it must resume and accept every remaining one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include <murphy/common.h>
+
+#define ADDRESS   "unxs:@murphy-accept-test"
+#define NOFILE    64                     /* server descriptor limit */
+#define NCONN     (3 * NOFILE)           /* connections to open */
+#define TIMEOUT   (10 * 1000)            /* test timeout */
+#define IDLE      (500)                  /* idle check interval */
+
+typedef struct {
+    mrp_mainloop_t  *ml;
+    mrp_sockaddr_t   addr;
+    socklen_t        alen;
+    const char      *atype;
+    mrp_transport_t *lt;                 /* listening transport */
+    mrp_transport_t *conns[NCONN];       /* accepted connections */
+    int              nconn;              /* currently held connections */
+    int              total;              /* total accepted connections */
+    int              last;               /* total at last idle check */
+    int              drops;              /* times we dropped connections */
+    pid_t            child;              /* connecting child */
+} context_t;
+
+
+static void drop_connections(context_t *c)
+{
+    int i;
+
+    for (i = 0; i < c->nconn; i++) {
+        mrp_transport_disconnect(c->conns[i]);
+        mrp_transport_destroy(c->conns[i]);
+    }
+
+    c->nconn = 0;
+    c->drops++;
+}
+
+
+static void connection_evt(mrp_transport_t *lt, void *user_data)
+{
+    context_t       *c = (context_t *)user_data;
+    mrp_transport_t *t;
+
+    t = mrp_transport_accept(lt, c, MRP_TRANSPORT_NONBLOCK);
+
+    if (t == NULL)
+        return;
+
+    c->conns[c->nconn++] = t;
+    c->total++;
+
+    if (c->total == NCONN) {
+        mrp_log_info("Accepted all %d connections (dropped %d times).",
+                     c->total, c->drops);
+        mrp_mainloop_quit(c->ml, c->drops > 0 ? 0 : 1);
+    }
+}
+
+
+static void recvfrom_msg(mrp_transport_t *t, mrp_msg_t *msg,
+                         mrp_sockaddr_t *addr, socklen_t addrlen,
+                         void *user_data)
+{
+    MRP_UNUSED(t);
+    MRP_UNUSED(msg);
+    MRP_UNUSED(addr);
+    MRP_UNUSED(addrlen);
+    MRP_UNUSED(user_data);
+}
+
+
+static void recv_msg(mrp_transport_t *t, mrp_msg_t *msg, void *user_data)
+{
+    recvfrom_msg(t, msg, NULL, 0, user_data);
+}
+
+
+static void closed_evt(mrp_transport_t *t, int error, void *user_data)
+{
+    MRP_UNUSED(t);
+    MRP_UNUSED(error);
+    MRP_UNUSED(user_data);
+}
+
+
+static void idle_cb(mrp_timer_t *t, void *user_data)
+{
+    context_t *c = (context_t *)user_data;
+
+    MRP_UNUSED(t);
+
+    /* no progress since last check, we must be out of descriptors */
+    if (c->total == c->last && c->nconn > 0) {
+        mrp_log_info("Stalled at %d connections, dropping %d of them.",
+                     c->total, c->nconn);
+        drop_connections(c);
+    }
+
+    c->last = c->total;
+}
+
+
+static void timeout_cb(mrp_timer_t *t, void *user_data)
+{
+    context_t *c = (context_t *)user_data;
+
+    MRP_UNUSED(t);
+
+    mrp_log_error("Timed out after accepting %d of %d connections.",
+                  c->total, NCONN);
+    mrp_mainloop_quit(c->ml, 1);
+}
+
+
+static void run_clients(context_t *c)
+{
+    int fds[NCONN], i;
+
+    for (i = 0; i < NCONN; i++) {
+        fds[i] = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (fds[i] < 0 || connect(fds[i], &c->addr.any, c->alen) < 0) {
+            mrp_log_error("Client failed to connect #%d (%d: %s).", i,
+                          errno, strerror(errno));
+            _exit(1);
+        }
+    }
+
+    pause();
+    _exit(0);
+}
+
+
+int main(int argc, char *argv[])
+{
+    static mrp_transport_evt_t evt = {
+        { .recvmsg     = recv_msg     },
+        { .recvmsgfrom = recvfrom_msg },
+        .closed        = closed_evt,
+        .connection    = connection_evt,
+    };
+
+    context_t     c;
+    struct rlimit rl;
+    int           status;
+
+    MRP_UNUSED(argc);
+    MRP_UNUSED(argv);
+
+    mrp_clear(&c);
+    mrp_log_set_mask(MRP_LOG_UPTO(MRP_LOG_INFO));
+
+    c.alen = mrp_transport_resolve(NULL, ADDRESS, &c.addr, sizeof(c.addr),
+                                   &c.atype);
+
+    if (c.alen <= 0) {
+        mrp_log_error("Failed to resolve address '%s'.", ADDRESS);
+        exit(1);
+    }
+
+    c.ml = mrp_mainloop_create();
+    c.lt = mrp_transport_create(c.ml, c.atype, &evt, &c,
+                                MRP_TRANSPORT_REUSEADDR);
+
+    if (c.ml == NULL || c.lt == NULL ||
+        !mrp_transport_bind(c.lt, &c.addr, c.alen) ||
+        !mrp_transport_listen(c.lt, NCONN)) {
+        mrp_log_error("Failed to set up listening transport.");
+        exit(1);
+    }
+
+    if ((c.child = fork()) < 0) {
+        mrp_log_error("Failed to fork (%d: %s).", errno, strerror(errno));
+        exit(1);
+    }
+
+    if (c.child == 0)
+        run_clients(&c);
+
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = NOFILE;
+
+    if (setrlimit(RLIMIT_NOFILE, &rl) < 0) {
+        mrp_log_error("Failed to lower RLIMIT_NOFILE (%d: %s).",
+                      errno, strerror(errno));
+        exit(1);
+    }
+
+    mrp_add_timer(c.ml, IDLE, idle_cb, &c);
+    mrp_add_timer(c.ml, TIMEOUT, timeout_cb, &c);
+
+    status = mrp_mainloop_run(c.ml);
+
+    kill(c.child, SIGTERM);
+    waitpid(c.child, NULL, 0);
+
+    return status;
+}
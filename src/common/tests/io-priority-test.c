@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * I/O watch priority and budget test.
+ *
+ * Keeps a large number of low priority descriptors continuously ready,
+ * then makes a high priority one ready and checks that it gets serviced
+ * within a single mainloop iteration, before any of the low priority
+ * ones. Finally checks that a watch with a budget which yields with
+ * buffered work left gets re-dispatched in the following iterations
+ * even though its descriptor is no longer ready.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <murphy/common.h>
+
+#define NLOW    500                      /* low priority descriptors */
+#define NROUND  10                       /* high priority rounds */
+#define NWORK   10                       /* work items for budget test */
+#define TIMEOUT (10 * 1000)              /* test timeout */
+
+typedef struct {
+    mrp_mainloop_t *ml;
+    int             lowfd[NLOW];         /* always ready low priority fds */
+    mrp_io_watch_t *loww[NLOW];          /* low priority watches */
+    int             highfd;              /* high priority fd */
+    int             nlow;                /* low dispatches this iteration */
+    int             nhigh;               /* high dispatches this iteration */
+    int             lowseen;             /* low dispatches before high */
+    int             total;               /* total low dispatches */
+    int             work;                /* buffered work left */
+    int             nwork;               /* work dispatches */
+    int             failed;              /* number of failed checks */
+} context_t;
+
+
+static void low_cb(mrp_io_watch_t *w, int fd, mrp_io_event_t events,
+                   void *user_data)
+{
+    context_t *c = (context_t *)user_data;
+
+    MRP_UNUSED(w);
+    MRP_UNUSED(fd);
+    MRP_UNUSED(events);
+
+    /* don't read, keep the descriptor ready */
+    c->nlow++;
+    c->total++;
+}
+
+
+static void high_cb(mrp_io_watch_t *w, int fd, mrp_io_event_t events,
+                    void *user_data)
+{
+    context_t *c = (context_t *)user_data;
+    uint64_t   cnt;
+
+    MRP_UNUSED(w);
+    MRP_UNUSED(events);
+
+    if (read(fd, &cnt, sizeof(cnt)) != sizeof(cnt))
+        mrp_log_error("Failed to read high priority eventfd.");
+
+    c->lowseen = c->nlow;
+    c->nhigh++;
+}
+
+
+static void work_cb(mrp_io_watch_t *w, int fd, mrp_io_event_t events,
+                    void *user_data)
+{
+    context_t *c = (context_t *)user_data;
+    uint64_t   cnt;
+    uint32_t   budget;
+
+    c->nwork++;
+
+    /* buffer all available input, like stream transports do */
+    if (read(fd, &cnt, sizeof(cnt)) == sizeof(cnt))
+        c->work += (int)cnt;
+
+    budget = mrp_get_io_watch_budget(w);
+
+    while (c->work > 0 && budget-- > 0)
+        c->work--;
+
+    if (c->work > 0)
+        mrp_yield_io_watch(w, events);
+}
+
+
+static void timeout_cb(mrp_timer_t *t, void *user_data)
+{
+    context_t *c = (context_t *)user_data;
+
+    MRP_UNUSED(t);
+
+    mrp_log_error("Timed out after %d work dispatches.", c->nwork);
+    exit(1);
+}
+
+
+static void test_priority(context_t *c)
+{
+    uint64_t one = 1;
+    int      i;
+
+    for (i = 0; i < NLOW; i++) {
+        c->lowfd[i] = eventfd(1, EFD_NONBLOCK);
+        c->loww[i]  = mrp_add_io_watch(c->ml, c->lowfd[i],
+                                       MRP_IO_EVENT_IN | MRP_IO_PRIORITY_LOW,
+                                       low_cb, c);
+
+        if (c->lowfd[i] < 0 || c->loww[i] == NULL) {
+            mrp_log_error("Failed to set up low priority fd #%d.", i);
+            exit(1);
+        }
+    }
+
+    c->highfd = eventfd(0, EFD_NONBLOCK);
+
+    if (c->highfd < 0 ||
+        mrp_add_io_watch(c->ml, c->highfd,
+                         MRP_IO_EVENT_IN | MRP_IO_PRIORITY_HIGH,
+                         high_cb, c) == NULL) {
+        mrp_log_error("Failed to set up high priority fd.");
+        exit(1);
+    }
+
+    for (i = 0; i < NROUND; i++) {
+        if (write(c->highfd, &one, sizeof(one)) != sizeof(one)) {
+            mrp_log_error("Failed to write high priority eventfd.");
+            exit(1);
+        }
+
+        c->nlow  = 0;
+        c->nhigh = 0;
+
+        mrp_mainloop_iterate(c->ml);
+
+        if (c->nhigh != 1) {
+            mrp_log_error("Round %d: high priority fd dispatched %d times.",
+                          i, c->nhigh);
+            c->failed++;
+        }
+
+        if (c->lowseen != 0) {
+            mrp_log_error("Round %d: %d low priority fds dispatched before "
+                          "the high priority one.", i, c->lowseen);
+            c->failed++;
+        }
+
+        if (c->nlow != NLOW) {
+            mrp_log_error("Round %d: %d/%d low priority fds dispatched.",
+                          i, c->nlow, NLOW);
+            c->failed++;
+        }
+    }
+
+    mrp_log_info("High priority fd serviced first in %d/%d rounds, "
+                 "%d low priority dispatches.", NROUND, NROUND, c->total);
+
+    for (i = 0; i < NLOW; i++) {
+        mrp_del_io_watch(c->loww[i]);
+        close(c->lowfd[i]);
+    }
+}
+
+
+static void test_budget(context_t *c)
+{
+    mrp_io_watch_t *w;
+    uint64_t        cnt = NWORK;
+    int             fd, i;
+
+    fd = eventfd(0, EFD_NONBLOCK);
+    w  = fd < 0 ? NULL : mrp_add_io_watch(c->ml, fd, MRP_IO_EVENT_IN,
+                                          work_cb, c);
+
+    if (w == NULL) {
+        mrp_log_error("Failed to set up budget test fd.");
+        exit(1);
+    }
+
+    mrp_set_io_watch_budget(w, 1);
+
+    if (write(fd, &cnt, sizeof(cnt)) != sizeof(cnt)) {
+        mrp_log_error("Failed to write budget test eventfd.");
+        exit(1);
+    }
+
+    for (i = 0; i < NWORK; i++) {
+        if (c->nwork != i) {
+            mrp_log_error("Iteration %d: %d work dispatches.", i, c->nwork);
+            c->failed++;
+        }
+
+        mrp_mainloop_iterate(c->ml);
+    }
+
+    if (c->nwork != NWORK || c->work != 0) {
+        mrp_log_error("%d work dispatches, %d work items left.",
+                      c->nwork, c->work);
+        c->failed++;
+    }
+
+    mrp_log_info("Yielding watch finished %d items in %d dispatches.",
+                 NWORK, c->nwork);
+
+    mrp_del_io_watch(w);
+    close(fd);
+}
+
+
+int main(int argc, char *argv[])
+{
+    context_t c;
+
+    MRP_UNUSED(argc);
+    MRP_UNUSED(argv);
+
+    mrp_clear(&c);
+    mrp_log_set_mask(MRP_LOG_UPTO(MRP_LOG_INFO));
+
+    if ((c.ml = mrp_mainloop_create()) == NULL) {
+        mrp_log_error("Failed to create mainloop.");
+        exit(1);
+    }
+
+    /* a yielding watch must not let us block in poll */
+    mrp_add_timer(c.ml, TIMEOUT, timeout_cb, &c);
+
+    test_priority(&c);
+    test_budget(&c);
+
+    mrp_mainloop_destroy(c.ml);
+
+    return c.failed ? 1 : 0;
+}
@@ -33,9 +33,36 @@
 
 struct glib_config_s {
     GMainLoop *gml;
+    guint      first_id;                 /* source id before running */
+    guint      last_id;                  /* source id after running */
 };
 
 
+static gboolean probe_cb(gpointer user_data)
+{
+    MRP_UNUSED(user_data);
+
+    return FALSE;
+}
+
+
+/*
+ * Source ids are allocated sequentially by glib, so the id of a probe
+ * source added before and after running tells us how many sources have
+ * been created in between.
+ */
+
+static guint probe_source_id(void)
+{
+    guint id;
+
+    id = g_idle_add(probe_cb, NULL);
+    g_source_remove(id);
+
+    return id;
+}
+
+
 mrp_mainloop_t *glib_mainloop_create(test_config_t *cfg)
 {
     glib_config_t  *glib;
@@ -66,7 +93,9 @@ mrp_mainloop_t *glib_mainloop_create(test_config_t *cfg)
 int glib_mainloop_run(test_config_t *cfg)
 {
     if (cfg->glib != NULL) {
+        cfg->glib->first_id = probe_source_id();
         g_main_loop_run(cfg->glib->gml);
+        cfg->glib->last_id = probe_source_id();
         return TRUE;
     }
     else
@@ -85,6 +114,30 @@ int glib_mainloop_quit(test_config_t *cfg)
 }
 
 
+int glib_mainloop_check(test_config_t *cfg)
+{
+    int nsource;
+
+    if (cfg->glib == NULL)
+        return FALSE;
+
+    /*
+     * We pump the murphy mainloop from a single GSource, so running it
+     * should not have allocated any new glib sources behind our back.
+     */
+
+    nsource = cfg->glib->last_id - cfg->glib->first_id - 1;
+
+    if (nsource > 0)
+        mrp_log_error("GLIB sources: FAIL (%d allocated while running)",
+                      nsource);
+    else
+        mrp_log_info("GLIB sources: OK (none allocated while running)");
+
+    return nsource == 0;
+}
+
+
 int glib_mainloop_cleanup(test_config_t *cfg)
 {
     if (cfg->glib != NULL) {
@@ -133,6 +186,15 @@ int glib_mainloop_quit(test_config_t *cfg)
 }
 
 
+int glib_mainloop_check(test_config_t *cfg)
+{
+    MRP_UNUSED(cfg);
+
+    mrp_log_error("glib mainloop support is not available.");
+    exit(1);
+}
+
+
 int glib_mainloop_cleanup(test_config_t *cfg)
 {
     MRP_UNUSED(cfg);
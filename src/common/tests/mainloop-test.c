@@ -1730,6 +1730,7 @@ void mainloop_cleanup(test_config_t *cfg)
 int main(int argc, char *argv[])
 {
     mrp_mainloop_t *ml;
+    int             status = 0;
 
     mrp_clear(&cfg);
     parse_cmdline(&cfg, argc, argv);
@@ -1782,6 +1783,13 @@ int main(int argc, char *argv[])
 
     check_dbus();
 
+    if (cfg.mainloop_type == MAINLOOP_GLIB) {
+        if (!glib_mainloop_check(&cfg)) {
+            error("GLIB mainloop check failed");
+            status = 1;
+        }
+    }
+
 #ifdef GLIB_ENABLED
     if (cfg.mainloop_type != MAINLOOP_GLIB) {
         if (cfg.ngio > 0 || cfg.ngtimer > 0)
@@ -1792,4 +1800,6 @@ int main(int argc, char *argv[])
     cleanup_wakeup();
 
     mainloop_cleanup(&cfg);
+
+    return status;
 }
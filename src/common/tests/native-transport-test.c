@@ -0,0 +1,472 @@
+/*
+ * Copyright (c) 2012, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Native-type transport conformance test.
+ *
+ * Runs the same native-type round trip (client -> server -> client) over
+ * every transport it is given, checking that the decoded objects arrive
+ * intact. Without arguments a default set of local transports is tried.
+ * Transports that are not available in this build (for instance wsck
+ * without websocket support) are skipped, as are D-Bus session bus
+ * addresses when there is no session bus to connect to. The internal and
+ * unxs transports are always built in, so they are never skipped. The
+ * test fails if no transport passed. Other addresses can be given on the
+ * command line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <murphy/common.h>
+
+#define ROUNDTRIP_TIMEOUT (5 * 1000)
+
+typedef struct {
+    uint32_t   seq;
+    char      *msg;
+    uint16_t   u16;
+    int16_t    s16;
+    double     dbl;
+    bool       bln;
+    char     **astr;
+    uint32_t   nstr;
+    char      *rpl;
+} native_t;
+
+
+typedef struct {
+    mrp_mainloop_t  *ml;
+    char           **addrs;              /* addresses to test */
+    int              naddr;              /* number of addresses */
+    int              idx;                /* address being tested */
+    mrp_sockaddr_t   addr;               /* resolved address */
+    socklen_t        alen;               /* resolved address length */
+    const char      *atype;              /* transport type */
+    mrp_transport_t *lt;                 /* server (listening) transport */
+    mrp_transport_t *st;                 /* server (accepted) transport */
+    mrp_transport_t *ct;                 /* client transport */
+    mrp_timer_t     *timer;              /* round trip timeout */
+    mrp_deferred_t  *next;               /* kick off next test */
+    uint32_t         seqno;              /* message sequence number */
+    int              passed;             /* number of passed transports */
+    int              failed;             /* number of failed transports */
+    int              skipped;            /* number of skipped transports */
+    int              done;               /* current test finished */
+} context_t;
+
+
+static char *default_addrs[] = {
+    "internal:native-test",
+    "unxs:@murphy-native-test",
+    "tcp4:127.0.0.1:37531",
+    "udp4:127.0.0.1:37532",
+    "wsck:127.0.0.1:37533/murphy",
+    "dbus:[session]@org.Murphy.NativeTest/nativetest",
+};
+
+static char *required_types[] = {
+    "internal:",
+    "unxs:",
+};
+
+static char     *astr[] = { "this", "is", "a", "native", "test" };
+static uint32_t  native_id;
+
+
+static void register_native(void)
+{
+    MRP_NATIVE_TYPE(native_type, native_t,
+                    MRP_UINT32(native_t, seq , DEFAULT),
+                    MRP_STRING(native_t, msg , DEFAULT),
+                    MRP_UINT16(native_t, u16 , DEFAULT),
+                    MRP_INT16 (native_t, s16 , DEFAULT),
+                    MRP_DOUBLE(native_t, dbl , DEFAULT),
+                    MRP_BOOL  (native_t, bln , DEFAULT),
+                    MRP_ARRAY (native_t, astr, DEFAULT, SIZED, char *, nstr),
+                    MRP_UINT32(native_t, nstr, DEFAULT),
+                    MRP_STRING(native_t, rpl , DEFAULT));
+
+    if ((native_id = mrp_register_native(&native_type)) == MRP_INVALID_TYPE) {
+        mrp_log_error("Failed to register native type 'native_t'.");
+        exit(1);
+    }
+}
+
+
+static void fill_native(native_t *msg, uint32_t seq, char *buf, size_t size)
+{
+    snprintf(buf, size, "this is message #%u", seq);
+
+    msg->seq  = seq;
+    msg->msg  = buf;
+    msg->u16  = seq;
+    msg->s16  = -seq;
+    msg->dbl  = seq / 3.0;
+    msg->bln  = seq & 0x1;
+    msg->astr = astr;
+    msg->nstr = MRP_ARRAY_SIZE(astr);
+    msg->rpl  = "";
+}
+
+
+static int check_native(native_t *msg, uint32_t type_id, const char *rpl)
+{
+    native_t  chk;
+    char      buf[128];
+    uint32_t  i;
+
+    if (type_id != native_id) {
+        mrp_log_error("Received type 0x%x, expected 0x%x.", type_id, native_id);
+        return FALSE;
+    }
+
+    fill_native(&chk, msg->seq, buf, sizeof(buf));
+
+    if (strcmp(msg->msg, chk.msg) || msg->u16 != chk.u16 ||
+        msg->s16 != chk.s16 || msg->dbl != chk.dbl || msg->bln != chk.bln ||
+        msg->nstr != chk.nstr || strcmp(msg->rpl, rpl)) {
+        mrp_log_error("Native message #%u has been corrupted.", msg->seq);
+        return FALSE;
+    }
+
+    for (i = 0; i < msg->nstr; i++) {
+        if (strcmp(msg->astr[i], chk.astr[i])) {
+            mrp_log_error("Native message #%u has corrupted string array.",
+                          msg->seq);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+static void finish_test(context_t *c, int success)
+{
+    if (c->done)
+        return;
+
+    c->done = TRUE;
+
+    if (success) {
+        mrp_log_info("PASS: native round trip over '%s'.", c->addrs[c->idx]);
+        c->passed++;
+    }
+    else {
+        mrp_log_error("FAIL: native round trip over '%s'.", c->addrs[c->idx]);
+        c->failed++;
+    }
+
+    c->idx++;
+    mrp_enable_deferred(c->next);
+}
+
+
+static void srv_recvfrom(mrp_transport_t *t, void *data, uint32_t type_id,
+                         mrp_sockaddr_t *addr, socklen_t addrlen,
+                         void *user_data)
+{
+    context_t *c   = (context_t *)user_data;
+    native_t  *msg = (native_t *)data;
+    native_t   rpl;
+    char       buf[128];
+    int        status;
+
+    if (!check_native(msg, type_id, "")) {
+        mrp_free_native(msg, type_id);
+        finish_test(c, FALSE);
+        return;
+    }
+
+    rpl = *msg;
+    snprintf(buf, sizeof(buf), "reply to message #%u", msg->seq);
+    rpl.rpl = buf;
+
+    if (t->connected)
+        status = mrp_transport_sendnative(t, &rpl, native_id);
+    else
+        status = mrp_transport_sendnativeto(t, &rpl, native_id,
+                                            addr, addrlen);
+
+    mrp_free_native(msg, type_id);
+
+    if (!status) {
+        mrp_log_error("Failed to send native reply.");
+        finish_test(c, FALSE);
+    }
+}
+
+
+static void srv_recv(mrp_transport_t *t, void *data, uint32_t type_id,
+                     void *user_data)
+{
+    srv_recvfrom(t, data, type_id, NULL, 0, user_data);
+}
+
+
+static void clt_recvfrom(mrp_transport_t *t, void *data, uint32_t type_id,
+                         mrp_sockaddr_t *addr, socklen_t addrlen,
+                         void *user_data)
+{
+    context_t *c   = (context_t *)user_data;
+    native_t  *msg = (native_t *)data;
+    char       rpl[128];
+
+    MRP_UNUSED(t);
+    MRP_UNUSED(addr);
+    MRP_UNUSED(addrlen);
+
+    snprintf(rpl, sizeof(rpl), "reply to message #%u", msg->seq);
+
+    finish_test(c, msg->seq == c->seqno && check_native(msg, type_id, rpl));
+
+    mrp_free_native(msg, type_id);
+}
+
+
+static void clt_recv(mrp_transport_t *t, void *data, uint32_t type_id,
+                     void *user_data)
+{
+    clt_recvfrom(t, data, type_id, NULL, 0, user_data);
+}
+
+
+static void closed_evt(mrp_transport_t *t, int error, void *user_data)
+{
+    MRP_UNUSED(t);
+    MRP_UNUSED(user_data);
+
+    if (error)
+        mrp_log_error("Connection closed with error %d (%s).", error,
+                      strerror(error));
+}
+
+
+static void connection_evt(mrp_transport_t *lt, void *user_data)
+{
+    context_t *c = (context_t *)user_data;
+
+    c->st = mrp_transport_accept(lt, c, MRP_TRANSPORT_NONBLOCK);
+
+    if (c->st == NULL) {
+        mrp_log_error("Failed to accept connection on '%s'.",
+                      c->addrs[c->idx]);
+        finish_test(c, FALSE);
+    }
+}
+
+
+static void timeout_cb(mrp_timer_t *t, void *user_data)
+{
+    context_t *c = (context_t *)user_data;
+
+    MRP_UNUSED(t);
+
+    mrp_log_error("Native round trip over '%s' timed out.", c->addrs[c->idx]);
+    finish_test(c, FALSE);
+}
+
+
+static void cleanup_test(context_t *c)
+{
+    mrp_del_timer(c->timer);
+    c->timer = NULL;
+
+    if (c->ct != NULL) {
+        mrp_transport_disconnect(c->ct);
+        mrp_transport_destroy(c->ct);
+        c->ct = NULL;
+    }
+
+    if (c->st != NULL) {
+        mrp_transport_disconnect(c->st);
+        mrp_transport_destroy(c->st);
+        c->st = NULL;
+    }
+
+    if (c->lt != NULL) {
+        mrp_transport_destroy(c->lt);
+        c->lt = NULL;
+    }
+}
+
+
+static int is_required(const char *addr)
+{
+    size_t i;
+
+    for (i = 0; i < MRP_ARRAY_SIZE(required_types); i++)
+        if (!strncmp(addr, required_types[i], strlen(required_types[i])))
+            return TRUE;
+
+    return FALSE;
+}
+
+
+static int start_test(context_t *c)
+{
+    static mrp_transport_evt_t sevt = {
+        { .recvnative     = srv_recv     },
+        { .recvnativefrom = srv_recvfrom },
+        .closed           = closed_evt,
+        .connection       = connection_evt,
+    };
+    static mrp_transport_evt_t cevt = {
+        { .recvnative     = clt_recv     },
+        { .recvnativefrom = clt_recvfrom },
+        .closed           = closed_evt,
+        .connection       = NULL,
+    };
+
+    const char *addr  = c->addrs[c->idx];
+    int         flags = MRP_TRANSPORT_MODE_NATIVE | MRP_TRANSPORT_REUSEADDR |
+                        MRP_TRANSPORT_NONBLOCK;
+    native_t    msg;
+    char        buf[128];
+
+    mrp_log_info("Testing native round trip over '%s'...", addr);
+
+    c->done = FALSE;
+
+    if (!strncmp(addr, "dbus:[session]", 14) &&
+        getenv("DBUS_SESSION_BUS_ADDRESS") == NULL) {
+        mrp_log_info("SKIP: no D-Bus session bus for '%s'.", addr);
+        c->skipped++;
+        c->idx++;
+        return TRUE;
+    }
+
+    c->alen = mrp_transport_resolve(NULL, addr, &c->addr, sizeof(c->addr),
+                                    &c->atype);
+
+    if (c->alen <= 0) {
+        if (is_required(addr)) {
+            mrp_log_error("Required transport for '%s' is not available.",
+                          addr);
+            return FALSE;
+        }
+
+        mrp_log_info("SKIP: transport for '%s' is not available.", addr);
+        c->skipped++;
+        c->idx++;
+        return TRUE;
+    }
+
+    c->lt = mrp_transport_create(c->ml, c->atype, &sevt, c, flags);
+
+    if (c->lt == NULL || !mrp_transport_bind(c->lt, &c->addr, c->alen)) {
+        mrp_log_error("Failed to set up server for '%s'.", addr);
+        return FALSE;
+    }
+
+    mrp_transport_listen(c->lt, 1);     /* fails for connectionless ones */
+
+    c->ct = mrp_transport_create(c->ml, c->atype, &cevt, c, flags);
+
+    if (c->ct == NULL || !mrp_transport_connect(c->ct, &c->addr, c->alen)) {
+        mrp_log_error("Failed to connect client to '%s'.", addr);
+        return FALSE;
+    }
+
+    c->timer = mrp_add_timer(c->ml, ROUNDTRIP_TIMEOUT, timeout_cb, c);
+
+    c->seqno++;
+    fill_native(&msg, c->seqno, buf, sizeof(buf));
+
+    if (!mrp_transport_sendnative(c->ct, &msg, native_id)) {
+        mrp_log_error("Failed to send native message over '%s'.", addr);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+static void next_test(mrp_deferred_t *d, void *user_data)
+{
+    context_t *c = (context_t *)user_data;
+
+    mrp_disable_deferred(d);
+    cleanup_test(c);
+
+    while (c->idx < c->naddr) {
+        if (start_test(c)) {
+            if (c->lt != NULL)
+                return;
+        }
+        else {
+            cleanup_test(c);
+            mrp_log_error("FAIL: native round trip over '%s'.",
+                          c->addrs[c->idx]);
+            c->failed++;
+            c->idx++;
+        }
+    }
+
+    mrp_log_info("%d passed, %d failed, %d skipped.", c->passed, c->failed,
+                 c->skipped);
+
+    if (!c->passed)
+        mrp_log_error("FAIL: no transport passed.");
+
+    mrp_mainloop_quit(c->ml, (c->failed || !c->passed) ? 1 : 0);
+}
+
+
+int main(int argc, char *argv[])
+{
+    context_t c;
+
+    mrp_clear(&c);
+    mrp_log_set_mask(MRP_LOG_UPTO(MRP_LOG_INFO));
+
+    if (argc > 1) {
+        c.addrs = argv + 1;
+        c.naddr = argc - 1;
+    }
+    else {
+        c.addrs = default_addrs;
+        c.naddr = MRP_ARRAY_SIZE(default_addrs);
+    }
+
+    register_native();
+
+    c.ml   = mrp_mainloop_create();
+    c.next = mrp_add_deferred(c.ml, next_test, &c);
+
+    if (c.ml == NULL || c.next == NULL) {
+        mrp_log_error("Failed to set up mainloop.");
+        exit(1);
+    }
+
+    return mrp_mainloop_run(c.ml);
+}
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Directory scanning cache test.
+ *
+ * Populates a directory with a number of files, a fraction of which look
+ * like plugins, then scans it repeatedly for plugins the way startup and
+ * reload do, with and without caching, and reports the time taken for
+ * both. Checks that both find the same entries, that a cached listing
+ * is refreshed once the directory is modified and that flushing the cache
+ * from within a scan callback is safe.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <murphy/common.h>
+#include <murphy/common/file-utils.h>
+
+#define NFILE    1000                    /* files to create */
+#define NPLUGIN  (NFILE / 10)            /* files looking like plugins */
+#define NSCAN    200                     /* scans per measurement */
+#define PATTERN  "glob:plugin-*.so"      /* pattern to scan for */
+
+
+static uint64_t now_usecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+
+static int count_cb(const char *dir, const char *entry, mrp_dirent_type_t type,
+                    void *user_data)
+{
+    MRP_UNUSED(dir);
+    MRP_UNUSED(entry);
+    MRP_UNUSED(type);
+
+    (*(int *)user_data)++;
+
+    return 1;
+}
+
+
+static int flush_cb(const char *dir, const char *entry, mrp_dirent_type_t type,
+                    void *user_data)
+{
+    int *cnt = (int *)user_data;
+
+    MRP_UNUSED(dir);
+    MRP_UNUSED(entry);
+    MRP_UNUSED(type);
+
+    /* drop the pattern and the listing we are scanning with */
+    if ((*cnt)++ % 2)
+        mrp_scan_dir_flush();
+    else {
+        mrp_scan_dir_cache(false);
+        mrp_scan_dir_cache(true);
+    }
+
+    return 1;
+}
+
+
+static int remove_cb(const char *dir, const char *entry,
+                     mrp_dirent_type_t type, void *user_data)
+{
+    char path[PATH_MAX];
+
+    MRP_UNUSED(type);
+    MRP_UNUSED(user_data);
+
+    snprintf(path, sizeof(path), "%s/%s", dir, entry);
+    unlink(path);
+
+    return 1;
+}
+
+
+static void create_file(const char *dir, const char *fmt, int idx)
+{
+    char name[64], path[PATH_MAX];
+    int  fd;
+
+    snprintf(name, sizeof(name), fmt, idx);
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    if ((fd = open(path, O_CREAT | O_WRONLY, 0644)) < 0) {
+        mrp_log_error("Failed to create '%s'.", path);
+        exit(1);
+    }
+
+    close(fd);
+}
+
+
+static void backdate(const char *dir)
+{
+    struct timespec times[2];
+
+    /* pretend the directory has not been touched for a while */
+    clock_gettime(CLOCK_REALTIME, times + 0);
+    times[0].tv_sec -= 60;
+    times[1] = times[0];
+
+    if (utimensat(AT_FDCWD, dir, times, 0) < 0) {
+        mrp_log_error("Failed to set modification time of '%s'.", dir);
+        exit(1);
+    }
+}
+
+
+static int scan(const char *dir)
+{
+    int cnt = 0;
+
+    if (mrp_scan_dir(dir, PATTERN, MRP_DIRENT_REG, count_cb, &cnt) < 0) {
+        mrp_log_error("Failed to scan '%s'.", dir);
+        exit(1);
+    }
+
+    return cnt;
+}
+
+
+static uint64_t measure(const char *dir, bool cached, int *failed)
+{
+    uint64_t start;
+    int      i, cnt;
+
+    mrp_scan_dir_cache(cached);
+
+    start = now_usecs();
+
+    for (i = 0; i < NSCAN; i++) {
+        cnt = scan(dir);
+
+        if (cnt != NPLUGIN) {
+            mrp_log_error("%s scan #%d found %d/%d plugins.",
+                          cached ? "Cached" : "Uncached", i, cnt, NPLUGIN);
+            (*failed)++;
+        }
+    }
+
+    return now_usecs() - start;
+}
+
+
+int main(int argc, char *argv[])
+{
+    char     dir[] = "/tmp/murphy-scan-dir-test.XXXXXX";
+    uint64_t uncached, cached;
+    int      i, cnt, failed;
+
+    MRP_UNUSED(argc);
+    MRP_UNUSED(argv);
+
+    mrp_log_set_mask(MRP_LOG_UPTO(MRP_LOG_INFO));
+    failed = 0;
+
+    if (mkdtemp(dir) == NULL) {
+        mrp_log_error("Failed to create test directory.");
+        exit(1);
+    }
+
+    for (i = 0; i < NFILE; i++)
+        create_file(dir, i % 10 ? "config-%d.lua" : "plugin-%d.so", i);
+
+    backdate(dir);
+
+    uncached = measure(dir, false, &failed);
+    cached   = measure(dir, true, &failed);
+
+    mrp_log_info("%d scans of %d entries: %.2f ms uncached, %.2f ms cached.",
+                 NSCAN, NFILE, uncached / 1000.0, cached / 1000.0);
+
+    /* a modified directory must be rescanned */
+    create_file(dir, "plugin-%d.so", NFILE);
+    cnt = scan(dir);
+
+    if (cnt != NPLUGIN + 1) {
+        mrp_log_error("Found %d/%d plugins after adding one.",
+                      cnt, NPLUGIN + 1);
+        failed++;
+    }
+
+    /* flushing the cache must not pull the pattern or listing from under us */
+    backdate(dir);
+    scan(dir);
+    cnt = 0;
+
+    if (mrp_scan_dir(dir, PATTERN, MRP_DIRENT_REG, flush_cb, &cnt) < 0 ||
+        cnt != NPLUGIN + 1) {
+        mrp_log_error("Found %d/%d plugins while flushing the cache.",
+                      cnt, NPLUGIN + 1);
+        failed++;
+    }
+
+    mrp_scan_dir_cache(false);
+    mrp_scan_dir(dir, NULL, MRP_DIRENT_REG, remove_cb, NULL);
+    rmdir(dir);
+
+    return failed ? 1 : 0;
+}
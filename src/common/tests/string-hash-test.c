@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * String hash quality and cost benchmark.
+ *
+ * Hashes a few realistic key sets (D-Bus object paths, member names,
+ * resource set paths and so on) with the old shift-and-xor string hash
+ * and with mrp_string_hash. For each it reports the longest chain, the
+ * average number of key comparisons a successful lookup needs and the
+ * cost of an mrp_htbl_lookup. Fails if the current hash produces
+ * unreasonably long chains or if the case-insensitive variant is
+ * inconsistent.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <murphy/common.h>
+
+#define NKEY     4096                    /* keys per key set */
+#define NBUCKET  (NKEY / 4)              /* like mrp_htbl for nentry = NKEY */
+#define NROUND   50                      /* lookup rounds per key set */
+#define MAXCHAIN 24                      /* max. acceptable chain length */
+
+typedef struct {
+    const char *name;                    /* key set name */
+    const char *fmt;                     /* key format, given a key index */
+} keyset_t;
+
+typedef struct {
+    int    max;                          /* longest chain */
+    double probe;                        /* avg. comparisons per lookup */
+    double ns;                           /* avg. ns per mrp_htbl_lookup */
+} result_t;
+
+
+static keyset_t keysets[] = {
+    { "resource set paths", "/org/murphy/resource/%d"                  },
+    { "D-Bus object paths", "/org/murphy/resource/%d/resource/audio"   },
+    { "D-Bus member names", "org.Murphy.Resource.Set%dChanged"         },
+    { "D-Bus unique names", ":1.%d"                                    },
+    { "long common prefix", "/com/example/very/deeply/nested/object/"
+                            "path/with/a/long/common/prefix/node%d"    },
+};
+
+
+static uint32_t legacy_hash(const void *key)
+{
+    uint32_t    h;
+    const char *p;
+
+    for (h = 0, p = key; *p; p++) {
+        h <<= 1;
+        h  ^= *p;
+    }
+
+    return h;
+}
+
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static void measure(char **keys, int nkey, mrp_htbl_hash_fn_t hash,
+                    result_t *r)
+{
+    static int         chain[NBUCKET];
+    mrp_htbl_config_t  cfg;
+    mrp_htbl_t        *ht;
+    double             start, sum;
+    int                i, j;
+
+    memset(chain, 0, sizeof(chain));
+
+    for (i = 0; i < nkey; i++)
+        chain[hash(keys[i]) & (NBUCKET - 1)]++;
+
+    r->max = 0;
+    sum    = 0;
+    for (i = 0; i < NBUCKET; i++) {
+        if (chain[i] > r->max)
+            r->max = chain[i];
+        sum += chain[i] * (chain[i] + 1) / 2.0;
+    }
+    r->probe = sum / nkey;
+
+    mrp_clear(&cfg);
+    cfg.comp    = mrp_string_comp;
+    cfg.hash    = hash;
+    cfg.nbucket = NBUCKET;
+
+    if ((ht = mrp_htbl_create(&cfg)) == NULL) {
+        mrp_log_error("Failed to create hash table.");
+        exit(1);
+    }
+
+    for (i = 0; i < nkey; i++)
+        mrp_htbl_insert(ht, keys[i], keys[i]);
+
+    start = now_ns();
+
+    for (j = 0; j < NROUND; j++) {
+        for (i = 0; i < nkey; i++) {
+            if (mrp_htbl_lookup(ht, keys[i]) != keys[i]) {
+                mrp_log_error("Lookup of '%s' failed.", keys[i]);
+                exit(1);
+            }
+        }
+    }
+
+    r->ns = (now_ns() - start) / ((double)NROUND * nkey);
+
+    mrp_htbl_destroy(ht, FALSE);
+}
+
+
+static int check_casehash(void)
+{
+    static const char *pairs[][2] = {
+        { "player"                  , "Player"                   },
+        { "navigator"               , "NAVIGATOR"                },
+        { "org.Murphy.Resource.Set" , "ORG.murphy.resource.set"  },
+        { "audio_playback_and_more" , "Audio_Playback_And_More"  },
+    };
+    size_t i;
+
+    for (i = 0; i < MRP_ARRAY_SIZE(pairs); i++) {
+        if (mrp_string_casehash(pairs[i][0]) !=
+            mrp_string_casehash(pairs[i][1]) ||
+            mrp_string_casecomp(pairs[i][0], pairs[i][1]) != 0) {
+            mrp_log_error("Case-insensitive hash mismatch for '%s'/'%s'.",
+                          pairs[i][0], pairs[i][1]);
+            return FALSE;
+        }
+
+        if (mrp_string_hash(pairs[i][0]) == mrp_string_hash(pairs[i][1]))
+            mrp_log_warning("Case-sensitive hash collision for '%s'/'%s'.",
+                            pairs[i][0], pairs[i][1]);
+    }
+
+    return TRUE;
+}
+
+
+int main(int argc, char *argv[])
+{
+    char     *keys[NKEY], buf[256];
+    result_t  old, new;
+    size_t    i;
+    int       j, failed;
+
+    MRP_UNUSED(argc);
+    MRP_UNUSED(argv);
+
+    mrp_log_set_mask(MRP_LOG_UPTO(MRP_LOG_INFO));
+
+    failed = !check_casehash();
+
+    printf("%-20s %20s %20s\n", "", "legacy", "mrp_string_hash");
+    printf("%-20s %6s %6s %6s  %6s %6s %6s\n", "key set",
+           "max", "probe", "ns", "max", "probe", "ns");
+
+    for (i = 0; i < MRP_ARRAY_SIZE(keysets); i++) {
+        for (j = 0; j < NKEY; j++) {
+            snprintf(buf, sizeof(buf), keysets[i].fmt, j);
+            keys[j] = mrp_strdup(buf);
+        }
+
+        measure(keys, NKEY, legacy_hash, &old);
+        measure(keys, NKEY, mrp_string_hash, &new);
+
+        printf("%-20s %6d %6.2f %6.1f  %6d %6.2f %6.1f\n", keysets[i].name,
+               old.max, old.probe, old.ns, new.max, new.probe, new.ns);
+
+        if (new.max > MAXCHAIN) {
+            mrp_log_error("Chains too long (%d) for %s.", new.max,
+                          keysets[i].name);
+            failed = TRUE;
+        }
+
+        for (j = 0; j < NKEY; j++)
+            mrp_free(keys[j]);
+    }
+
+    return failed ? 1 : 0;
+}
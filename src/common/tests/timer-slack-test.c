@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Timer slack test.
+ *
+ * Arms a large number of one-shot timers with expiration times spread
+ * 1 msec apart and counts the mainloop wakeups it takes to get them all
+ * fired, first without slack, then with a per-timer slack, and finally
+ * with a mainloop-wide default slack. The wakeups must be drastically
+ * reduced with slack and no timer may ever fire before it is due.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <murphy/common.h>
+
+#define NTIMER  1000                     /* number of timers */
+#define SLACK   50                       /* timer slack, msecs */
+#define TIMEOUT 30                       /* test timeout, seconds */
+
+typedef struct context_s context_t;
+
+typedef struct {
+    context_t *c;                        /* test context */
+    uint64_t   due;                      /* earliest allowed firing time */
+} test_timer_t;
+
+struct context_s {
+    mrp_mainloop_t *ml;
+    test_timer_t    timers[NTIMER];      /* timers under test */
+    int             fired;               /* timers fired */
+    int             early;               /* timers fired too early */
+    uint64_t        late;                /* max. lateness, usecs */
+};
+
+
+static uint64_t now_usecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+static void timer_cb(mrp_timer_t *t, void *user_data)
+{
+    test_timer_t *tt  = (test_timer_t *)user_data;
+    context_t    *c   = tt->c;
+    uint64_t      now = now_usecs();
+
+    if (now < tt->due)
+        c->early++;
+    else if (now - tt->due > c->late)
+        c->late = now - tt->due;
+
+    c->fired++;
+    mrp_del_timer(t);
+}
+
+
+static int run_timers(const char *mode, unsigned int slack)
+{
+    context_t     c;
+    test_timer_t *tt;
+    int           wakeups, i;
+
+    mrp_clear(&c);
+
+    if ((c.ml = mrp_mainloop_create()) == NULL) {
+        mrp_log_error("Failed to create mainloop.");
+        exit(1);
+    }
+
+    if (slack == MRP_TIMER_SLACK_DEFAULT)
+        mrp_set_timer_default_slack(c.ml, SLACK);
+
+    for (i = 0; i < NTIMER; i++) {
+        tt      = c.timers + i;
+        tt->c   = &c;
+        tt->due = now_usecs() + (i + 1) * 1000;
+
+        if (mrp_add_timer_full(c.ml, i + 1, slack, timer_cb, tt) == NULL) {
+            mrp_log_error("Failed to create timer #%d.", i);
+            exit(1);
+        }
+    }
+
+    for (wakeups = 0; c.fired < NTIMER; wakeups++)
+        mrp_mainloop_iterate(c.ml);
+
+    mrp_log_info("%s: %d timers fired in %d wakeups, %d early, "
+                 "max. %.1f msecs late.", mode, c.fired, wakeups, c.early,
+                 c.late / 1000.0);
+
+    mrp_mainloop_destroy(c.ml);
+
+    if (c.early > 0) {
+        mrp_log_error("%s: %d timers fired before they were due.", mode,
+                      c.early);
+        exit(1);
+    }
+
+    return wakeups;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int exact, slack, dflt;
+
+    MRP_UNUSED(argc);
+    MRP_UNUSED(argv);
+
+    mrp_log_set_mask(MRP_LOG_UPTO(MRP_LOG_INFO));
+    alarm(TIMEOUT);
+
+    exact = run_timers("no slack", 0);
+    slack = run_timers("timer slack", SLACK);
+    dflt  = run_timers("default slack", MRP_TIMER_SLACK_DEFAULT);
+
+    /* expect roughly NTIMER / SLACK wakeups with slack, allow for jitter */
+    if (slack * 4 > exact || dflt * 4 > exact ||
+        slack > 2 * NTIMER / SLACK || dflt > 2 * NTIMER / SLACK) {
+        mrp_log_error("Timer slack did not reduce wakeups enough "
+                      "(%d, %d vs. %d).", slack, dflt, exact);
+        exit(1);
+    }
+
+    return 0;
+}
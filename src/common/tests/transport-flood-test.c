@@ -0,0 +1,380 @@
+/*
+ * Copyright (c) 2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Transport flood test.
+ *
+ * Floods a datagram and a stream transport with bursts of messages and
+ * counts the mainloop iterations it takes to receive them. Since the
+ * transports drain their edge-triggered sockets, a single wakeup should
+ * deliver a full budget worth of messages. For comparison, the same
+ * flood is received by a level-triggered watch reading a single datagram
+ * per wakeup, the way the datagram transport used to. Finally a single
+ * message larger than the stream transport input buffer cap is sent to
+ * check that buffering is never capped below a full message.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <murphy/common.h>
+
+#define NMSG    1024                     /* messages to flood with */
+#define NBURST  128                      /* messages per burst */
+#define BUDGET  32                       /* transport receive budget */
+#define BIGMSG  (192 * 1024)             /* oversized stream message */
+#define TIMEOUT (10 * 1000)              /* test timeout */
+
+typedef struct {
+    mrp_mainloop_t *ml;
+    int             nrecv;               /* messages received */
+    int             nwake;               /* wakeups delivering messages */
+    int             iter;                /* current iteration */
+    int             last;                /* last iteration delivering */
+    int             failed;              /* number of failed checks */
+} context_t;
+
+
+static void count_wakeup(context_t *c)
+{
+    if (c->last != c->iter) {
+        c->last = c->iter;
+        c->nwake++;
+    }
+
+    c->nrecv++;
+}
+
+
+static void recv_msg(mrp_transport_t *t, mrp_msg_t *msg, void *user_data)
+{
+    MRP_UNUSED(t);
+    MRP_UNUSED(msg);
+
+    count_wakeup((context_t *)user_data);
+}
+
+
+static void recvfrom_msg(mrp_transport_t *t, mrp_msg_t *msg,
+                         mrp_sockaddr_t *addr, socklen_t addrlen,
+                         void *user_data)
+{
+    MRP_UNUSED(t);
+    MRP_UNUSED(msg);
+    MRP_UNUSED(addr);
+    MRP_UNUSED(addrlen);
+
+    count_wakeup((context_t *)user_data);
+}
+
+
+static void closed_evt(mrp_transport_t *t, int error, void *user_data)
+{
+    MRP_UNUSED(t);
+    MRP_UNUSED(user_data);
+
+    mrp_log_error("Transport closed unexpectedly (%d: %s).", error,
+                  strerror(error));
+    exit(1);
+}
+
+
+static void recv_one(mrp_io_watch_t *w, int fd, mrp_io_event_t events,
+                     void *user_data)
+{
+    char buf[256];
+
+    MRP_UNUSED(w);
+    MRP_UNUSED(events);
+
+    if (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+        count_wakeup((context_t *)user_data);
+}
+
+
+static void timeout_cb(mrp_timer_t *t, void *user_data)
+{
+    context_t *c = (context_t *)user_data;
+
+    MRP_UNUSED(t);
+
+    mrp_log_error("Timed out after receiving %d messages.", c->nrecv);
+    exit(1);
+}
+
+
+static void receive(context_t *c, int target)
+{
+    while (c->nrecv < target) {
+        c->iter++;
+        mrp_mainloop_iterate(c->ml);
+    }
+}
+
+
+static void reset(context_t *c)
+{
+    c->nrecv = 0;
+    c->nwake = 0;
+    c->iter  = 0;
+    c->last  = 0;
+}
+
+
+static int flood_transport(context_t *c, const char *type, int socktype)
+{
+    static mrp_transport_evt_t evt = {
+        { .recvmsg     = recv_msg     },
+        { .recvmsgfrom = recvfrom_msg },
+        .closed        = closed_evt,
+        .connection    = NULL,
+    };
+
+    mrp_transport_t *srv, *clt;
+    mrp_msg_t       *msg;
+    int              fds[2], flags, state, i, j;
+
+    if (socketpair(AF_UNIX, socktype, 0, fds) < 0) {
+        mrp_log_error("Failed to create %s socket pair.", type);
+        exit(1);
+    }
+
+    flags = MRP_TRANSPORT_MODE_MSG | MRP_TRANSPORT_NONBLOCK;
+    state = MRP_TRANSPORT_CONNECTED;
+    srv   = mrp_transport_create_from(c->ml, type, fds + 0, &evt, c,
+                                      flags, state);
+    clt   = mrp_transport_create_from(c->ml, type, fds + 1, &evt, c,
+                                      flags, state);
+
+    if (srv == NULL || clt == NULL) {
+        mrp_log_error("Failed to create %s transports.", type);
+        exit(1);
+    }
+
+    reset(c);
+
+    for (i = 0; i < NMSG; i += NBURST) {
+        for (j = 0; j < NBURST; j++) {
+            msg = mrp_msg_create(MRP_MSG_TAG_UINT32(1, i + j), MRP_MSG_END);
+
+            if (msg == NULL || !mrp_transport_send(clt, msg)) {
+                mrp_log_error("Failed to send %s message #%d.", type, i + j);
+                exit(1);
+            }
+
+            mrp_msg_unref(msg);
+        }
+
+        receive(c, i + NBURST);
+    }
+
+    if (c->nrecv != NMSG) {
+        mrp_log_error("%s transport received %d/%d messages.", type,
+                      c->nrecv, NMSG);
+        c->failed++;
+    }
+
+    if (c->nwake > NMSG / BUDGET + NMSG / NBURST) {
+        mrp_log_error("%s transport needed %d wakeups for %d messages.",
+                      type, c->nwake, NMSG);
+        c->failed++;
+    }
+
+    mrp_log_info("%s transport received %d messages in %d wakeups.",
+                 type, c->nrecv, c->nwake);
+
+    mrp_transport_disconnect(clt);
+    mrp_transport_destroy(clt);
+    mrp_transport_disconnect(srv);
+    mrp_transport_destroy(srv);
+
+    return c->nwake;
+}
+
+
+static int flood_level(context_t *c)
+{
+    mrp_io_watch_t *w;
+    char            buf[64];
+    uint32_t        size;
+    int             fds[2], i, j;
+
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) < 0) {
+        mrp_log_error("Failed to create datagram socket pair.");
+        exit(1);
+    }
+
+    w = mrp_add_io_watch(c->ml, fds[0], MRP_IO_EVENT_IN | MRP_IO_TRIGGER_LEVEL,
+                         recv_one, c);
+
+    if (w == NULL) {
+        mrp_log_error("Failed to add level-triggered I/O watch.");
+        exit(1);
+    }
+
+    reset(c);
+
+    memset(buf, 0, sizeof(buf));
+    size = htonl(sizeof(buf) - sizeof(size));
+    memcpy(buf, &size, sizeof(size));
+
+    for (i = 0; i < NMSG; i += NBURST) {
+        for (j = 0; j < NBURST; j++) {
+            if (send(fds[1], buf, sizeof(buf), 0) != sizeof(buf)) {
+                mrp_log_error("Failed to send datagram #%d.", i + j);
+                exit(1);
+            }
+        }
+
+        receive(c, i + NBURST);
+    }
+
+    mrp_log_info("level-triggered watch received %d messages in %d wakeups.",
+                 c->nrecv, c->nwake);
+
+    mrp_del_io_watch(w);
+    close(fds[0]);
+    close(fds[1]);
+
+    return c->nwake;
+}
+
+
+static void send_big(context_t *c)
+{
+    static mrp_transport_evt_t evt = {
+        { .recvmsg     = recv_msg     },
+        { .recvmsgfrom = recvfrom_msg },
+        .closed        = closed_evt,
+        .connection    = NULL,
+    };
+
+    mrp_transport_t *srv, *clt;
+    mrp_msg_t       *msg;
+    char            *str;
+    int              fds[2], flags, state, bufsize;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        mrp_log_error("Failed to create stream socket pair.");
+        exit(1);
+    }
+
+    bufsize = 2 * BIGMSG;
+    setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+
+    flags = MRP_TRANSPORT_MODE_MSG | MRP_TRANSPORT_NONBLOCK;
+    state = MRP_TRANSPORT_CONNECTED;
+    srv   = mrp_transport_create_from(c->ml, "unxs", fds + 0, &evt, c,
+                                      flags, state);
+    clt   = mrp_transport_create_from(c->ml, "unxs", fds + 1, &evt, c,
+                                      flags, state);
+
+    if (srv == NULL || clt == NULL) {
+        mrp_log_error("Failed to create unxs transports.");
+        exit(1);
+    }
+
+    reset(c);
+
+    str = mrp_allocz(BIGMSG);
+    memset(str, 'x', BIGMSG - 1);
+    msg = mrp_msg_create(MRP_MSG_TAG_STRING(1, str), MRP_MSG_END);
+
+    if (msg == NULL || !mrp_transport_send(clt, msg)) {
+        mrp_log_error("Failed to send oversized message.");
+        exit(1);
+    }
+
+    mrp_msg_unref(msg);
+    mrp_free(str);
+
+    receive(c, 1);
+
+    if (c->nrecv != 1) {
+        mrp_log_error("unxs transport received %d/1 oversized messages.",
+                      c->nrecv);
+        c->failed++;
+    }
+
+    mrp_log_info("unxs transport received a %d byte message in %d iterations.",
+                 BIGMSG, c->iter);
+
+    mrp_transport_disconnect(clt);
+    mrp_transport_destroy(clt);
+    mrp_transport_disconnect(srv);
+    mrp_transport_destroy(srv);
+}
+
+
+int main(int argc, char *argv[])
+{
+    context_t c;
+    int       level, dgrm, strm;
+
+    MRP_UNUSED(argc);
+    MRP_UNUSED(argv);
+
+    mrp_clear(&c);
+    mrp_log_set_mask(MRP_LOG_UPTO(MRP_LOG_INFO));
+
+    if ((c.ml = mrp_mainloop_create()) == NULL) {
+        mrp_log_error("Failed to create mainloop.");
+        exit(1);
+    }
+
+    mrp_add_timer(c.ml, TIMEOUT, timeout_cb, &c);
+
+    level = flood_level(&c);
+    dgrm  = flood_transport(&c, "unxd", SOCK_DGRAM);
+    strm  = flood_transport(&c, "unxs", SOCK_STREAM);
+
+    if (dgrm >= level) {
+        mrp_log_error("Datagram transport needed %d wakeups, "
+                      "level-triggered watch %d.", dgrm, level);
+        c.failed++;
+    }
+
+    if (strm >= level) {
+        mrp_log_error("Stream transport needed %d wakeups, "
+                      "level-triggered watch %d.", strm, level);
+        c.failed++;
+    }
+
+    send_big(&c);
+
+    mrp_mainloop_destroy(c.ml);
+
+    return c.failed ? 1 : 0;
+}
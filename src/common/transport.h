@@ -496,7 +496,8 @@ socklen_t mrp_transport_resolve(mrp_transport_t *t, const char *str,
 int mrp_transport_bind(mrp_transport_t *t, mrp_sockaddr_t *addr,
                        socklen_t addrlen);
 
-/** Listen for incoming connection on the given transport. */
+/** Listen for incoming connection on the given transport. A backlog of
+ *  0 or less selects the system default. */
 int  mrp_transport_listen(mrp_transport_t *t, int backlog);
 
 /** Accept and create a new transport connection. */
@@ -34,9 +34,13 @@
 #include <string.h>
 #include <stdarg.h>
 #include <fcntl.h>
+#include <ctype.h>
+#include <endian.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/auxv.h>
 
+#include <murphy/common/macros.h>
 #include <murphy/common/log.h>
 #include <murphy/common/utils.h>
 
@@ -197,15 +201,128 @@ int mrp_string_comp(const void *key1, const void *key2)
 }
 
 
-uint32_t mrp_string_hash(const void *key)
+/*
+ * String hashing.
+ *
+ * We use SipHash-1-3 with a per-process random key. The previous
+ * shift-and-xor hash only let the last 32 characters of a key affect
+ * the result. Keys with a common suffix, for instance D-Bus object
+ * paths, collided badly. Since the key is random, peers that control
+ * key strings cannot force worst-case chains on us either.
+ */
+
+#define HASH_SEED_ENV "MURPHY_HASH_SEED"
+
+static uint64_t hash_key[2];
+
+static __attribute__((constructor)) void init_hash_key(void)
+{
+    const char *env = getenv(HASH_SEED_ENV);
+    const void *rnd;
+    int         fd;
+
+    /* a fixed seed makes hash table iteration order reproducible */
+    if (env != NULL && *env) {
+        hash_key[0] = strtoull(env, NULL, 0);
+        hash_key[1] = ~hash_key[0];
+        return;
+    }
+
+    /* the kernel hands every process 16 random bytes, use them if we can */
+    if ((rnd = (const void *)getauxval(AT_RANDOM)) != NULL) {
+        memcpy(hash_key, rnd, sizeof(hash_key));
+        return;
+    }
+
+    if ((fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC)) >= 0) {
+        if (read(fd, hash_key, sizeof(hash_key)) == sizeof(hash_key)) {
+            close(fd);
+            return;
+        }
+        close(fd);
+    }
+
+    hash_key[0] = (uint64_t)getpid() * 0x9e3779b97f4a7c15ULL;
+    hash_key[1] = (uintptr_t)&hash_key ^ hash_key[0];
+}
+
+
+#define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND(v0, v1, v2, v3) do {                                   \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32);       \
+        v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2;                          \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0;                          \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32);       \
+    } while (0)
+
+
+static inline uint64_t load_word(const unsigned char *p, size_t n, int fold)
 {
-    uint32_t    h;
-    const char *p;
+    uint64_t w = 0;
+    size_t   i;
+
+    if (!fold && n == 8) {
+        memcpy(&w, p, sizeof(w));
+        return le64toh(w);
+    }
+
+    for (i = 0; i < n; i++)
+        w |= (uint64_t)(fold ? tolower(p[i]) : p[i]) << (8 * i);
+
+    return w;
+}
+
 
-    for (h = 0, p = key; *p; p++) {
-        h <<= 1;
-        h  ^= *p;
+static uint32_t siphash13(const char *str, int fold)
+{
+    const unsigned char *p = (const unsigned char *)str;
+    size_t               len, n;
+    uint64_t             v0, v1, v2, v3, m;
+
+    v0 = hash_key[0] ^ 0x736f6d6570736575ULL;
+    v1 = hash_key[1] ^ 0x646f72616e646f6dULL;
+    v2 = hash_key[0] ^ 0x6c7967656e657261ULL;
+    v3 = hash_key[1] ^ 0x7465646279746573ULL;
+
+    len = strlen(str);
+
+    for (n = len; n >= 8; n -= 8, p += 8) {
+        m   = load_word(p, 8, fold);
+        v3 ^= m;
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
     }
 
-    return h;
+    m   = load_word(p, n, fold) | ((uint64_t)len << 56);
+    v3 ^= m;
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= m;
+
+    v2 ^= 0xff;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+
+    m = v0 ^ v1 ^ v2 ^ v3;
+
+    return (uint32_t)(m ^ (m >> 32));
+}
+
+
+uint32_t mrp_string_hash(const void *key)
+{
+    return siphash13(key, FALSE);
+}
+
+
+int mrp_string_casecomp(const void *key1, const void *key2)
+{
+    return strcasecmp(key1, key2);
+}
+
+
+uint32_t mrp_string_casehash(const void *key)
+{
+    return siphash13(key, TRUE);
 }
@@ -37,4 +37,8 @@ int mrp_daemonize(const char *dir, const char *new_out, const char *new_err);
 int mrp_string_comp(const void *key1, const void *key2);
 uint32_t mrp_string_hash(const void *key);
 
+/* case-insensitive variants for string keys compared with strcasecmp */
+int mrp_string_casecomp(const void *key1, const void *key2);
+uint32_t mrp_string_casehash(const void *key);
+
 #endif /* __MURPHY_UTILS_H__ */
@@ -203,6 +203,14 @@ static int wsck_setopt(mrp_transport_t *mt, const char *opt, const void *val)
             return TRUE;
     }
 
+    if (!strcmp(opt, MRP_TRANSPORT_OPT_TYPEMAP)) {
+        if (t->mode != MRP_TRANSPORT_MODE_NATIVE)
+            return FALSE;
+
+        t->map = (void *)val;
+        return TRUE;
+    }
+
     success = TRUE;
 
     if (!strcmp(opt, MRP_WSCK_OPT_HTTPDIR))
@@ -515,6 +523,39 @@ static int wsck_sendcustom(mrp_transport_t *mt, void *data)
 }
 
 
+static int wsck_sendnative(mrp_transport_t *mt, void *data, uint32_t type_id)
+{
+    wsck_t  *t = (wsck_t *)mt;
+    void    *buf;
+    size_t   size;
+    int      status;
+
+    /*
+     * Notes:
+     *     The native wire format is not text, so we always send it in
+     *     binary frames, regardless of any send mode configured by the
+     *     user. Websocket framing already delimits our messages, so
+     *     unlike the stream transports we don't need a length prefix.
+     */
+
+    if (t->send_mode != WSL_SEND_BINARY) {
+        if (!wsl_set_sendmode(t->sck, WSL_SEND_BINARY))
+            return FALSE;
+
+        t->send_mode = WSL_SEND_BINARY;
+    }
+
+    if (mrp_encode_native(data, type_id, 0, &buf, &size, t->map) < 0)
+        return FALSE;
+
+    status = wsl_send(t->sck, buf, size);
+
+    mrp_free(buf);
+
+    return status;
+}
+
+
 static int wsck_sendjson(mrp_transport_t *mt, mrp_json_t *msg)
 {
     /* we could have casted and used wsck_sendcustom as well... */
@@ -1017,5 +1058,5 @@ MRP_REGISTER_TRANSPORT(wsck, WSCKP, wsck_t, wsck_resolve,
                        wsck_sendraw, NULL,
                        wsck_senddata, NULL,
                        wsck_sendcustom, NULL,
-                       NULL, NULL,
+                       wsck_sendnative, NULL,
                        wsck_sendjson, NULL);
@@ -111,6 +111,150 @@ void db_source(mrp_console_t *c, void *user_data, int argc, char **argv)
 }
 
 
+static void print_table_stats(const char *name)
+{
+    mqi_table_stats_t  st;
+    mqi_handle_t       h;
+    const char        *policy;
+    char               limit[64];
+
+    if ((h = mqi_get_table_handle((char *)name)) == MQI_HANDLE_INVALID ||
+        mqi_get_table_stats(h, &st) < 0) {
+        printf("%-24s <error %d: %s>\n", name, errno, strerror(errno));
+        return;
+    }
+
+    if (!st.quota.rows && !st.quota.bytes)
+        snprintf(limit, sizeof(limit), "-");
+    else {
+        policy = st.quota.policy == mqi_quota_evict_oldest ? "evict":"reject";
+        snprintf(limit, sizeof(limit), "%u rows/%u bytes (%s)",
+                 st.quota.rows, st.quota.bytes, policy);
+    }
+
+    printf("%-24s %8u %8u %10u %10u %8u %8u  %s\n", name,
+           st.rows, st.rows_max, st.bytes, st.bytes_max,
+           st.rejected, st.evicted, limit);
+}
+
+
+void db_stats(mrp_console_t *c, void *user_data, int argc, char **argv)
+{
+    char *names[256];
+    int   i, n;
+
+    MRP_UNUSED(c);
+    MRP_UNUSED(user_data);
+
+    printf("%-24s %8s %8s %10s %10s %8s %8s  %s\n", "table", "rows",
+           "max", "bytes", "max", "rejected", "evicted", "quota");
+
+    if (argc > 2) {
+        for (i = 2; i < argc; i++)
+            print_table_stats(argv[i]);
+    }
+    else {
+        if ((n = mqi_show_tables(MQI_ANY, names, MRP_ARRAY_SIZE(names))) < 0)
+            printf("DB error %d: %s\n", errno, strerror(errno));
+
+        for (i = 0; i < n; i++)
+            print_table_stats(names[i]);
+    }
+}
+
+
+void db_queries(mrp_console_t *c, void *user_data, int argc, char **argv)
+{
+    mqi_query_stats_t qs[64];
+    int               i, n;
+
+    MRP_UNUSED(c);
+    MRP_UNUSED(user_data);
+
+    if (argc == 3) {
+        if (!strcmp(argv[2], "reset")) {
+            mqi_reset_query_stats();
+            printf("DB query statistics reset.\n");
+        }
+        else if (!strcmp(argv[2], "enable") || !strcmp(argv[2], "disable")) {
+            mqi_enable_query_stats(argv[2][0] == 'e');
+            printf("DB query statistics %sd.\n", argv[2]);
+        }
+        else
+            printf("Invalid DB queries command '%s'.\n", argv[2]);
+        return;
+    }
+
+    if (argc != 2) {
+        printf("Invalid DB queries command.\n");
+        return;
+    }
+
+    if ((n = mqi_get_query_stats(qs, MRP_ARRAY_SIZE(qs))) < 0) {
+        printf("DB error %d: %s\n", errno, strerror(errno));
+        return;
+    }
+
+    if (!mqi_query_stats_enabled())
+        printf("DB query statistics are disabled.\n");
+
+    printf("%8s %10s %8s %8s %10s %10s  %s\n", "calls", "total ms",
+           "avg us", "max us", "scanned", "returned", "query");
+
+    for (i = 0; i < n; i++)
+        printf("%8u %10.3f %8u %8u %10llu %10llu  %s\n", qs[i].calls,
+               qs[i].total / 1000.0, (uint32_t)(qs[i].total / qs[i].calls),
+               qs[i].max, (unsigned long long)qs[i].scanned,
+               (unsigned long long)qs[i].returned, qs[i].query);
+}
+
+
+static void log_slow_query(const char *query, const char *plan,
+                           uint32_t usecs, void *user_data)
+{
+    MRP_UNUSED(user_data);
+
+    mrp_log_warning("DB: slow query (%u usecs): %s [%s]", usecs, query, plan);
+}
+
+
+void db_slowlog(mrp_console_t *c, void *user_data, int argc, char **argv)
+{
+    uint32_t  usecs;
+    char     *e;
+
+    MRP_UNUSED(c);
+    MRP_UNUSED(user_data);
+
+    if (argc == 2) {
+        if ((usecs = mqi_get_slow_query_threshold()) != 0)
+            printf("DB slow query threshold is %u usecs.\n", usecs);
+        else
+            printf("DB slow query logging is disabled.\n");
+        return;
+    }
+
+    if (argc != 3) {
+        printf("Invalid DB slowlog command.\n");
+        return;
+    }
+
+    usecs = (uint32_t)strtoul(argv[2], &e, 10);
+
+    if (*e || e == argv[2]) {
+        printf("Invalid DB slow query threshold '%s'.\n", argv[2]);
+        return;
+    }
+
+    mqi_set_slow_query_log(usecs, log_slow_query, NULL);
+
+    if (usecs)
+        printf("DB slow query threshold set to %u usecs.\n", usecs);
+    else
+        printf("DB slow query logging disabled.\n");
+}
+
+
 #define DB_GROUP_DESCRIPTION                                                \
     "Database commands provide means to manipulate the Murphy database\n"   \
     "from the console. Commands are provided for listing, describing,\n"    \
@@ -128,10 +272,37 @@ void db_source(mrp_console_t *c, void *user_data, int argc, char **argv)
 #define DBSRC_SUMMARY     "evaluate the MQL script in the given <file>"
 #define DBSRC_DESCRIPTION "Read and evaluate the contents of <file>.\n"
 
+#define DBSTATS_SYNTAX      "stats [<table> ...]"
+#define DBSTATS_SUMMARY     "show usage statistics of tables"
+#define DBSTATS_DESCRIPTION                                                 \
+    "Show the current and peak number of rows and approximate memory\n"    \
+    "usage, the number of rows rejected or evicted due to quota, and the\n" \
+    "quota itself for the given or all tables.\n"
+
+#define DBQUERIES_SYNTAX      "queries [reset|enable|disable]"
+#define DBQUERIES_SUMMARY     "show, reset, enable or disable query statistics"
+#define DBQUERIES_DESCRIPTION                                               \
+    "Show the number of executions, total, average and maximum execution\n" \
+    "time and the number of rows scanned and returned per query shape,\n"  \
+    "most expensive first, or reset all query statistics. Statistics are\n"\
+    "not collected unless enabled.\n"
+
+#define DBSLOWLOG_SYNTAX      "slowlog [<usecs>]"
+#define DBSLOWLOG_SUMMARY     "show or set the slow query threshold"
+#define DBSLOWLOG_DESCRIPTION                                               \
+    "Show or set the execution time in microseconds above which queries\n" \
+    "are logged together with their plan. 0 disables slow query logging.\n"
+
 
 MRP_CORE_CONSOLE_GROUP(db_group, "db", DB_GROUP_DESCRIPTION, NULL, {
         MRP_TOKENIZED_CMD("source", db_source, FALSE,
                           DBSRC_SYNTAX, DBSRC_SUMMARY, DBSRC_DESCRIPTION),
+        MRP_TOKENIZED_CMD("stats", db_stats, FALSE,
+                          DBSTATS_SYNTAX, DBSTATS_SUMMARY, DBSTATS_DESCRIPTION),
+        MRP_TOKENIZED_CMD("queries", db_queries, FALSE, DBQUERIES_SYNTAX,
+                          DBQUERIES_SUMMARY, DBQUERIES_DESCRIPTION),
+        MRP_TOKENIZED_CMD("slowlog", db_slowlog, FALSE, DBSLOWLOG_SYNTAX,
+                          DBSLOWLOG_SUMMARY, DBSLOWLOG_DESCRIPTION),
         MRP_RAWINPUT_CMD("eval", db_exec,
                          MRP_CONSOLE_CATCHALL | MRP_CONSOLE_SELECTABLE,
                          DBEXEC_SYNTAX, DBEXEC_SUMMARY, DBEXEC_DESCRIPTION),
@@ -37,6 +37,8 @@
 #include <sys/stat.h>
 
 #include <murphy/core/console.h>
+#include <murphy/core/lua-utils/budget.h>
+#include <murphy/core/lua-utils/profile.h>
 #include <murphy/core/lua-bindings/murphy.h>
 
 static void eval_cb(mrp_console_t *c, void *user_data, const char *grp,
@@ -60,7 +62,8 @@ static void eval_cb(mrp_console_t *c, void *user_data, const char *grp,
     top = lua_gettop(L);
 
     len = strlen(code);
-    if (luaL_loadbuffer(L, code, len, "<console>") || lua_pcall(L, 0, 0, 0))
+    if (luaL_loadbuffer(L, code, len, "<console>") ||
+        mrp_lua_pcall(L, 0, 0, 0))
         printf("Lua error: %s\n", lua_tostring(L, -1));
 
     lua_settop(L, top);
@@ -108,7 +111,7 @@ static void source_cb(mrp_console_t *c, void *user_data, int argc, char **argv)
 
                 if (len > 0) {
                     if (luaL_loadbuffer(L, code, len, path) != 0 ||
-                        lua_pcall(L, 0, 0, 0) != 0)
+                        mrp_lua_pcall(L, 0, 0, 0) != 0)
                         printf("Lua error: %s\n", lua_tostring(L, -1));
                 }
             }
@@ -282,6 +285,217 @@ static void gc_cb(mrp_console_t *c, void *user_data, int argc, char **argv)
     }
 }
 
+
+static void show_overrun(mrp_lua_overrun_t *o, void *user_data)
+{
+    int *cnt = (int *)user_data;
+
+    printf("    %s: %u instruction, %u time overruns\n", o->name,
+           o->insns, o->msecs);
+    (*cnt)++;
+}
+
+
+static void budget_cb(mrp_console_t *c, void *user_data, int argc, char **argv)
+{
+    uint32_t  insns, msecs;
+    char     *e;
+    int       cnt;
+
+    MRP_UNUSED(c);
+    MRP_UNUSED(user_data);
+
+    switch (argc) {
+    case 2:
+    show:
+        mrp_lua_get_budget(&insns, &msecs);
+        printf("Lua execution budget: %u instructions, %u msecs\n",
+               insns, msecs);
+        printf("Budget overruns:\n");
+        cnt = 0;
+        mrp_lua_foreach_overrun(show_overrun, &cnt);
+        if (!cnt)
+            printf("    none\n");
+        break;
+
+    case 3:
+        if (!strcmp(argv[2], "show"))
+            goto show;
+        else if (!strcmp(argv[2], "reset")) {
+            mrp_lua_reset_overruns();
+            printf("Lua execution budget overrun counters reset.\n");
+        }
+        else
+        invalid:
+            printf("Invalid Lua execution budget command.\n");
+        break;
+
+    case 5:
+        if (strcmp(argv[2], "set"))
+            goto invalid;
+
+        insns = (uint32_t)strtoul(argv[3], &e, 10);
+        if (*e) {
+            printf("Invalid Lua instruction budget '%s'.\n", argv[3]);
+            return;
+        }
+
+        msecs = (uint32_t)strtoul(argv[4], &e, 10);
+        if (*e) {
+            printf("Invalid Lua time budget '%s'.\n", argv[4]);
+            return;
+        }
+
+        mrp_lua_set_budget(insns, msecs);
+        printf("Lua execution budget set to %u instructions, %u msecs.\n",
+               insns, msecs);
+        break;
+
+    default:
+        goto invalid;
+    }
+}
+
+
+static void profile_cb(mrp_console_t *c, void *user_data, int argc, char **argv)
+{
+    mrp_lua_profile_stats_t  st;
+    FILE                    *fp;
+    uint32_t                 hz;
+    char                    *e;
+    int                      n;
+
+    MRP_UNUSED(c);
+    MRP_UNUSED(user_data);
+
+    if (argc < 3 || !strcmp(argv[2], "show")) {
+        mrp_lua_profile_stats(&st);
+        printf("Lua profiler is %s (%u Hz).\n",
+               st.active ? "running" : "stopped", st.hz);
+        printf("    samples: %llu (%llu dropped), unique stacks: %u\n",
+               (unsigned long long)st.samples,
+               (unsigned long long)st.dropped, st.stacks);
+        printf("    profiled Lua time: %.3f msecs, sampling overhead: "
+               "%.3f msecs (%.2f %%)\n", st.runtime / 1000000.0,
+               st.overhead / 1000000.0,
+               st.runtime ? 100.0 * st.overhead / st.runtime : 0.0);
+    }
+    else if (!strcmp(argv[2], "start") && argc <= 4) {
+        hz = 0;
+        if (argc == 4) {
+            hz = (uint32_t)strtoul(argv[3], &e, 10);
+            if (*e || !hz) {
+                printf("Invalid Lua profiler sampling rate '%s'.\n", argv[3]);
+                return;
+            }
+        }
+
+        if (mrp_lua_profile_start(hz) < 0)
+            printf("Failed to start Lua profiler (%d: %s).\n",
+                   errno, strerror(errno));
+        else
+            printf("Lua profiler started.\n");
+    }
+    else if (!strcmp(argv[2], "stop") && argc == 3) {
+        mrp_lua_profile_stop();
+        printf("Lua profiler stopped.\n");
+    }
+    else if (!strcmp(argv[2], "reset") && argc == 3) {
+        mrp_lua_profile_reset();
+        printf("Lua profiler samples discarded.\n");
+    }
+    else if (!strcmp(argv[2], "dump") && argc <= 4) {
+        if (argc == 4) {
+            if ((fp = fopen(argv[3], "w")) == NULL) {
+                printf("Failed to open %s (%d: %s).\n", argv[3],
+                       errno, strerror(errno));
+                return;
+            }
+
+            n = mrp_lua_profile_dump(fp);
+            fclose(fp);
+
+            printf("Dumped %d Lua stacks to %s.\n", n, argv[3]);
+        }
+        else
+            mrp_lua_profile_dump(stdout);
+    }
+    else
+        printf("Invalid Lua profiler command.\n");
+}
+
+
+static void heap_cb(mrp_console_t *c, void *user_data, int argc, char **argv)
+{
+    mrp_lua_memory_stats_t  st;
+    uint32_t                kbytes;
+    char                   *e;
+
+    MRP_UNUSED(c);
+    MRP_UNUSED(user_data);
+
+    if (argc < 3 || (argc == 3 && !strcmp(argv[2], "show"))) {
+        mrp_lua_get_memory_stats(&st);
+
+        if (st.limit)
+            printf("Lua heap: %zu kB used, %zu kB peak, %zu kB limit\n",
+                   st.used / 1024, st.peak / 1024, st.limit / 1024);
+        else
+            printf("Lua heap: %zu kB used, %zu kB peak, unlimited\n",
+                   st.used / 1024, st.peak / 1024);
+        printf("    allocations failed due to limit: %u\n", st.failed);
+        printf("    unprotected allocations over limit: %u\n", st.overshot);
+        printf("    collector heap size: %zu kB\n", st.gcsize / 1024);
+        printf("    collector pauses: %u (%u skipped/cut short near limit)\n",
+               st.pauses, st.skipped);
+        printf("    idle steps: %llu (%d kB each), cycles completed: %llu\n",
+               (unsigned long long)st.steps, st.stepsize,
+               (unsigned long long)st.cycles);
+        printf("    idle step time: %llu usecs total, %llu usecs max\n",
+               (unsigned long long)st.steptime,
+               (unsigned long long)st.maxstep);
+        return;
+    }
+
+    if (argc != 4)
+        goto invalid;
+
+    kbytes = (uint32_t)strtoul(argv[3], &e, 10);
+    if (*e) {
+        printf("Invalid size '%s'.\n", argv[3]);
+        return;
+    }
+
+    if (!strcmp(argv[2], "limit")) {
+        mrp_lua_set_heap_limit(kbytes);
+        printf("Lua heap limit set to %u kB.\n", kbytes);
+    }
+    else if (!strcmp(argv[2], "step")) {
+        mrp_lua_gc_set_stepsize((int)kbytes);
+        printf("Lua idle collection step size set to %u kB.\n", kbytes);
+    }
+    else
+    invalid:
+        printf("Invalid Lua heap command.\n");
+}
+
+static void reload_cb(mrp_console_t *c, void *user_data, int argc, char **argv)
+{
+    MRP_UNUSED(c);
+    MRP_UNUSED(user_data);
+    MRP_UNUSED(argc);
+    MRP_UNUSED(argv);
+
+    if (mrp_lua_reload_config() < 0) {
+        printf("Failed to reload Lua configuration (%d: %s), "
+               "keeping the old one.\n", errno, strerror(errno));
+        return;
+    }
+
+    mrp_lua_finish_reload(TRUE);
+    printf("Reloaded Lua configuration.\n");
+}
+
 #define LUA_GROUP_DESCRIPTION                                    \
     "Lua commands allows one to evaluate Lua code either from\n" \
     "the console command line itself, or from sourced files.\n"
@@ -324,6 +538,40 @@ static void gc_cb(mrp_console_t *c, void *user_data, int argc, char **argv)
 #define GC_SUMMARY       "trigger or configure the Lua garbage collector"
 #define GC_DESCRIPTION   "Trigger or configure the Lua garbage collector."
 
+#define HEAP_SYNTAX      "heap [show|limit <kbytes>|step <kbytes>]"
+#define HEAP_SUMMARY     "show Lua heap statistics or configure the heap"
+#define HEAP_DESCRIPTION                                                     \
+    "Show Lua heap and garbage collection statistics, set the Lua heap\n"   \
+    "limit (0 for unlimited) or set the size of the incremental garbage\n"  \
+    "collection steps taken when the daemon is idle.\n"
+
+#define RELOAD_SYNTAX    "reload"
+#define RELOAD_SUMMARY   "reload the Lua configuration"
+#define RELOAD_DESCRIPTION                                                   \
+    "Rerun the main Lua configuration file in reload mode. Existing\n"     \
+    "plugins, zones, application and resource classes, tables, selects\n" \
+    "and decision elements are kept, adding new ones is an error. The\n"  \
+    "update functions of elements and sinks and the resource vetoes are\n"\
+    "replaced only if the whole file runs without errors.\n"
+
+#define BUDGET_SYNTAX    "budget [show|reset|set <instructions> <msecs>]"
+#define BUDGET_SUMMARY   "show or configure Lua execution budgets"
+#define BUDGET_DESCRIPTION                                                   \
+    "Show or configure the per-invocation execution budget of Lua code\n"    \
+    "called from C, or show or reset the per-function budget overrun\n"     \
+    "counters. A budget of 0 means unlimited. Functions running over\n"     \
+    "their budget are aborted and their traceback gets logged.\n"
+
+#define PROFILE_SYNTAX   "profile [show|start [<hz>]|stop|reset|dump [<file>]]"
+#define PROFILE_SUMMARY  "control the Lua sampling profiler"
+#define PROFILE_DESCRIPTION                                                  \
+    "Start, stop, reset or show the status of the Lua sampling profiler,\n" \
+    "or dump the collected samples to the console or to <file>. Samples\n"  \
+    "are taken <hz> times per second of executed Lua code (1000 if not\n"   \
+    "given) and are dumped in collapsed-stack format, one stack per line\n" \
+    "prefixed by the C entry point that invoked Lua, suitable as input to\n"\
+    "flame graph generators.\n"
+
 MRP_CORE_CONSOLE_GROUP(lua_group, "lua", LUA_GROUP_DESCRIPTION, NULL, {
         MRP_TOKENIZED_CMD("source", source_cb, FALSE,
                           SOURCE_SYNTAX, SOURCE_SUMMARY, SOURCE_DESCRIPTION),
@@ -336,4 +584,12 @@ MRP_CORE_CONSOLE_GROUP(lua_group, "lua", LUA_GROUP_DESCRIPTION, NULL, {
                           DUMP_SYNTAX, DUMP_SUMMARY, DUMP_DESCRIPTION),
         MRP_TOKENIZED_CMD("gc", gc_cb, FALSE,
                           GC_SYNTAX, GC_SUMMARY, GC_DESCRIPTION),
+        MRP_TOKENIZED_CMD("heap", heap_cb, FALSE,
+                          HEAP_SYNTAX, HEAP_SUMMARY, HEAP_DESCRIPTION),
+        MRP_TOKENIZED_CMD("reload", reload_cb, FALSE,
+                          RELOAD_SYNTAX, RELOAD_SUMMARY, RELOAD_DESCRIPTION),
+        MRP_TOKENIZED_CMD("budget", budget_cb, FALSE,
+                          BUDGET_SYNTAX, BUDGET_SUMMARY, BUDGET_DESCRIPTION),
+        MRP_TOKENIZED_CMD("profile", profile_cb, FALSE,
+                          PROFILE_SYNTAX, PROFILE_SUMMARY, PROFILE_DESCRIPTION),
     });
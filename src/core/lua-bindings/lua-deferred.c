@@ -39,6 +39,7 @@
 #include <murphy/common/mainloop.h>
 #include <murphy/core/lua-utils/error.h>
 #include <murphy/core/lua-utils/object.h>
+#include <murphy/core/lua-utils/budget.h>
 #include <murphy/core/lua-bindings/murphy.h>
 
 #define DEFERRED_LUA_CLASS MRP_LUA_CLASS(deferred, lua)
@@ -114,7 +115,7 @@ static void deferred_lua_cb(mrp_deferred_t *deferred, void *user_data)
     if (mrp_lua_object_deref_value(d, d->L, d->callback, false)) {
         mrp_lua_push_object(d->L, d);
 
-        if (lua_pcall(d->L, 1, 0, 0) != 0) {
+        if (mrp_lua_budget_pcall(d->L, 1, 0, NULL) != 0) {
             mrp_log_error("failed to invoke Lua deferred callback, disabling");
             mrp_disable_deferred(d->d);
             d->disabled = true;
@@ -34,6 +34,7 @@
 
 #include <murphy/common.h>
 #include <murphy/core/lua-utils/object.h>
+#include <murphy/core/lua-utils/budget.h>
 #include <murphy/core/lua-bindings/murphy.h>
 
 /* This is a placeholder for proper Murphy event system. The facilities for
@@ -155,7 +156,7 @@ static void evtwatch_lua_cb(mrp_event_watch_t *watch, uint32_t id,
         mrp_lua_push_object(w->L, w);
         lua_pushinteger(w->L, id);
 
-        if (lua_pcall(w->L, 2, 0, 0) != 0) {
+        if (mrp_lua_budget_pcall(w->L, 2, 0, NULL) != 0) {
             mrp_log_error("failed to invoke Lua event watch callback (%s), "
                           "stopping", lua_tostring(w->L, -1));
             evtwatch_stop(w);
@@ -38,6 +38,7 @@
 #include <murphy/core/plugin.h>
 
 #include <murphy/core/lua-utils/include.h>
+#include <murphy/core/lua-utils/budget.h>
 #include <murphy/core/lua-bindings/murphy.h>
 
 static MRP_LIST_HOOK(included);
@@ -147,6 +148,56 @@ static int disable_include(lua_State *L)
 }
 
 
+static int set_budget(lua_State *L)
+{
+    lua_Integer insns, msecs;
+
+    if (lua_isuserdata(L, 1))
+        lua_remove(L, 1);                /* remove self if any */
+
+    insns = luaL_checkinteger(L, 1);
+    msecs = luaL_optinteger(L, 2, 0);
+
+    if (insns < 0 || msecs < 0)
+        return luaL_error(L, "invalid negative execution budget");
+
+    mrp_lua_set_budget((uint32_t)insns, (uint32_t)msecs);
+
+    mrp_log_info("Lua execution budget set to %u instructions, %u msecs.",
+                 (uint32_t)insns, (uint32_t)msecs);
+
+    lua_settop(L, 0);
+    return 0;
+}
+
+
+static int set_heap_limit(lua_State *L)
+{
+    lua_Integer kbytes, step;
+
+    if (lua_isuserdata(L, 1))
+        lua_remove(L, 1);                /* remove self if any */
+
+    kbytes = luaL_checkinteger(L, 1);
+    step   = luaL_optinteger(L, 2, 0);
+
+    if (kbytes < 0 || step < 0)
+        return luaL_error(L, "invalid negative heap limit or GC step size");
+
+    if (kbytes && (size_t)kbytes < 1 + (size_t)lua_gc(L, LUA_GCCOUNT, 0))
+        return luaL_error(L, "heap limit %d kB below current heap size",
+                          (int)kbytes);
+
+    mrp_lua_set_heap_limit((size_t)kbytes);
+    mrp_lua_gc_set_stepsize((int)step);
+
+    mrp_log_info("Lua heap limit set to %u kbytes.", (unsigned int)kbytes);
+
+    lua_settop(L, 0);
+    return 0;
+}
+
+
 static int open_stdlibs(lua_State *L)
 {
     luaL_openlibs(L);
@@ -223,4 +274,6 @@ MURPHY_REGISTER_LUA_BINDINGS(murphy, NULL,
                              { "include_once"    , include_once_luafile },
                              { "try_include"     , try_luafile          },
                              { "try_include_once", try_once_luafile     },
-                             { "disable_include" , disable_include      });
+                             { "disable_include" , disable_include      },
+                             { "set_budget"      , set_budget           },
+                             { "set_heap_limit"  , set_heap_limit       });
@@ -28,15 +28,20 @@
  */
 
 #include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
 
 #include <lualib.h>
 #include <lauxlib.h>
 
 #include <murphy/common/mm.h>
 #include <murphy/common/log.h>
+#include <murphy/common/mainloop.h>
 #include <murphy/core/plugin.h>
 #include <murphy/core/lua-utils/lua-compat.h>
 #include <murphy/core/lua-utils/funcbridge.h>
+#include <murphy/core/lua-utils/budget.h>
 #include <murphy/core/lua-decision/mdb.h>
 #include <murphy/core/lua-decision/element.h>
 #include <murphy/core/lua-bindings/murphy.h>
@@ -49,6 +54,8 @@ static char *config_file;
 static char *config_dir;
 
 static lua_Alloc setup_allocator(void);
+static int lua_panic(lua_State *L);
+static void gc_restart_near_limit(void);
 
 
 static int create_murphy_object(lua_State *L)
@@ -143,12 +150,10 @@ static lua_State *init_lua(void)
     lua_Alloc  A = setup_allocator();
     lua_State *L;
 
-    if (A == NULL)
-        L = luaL_newstate();
-    else
-        L = lua_newstate(A, NULL);
+    L = lua_newstate(A, NULL);
 
     if (L != NULL) {
+        lua_atpanic(L, lua_panic);
         luaopen_base(L);
         init_lua_utils(L);
         init_lua_decision(L);
@@ -280,6 +285,171 @@ const char *mrp_lua_get_murphy_lua_config_dir(void)
 }
 
 
+/*
+ * configuration reload
+ *
+ * The configuration is reloaded by running the main configuration file
+ * again in reload mode. Objects that own runtime state (plugins, zones,
+ * application and resource classes, tables, selects, decision elements)
+ * are not recreated in this mode, their constructors look up and return
+ * the existing ones and refuse to add new ones. Replaceable Lua hooks
+ * (element and sink update functions, resource vetoes) are not swapped
+ * in right away but staged, and the staged changes are either committed
+ * or discarded once the reload is finished.
+ */
+
+typedef struct {
+    mrp_list_hook_t      hook;           /* to list of staged changes */
+    mrp_lua_reload_cb_t  cb;             /* commit/discard callback */
+    void                *data;           /* opaque callback data */
+} staged_t;
+
+MRP_REGISTER_EVENTS(lua_events,
+                    MRP_EVENT(MRP_LUA_EVENT_RELOAD, 0));
+
+static MRP_LIST_HOOK(staged);
+static int reloading;                    /* running config in reload mode */
+static int reload_pending;               /* reload waiting to be finished */
+
+
+int mrp_lua_reload_config(void)
+{
+    lua_State *L = mrp_lua_get_lua_state();
+    int        top;
+
+    if (L == NULL || config_file == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (reload_pending) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    top = lua_gettop(L);
+
+    if (luaL_loadfile(L, config_file) != 0) {
+        mrp_log_error("Failed to load Lua configuration '%s' (%s).",
+                      config_file, lua_tostring(L, -1));
+        lua_settop(L, top);
+        errno = EINVAL;
+        return -1;
+    }
+
+    reloading      = TRUE;
+    reload_pending = TRUE;
+
+    if (mrp_lua_pcall(L, 0, 0, 0) != 0) {
+        mrp_log_error("Failed to reload Lua configuration '%s' (%s).",
+                      config_file, lua_tostring(L, -1));
+        lua_settop(L, top);
+        mrp_lua_finish_reload(FALSE);
+        errno = EINVAL;
+        return -1;
+    }
+
+    lua_settop(L, top);
+    reloading = FALSE;
+
+    return 0;
+}
+
+
+void mrp_lua_finish_reload(int commit)
+{
+    lua_State       *L = mrp_lua_get_lua_state();
+    mrp_list_hook_t *p, *n;
+    staged_t        *s;
+    mrp_event_bus_t *bus;
+
+    if (!reload_pending)
+        return;
+
+    mrp_list_foreach(&staged, p, n) {
+        s = mrp_list_entry(p, typeof(*s), hook);
+
+        mrp_list_delete(&s->hook);
+        s->cb(L, s->data, commit);
+        mrp_free(s);
+    }
+
+    reloading      = FALSE;
+    reload_pending = FALSE;
+
+    if (!commit) {
+        mrp_log_info("Discarded Lua configuration reload.");
+        return;
+    }
+
+    mrp_log_info("Reloaded Lua configuration '%s'.", config_file);
+
+    if ((bus = mrp_event_bus_get(context->ml, MRP_LUA_BUS)) != NULL)
+        mrp_event_emit_msg(bus, lua_events[0].id, MRP_EVENT_SYNCHRONOUS,
+                           MRP_MSG_END);
+}
+
+
+int mrp_lua_config_reloading(void)
+{
+    return reloading;
+}
+
+
+int mrp_lua_stage_reload(mrp_lua_reload_cb_t cb, void *data)
+{
+    staged_t *s;
+
+    if (!reloading) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((s = mrp_allocz(sizeof(*s))) == NULL)
+        return -1;
+
+    mrp_list_init(&s->hook);
+    s->cb   = cb;
+    s->data = data;
+
+    mrp_list_append(&staged, &s->hook);
+
+    return 0;
+}
+
+
+int mrp_lua_reload_object(lua_State *L, mrp_lua_classdef_t *def, int t)
+{
+    const char *name;
+
+    if (!reloading)
+        return FALSE;
+
+    if (t < 0 && t > LUA_REGISTRYINDEX)
+        t = lua_gettop(L) + t + 1;
+
+    luaL_checktype(L, t, LUA_TTABLE);
+
+    lua_getfield(L, t, "name");
+    name = lua_tostring(L, -1);
+
+    if (name == NULL)
+        return luaL_error(L, "missing or wrong name field");
+
+    mrp_lua_find_object(L, def, name);
+
+    if (lua_isnil(L, -1))
+        return luaL_error(L, "can't add %s '%s' by a configuration reload",
+                          def->class_name, name);
+
+    lua_remove(L, -2);
+
+    mrp_debug("reusing %s '%s' on reload", def->class_name, name);
+
+    return TRUE;
+}
+
+
 /*
  * runtime debugging
  */
@@ -597,16 +767,94 @@ static void *lua_alloc(void *ud, void *optr, size_t olsize, size_t nlsize)
 }
 
 
+/*
+ * Lua heap limit
+ *
+ * All Lua allocations are accounted for, and if a heap limit is set any
+ * allocation inside a protected call that would push the heap above it
+ * fails. Lua turns these into ordinary memory errors, failing the
+ * offending script instead of letting a leaking policy grow the daemon
+ * without bound. Outside of protected calls (C pushing arguments, setting
+ * up objects, etc.) a memory error would end up in the panic handler and
+ * terminate the daemon, so there the limit is allowed to be overshot and
+ * we only count how often this happens. If the collector is stopped for
+ * a recalculation when the heap gets close to the limit, it is restarted
+ * right away, so that the limit is not hit just for lack of collection.
+ */
+
+static struct {
+    size_t   limit;                      /* heap limit, 0 for unlimited */
+    size_t   used;                       /* bytes currently in use */
+    size_t   peak;                       /* peak bytes in use */
+    uint32_t failed;                     /* allocations failed due to limit */
+    uint32_t overshot;                   /* unprotected allocations over it */
+    int      tracking;                   /* whether tracking allocations */
+} heap;
+
+
+static void *heap_alloc(void *ud, void *optr, size_t olsize, size_t nlsize)
+{
+    void *nptr;
+
+    if (optr == NULL)                    /* Lua 5.2+ passes a type tag here */
+        olsize = 0;
+
+    if (nlsize > olsize && heap.limit &&
+        heap.used - olsize + nlsize > heap.limit / 8 * 7) {
+        gc_restart_near_limit();
+
+        if (heap.used - olsize + nlsize > heap.limit) {
+            if (mrp_lua_in_pcall()) {
+                heap.failed++;
+                return NULL;
+            }
+
+            heap.overshot++;
+        }
+    }
+
+    if (heap.tracking)
+        nptr = lua_alloc(ud, optr, olsize, nlsize);
+    else {
+        if (nlsize > 0)
+            nptr = realloc(optr, nlsize);
+        else {
+            free(optr);
+            nptr = NULL;
+        }
+    }
+
+    if (nptr != NULL || nlsize == 0) {
+        heap.used = heap.used - olsize + nlsize;
+
+        if (heap.used > heap.peak)
+            heap.peak = heap.used;
+    }
+
+    return nptr;
+}
+
+
+static int lua_panic(lua_State *L)
+{
+    mrp_log_error("Unprotected Lua error: %s",
+                  lua_isstring(L, -1) ? lua_tostring(L, -1) : "<unknown>");
+
+    return 0;
+}
+
+
 static lua_Alloc setup_allocator(void)
 {
     int debug;
 
-    debug = mrp_mm_config_bool("lua", FALSE);
+    heap.limit = 1024 * (size_t)mrp_mm_config_uint32("lua_limit", 0);
+    debug      = mrp_mm_config_bool("lua", FALSE);
 
     if (!debug) {
         mrp_debug("%s not set to debug*, using native Lua allocator",
                   MRP_MM_CONFIG_ENVVAR);
-        return NULL;
+        heap.tracking = FALSE;
     }
     else {
         mrp_debug("Lua memory tracking enabled, overriding native allocator");
@@ -614,6 +862,174 @@ static lua_Alloc setup_allocator(void)
         mrp_list_init(&memblks);
         mrp_lua_track_objects(true);
 
-        return lua_alloc;
+        heap.tracking = TRUE;
+    }
+
+    if (heap.limit)
+        mrp_log_info("Lua heap limited to %zu kbytes.", heap.limit / 1024);
+
+    return heap_alloc;
+}
+
+
+void mrp_lua_set_heap_limit(size_t kbytes)
+{
+    heap.limit = kbytes * 1024;
+}
+
+
+/*
+ * Lua garbage collection pacing
+ *
+ * Recalculations run with the collector stopped, so that collection work
+ * does not land in the middle of them as latency spikes. Once the
+ * outermost recalculation is done, the collector is restarted and an idle
+ * (deferred) callback performs incremental collection steps from the
+ * mainloop until the current cycle is completed or a maximum number of
+ * steps have been taken. If the heap is close to its limit, the collector
+ * is left running during recalculations, and restarted if it gets there
+ * during one.
+ */
+
+#define GC_STEPSIZE  16                  /* default step size, in kbytes */
+#define GC_MAXSTEPS  64                  /* max. idle steps per round */
+
+static struct {
+    int             paused;              /* pause nesting depth */
+    int             stopped;             /* whether we stopped the collector */
+    mrp_deferred_t *idle;                /* idle-time collection */
+    int             stepsize;            /* step size for LUA_GCSTEP */
+    int             nstep;               /* steps taken in this round */
+    uint32_t        pauses;              /* number of collector pauses */
+    uint32_t        skipped;             /* pauses skipped or cut short */
+    uint64_t        steps;               /* total idle steps taken */
+    uint64_t        cycles;              /* cycles completed by idle steps */
+    uint64_t        steptime;            /* total idle step time (usecs) */
+    uint64_t        maxstep;             /* longest idle step (usecs) */
+} gc = {
+    .stepsize = GC_STEPSIZE,
+};
+
+
+static inline uint64_t gc_usecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+
+static void gc_idle_cb(mrp_deferred_t *d, void *user_data)
+{
+    lua_State *L = mrp_lua_get_lua_state();
+    uint64_t   start, diff;
+    int        done;
+
+    MRP_UNUSED(user_data);
+
+    if (L == NULL || gc.paused) {
+        mrp_disable_deferred(d);
+        return;
     }
+
+    start = gc_usecs();
+    done  = lua_gc(L, LUA_GCSTEP, gc.stepsize);
+    diff  = gc_usecs() - start;
+
+    gc.steps++;
+    gc.steptime += diff;
+
+    if (diff > gc.maxstep)
+        gc.maxstep = diff;
+
+    if (done)
+        gc.cycles++;
+
+    if (done || ++gc.nstep >= GC_MAXSTEPS)
+        mrp_disable_deferred(d);
+}
+
+
+void mrp_lua_gc_pause(void)
+{
+    lua_State *L = mrp_lua_get_lua_state();
+
+    if (gc.paused++ || L == NULL)
+        return;
+
+    if (heap.limit && heap.used > heap.limit / 8 * 7) {
+        gc.skipped++;
+        return;
+    }
+
+    lua_gc(L, LUA_GCSTOP, 0);
+    gc.stopped = TRUE;
+    gc.pauses++;
+}
+
+
+static void gc_restart_near_limit(void)
+{
+    lua_State *L = mrp_lua_get_lua_state();
+
+    if (!gc.stopped || L == NULL)
+        return;
+
+    /* only resets the collection threshold, safe within the allocator */
+    lua_gc(L, LUA_GCRESTART, 0);
+    gc.stopped = FALSE;
+    gc.skipped++;
+}
+
+
+void mrp_lua_gc_resume(void)
+{
+    lua_State *L = mrp_lua_get_lua_state();
+
+    if (gc.paused <= 0 || --gc.paused > 0 || L == NULL)
+        return;
+
+    if (gc.stopped) {
+        lua_gc(L, LUA_GCRESTART, 0);
+        gc.stopped = FALSE;
+    }
+
+    if (gc.idle == NULL) {
+        gc.idle = mrp_add_deferred(context->ml, gc_idle_cb, NULL);
+
+        if (gc.idle == NULL)
+            return;
+    }
+    else
+        mrp_enable_deferred(gc.idle);
+
+    gc.nstep = 0;
+}
+
+
+void mrp_lua_gc_set_stepsize(int kbytes)
+{
+    gc.stepsize = kbytes > 0 ? kbytes : GC_STEPSIZE;
+}
+
+
+void mrp_lua_get_memory_stats(mrp_lua_memory_stats_t *st)
+{
+    lua_State *L = mrp_lua_get_lua_state();
+
+    st->limit    = heap.limit;
+    st->used     = heap.used;
+    st->peak     = heap.peak;
+    st->failed   = heap.failed;
+    st->overshot = heap.overshot;
+    st->gcsize   = L ? 1024 * (size_t)lua_gc(L, LUA_GCCOUNT, 0) : 0;
+    st->stepsize = gc.stepsize;
+    st->pauses   = gc.pauses;
+    st->skipped  = gc.skipped;
+    st->steps    = gc.steps;
+    st->cycles   = gc.cycles;
+    st->steptime = gc.steptime;
+    st->maxstep  = gc.maxstep;
 }
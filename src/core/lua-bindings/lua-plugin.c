@@ -374,19 +374,31 @@ static int load(lua_State *L, int may_fail)
         break;
     }
 
-    plugin = mrp_load_plugin(ctx, name, instance, narg ? args : NULL, narg);
+    if (mrp_lua_config_reloading()) {
+        /* plugins are kept as they are, new ones can't be started */
+        success = mrp_plugin_loaded(ctx, instance ? instance : name);
 
-    if (plugin != NULL) {
-        plugin->may_fail = may_fail;
-
-        success = TRUE;
+        if (!success && !may_fail)
+            return luaL_error(L, "can't load plugin %s (as instance %s) "
+                              "on reload", name, instance ? instance : name);
     }
     else {
-        success = FALSE;
+        plugin = mrp_load_plugin(ctx, name, instance, narg ? args : NULL,
+                                 narg);
+
+        if (plugin != NULL) {
+            plugin->may_fail = may_fail;
+
+            success = TRUE;
+        }
+        else {
+            success = FALSE;
 
-        if (!may_fail)
-            return luaL_error(L, "failed to load plugin %s (as instance %s)",
-                              name, instance ? instance : name);
+            if (!may_fail)
+                return luaL_error(L, "failed to load plugin %s "
+                                  "(as instance %s)",
+                                  name, instance ? instance : name);
+        }
     }
 
     while (narg > 0) {
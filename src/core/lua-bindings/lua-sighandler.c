@@ -39,6 +39,7 @@
 #include <murphy/common/mainloop.h>
 #include <murphy/core/lua-utils/object.h>
 #include <murphy/core/lua-utils/funcbridge.h>
+#include <murphy/core/lua-utils/budget.h>
 #include <murphy/core/lua-bindings/murphy.h>
 
 #define SIGHANDLER_LUA_CLASS MRP_LUA_CLASS(sighandler, lua)
@@ -118,7 +119,7 @@ static void sighandler_lua_cb(mrp_sighandler_t *hlr, int sig, void *user_data)
         else
             lua_pushinteger(h->L, sig);
 
-        if (lua_pcall(h->L, 2, 0, 0) != 0)
+        if (mrp_lua_budget_pcall(h->L, 2, 0, NULL) != 0)
             mrp_log_error("failed to invoke Lua sighandler callback");
     }
 
@@ -39,6 +39,7 @@
 #include <murphy/common/mainloop.h>
 #include <murphy/core/lua-utils/object.h>
 #include <murphy/core/lua-utils/funcbridge.h>
+#include <murphy/core/lua-utils/budget.h>
 #include <murphy/core/lua-bindings/murphy.h>
 
 
@@ -53,6 +54,7 @@ typedef struct {
     mrp_context_t *ctx;                  /* murphy context */
     mrp_timer_t   *t;                    /* associated murphy timer */
     unsigned int   msecs;                /* timer interval in milliseconds */
+    unsigned int   slack;                /* allowed delay in milliseconds */
     int            callback;             /* reference to callback */
     bool           oneshot;              /* true for one-shot timers */
 } timer_lua_t;
@@ -87,13 +89,15 @@ MRP_LUA_METHOD_LIST_TABLE(timer_lua_overrides,
 MRP_LUA_MEMBER_LIST_TABLE(timer_lua_members,
     MRP_LUA_CLASS_INTEGER("interval", OFFS(msecs)   , NULL, NULL, NOTIFY)
     MRP_LUA_CLASS_LFUNC  ("callback", OFFS(callback), NULL, NULL, NOTIFY)
-    MRP_LUA_CLASS_BOOLEAN("oneshot" , OFFS(oneshot) , NULL, NULL, NOTIFY));
+    MRP_LUA_CLASS_BOOLEAN("oneshot" , OFFS(oneshot) , NULL, NULL, NOTIFY)
+    MRP_LUA_CLASS_INTEGER("slack"   , OFFS(slack)   , NULL, NULL, NOTIFY));
 
 
 typedef enum {
     TIMER_MEMBER_INTERVAL,
     TIMER_MEMBER_CALLBACK,
-    TIMER_MEMBER_ONESHOT
+    TIMER_MEMBER_ONESHOT,
+    TIMER_MEMBER_SLACK
 } timer_member_t;
 
 MRP_LUA_DEFINE_CLASS(timer, lua, timer_lua_t, timer_lua_destroy,
@@ -116,7 +120,7 @@ static void timer_lua_cb(mrp_timer_t *timer, void *user_data)
     if (mrp_lua_object_deref_value(t, t->L, t->callback, false)) {
         mrp_lua_push_object(t->L, t);
 
-        if (lua_pcall(t->L, 1, 0, 0) != 0) {
+        if (mrp_lua_budget_pcall(t->L, 1, 0, NULL) != 0) {
             mrp_log_error("failed to invoke Lua timer callback, stopping");
             mrp_del_timer(t->t);
             t->t = NULL;
@@ -147,7 +151,8 @@ static void timer_lua_changed(void *data, lua_State *L, int member)
             mrp_mod_timer(t->t, t->msecs);
         else {
         enable:
-            t->t = mrp_add_timer(t->ctx->ml, t->msecs, timer_lua_cb, t);
+            t->t = mrp_add_timer_full(t->ctx->ml, t->msecs, t->slack,
+                                      timer_lua_cb, t);
             if (t->t == NULL)
                 luaL_error(L, "failed to create Murphy timer");
         }
@@ -164,6 +169,10 @@ static void timer_lua_changed(void *data, lua_State *L, int member)
         }
         break;
 
+    case TIMER_MEMBER_SLACK:
+        mrp_set_timer_slack(t->t, t->slack);
+        break;
+
     default:
         break;
     }
@@ -189,6 +198,7 @@ static int timer_lua_create(lua_State *L)
     t->ctx      = ctx;
     t->callback = LUA_NOREF;
     t->msecs    = 5000;
+    t->slack    = MRP_TIMER_SLACK_DEFAULT;
 
     switch (narg) {
     case 1:
@@ -203,7 +213,8 @@ static int timer_lua_create(lua_State *L)
     }
 
     if (t->callback != LUA_NOREF && t->callback != LUA_REFNIL && t->t == NULL) {
-        t->t = mrp_add_timer(t->ctx->ml, t->msecs, timer_lua_cb, t);
+        t->t = mrp_add_timer_full(t->ctx->ml, t->msecs, t->slack,
+                                  timer_lua_cb, t);
 
         if (t->t == NULL)
             return luaL_error(L, "failed to create Murphy timer");
@@ -262,7 +273,8 @@ static int timer_lua_start(lua_State *L)
     }
 
     if (t->t == NULL && t->callback != LUA_NOREF)
-        t->t = mrp_add_timer(t->ctx->ml, t->msecs, timer_lua_cb, t);
+        t->t = mrp_add_timer_full(t->ctx->ml, t->msecs, t->slack,
+                                  timer_lua_cb, t);
 
     lua_pushboolean(L, t->t != NULL);
 
@@ -43,6 +43,7 @@
 #include <murphy/core/lua-utils/error.h>
 #include <murphy/core/lua-utils/object.h>
 #include <murphy/core/lua-utils/funcbridge.h>
+#include <murphy/core/lua-utils/budget.h>
 #include <murphy/core/lua-bindings/murphy.h>
 #include <murphy/core/lua-bindings/lua-json.h>
 
@@ -541,7 +542,7 @@ static void event_connect(mrp_transport_t *mt, void *user_data)
         lua_pushliteral(t->L, "<remote address should be here>");
         mrp_lua_object_deref_value(t, t->L, t->data, true);
 
-        if (lua_pcall(t->L, 3, 0, 0) != 0)
+        if (mrp_lua_budget_pcall(t->L, 3, 0, NULL) != 0)
             mrp_log_error("failed to invoke transport connect callback");
     }
 
@@ -566,7 +567,7 @@ static void event_closed(mrp_transport_t *mt, int error, void *user_data)
         lua_pushinteger(t->L, error);
         mrp_lua_object_deref_value(t, t->L, t->data, true);
 
-        if (lua_pcall(t->L, 3, 0, 0) != 0)
+        if (mrp_lua_budget_pcall(t->L, 3, 0, NULL) != 0)
             mrp_log_error("failed to invoke transport closed callback");
 
         mrp_transport_destroy(t->t);
@@ -594,7 +595,7 @@ static void event_recv(mrp_transport_t *mt, void *msg, void *user_data)
         mrp_json_lua_push(t->L, msg);
         mrp_lua_object_deref_value(t, t->L, t->data, true);
 
-        if (lua_pcall(t->L, 3, 0, 0) != 0)
+        if (mrp_lua_budget_pcall(t->L, 3, 0, NULL) != 0)
             mrp_log_error("failed to invoke transport recv callback");
     }
 
@@ -623,7 +624,7 @@ static void event_recvfrom(mrp_transport_t *mt, void *msg, mrp_sockaddr_t *addr,
         lua_pushliteral(t->L, "<remote address should be here>");
         mrp_lua_object_deref_value(t, t->L, t->data, true);
 
-        if (lua_pcall(t->L, 4, 0, 0) != 0)
+        if (mrp_lua_budget_pcall(t->L, 4, 0, NULL) != 0)
             mrp_log_error("failed to invoke transport recvfrom callback");
     }
 
@@ -95,6 +95,37 @@ mrp_context_t *mrp_lua_check_murphy_context(lua_State *L, int index);
 /** Produce a debugging dump of the Lua stack (using mrp_debug). */
 void mrp_lua_dump_stack(lua_State *L, const char *prefix);
 
+/*
+ * configuration reload
+ */
+
+#define MRP_LUA_BUS           "lua-bus"              /* bus for Lua events */
+#define MRP_LUA_EVENT_RELOAD  "lua-config-reloaded"  /* config reloaded */
+
+/** Callback to commit (or discard) a change staged during a reload. */
+typedef void (*mrp_lua_reload_cb_t)(lua_State *L, void *data, int commit);
+
+/** Rerun the main Lua configuration file in reload mode. Existing objects
+    are kept, replaceable hooks are staged. On success the reload must be
+    finished with mrp_lua_finish_reload(). On failure the staged changes
+    are discarded and -1 is returned with errno set. */
+int mrp_lua_reload_config(void);
+
+/** Commit or discard the changes staged by a successful reload. Emits
+    MRP_LUA_EVENT_RELOAD on MRP_LUA_BUS if the changes are committed. */
+void mrp_lua_finish_reload(int commit);
+
+/** Check if the configuration is being run in reload mode. */
+int mrp_lua_config_reloading(void);
+
+/** Stage a change to be committed or discarded when the reload finishes. */
+int mrp_lua_stage_reload(mrp_lua_reload_cb_t cb, void *data);
+
+/** In reload mode, push the existing object of class def named by the
+    definition table at t and return TRUE. Raises a Lua error if there is
+    no such object. Returns FALSE without touching the stack otherwise. */
+int mrp_lua_reload_object(lua_State *L, mrp_lua_classdef_t *def, int t);
+
 /*
  * level of debugging detail
  */
@@ -108,4 +139,39 @@ typedef enum {
 /** Configure murphy lua debugging. */
 int mrp_lua_set_debug(mrp_lua_debug_t level);
 
+/*
+ * Lua heap and garbage collection statistics
+ */
+
+typedef struct {
+    size_t   limit;                      /* heap limit, 0 if unlimited */
+    size_t   used;                       /* bytes currently allocated */
+    size_t   peak;                       /* peak bytes allocated */
+    uint32_t failed;                     /* allocations failed due to limit */
+    uint32_t overshot;                   /* unprotected allocations over it */
+    size_t   gcsize;                     /* heap size as seen by collector */
+    int      stepsize;                   /* idle collection step size (kB) */
+    uint32_t pauses;                     /* collector pauses */
+    uint32_t skipped;                    /* pauses skipped or cut short */
+    uint64_t steps;                      /* idle collection steps */
+    uint64_t cycles;                     /* cycles completed in idle steps */
+    uint64_t steptime;                   /* total idle step time (usecs) */
+    uint64_t maxstep;                    /* longest idle step (usecs) */
+} mrp_lua_memory_stats_t;
+
+/** Limit the Lua heap to the given kbytes, 0 for unlimited. */
+void mrp_lua_set_heap_limit(size_t kbytes);
+
+/** Set the size of idle-time garbage collection steps in kbytes. */
+void mrp_lua_gc_set_stepsize(int kbytes);
+
+/** Pause garbage collection (during a recalculation). */
+void mrp_lua_gc_pause(void);
+
+/** Resume garbage collection and schedule idle-time collection. */
+void mrp_lua_gc_resume(void);
+
+/** Get Lua heap and garbage collection statistics. */
+void mrp_lua_get_memory_stats(mrp_lua_memory_stats_t *st);
+
 #endif /* __MURPHY_LUA_BINDINGS_H__ */
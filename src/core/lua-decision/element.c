@@ -43,6 +43,7 @@
 #include <murphy/core/lua-utils/object.h>
 #include <murphy/core/lua-utils/strarray.h>
 #include <murphy/core/lua-utils/funcbridge.h>
+#include <murphy/core/lua-utils/profile.h>
 #include <murphy/core/lua-bindings/murphy.h>
 
 
@@ -122,6 +123,9 @@ static void sink_destroy_from_lua(void *);
 static mrp_lua_sink_t *sink_check(lua_State *, int);
 static void sink_install(lua_State *, void *);
 
+static int  element_reload(lua_State *, mrp_lua_classdef_t *);
+static mrp_funcbridge_t *funcbridge_check(lua_State *, int);
+
 static void element_input_class_create(lua_State *);
 static int  element_input_create_luatbl(lua_State *, int);
 static int  element_input_getfield(lua_State *);
@@ -419,6 +423,9 @@ static int element_create_from_lua(lua_State *L)
 
     MRP_LUA_ENTER;
 
+    if (mrp_lua_config_reloading())
+        MRP_LUA_LEAVE(element_reload(L, ELEMENT_CLASS));
+
     el = (mrp_lua_element_t *)mrp_lua_create_object(L, ELEMENT_CLASS, NULL,0);
     el->install = element_install;
 
@@ -446,7 +453,7 @@ static int element_create_from_lua(lua_State *L)
             break;
 
         case UPDATE:
-            el->update = mrp_funcbridge_create_luafunc(L, -1);
+            el->update = funcbridge_check(L, -1);
             break;
 
         default:
@@ -549,7 +556,9 @@ static int element_update_cb(mrp_scriptlet_t *script, mrp_context_tbl_t *ctbl)
     mrp_lua_element_t *el = (mrp_lua_element_t *)script->data;
     mrp_funcbridge_value_t args[1] = { { .pointer = el } };
     mrp_funcbridge_value_t ret;
+    const char *entry;
     char t;
+    bool success;
 
     MRP_UNUSED(ctbl);
 
@@ -557,7 +566,10 @@ static int element_update_cb(mrp_scriptlet_t *script, mrp_context_tbl_t *ctbl)
 
     if (el->update) {
         memset(&ret, 0, sizeof(ret));
-        if (!mrp_funcbridge_call_from_c(L, el->update, "o", args, &t, &ret)) {
+        entry = mrp_lua_profile_enter("element-update");
+        success = mrp_funcbridge_call_from_c(L, el->update, "o", args, &t,&ret);
+        mrp_lua_profile_leave(entry);
+        if (!success) {
             mrp_log_error("failed to call element.lua.%s:update method (%s)",
                           el->name, ret.string ? ret.string : "NULL");
             mrp_free((void *)ret.string);
@@ -649,6 +661,9 @@ static int sink_create_from_lua(lua_State *L)
 
     MRP_LUA_ENTER;
 
+    if (mrp_lua_config_reloading())
+        MRP_LUA_LEAVE(element_reload(L, SINK_CLASS));
+
     sink = (mrp_lua_sink_t *)mrp_lua_create_object(L, SINK_CLASS, NULL,0);
     sink->install = sink_install;
 
@@ -692,11 +707,11 @@ static int sink_create_from_lua(lua_State *L)
             break;
 
         case INITIATE:
-            sink->initiate = mrp_funcbridge_create_luafunc(L, -1);
+            sink->initiate = funcbridge_check(L, -1);
             break;
 
         case UPDATE:
-            sink->update = mrp_funcbridge_create_luafunc(L, -1);
+            sink->update = funcbridge_check(L, -1);
             break;
 
         default:
@@ -804,14 +819,19 @@ static int sink_update_cb(mrp_scriptlet_t *script, mrp_context_tbl_t *ctbl)
     mrp_lua_sink_t *sink = (mrp_lua_sink_t *)script->data;
     mrp_funcbridge_value_t args[1] = { { .pointer = sink } };
     mrp_funcbridge_value_t ret;
+    const char *entry;
     char t;
+    bool success;
 
     MRP_UNUSED(ctbl);
 
     mrp_debug("'%s'", sink->name);
 
     if (sink->update) {
-        if (!mrp_funcbridge_call_from_c(L, sink->update, "o",args, &t,&ret)) {
+        entry = mrp_lua_profile_enter("sink-update");
+        success = mrp_funcbridge_call_from_c(L, sink->update, "o",args,&t,&ret);
+        mrp_lua_profile_leave(entry);
+        if (!success) {
             mrp_log_error("failed to call sink.lua.%s:update method (%s)",
                           sink->name, ret.string);
             mrp_free((void *)ret.string);
@@ -909,6 +929,121 @@ static void sink_install(lua_State *L, void *void_sink)
     MRP_LUA_LEAVE_NOARG;
 }
 
+typedef struct {
+    mrp_lua_element_t  *el;               /* element or sink being reloaded */
+    mrp_funcbridge_t  **initiatep;        /* sink initiate, NULL for elements */
+    mrp_funcbridge_t   *update;           /* staged update function */
+    mrp_funcbridge_t   *initiate;         /* staged initiate function */
+} element_reload_t;
+
+
+static void element_reload_cb(lua_State *L, void *data, int commit)
+{
+    element_reload_t *er = (element_reload_t *)data;
+    mrp_funcbridge_t *fb;
+
+    if (commit) {
+        if (er->update) {
+            fb = er->el->update;
+            er->el->update = er->update;
+            er->update = fb;
+        }
+
+        if (er->initiate && er->initiatep) {
+            fb = *er->initiatep;
+            *er->initiatep = er->initiate;
+            er->initiate = fb;
+        }
+
+        mrp_debug("'%s' reloaded", er->el->name);
+    }
+
+    mrp_funcbridge_unref(L, er->update);
+    mrp_funcbridge_unref(L, er->initiate);
+
+    mrp_free(er);
+}
+
+
+static int element_reload(lua_State *L, mrp_lua_classdef_t *def)
+{
+    mrp_lua_element_t *el;
+    element_reload_t *er;
+    size_t fldnamlen;
+    const char *fldnam;
+    size_t n;
+
+    mrp_lua_reload_object(L, def, 2);
+
+    el = (mrp_lua_element_t *)mrp_lua_check_object(L, def, -1);
+
+    if (!(er = mrp_allocz(sizeof(*er))))
+        luaL_error(L, "failed to stage reload of '%s'", el->name);
+
+    er->el = el;
+
+    if (def == SINK_CLASS)
+        er->initiatep = &((mrp_lua_sink_t *)el)->initiate;
+
+    if (mrp_lua_stage_reload(element_reload_cb, er) < 0) {
+        mrp_free(er);
+        luaL_error(L, "failed to stage reload of '%s'", el->name);
+    }
+
+    MRP_LUA_FOREACH_FIELD(L, 2, fldnam, fldnamlen) {
+
+        switch (field_name_to_type(fldnam, fldnamlen)) {
+
+        case INPUTS:
+            luaL_checktype(L, -1, LUA_TTABLE);
+            for (n = 0, lua_pushnil(L);  lua_next(L, -2);  lua_pop(L, 1))
+                n++;
+            if (n != el->ninput)
+                luaL_error(L, "can't change the inputs of '%s' on reload",
+                           el->name);
+            break;
+
+        case OUTPUTS:
+            luaL_checktype(L, -1, LUA_TTABLE);
+            if (lua_objlen(L, -1) != el->noutput)
+                luaL_error(L, "can't change the outputs of '%s' on reload",
+                           el->name);
+            break;
+
+        case UPDATE:
+            er->update = funcbridge_check(L, -1);
+            break;
+
+        case INITIATE:
+            if (er->initiatep)
+                er->initiate = funcbridge_check(L, -1);
+            break;
+
+        default:
+            break;
+        }
+
+    } /* MRP_LUA_FOREACH_FIELD */
+
+    if (!er->update)
+        luaL_error(L, "missing or invalid mandatory 'update' field");
+
+    return 1;
+}
+
+
+static mrp_funcbridge_t *funcbridge_check(lua_State *L, int idx)
+{
+    mrp_funcbridge_t *fb = mrp_funcbridge_create_luafunc(L, idx);
+
+    /* take a reference to builtins, so they can be released like the rest */
+    if (fb != NULL && lua_type(L, idx) == LUA_TTABLE)
+        mrp_funcbridge_ref(L, fb);
+
+    return fb;
+}
+
+
 static void element_input_class_create(lua_State *L)
 {
     /* create a metatable for input's */
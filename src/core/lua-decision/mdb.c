@@ -407,6 +407,9 @@ static int table_create_from_lua(lua_State *L)
     if (!lua_istable(L, 2))
         luaL_error(L, "expecting table as argument");
 
+    if (mrp_lua_reload_object(L, TABLE_CLASS, 2))
+        MRP_LUA_LEAVE(1);
+
     tbl = (mrp_lua_mdb_table_t *)mrp_lua_create_object(L, TABLE_CLASS, NULL,0);
 
     tbl->builtin = true;
@@ -932,6 +935,9 @@ static int select_create_from_lua(lua_State *L)
     if (!lua_istable(L, 2))
         luaL_error(L, "expecting table as argument");
 
+    if (mrp_lua_reload_object(L, SELECT_CLASS, 2))
+        MRP_LUA_LEAVE(1);
+
     sel = (mrp_lua_mdb_select_t *)mrp_lua_create_object(L,SELECT_CLASS,NULL,0);
 
     MRP_LUA_FOREACH_FIELD(L, 2, fldnam, fldnamlen) {
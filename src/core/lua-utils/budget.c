@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2012-2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <murphy/common/macros.h>
+#include <murphy/common/mm.h>
+#include <murphy/common/list.h>
+#include <murphy/common/log.h>
+
+#include <murphy/core/lua-utils/lua-utils.h>
+#include <murphy/core/lua-utils/budget.h>
+#include <murphy/core/lua-utils/profile.h>
+
+#define BUDGET_STEP  1000                /* instructions between checks */
+#define BUDGET_TRACE 16                  /* traceback depth on overrun */
+#define UNWIND_MAX   16                  /* max. unwind callbacks */
+
+typedef enum {
+    BUDGET_OK = 0,                       /* within budget */
+    BUDGET_INSNS,                        /* instruction budget exceeded */
+    BUDGET_MSECS,                        /* wall-clock budget exceeded */
+} budget_status_t;
+
+typedef struct {
+    mrp_list_hook_t   hook;              /* to list of overruns */
+    mrp_lua_overrun_t o;                 /* overrun statistics */
+} overrun_t;
+
+static struct {
+    uint32_t         insns;              /* instruction budget */
+    uint32_t         msecs;              /* wall-clock budget */
+    int              depth;              /* budgeted call nesting depth */
+    int              pcall;              /* protected call nesting depth */
+    int              step;               /* hook instruction count */
+    uint64_t         used;               /* instructions used so far */
+    uint64_t         deadline;           /* wall-clock deadline */
+    const char      *name;               /* outermost function name */
+    budget_status_t  status;             /* budget status of current call */
+    bool             profile;            /* whether we're also profiling */
+    bool             overrun;            /* whether last call overran */
+} budget = {
+    .insns = MRP_LUA_BUDGET_INSNS,
+    .msecs = MRP_LUA_BUDGET_MSECS,
+};
+
+static MRP_LIST_HOOK(overruns);
+
+static struct {
+    mrp_lua_unwind_cb_t cb;              /* callback to restore state */
+    void               *data;            /* opaque callback data */
+} unwind[UNWIND_MAX];
+static int nunwind;
+
+
+static inline uint64_t budget_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+void mrp_lua_set_budget(uint32_t insns, uint32_t msecs)
+{
+    budget.insns = insns;
+    budget.msecs = msecs;
+}
+
+
+void mrp_lua_get_budget(uint32_t *insns, uint32_t *msecs)
+{
+    if (insns != NULL)
+        *insns = budget.insns;
+    if (msecs != NULL)
+        *msecs = budget.msecs;
+}
+
+
+static void count_overrun(const char *name, budget_status_t status)
+{
+    mrp_list_hook_t *p, *n;
+    overrun_t       *o;
+
+    mrp_list_foreach(&overruns, p, n) {
+        o = mrp_list_entry(p, typeof(*o), hook);
+
+        if (!strcmp(o->o.name, name))
+            goto found;
+    }
+
+    if ((o = mrp_allocz(sizeof(*o))) == NULL)
+        return;
+
+    mrp_list_init(&o->hook);
+    o->o.name = mrp_strdup(name);
+
+    if (o->o.name == NULL) {
+        mrp_free(o);
+        return;
+    }
+
+    mrp_list_append(&overruns, &o->hook);
+
+ found:
+    if (status == BUDGET_INSNS)
+        o->o.insns++;
+    else
+        o->o.msecs++;
+}
+
+
+static void budget_hook(lua_State *L, lua_Debug *ar)
+{
+    char trace[1024];
+
+    if (ar->event != LUA_HOOKCOUNT)
+        return;
+
+    if (budget.profile)
+        mrp_lua_profile_tick(L);
+
+    if (budget.status == BUDGET_OK) {
+        budget.used += budget.step;
+
+        if (budget.insns && budget.used >= budget.insns)
+            budget.status = BUDGET_INSNS;
+        else if (budget.msecs && budget_now() >= budget.deadline)
+            budget.status = BUDGET_MSECS;
+        else
+            return;
+
+        mrp_log_error("Lua: %s exceeded its %s budget (%u %s), aborting:%s",
+                      budget.name,
+                      budget.status == BUDGET_INSNS ? "instruction" : "time",
+                      budget.status == BUDGET_INSNS ? budget.insns : budget.msecs,
+                      budget.status == BUDGET_INSNS ? "instructions" : "msecs",
+                      mrp_lua_callstack(L, trace, sizeof(trace), BUDGET_TRACE));
+
+        /* make sure a pcall within the script can't catch us for long */
+        lua_sethook(L, budget_hook, LUA_MASKCOUNT, 1);
+    }
+
+    luaL_error(L, "%s: execution budget exceeded", budget.name);
+}
+
+
+/*
+ * Keep track of whether we're inside a protected call. The Lua heap limit
+ * is only enforced there: an allocation failure outside of one would end
+ * up in the panic handler and take the whole daemon down. If the call
+ * fails, any unwind callbacks registered within it are called (in reverse
+ * order), as the C code that would have unregistered them has been
+ * skipped by the error.
+ */
+
+int mrp_lua_pcall(lua_State *L, int narg, int nresult, int errfunc)
+{
+    int status, mark;
+
+    mark = nunwind;
+
+    budget.pcall++;
+    status = lua_pcall(L, narg, nresult, errfunc);
+    budget.pcall--;
+
+    if (status != 0) {
+        while (nunwind > mark) {
+            nunwind--;
+            unwind[nunwind].cb(unwind[nunwind].data);
+        }
+    }
+
+    return status;
+}
+
+
+bool mrp_lua_push_unwind(mrp_lua_unwind_cb_t cb, void *data)
+{
+    if (nunwind >= UNWIND_MAX)
+        return false;
+
+    unwind[nunwind].cb   = cb;
+    unwind[nunwind].data = data;
+    nunwind++;
+
+    return true;
+}
+
+
+void mrp_lua_pop_unwind(void)
+{
+    if (nunwind > 0)
+        nunwind--;
+}
+
+
+bool mrp_lua_in_pcall(void)
+{
+    return budget.pcall > 0;
+}
+
+
+int mrp_lua_budget_pcall(lua_State *L, int narg, int nresult, const char *name)
+{
+    lua_Debug ar;
+    char      where[128];
+    int       status;
+
+    if (budget.depth > 0) {
+        budget.depth++;
+        status = mrp_lua_pcall(L, narg, nresult, 0);
+        budget.depth--;
+
+        return status;
+    }
+
+    budget.overrun = false;
+    budget.profile = mrp_lua_profile_active();
+
+    if ((!budget.insns && !budget.msecs && !budget.profile) ||
+        lua_gethook(L) != NULL)
+        return mrp_lua_pcall(L, narg, nresult, 0);
+
+    if (name == NULL) {
+        lua_pushvalue(L, -(narg + 1));
+
+        if (lua_getinfo(L, ">S", &ar))
+            snprintf(where, sizeof(where), "%s:%d",
+                     ar.short_src, ar.linedefined);
+        else
+            snprintf(where, sizeof(where), "<unknown>");
+
+        name = where;
+    }
+
+    budget.name     = name;
+    budget.status   = BUDGET_OK;
+    budget.used     = 0;
+    budget.step     = budget.insns && budget.insns < BUDGET_STEP ?
+        (int)budget.insns : BUDGET_STEP;
+    budget.deadline = budget_now() + (uint64_t)budget.msecs * 1000000ULL;
+
+    lua_sethook(L, budget_hook, LUA_MASKCOUNT, budget.step);
+
+    if (budget.profile)
+        mrp_lua_profile_begin();
+
+    budget.depth++;
+    status = mrp_lua_pcall(L, narg, nresult, 0);
+    budget.depth--;
+
+    if (budget.profile)
+        mrp_lua_profile_end();
+
+    if (lua_gethook(L) == budget_hook)
+        lua_sethook(L, NULL, 0, 0);
+
+    if (budget.status != BUDGET_OK) {
+        count_overrun(name, budget.status);
+        budget.overrun = true;
+    }
+
+    budget.name = NULL;
+
+    return status;
+}
+
+
+bool mrp_lua_budget_overrun(void)
+{
+    return budget.overrun;
+}
+
+
+void mrp_lua_foreach_overrun(void (*cb)(mrp_lua_overrun_t *o, void *user_data),
+                             void *user_data)
+{
+    mrp_list_hook_t *p, *n;
+    overrun_t       *o;
+
+    mrp_list_foreach(&overruns, p, n) {
+        o = mrp_list_entry(p, typeof(*o), hook);
+        cb(&o->o, user_data);
+    }
+}
+
+
+void mrp_lua_reset_overruns(void)
+{
+    mrp_list_hook_t *p, *n;
+    overrun_t       *o;
+
+    mrp_list_foreach(&overruns, p, n) {
+        o = mrp_list_entry(p, typeof(*o), hook);
+
+        mrp_list_delete(&o->hook);
+        mrp_free((char *)o->o.name);
+        mrp_free(o);
+    }
+}
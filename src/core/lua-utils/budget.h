@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2012-2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __MURPHY_LUA_BUDGET_H__
+#define __MURPHY_LUA_BUDGET_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <lualib.h>
+#include <lauxlib.h>
+
+/*
+ * Execution budgets for Lua code invoked from C.
+ *
+ * Policy code (veto functions, resource and event callbacks, timers, etc.)
+ * is run from the mainloop. A runaway script would stall the whole daemon,
+ * so these invocations go through mrp_lua_budget_pcall which limits both
+ * the number of VM instructions executed and the wall-clock time spent per
+ * outermost invocation. Nested invocations share the budget of the
+ * outermost one. An invocation running over its budget is aborted with a
+ * Lua error, its traceback is logged and a per-function overrun counter is
+ * bumped. Budgets are not enforced while Lua debugging (which needs the
+ * single per-state hook for itself) is enabled.
+ */
+
+/** Default instruction budget per invocation (0 = unlimited). */
+#define MRP_LUA_BUDGET_INSNS  0
+/** Default wall-clock budget in milliseconds per invocation (0 = unlimited). */
+#define MRP_LUA_BUDGET_MSECS  0
+
+/** Per-function budget overrun statistics. */
+typedef struct {
+    const char *name;                    /* function name or location */
+    uint32_t    insns;                   /* instruction budget overruns */
+    uint32_t    msecs;                   /* wall-clock budget overruns */
+} mrp_lua_overrun_t;
+
+/** Set the per-invocation execution budget, 0 meaning unlimited. */
+void mrp_lua_set_budget(uint32_t insns, uint32_t msecs);
+
+/** Get the current per-invocation execution budget. */
+void mrp_lua_get_budget(uint32_t *insns, uint32_t *msecs);
+
+/** lua_pcall the function below the @narg arguments within budget. */
+int mrp_lua_budget_pcall(lua_State *L, int narg, int nresult, const char *name);
+
+/** Check whether the last failed mrp_lua_budget_pcall was a budget overrun. */
+bool mrp_lua_budget_overrun(void);
+
+/** Call @cb for each function that has overrun its budget. */
+void mrp_lua_foreach_overrun(void (*cb)(mrp_lua_overrun_t *o, void *user_data),
+                             void *user_data);
+
+/** Reset all budget overrun counters. */
+void mrp_lua_reset_overruns(void);
+
+/** lua_pcall without an execution budget, but marked as a protected call. */
+int mrp_lua_pcall(lua_State *L, int narg, int nresult, int errfunc);
+
+/** Check whether we're running inside a protected call made by us. */
+bool mrp_lua_in_pcall(void);
+
+/*
+ * A Lua error raised from C code called by Lua longjmps straight back to
+ * the innermost protected call, skipping any cleanup in the C frames in
+ * between. Code that keeps state across calls into Lua (nesting depths,
+ * etc.) can register a callback to restore it if that happens.
+ */
+
+/** Callback to restore state left behind by an unwound protected call. */
+typedef void (*mrp_lua_unwind_cb_t)(void *data);
+
+/** Call @cb if an error unwinds the innermost mrp_lua_pcall. */
+bool mrp_lua_push_unwind(mrp_lua_unwind_cb_t cb, void *data);
+
+/** Unregister the last registered unwind callback without calling it. */
+void mrp_lua_pop_unwind(void);
+
+#endif /* __MURPHY_LUA_BUDGET_H__ */
@@ -41,6 +41,7 @@
 #include <murphy/core/lua-utils/funcbridge.h>
 #include <murphy/core/lua-utils/object.h>
 #include <murphy/core/lua-utils/lua-utils.h>
+#include <murphy/core/lua-utils/budget.h>
 
 #define FUNCBRIDGE_METATABLE             "LuaBook.funcbridge"
 #define FUNCBRIDGE_USERDATA_METATABLE    "LuaBook.funcbridge.userdata"
@@ -442,7 +443,7 @@ bool mrp_funcbridge_call_from_c(lua_State *L,
                     mrp_lua_checkstack(L, -1);
             }
 
-            sts = lua_pcall(L, i, 1, 0);
+            sts = mrp_lua_budget_pcall(L, i, 1, NULL);
 
             MRP_ASSERT(!sts || (sts && lua_type(L, -1) == LUA_TSTRING),
                        "lua pcall did not return error string when failed");
@@ -37,6 +37,7 @@
 #include <murphy/common/list.h>
 #include <murphy/common/file-utils.h>
 
+#include <murphy/core/lua-utils/budget.h>
 #include <murphy/core/lua-utils/include.h>
 
 
@@ -111,7 +112,7 @@ int mrp_lua_include_file(lua_State *L, const char *file, const char **dirs,
 
     mrp_debug("file '%s' resolved to '%s' for inclusion", file, path);
 
-    if (!luaL_loadfile(L, path) && !lua_pcall(L, 0, 0, 0)) {
+    if (!luaL_loadfile(L, path) && !mrp_lua_pcall(L, 0, 0, 0)) {
         if (files != NULL)
             save_included(files, path, st.st_dev, st.st_ino);
 
@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2012-2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <murphy/common/macros.h>
+#include <murphy/common/mm.h>
+#include <murphy/common/log.h>
+#include <murphy/common/utils.h>
+
+#include <murphy/core/lua-utils/profile.h>
+
+#define PROFILE_SLOTS  1024              /* sample table size, power of 2 */
+#define PROFILE_STACKS (PROFILE_SLOTS / 4 * 3) /* max. unique stacks */
+#define PROFILE_DEPTH  32                /* max. captured stack depth */
+#define PROFILE_LINE   1024              /* max. collapsed stack length */
+
+typedef struct {
+    uint32_t  hash;                      /* collapsed stack hash */
+    uint32_t  count;                     /* number of samples */
+    char     *stack;                     /* collapsed stack */
+} slot_t;
+
+static struct {
+    bool        active;                  /* whether we're profiling */
+    uint32_t    hz;                      /* sampling rate */
+    uint64_t    period;                  /* sampling period (nsecs) */
+    uint64_t    acc;                     /* Lua time since last sample */
+    uint64_t    last;                    /* last accounting timestamp */
+    uint64_t    samples;                 /* samples taken */
+    uint64_t    dropped;                 /* samples dropped */
+    uint64_t    runtime;                 /* profiled Lua time */
+    uint64_t    overhead;                /* time spent sampling */
+    const char *entry;                   /* current C entry point */
+    slot_t     *slots;                   /* sample table */
+    uint32_t    nstack;                  /* number of unique stacks */
+} prof;
+
+
+static inline uint64_t profile_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+int mrp_lua_profile_start(uint32_t hz)
+{
+    if (hz == 0)
+        hz = MRP_LUA_PROFILE_HZ;
+
+    if (hz > 1000000) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (prof.slots == NULL) {
+        prof.slots = mrp_allocz_array(slot_t, PROFILE_SLOTS);
+
+        if (prof.slots == NULL)
+            return -1;
+    }
+
+    prof.hz     = hz;
+    prof.period = 1000000000ULL / hz;
+    prof.active = true;
+
+    return 0;
+}
+
+
+void mrp_lua_profile_stop(void)
+{
+    prof.active = false;
+}
+
+
+void mrp_lua_profile_reset(void)
+{
+    int i;
+
+    if (prof.slots != NULL) {
+        for (i = 0; i < PROFILE_SLOTS; i++)
+            mrp_free(prof.slots[i].stack);
+
+        if (prof.active)
+            memset(prof.slots, 0, PROFILE_SLOTS * sizeof(prof.slots[0]));
+        else {
+            mrp_free(prof.slots);
+            prof.slots = NULL;
+        }
+    }
+
+    prof.nstack   = 0;
+    prof.acc      = 0;
+    prof.samples  = 0;
+    prof.dropped  = 0;
+    prof.runtime  = 0;
+    prof.overhead = 0;
+}
+
+
+bool mrp_lua_profile_active(void)
+{
+    return prof.active;
+}
+
+
+void mrp_lua_profile_stats(mrp_lua_profile_stats_t *stats)
+{
+    stats->active   = prof.active;
+    stats->hz       = prof.hz;
+    stats->samples  = prof.samples;
+    stats->dropped  = prof.dropped;
+    stats->stacks   = prof.nstack;
+    stats->runtime  = prof.runtime;
+    stats->overhead = prof.overhead;
+}
+
+
+int mrp_lua_profile_dump(FILE *fp)
+{
+    slot_t *s;
+    int     i;
+
+    if (prof.slots == NULL)
+        return 0;
+
+    for (i = 0, s = prof.slots; i < PROFILE_SLOTS; i++, s++)
+        if (s->stack != NULL)
+            fprintf(fp, "%s %u\n", s->stack, s->count);
+
+    return (int)prof.nstack;
+}
+
+
+const char *mrp_lua_profile_enter(const char *entry)
+{
+    const char *prev = prof.entry;
+
+    prof.entry = entry;
+
+    return prev;
+}
+
+
+void mrp_lua_profile_leave(const char *entry)
+{
+    prof.entry = entry;
+}
+
+
+static int collapse_stack(lua_State *L, char *buf, size_t size)
+{
+    lua_Debug   ar[PROFILE_DEPTH], *a;
+    const char *name;
+    char       *p;
+    int         depth, n, l;
+
+    for (depth = 0; depth < PROFILE_DEPTH; depth++)
+        if (!lua_getstack(L, depth, ar + depth) ||
+            !lua_getinfo(L, "Sn", ar + depth))
+            break;
+
+    p = buf;
+    l = (int)size;
+
+    n = snprintf(p, l, "%s", prof.entry ? prof.entry : "lua");
+
+    if (n >= l)
+        return -1;
+
+    p += n;
+    l -= n;
+
+    while (depth-- > 0) {
+        a    = ar + depth;
+        name = a->name ? a->name : "?";
+
+        if (a->what != NULL && !strcmp(a->what, "C"))
+            n = snprintf(p, l, ";%s@[C]", name);
+        else if (a->what != NULL && !strcmp(a->what, "main"))
+            n = snprintf(p, l, ";main@%s", a->short_src);
+        else
+            n = snprintf(p, l, ";%s@%s:%d", name, a->short_src,
+                         a->linedefined);
+
+        if (n >= l) {                    /* truncate at the last full frame */
+            *p = '\0';
+            break;
+        }
+
+        p += n;
+        l -= n;
+    }
+
+    return (int)(p - buf);
+}
+
+
+static void take_sample(lua_State *L, uint32_t weight)
+{
+    char      stack[PROFILE_LINE];
+    uint32_t  h, i, n;
+    slot_t   *s;
+
+    if (collapse_stack(L, stack, sizeof(stack)) < 0) {
+        prof.dropped += weight;
+        return;
+    }
+
+    h = mrp_string_hash(stack);
+
+    for (i = h & (PROFILE_SLOTS - 1), n = 0;
+         n < PROFILE_SLOTS;
+         i = (i + 1) & (PROFILE_SLOTS - 1), n++) {
+        s = prof.slots + i;
+
+        if (s->stack == NULL)
+            break;
+
+        if (s->hash == h && !strcmp(s->stack, stack)) {
+            s->count     += weight;
+            prof.samples += weight;
+            return;
+        }
+    }
+
+    if (n >= PROFILE_SLOTS || prof.nstack >= PROFILE_STACKS ||
+        (s->stack = mrp_strdup(stack)) == NULL) {
+        prof.dropped += weight;
+        return;
+    }
+
+    s->hash  = h;
+    s->count = weight;
+
+    prof.nstack++;
+    prof.samples += weight;
+}
+
+
+void mrp_lua_profile_begin(void)
+{
+    prof.last = profile_now();
+}
+
+
+void mrp_lua_profile_tick(lua_State *L)
+{
+    uint64_t now, diff;
+    uint32_t weight;
+
+    if (!prof.active || prof.slots == NULL)
+        return;
+
+    now  = profile_now();
+    diff = now - prof.last;
+
+    prof.acc     += diff;
+    prof.runtime += diff;
+    prof.last     = now;
+
+    if (prof.acc < prof.period)
+        return;
+
+    weight    = (uint32_t)(prof.acc / prof.period);
+    prof.acc %= prof.period;
+
+    take_sample(L, weight);
+
+    prof.last      = profile_now();
+    prof.overhead += prof.last - now;
+}
+
+
+void mrp_lua_profile_end(void)
+{
+    uint64_t now, diff;
+
+    if (!prof.active)
+        return;
+
+    now  = profile_now();
+    diff = now - prof.last;
+
+    prof.acc     += diff;
+    prof.runtime += diff;
+    prof.last     = now;
+}
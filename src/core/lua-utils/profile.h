@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2012-2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __MURPHY_LUA_PROFILE_H__
+#define __MURPHY_LUA_PROFILE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <lualib.h>
+#include <lauxlib.h>
+
+/*
+ * Sampling profiler for Lua code invoked from C.
+ *
+ * The profiler piggybacks on the count hook installed by
+ * mrp_lua_budget_pcall. Time spent executing Lua is accumulated from hook
+ * to hook and whenever a full sampling period has elapsed, the current Lua
+ * call stack is captured, prefixed with the name of the C entry point that
+ * invoked Lua, and aggregated into a fixed-size table. The table can be
+ * dumped in collapsed-stack format, directly usable for flame graphs.
+ */
+
+/** Default sampling rate in Hz of Lua execution time. */
+#define MRP_LUA_PROFILE_HZ 1000
+
+/** Profiler statistics. */
+typedef struct {
+    bool     active;                     /* whether profiling is active */
+    uint32_t hz;                         /* sampling rate */
+    uint64_t samples;                    /* number of samples taken */
+    uint64_t dropped;                    /* samples dropped (table full) */
+    uint32_t stacks;                     /* number of unique stacks */
+    uint64_t runtime;                    /* profiled Lua time (nsecs) */
+    uint64_t overhead;                   /* time spent sampling (nsecs) */
+} mrp_lua_profile_stats_t;
+
+/** Start profiling, sampling @hz times per second of Lua time (0 = default). */
+int mrp_lua_profile_start(uint32_t hz);
+
+/** Stop profiling, keeping collected samples. */
+void mrp_lua_profile_stop(void);
+
+/** Discard all collected samples. */
+void mrp_lua_profile_reset(void);
+
+/** Check whether profiling is active. */
+bool mrp_lua_profile_active(void);
+
+/** Get profiler statistics. */
+void mrp_lua_profile_stats(mrp_lua_profile_stats_t *stats);
+
+/** Dump collected samples in collapsed-stack format to @fp. */
+int mrp_lua_profile_dump(FILE *fp);
+
+/** Set the name of the C entry point invoking Lua, return the previous one. */
+const char *mrp_lua_profile_enter(const char *entry);
+
+/** Restore the C entry point name returned by mrp_lua_profile_enter. */
+void mrp_lua_profile_leave(const char *entry);
+
+/** Mark the start of a profiled Lua invocation (used by the count hook). */
+void mrp_lua_profile_begin(void);
+
+/** Account Lua time so far, taking a sample if necessary. */
+void mrp_lua_profile_tick(lua_State *L);
+
+/** Mark the end of a profiled Lua invocation. */
+void mrp_lua_profile_end(void);
+
+#endif /* __MURPHY_LUA_PROFILE_H__ */
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Lua profiler overhead test.
+ *
+ * Runs a CPU-bound Lua chunk through mrp_lua_budget_pcall, alternating
+ * between profiling off and profiling at the default sampling rate of
+ * 1 kHz, and reports the slowdown between the best CPU times of the two.
+ * Since that comparison is at the mercy of the machine running the test,
+ * what gets checked are ratios taken within the profiled runs themselves:
+ * the share of Lua time the profiler spends sampling needs to stay within
+ * a few percent and the number of samples taken needs to match the
+ * profiled Lua time at the requested rate. Pass -s to also fail the test
+ * if the measured slowdown exceeds its bound.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <lualib.h>
+#include <lauxlib.h>
+
+#include <murphy/common.h>
+
+#include <murphy/core/lua-utils/budget.h>
+#include <murphy/core/lua-utils/profile.h>
+
+#define NRUN           9                 /* runs per configuration */
+#define MAX_SLOWDOWN   5.0               /* max. total slowdown, percent */
+#define MAX_SAMPLING   2.0               /* max. sampling overhead, percent */
+#define MAX_SKEW       10.0              /* max. sample count skew, percent */
+
+static const char *chunk =
+    "local function fib(n)\n"
+    "    if n < 2 then return n end\n"
+    "    return fib(n - 1) + fib(n - 2)\n"
+    "end\n"
+    "local function spin(n)\n"
+    "    local s = 0\n"
+    "    for i = 1, n do s = s + i % 7 end\n"
+    "    return s\n"
+    "end\n"
+    "return fib(25) + spin(2000000)\n";
+
+
+static uint64_t cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static uint64_t run_chunk(lua_State *L)
+{
+    uint64_t start, diff;
+
+    if (luaL_loadbuffer(L, chunk, strlen(chunk), "profile-test") != 0) {
+        mrp_log_error("Failed to load test chunk: %s", lua_tostring(L, -1));
+        exit(1);
+    }
+
+    start = cpu_ns();
+
+    if (mrp_lua_budget_pcall(L, 0, 1, "profile-test") != 0) {
+        mrp_log_error("Failed to run test chunk: %s", lua_tostring(L, -1));
+        exit(1);
+    }
+
+    diff = cpu_ns() - start;
+    lua_pop(L, 1);
+
+    return diff;
+}
+
+
+int main(int argc, char *argv[])
+{
+    mrp_lua_profile_stats_t st;
+    lua_State              *L;
+    uint64_t                plain, profiled, t;
+    double                  slowdown, sampling, expected, skew;
+    int                     strict, failed, i;
+
+    strict = (argc > 1 && !strcmp(argv[1], "-s"));
+
+    mrp_log_set_mask(MRP_LOG_UPTO(MRP_LOG_INFO));
+
+    if ((L = luaL_newstate()) == NULL) {
+        mrp_log_error("Failed to create Lua state.");
+        exit(1);
+    }
+
+    luaL_openlibs(L);
+    mrp_lua_set_budget(0, 0);
+
+    run_chunk(L);                        /* warm up */
+
+    plain = profiled = 0;
+
+    for (i = 0; i < NRUN; i++) {
+        t = run_chunk(L);
+
+        if (plain == 0 || t < plain)
+            plain = t;
+
+        if (mrp_lua_profile_start(MRP_LUA_PROFILE_HZ) < 0) {
+            mrp_log_error("Failed to start profiling.");
+            exit(1);
+        }
+
+        t = run_chunk(L);
+        mrp_lua_profile_stop();
+
+        if (profiled == 0 || t < profiled)
+            profiled = t;
+    }
+
+    mrp_lua_profile_stats(&st);
+
+    slowdown = 100.0 * ((double)profiled - (double)plain) / (double)plain;
+    sampling = st.runtime ? 100.0 * st.overhead / st.runtime : 0.0;
+    expected = (double)st.runtime * MRP_LUA_PROFILE_HZ / 1000000000.0;
+    skew     = expected ? 100.0 * (st.samples - expected) / expected : 100.0;
+
+    mrp_log_info("plain: %.3f msecs, profiled at %u Hz: %.3f msecs "
+                 "(%+.2f %%)", plain / 1000000.0, MRP_LUA_PROFILE_HZ,
+                 profiled / 1000000.0, slowdown);
+    mrp_log_info("profiler: %llu samples, %llu dropped, %u stacks, "
+                 "sampling %.3f / %.3f msecs (%.2f %%)",
+                 (unsigned long long)st.samples,
+                 (unsigned long long)st.dropped, st.stacks,
+                 st.overhead / 1000000.0, st.runtime / 1000000.0, sampling);
+
+    failed = 0;
+
+    if (st.samples == 0 || st.stacks == 0) {
+        mrp_log_error("No samples taken or no stacks recorded.");
+        failed++;
+    }
+
+    if (skew <= -MAX_SKEW || skew >= MAX_SKEW) {
+        mrp_log_error("Took %llu samples for %.0f expected.",
+                      (unsigned long long)st.samples, expected);
+        failed++;
+    }
+
+    if (strict && slowdown >= MAX_SLOWDOWN) {
+        mrp_log_error("Profiling slowed Lua down by %.2f %% (max. %.2f %%).",
+                      slowdown, MAX_SLOWDOWN);
+        failed++;
+    }
+
+    if (sampling >= MAX_SAMPLING) {
+        mrp_log_error("Sampling took %.2f %% of Lua time (max. %.2f %%).",
+                      sampling, MAX_SAMPLING);
+        failed++;
+    }
+
+    mrp_lua_profile_reset();
+    lua_close(L);
+
+    return failed ? 1 : 0;
+}
@@ -28,6 +28,7 @@
  */
 
 #include <stdlib.h>
+#include <errno.h>
 #include <signal.h>
 
 #include <murphy/config.h>
@@ -37,6 +38,7 @@
 #include <murphy/common/utils.h>
 #include <murphy/core/context.h>
 #include <murphy/core/plugin.h>
+#include <murphy/core/lua-bindings/murphy.h>
 #include <murphy/resolver/resolver.h>
 #include <murphy/daemon/config.h>
 #include <murphy/daemon/daemon.h>
@@ -68,6 +70,7 @@ MRP_REGISTER_EVENTS(daemon_events,
 static void create_mainloop(mrp_context_t *ctx);
 static void quit_mainloop(mrp_context_t *ctx, int exit_status);
 static void cleanup_mainloop(mrp_context_t *ctx);
+static void reload_configuration(mrp_context_t *ctx);
 
 static int emit_daemon_event(mrp_context_t *ctx, int idx)
 {
@@ -98,6 +101,11 @@ static void signal_handler(mrp_sighandler_t *h, int signum, void *user_data)
         mrp_log_info("Got SIGTERM, stopping...");
         quit_mainloop(ctx, 0);
         break;
+
+    case SIGHUP:
+        mrp_log_info("Got SIGHUP, reloading configuration...");
+        reload_configuration(ctx);
+        break;
     }
 }
 
@@ -123,6 +131,7 @@ static void setup_signals(mrp_context_t *ctx)
 {
     mrp_add_sighandler(ctx->ml, SIGINT , signal_handler, ctx);
     mrp_add_sighandler(ctx->ml, SIGTERM, signal_handler, ctx);
+    mrp_add_sighandler(ctx->ml, SIGHUP , signal_handler, ctx);
 }
 
 
@@ -191,6 +200,39 @@ static void load_ruleset(mrp_context_t *ctx)
 }
 
 
+/*
+ * Reload the Lua configuration and the resolver ruleset. The Lua changes
+ * are only committed if the ruleset reloads too, otherwise both are kept
+ * as they were.
+ */
+static void reload_configuration(mrp_context_t *ctx)
+{
+    mrp_resolver_t *r;
+
+    if (mrp_lua_reload_config() < 0 && errno != ENOENT) {
+        mrp_log_error("Failed to reload Lua configuration, "
+                      "keeping the old one.");
+        return;
+    }
+
+    if (ctx->resolver_ruleset != NULL && ctx->r != NULL) {
+        r = mrp_resolver_reload(ctx->r, ctx->resolver_ruleset);
+
+        if (r == NULL) {
+            mrp_log_error("Failed to reload resolver ruleset '%s', "
+                          "keeping the old configuration.",
+                          ctx->resolver_ruleset);
+            mrp_lua_finish_reload(FALSE);
+            return;
+        }
+
+        ctx->r = r;
+    }
+
+    mrp_lua_finish_reload(TRUE);
+}
+
+
 static void start_plugins(mrp_context_t *ctx)
 {
     mrp_context_setstate(ctx, MRP_STATE_STARTING);
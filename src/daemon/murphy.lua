@@ -42,6 +42,8 @@ PLUGINS = {
 }
 
 -- application classes
+--   an optional 'grace = <msecs>' lets acquired resource sets keep their
+--   resources for that long when a higher priority set wants them
 APPLICATION_CLASSES = {
    interrupt = { priority = 99, order = 'fifo' },
    navigator = { priority =  4, order = 'fifo' },
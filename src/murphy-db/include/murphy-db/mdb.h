@@ -76,6 +76,10 @@ mqi_data_type_t mdb_table_get_column_type(mdb_table_t *, int);
 int mdb_table_get_column_size(mdb_table_t *, int);
 uint32_t mdb_table_get_stamp(mdb_table_t *);
 int mdb_table_print_rows(mdb_table_t *, char *, int);
+int mdb_table_set_quota(mdb_table_t *, mqi_table_quota_t *);
+int mdb_table_get_stats(mdb_table_t *, mqi_table_stats_t *);
+mdb_table_t *mdb_table_snapshot(mdb_table_t *);
+void mdb_table_snapshot_release(mdb_table_t *);
 
 
 #endif /* __MDB_MDB_H__ */
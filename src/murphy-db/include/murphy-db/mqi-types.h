@@ -109,6 +109,11 @@ enum mqi_cond_entry_type_e {
     mqi_column
 };
 
+enum mqi_quota_policy_e {
+    mqi_quota_reject = 0,       /* fail inserts that would exceed the quota */
+    mqi_quota_evict_oldest,     /* make room by deleting the oldest rows */
+};
+
 enum mqi_event_type_e {
     mqi_event_unknown = 0,
     mqi_column_changed,
@@ -134,6 +139,11 @@ typedef struct mqi_variable_s        mqi_variable_t;
 typedef enum mqi_cond_entry_type_e   mqi_cond_entry_type_t;
 typedef struct mqi_cond_entry_s      mqi_cond_entry_t;
 
+typedef enum mqi_quota_policy_e      mqi_quota_policy_t;
+typedef struct mqi_table_quota_s     mqi_table_quota_t;
+typedef struct mqi_table_stats_s     mqi_table_stats_t;
+typedef struct mqi_query_stats_s     mqi_query_stats_t;
+
 typedef enum mqi_event_type_e        mqi_event_type_t;
 typedef union mqi_event_u            mqi_event_t;
 
@@ -149,6 +159,8 @@ typedef struct mqi_table_event_s     mqi_table_event_t;
 typedef struct mqi_transact_event_s  mqi_transact_event_t;
 
 typedef void (*mqi_trigger_cb_t)(mqi_event_t *, void *);
+typedef void (*mqi_slow_query_cb_t)(const char *query, const char *plan,
+                                    uint32_t usecs, void *user_data);
 
 
 
@@ -188,6 +200,33 @@ struct mqi_cond_entry_s {
 };
 
 
+struct mqi_table_quota_s {
+    uint32_t            rows;    /* max. number of rows, 0 = unlimited */
+    uint32_t            bytes;   /* max. approx. memory use, 0 = unlimited */
+    mqi_quota_policy_t  policy;  /* what to do when a limit is hit */
+};
+
+struct mqi_table_stats_s {
+    mqi_table_quota_t   quota;
+    uint32_t            rows;      /* current number of rows */
+    uint32_t            bytes;     /* approx. memory used by the rows */
+    uint32_t            rows_max;  /* high-water mark of rows */
+    uint32_t            bytes_max; /* high-water mark of bytes */
+    uint32_t            rejected;  /* number of rows rejected due to quota */
+    uint32_t            evicted;   /* number of rows evicted due to quota */
+    uint64_t            scanned;   /* number of rows visited by queries */
+};
+
+struct mqi_query_stats_s {
+    const char         *query;     /* normalized query text */
+    uint32_t            calls;     /* number of executions */
+    uint64_t            total;     /* total execution time (usecs) */
+    uint32_t            max;       /* longest execution time (usecs) */
+    uint64_t            scanned;   /* total rows visited */
+    uint64_t            returned;  /* total rows returned or affected */
+};
+
+
 struct mqi_change_table_s {
     mqi_handle_t  handle;
     const char   *name;
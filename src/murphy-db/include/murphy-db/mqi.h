@@ -131,6 +131,10 @@
 #define MQI_CREATE_TABLE(name, type, column_defs, index_def)    \
     mqi_create_table(name, type, index_def, column_defs)
 
+#define MQI_CREATE_TABLE_WITH_QUOTA(name, type, column_defs, index_def, \
+                                    quota)                              \
+    mqi_create_table_with_quota(name, type, index_def, column_defs, quota)
+
 #define MQI_DESCRIBE(table, coldefs)                            \
     mqi_describe(table, coldefs, MQI_DIMENSION(coldefs))
 
@@ -144,6 +148,10 @@
     mqi_select(table, where, columns, result,                   \
                sizeof(result[0]), MQI_DIMENSION(result))
 
+#define MQI_SNAPSHOT_SELECT(snapshot, columns, table, where, result) \
+    mqi_snapshot_select(snapshot, table, where, columns, result,     \
+                        sizeof(result[0]), MQI_DIMENSION(result))
+
 #define MQI_SELECT_BY_INDEX(columns, table, idxvars, result)    \
     mqi_select_by_index(table, idxvars, columns, result)
 
@@ -176,6 +184,9 @@ int mqi_rollback_transaction(mqi_handle_t);
 mqi_handle_t mqi_get_transaction_handle(void);
 uint32_t mqi_get_transaction_depth(void);
 mqi_handle_t mqi_create_table(char *, uint32_t, char **, mqi_column_def_t *);
+mqi_handle_t mqi_create_table_with_quota(char *, uint32_t, char **,
+                                         mqi_column_def_t *,
+                                         mqi_table_quota_t *);
 int mqi_create_index(mqi_handle_t, char **);
 int mqi_drop_table(mqi_handle_t);
 int mqi_describe(mqi_handle_t, mqi_column_def_t *, int);
@@ -195,6 +206,23 @@ mqi_data_type_t mqi_get_column_type(mqi_handle_t, int);
 int mqi_get_column_size(mqi_handle_t, int);
 uint32_t mqi_get_table_stamp(mqi_handle_t);
 int mqi_print_rows(mqi_handle_t, char *, int);
+int mqi_set_table_quota(mqi_handle_t, mqi_table_quota_t *);
+int mqi_get_table_stats(mqi_handle_t, mqi_table_stats_t *);
+
+int mqi_enable_query_stats(int);
+int mqi_query_stats_enabled(void);
+int mqi_query_begin(const char *);
+int mqi_query_end(void);
+int mqi_get_query_stats(mqi_query_stats_t *, int);
+void mqi_reset_query_stats(void);
+void mqi_set_slow_query_log(uint32_t, mqi_slow_query_cb_t, void *);
+uint32_t mqi_get_slow_query_threshold(void);
+
+mqi_handle_t mqi_snapshot_create(mqi_handle_t *, int);
+int mqi_snapshot_release(mqi_handle_t);
+int mqi_snapshot_select(mqi_handle_t, mqi_handle_t, mqi_cond_entry_t *,
+                        mqi_column_desc_t *, void *, int, int);
+int mqi_snapshot_get_table_size(mqi_handle_t, mqi_handle_t);
 
 
 #endif /* __MQI_MQI_H__ */
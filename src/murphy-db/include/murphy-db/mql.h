@@ -88,6 +88,63 @@ int mql_exec_file(const char *file);
 mql_result_t *mql_exec_string(mql_result_type_t result_type,
                               const char *statement);
 
+/**
+ * @brief execute a series of MQL statements atomically
+ *
+ * This function is to execute a series of MQL statements separated with
+ * ';'. No ';' shall follow the last statement. The whole script is parsed
+ * in a single pass and executed within a single transaction. The execution
+ * stops at the first failing statement, in which case the transaction is
+ * rolled back, ie. none of the statements in the script will have any
+ * effect.
+ *
+ * Creating or dropping tables, creating indices and creating triggers are
+ * not undone by a rollback, so these statements are not allowed in a
+ * script. They fail the batch with EPERM before being carried out.
+ *
+ * The result of each statement can be collected to @results. The results
+ * are subject to the same rules as those of mql_exec_string() and should
+ * be freed by mql_result_free(). Results of statements beyond the
+ * dimension of @results are dropped. If the execution failed no results
+ * are collected.
+ *
+ * @param [in] result_type   specifies the expected type of the results
+ *                           of the individual statements.
+ *
+ * @param [in] script        is the string of the MQL statements to execute
+ *
+ * @param [out] results      is an optional array to collect the results
+ *                           of the individual statements to
+ *
+ * @param [in,out] nresult   is the dimension of @results on input and the
+ *                           number of collected results on output
+ *
+ * @return mql_exec_batch() returns a success result if all the statements
+ *         were successfully executed and committed. Otherwise an error
+ *         result is returned with the message telling which statement
+ *         failed and why. The returned result should be freed by
+ *         mql_result_free().
+ *
+ * @code
+ *    #include <stdio.h>
+ *    #include <murphy-db/mql.h>
+ *
+ *    const char *script = "INSERT INTO persons VALUES ('murphy', 1);"
+ *                         "INSERT INTO persons VALUES ('joe', 2)";
+ *    mql_result_t *r = mql_exec_batch(mql_result_string, script, NULL, NULL);
+ *
+ *    if (!mql_result_is_success(r))
+ *      printf("failed to insert persons: %s\n",
+ *             mql_result_error_get_message(r));
+ *
+ *    mql_result_free(r);
+ * @endcode
+ */
+mql_result_t *mql_exec_batch(mql_result_type_t result_type,
+                             const char *script,
+                             mql_result_t **results,
+                             int *nresult);
+
 /**
  * @brief precompile an MQL statement
  *
@@ -359,6 +359,7 @@ static int freemap_free(freemap_t *freemap, int index)
                     return -1;
                 }
 
+                freemap->nbucket = nbucket;
                 freemap->buckets = buckets;
             }
         }
@@ -57,6 +57,9 @@ mdb_row_t *mdb_row_create(mdb_table_t *tbl)
     }
 
     MDB_DLIST_APPEND(mdb_row_t, link, row, &tbl->rows);
+    MDB_TABLE_CHANGED(tbl);
+
+    tbl->nrow++;
 
     return row;
 }
@@ -85,15 +88,16 @@ int mdb_row_delete(mdb_table_t *tbl,
 {
     int sts = 0;
 
-    (void)tbl;
-
     MDB_CHECKARG(row, -1);
 
     if (index_update && mdb_index_delete(tbl, row) < 0)
         sts = -1;
 
-    if (!MDB_DLIST_EMPTY(row->link))
+    if (!MDB_DLIST_EMPTY(row->link)) {
         MDB_DLIST_UNLINK(mdb_row_t, link, row);
+        MDB_TABLE_CHANGED(tbl);
+        tbl->nrow--;
+    }
 
     if (free_it)
         free(row);
@@ -142,8 +146,10 @@ int mdb_row_update(mdb_table_t       *tbl,
 
     if (!cmod)
         return 0;
-    else
-        return 1;
+
+    MDB_TABLE_CHANGED(tbl);
+
+    return 1;
 }
 
 int mdb_row_copy_over(mdb_table_t *tbl, mdb_row_t *dst, mdb_row_t *src)
@@ -154,6 +160,7 @@ int mdb_row_copy_over(mdb_table_t *tbl, mdb_row_t *dst, mdb_row_t *src)
         return -1;
 
     memcpy(dst->data, src->data, tbl->dlgh);
+    MDB_TABLE_CHANGED(tbl);
 
     if (mdb_index_insert(tbl, dst, 0, 0) < 0)
         return -1;
@@ -73,6 +73,9 @@ static int update_single_row(mdb_table_t *, mdb_row_t *, mqi_column_desc_t *,
 static int delete_conditional(mdb_table_t *, mqi_cond_entry_t *);
 static int delete_all(mdb_table_t *);
 static int delete_single_row(mdb_table_t *, mdb_row_t *, int);
+static int quota_row_limit(mdb_table_t *);
+static int check_quota(mdb_table_t *, mqi_column_desc_t *, void **);
+static int enforce_quota(mdb_table_t *, mdb_row_t *);
 
 
 mdb_table_t *mdb_table_create(char *name,
@@ -300,6 +303,9 @@ int mdb_table_insert(mdb_table_t        *tbl,
 
     MDB_CHECKARG(tbl && cds && data && data[0], -1);
 
+    if (check_quota(tbl, cds, data) < 0)
+        return -1;
+
     for (i = 0, error = 0, ninsert = 0;    data[i];    i++) {
         if (!(row = mdb_row_create(tbl))) {
             errno = ENOMEM;
@@ -315,7 +321,15 @@ int mdb_table_insert(mdb_table_t        *tbl,
             ninsert = -1;
         }
         else if (nrow > 0) {
-            tbl->nrow++;
+            if (enforce_quota(tbl, row) < 0) {
+                mdb_index_delete(tbl, row);
+                mdb_row_delete(tbl, row, 0, 1);
+                errno = ENOSPC;
+                return -1;
+            }
+
+            if (tbl->nrow > tbl->stats.rows_max)
+                tbl->stats.rows_max = tbl->nrow;
 
             if (mdb_log_change(tbl,txdepth,mdb_log_insert,cmask,NULL,row) < 0)
                 ninsert = -1;
@@ -523,6 +537,127 @@ int mdb_table_print_rows(mdb_table_t *tbl, char *buf, int len)
     return p - buf;
 }
 
+int mdb_table_set_quota(mdb_table_t *tbl, mqi_table_quota_t *quota)
+{
+    MDB_CHECKARG(tbl && quota, -1);
+    MDB_CHECKARG(quota->policy == mqi_quota_reject ||
+                 quota->policy == mqi_quota_evict_oldest, -1);
+
+    tbl->quota = *quota;
+
+    return 0;
+}
+
+int mdb_table_get_stats(mdb_table_t *tbl, mqi_table_stats_t *stats)
+{
+    uint32_t rsize;
+
+    MDB_CHECKARG(tbl && stats, -1);
+
+    rsize = MDB_TABLE_ROW_SIZE(tbl);
+
+    stats->quota     = tbl->quota;
+    stats->rows      = tbl->nrow;
+    stats->bytes     = tbl->nrow * rsize;
+    stats->rows_max  = tbl->stats.rows_max;
+    stats->bytes_max = tbl->stats.rows_max * rsize;
+    stats->rejected  = tbl->stats.rejected;
+    stats->evicted   = tbl->stats.evicted;
+    stats->scanned   = tbl->stats.scanned;
+
+    return 0;
+}
+
+/*
+ * Snapshots are frozen, unindexed copies of a table sharing the column
+ * definitions (but not the names) of the original and holding all rows,
+ * in iteration order, in a single block. The latest copy is cached in
+ * the table until it next changes, so snapshotting an unchanged table
+ * only takes a reference.
+ */
+mdb_table_t *mdb_table_snapshot(mdb_table_t *tbl)
+{
+    mdb_table_t      *snap;
+    mdb_row_t        *row, *copy;
+    table_iterator_t  it;
+    uint8_t          *block;
+    int               rsize, i;
+
+    MDB_CHECKARG(tbl, NULL);
+
+    if (tbl->snapref > 0)
+        snap = tbl;
+    else
+        snap = tbl->snapshot;
+
+    if (snap != NULL) {
+        snap->snapref++;
+        return snap;
+    }
+
+    rsize = MDB_TABLE_ROW_SIZE(tbl);
+    block = NULL;
+
+    if (!(snap = calloc(1, sizeof(*snap))) ||
+        !(snap->columns = calloc(tbl->ncolumn, sizeof(mdb_column_t))) ||
+        (tbl->nrow > 0 && !(block = malloc(tbl->nrow * rsize))))
+    {
+        if (snap)
+            free(snap->columns);
+        free(snap);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memcpy(snap->columns, tbl->columns, tbl->ncolumn * sizeof(mdb_column_t));
+
+    for (i = 0;  i < tbl->ncolumn;  i++)
+        snap->columns[i].name = NULL;
+
+    snap->handle  = MQI_HANDLE_INVALID;
+    snap->ncolumn = tbl->ncolumn;
+    snap->dlgh    = tbl->dlgh;
+
+    MDB_DLIST_INIT(snap->rows);
+    MDB_DLIST_INIT(snap->logs);
+
+    for (it.cursor = NULL;  (row = table_iterator(tbl, &it)); ) {
+        if (snap->nrow >= tbl->nrow)
+            break;
+
+        copy = (mdb_row_t *)(block + snap->nrow++ * rsize);
+        memcpy(copy->data, row->data, tbl->dlgh);
+
+        MDB_DLIST_APPEND(mdb_row_t, link, copy, &snap->rows);
+    }
+
+    snap->snapref = 2;                   /* the caller's and ours */
+    tbl->snapshot = snap;
+
+    return snap;
+}
+
+void mdb_table_snapshot_release(mdb_table_t *snap)
+{
+    if (!snap || snap->snapref <= 0 || --snap->snapref > 0)
+        return;
+
+    /* the first row is the start of the row block */
+    if (!MDB_DLIST_EMPTY(snap->rows))
+        free(MDB_LIST_RELOCATE(mdb_row_t, link, snap->rows.next));
+
+    free(snap->columns);
+    free(snap);
+}
+
+void mdb_table_snapshot_invalidate(mdb_table_t *tbl)
+{
+    mdb_table_t *snap = tbl->snapshot;
+
+    tbl->snapshot = NULL;
+    mdb_table_snapshot_release(snap);
+}
+
 
 static void destroy_table(mdb_table_t *tbl)
 {
@@ -530,6 +665,7 @@ static void destroy_table(mdb_table_t *tbl)
     mdb_column_t *cols;
     int           i;
 
+    mdb_table_snapshot_invalidate(tbl);
     mdb_index_drop(tbl);
 
     mdb_hash_table_destroy(tbl->chash);
@@ -569,6 +705,9 @@ static mdb_row_t *table_iterator(mdb_table_t *tbl, table_iterator_t *it)
         }
     }
 
+    if (row)
+        tbl->stats.scanned++;
+
     return row;
 }
 
@@ -691,6 +830,8 @@ static int select_by_index(mdb_table_t       *tbl,
     if (!(row = mdb_index_get_row(tbl, idxlen,idxval)))
         return 0;
 
+    tbl->stats.scanned++;
+
     for (j = 0;   (cindex = (result_dsc = cds + j)->cindex) >= 0;    j++)
             mdb_column_read(result_dsc, result, columns + cindex, row->data);
 
@@ -806,6 +947,8 @@ static int delete_all(mdb_table_t *tbl)
     mdb_index_reset(tbl);
 
     MDB_DLIST_FOR_EACH_SAFE(mdb_row_t, link, row,n, &tbl->rows) {
+        tbl->stats.scanned++;
+
         if (delete_single_row(tbl, row, 0) < 0)
             ndelete = -1;
         else
@@ -815,6 +958,128 @@ static int delete_all(mdb_table_t *tbl)
     return ndelete;
 }
 
+static int quota_row_limit(mdb_table_t *tbl)
+{
+    int limit, bytes;
+
+    limit = tbl->quota.rows;
+
+    if (tbl->quota.bytes) {
+        bytes = tbl->quota.bytes / MDB_TABLE_ROW_SIZE(tbl);
+
+        if (!limit || bytes < limit)
+            limit = bytes;
+    }
+
+    return limit;
+}
+
+static int check_quota(mdb_table_t       *tbl,
+                       mqi_column_desc_t *cds,
+                       void             **data)
+{
+    mdb_index_t *ix = &tbl->index;
+    mdb_row_t   *row;
+    uint8_t     *keys, *key;
+    int          limit, lgh, ndata, nnew, i, j;
+
+    if (!tbl->quota.rows && !tbl->quota.bytes)
+        return 0;
+
+    limit = quota_row_limit(tbl);
+
+    if (tbl->quota.policy == mqi_quota_evict_oldest && limit > 0)
+        return 0;
+
+    for (ndata = 0;  data[ndata];  ndata++)
+        ;
+
+    if (tbl->nrow + ndata <= limit)
+        return 0;
+
+    /*
+     * A rejected row must not leave the rows before it in the table,
+     * so find out up front how many of the rows would really be added.
+     * Rows replacing or duplicating an indexed row do not count.
+     */
+    if (!MDB_INDEX_DEFINED(ix))
+        nnew = ndata;
+    else {
+        lgh  = ix->length;
+        row  = calloc(1, sizeof(mdb_row_t) + tbl->dlgh);
+        keys = calloc(ndata, lgh);
+
+        if (!row || !keys) {
+            free(row);
+            free(keys);
+            errno = ENOMEM;
+            return -1;
+        }
+
+        key = row->data + ix->offset;
+
+        for (i = nnew = 0;  i < ndata;  i++) {
+            for (j = 0;  cds[j].cindex >= 0;  j++) {
+                mdb_column_write(tbl->columns + cds[j].cindex, row->data,
+                                 cds + j, data[i]);
+            }
+
+            if (mdb_hash_get_data(ix->hash, lgh,key))
+                continue;
+
+            for (j = 0;  j < nnew;  j++) {
+                if (!memcmp(keys + j * lgh, key, lgh))
+                    break;
+            }
+
+            if (j == nnew)
+                memcpy(keys + nnew++ * lgh, key, lgh);
+        }
+
+        free(keys);
+        free(row);
+    }
+
+    if (tbl->nrow + nnew <= limit)
+        return 0;
+
+    tbl->stats.rejected += ndata;
+    errno = ENOSPC;
+
+    return -1;
+}
+
+static int enforce_quota(mdb_table_t *tbl, mdb_row_t *row)
+{
+    mdb_row_t *oldest, *n;
+    int        limit;
+
+    if (!tbl->quota.rows && !tbl->quota.bytes)
+        return 0;
+
+    if (tbl->nrow <= (limit = quota_row_limit(tbl)))
+        return 0;
+
+    if (tbl->quota.policy != mqi_quota_evict_oldest || limit < 1) {
+        tbl->stats.rejected++;
+        return -1;
+    }
+
+    /* rows are kept in insertion order, so the oldest ones are first */
+    MDB_DLIST_FOR_EACH_SAFE(mdb_row_t, link, oldest,n, &tbl->rows) {
+        if (tbl->nrow <= limit)
+            break;
+
+        if (oldest == row)
+            continue;
+
+        delete_single_row(tbl, oldest, 1);
+        tbl->stats.evicted++;
+    }
+
+    return 0;
+}
+
 static int delete_single_row(mdb_table_t *tbl, mdb_row_t *row,int index_update)
 {
     uint32_t txdepth = mdb_transaction_get_depth();
@@ -39,6 +39,13 @@
 #include "trigger.h"
 
 #define MDB_TABLE_HAS_INDEX(t)  MDB_INDEX_DEFINED(&t->index)
+#define MDB_TABLE_ROW_SIZE(t)   ((int)sizeof(mdb_row_t) + (t)->dlgh)
+
+#define MDB_TABLE_CHANGED(t)                                    \
+    do {                                                        \
+        if ((t)->snapshot)                                      \
+            mdb_table_snapshot_invalidate(t);                   \
+    } while (0)
 
 struct mdb_table_s {
     mqi_handle_t  handle;
@@ -52,10 +59,22 @@ struct mdb_table_s {
     mdb_dlist_t   rows;
     mdb_dlist_t   logs;         /* transaction logs */
     mdb_opcnt_t   cnt;
+    mqi_table_quota_t quota;    /* optional row/memory limits */
+    struct {
+        int       rows_max;     /* high-water mark of nrow */
+        uint32_t  rejected;     /* inserts rejected due to the quota */
+        uint32_t  evicted;      /* rows evicted due to the quota */
+        uint64_t  scanned;      /* rows visited by queries */
+    }             stats;
+    mdb_table_t  *snapshot;     /* frozen copy of the current rows */
+    int           snapref;      /* references to a frozen copy */
     mdb_trigger_t trigger;      /* must be the last: it has a array[0] @end  */
 };
 
 
+void mdb_table_snapshot_invalidate(mdb_table_t *);
+
+
 #endif /* __MDB_TABLE_H__ */
 
 /*
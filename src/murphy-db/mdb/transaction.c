@@ -227,6 +227,8 @@ static int add_row(mdb_table_t *tbl, mdb_row_t *row)
     MDB_CHECKARG(tbl && row, -1);
 
     MDB_DLIST_APPEND(mdb_row_t, link, row, &tbl->rows);
+    MDB_TABLE_CHANGED(tbl);
+    tbl->nrow++;
 
     tbl->cnt.deletes--;
 
@@ -65,6 +65,10 @@ typedef struct {
     mqi_data_type_t (*get_column_type)(void *, int);
     int (*get_column_size)(void *, int);
     int (*print_rows)(void *, char *, int);
+    int (*set_table_quota)(void *, mqi_table_quota_t *);
+    int (*get_table_stats)(void *, mqi_table_stats_t *);
+    void *(*snapshot_table)(void *);
+    void (*release_table_snapshot)(void *);
 } mqi_db_functbl_t;
 
 
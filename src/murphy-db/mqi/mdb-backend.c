@@ -76,6 +76,10 @@ static char *   get_column_name(void *, int);
 static mqi_data_type_t get_column_type(void *, int);
 static int      get_column_size(void *, int);
 static int      print_rows(void *, char *, int);
+static int      set_table_quota(void *, mqi_table_quota_t *);
+static int      get_table_stats(void *, mqi_table_stats_t *);
+static void *   snapshot_table(void *);
+static void     release_table_snapshot(void *);
 
 static mqi_db_functbl_t functbl = {
     create_transaction_trigger,
@@ -107,7 +111,11 @@ static mqi_db_functbl_t functbl = {
     get_column_name,
     get_column_type,
     get_column_size,
-    print_rows
+    print_rows,
+    set_table_quota,
+    get_table_stats,
+    snapshot_table,
+    release_table_snapshot
 };
 
 
@@ -304,6 +312,26 @@ static int print_rows(void *t, char *buf, int len)
     return mdb_table_print_rows((mdb_table_t *)t, buf, len);
 }
 
+static int set_table_quota(void *t, mqi_table_quota_t *quota)
+{
+    return mdb_table_set_quota((mdb_table_t *)t, quota);
+}
+
+static int get_table_stats(void *t, mqi_table_stats_t *stats)
+{
+    return mdb_table_get_stats((mdb_table_t *)t, stats);
+}
+
+static void *snapshot_table(void *t)
+{
+    return mdb_table_snapshot((mdb_table_t *)t);
+}
+
+static void release_table_snapshot(void *s)
+{
+    mdb_table_snapshot_release((mdb_table_t *)s);
+}
+
 
 /*
  * Local Variables:
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
+#include <time.h>
 
 #define _GNU_SOURCE
 #include <string.h>
@@ -68,6 +69,11 @@
 
 #define DB_TYPE(db) ((db)->flags & MQI_TABLE_TYPE_MASK)
 
+#define QUERY_LEN      256     /* max. length of a normalized query */
+#define QUERY_PLAN_LEN 256     /* max. length of a query plan */
+#define QUERY_MAX      512     /* max. number of distinct queries tracked */
+#define QUERY_OTHER    "<other>"
+
 #define GET_TABLE(tbl, ftb, h, errval)                                      \
     do {                                                                    \
         mqi_table_t *t;                                                     \
@@ -82,6 +88,26 @@
         }                                                                   \
     } while(0)
 
+#define GET_SNAPSHOT_TABLE(tbl, ftb, s, h, errval)                          \
+    do {                                                                    \
+        mqi_snapshot_t *snap;                                               \
+        int i;                                                              \
+        if (!(snap = mdb_handle_get_data(snapshot_handle, s))) {            \
+            errno = ENOENT;                                                 \
+            return errval;                                                  \
+        }                                                                   \
+        for (i = 0;  i < snap->ntable;  i++) {                              \
+            if (snap->tables[i].handle == h)                                \
+                break;                                                      \
+        }                                                                   \
+        if (i >= snap->ntable) {                                            \
+            errno = ENOENT;                                                 \
+            return errval;                                                  \
+        }                                                                   \
+        tbl = snap->tables[i].data;                                         \
+        ftb = snap->tables[i].ftb;                                          \
+    } while(0)
+
 typedef struct {
     const char       *engine;
     uint32_t          flags;
@@ -91,6 +117,7 @@ typedef struct {
 typedef struct {
     mqi_db_t    *db;
     void        *handle;
+    const char  *name;
 } mqi_table_t;
 
 typedef struct {
@@ -98,8 +125,41 @@ typedef struct {
     uint32_t txid[MAX_DB];
 } mqi_transaction_t;
 
+typedef struct {
+    int                  ntable;      /* number of tables in snapshot */
+    struct {
+        mqi_handle_t      handle;     /* table handle */
+        mqi_db_functbl_t *ftb;        /* backend of the table */
+        void             *data;       /* frozen table */
+    }                    tables[0];
+} mqi_snapshot_t;
+
+typedef struct {
+    int       depth;                  /* query nesting depth */
+    uint64_t  start;                  /* start of outermost query */
+    uint64_t  scanned;                /* rows visited so far */
+    uint64_t  returned;               /* rows returned/affected so far */
+    char      text[QUERY_LEN];        /* normalized query */
+    char      plan[QUERY_PLAN_LEN];   /* table accesses of the query */
+    int       planlen;
+} mqi_query_t;
+
+typedef struct {
+    int         active;               /* whether the access is tracked */
+    const char *table;                /* table being accessed */
+    uint64_t    scanned;              /* rows visited before the access */
+} mqi_query_op_t;
+
 
 static int db_register(const char *, uint32_t, mqi_db_functbl_t *);
+static void query_op_begin(mqi_query_op_t *, mqi_handle_t, const char *,
+                           int, mqi_db_functbl_t *, void *);
+static void query_op_end(mqi_query_op_t *, const char *, int,
+                         mqi_db_functbl_t *, void *);
+static uint64_t query_now(void);
+static mqi_query_stats_t *query_lookup(const char *);
+static int query_stats_cmp(const void *, const void *);
+static int snapshot_add(mqi_snapshot_t *, mqi_handle_t);
 
 
 static int        ndb;
@@ -107,9 +167,27 @@ static mqi_db_t   *dbs;
 mdb_handle_map_t  *table_handle;
 mdb_hash_t        *table_name_hash;
 mdb_handle_map_t  *transact_handle;
+mdb_handle_map_t  *snapshot_handle;
 mqi_transaction_t  txstack[MQI_TXDEPTH_MAX];
 int                txdepth;
 
+static mqi_query_t   query;
+static mdb_hash_t   *query_hash;
+static int           nquery;
+static int           query_stats;     /* whether to collect statistics */
+static struct {
+    uint32_t            threshold;    /* slow query threshold, 0 = off */
+    mqi_slow_query_cb_t cb;
+    void               *user_data;
+} slowlog;
+
+/*
+ * Queries are only timed and accounted if statistics are enabled or a
+ * slow query callback is set. An already started query is always
+ * finished, so toggling either in the middle of a query is safe.
+ */
+#define QUERY_TRACKED() (query.depth > 0 || query_stats || slowlog.threshold)
+
 
 int mqi_open(void)
 {
@@ -123,6 +201,7 @@ int mqi_open(void)
         table_name_hash = MDB_HASH_TABLE_CREATE(varchar, 256);
 
         transact_handle = MDB_HANDLE_MAP_CREATE();
+        snapshot_handle = MDB_HANDLE_MAP_CREATE();
 
         if (db_register("MurphyDB", MQI_TEMPORARY, mdb_backend_init()) < 0) {
             errno = EIO;
@@ -146,10 +225,14 @@ int mqi_close(void)
         MDB_HANDLE_MAP_DESTROY(table_handle);
         MDB_HASH_TABLE_DESTROY(table_name_hash);
         MDB_HANDLE_MAP_DESTROY(transact_handle);
+        MDB_HANDLE_MAP_DESTROY(snapshot_handle);
 
         table_handle = NULL;
         table_name_hash = NULL;
         transact_handle = NULL;
+        snapshot_handle = NULL;
+
+        mqi_reset_query_stats();
 
         dbs = NULL;
         ndb = 0;
@@ -518,6 +601,8 @@ mqi_handle_t mqi_create_table(char *name,
     if (!(namedup = strdup(name)))
         goto cleanup;
 
+    tbl->name = namedup;
+
     if (!(tbl->handle = ftb->create_table(name, index_columns, cdefs)))
         goto cleanup;
 
@@ -547,6 +632,29 @@ mqi_handle_t mqi_create_table(char *name,
     return MDB_HANDLE_INVALID;
 }
 
+mqi_handle_t mqi_create_table_with_quota(char *name,
+                                         uint32_t flags,
+                                         char **index_columns,
+                                         mqi_column_def_t *cdefs,
+                                         mqi_table_quota_t *quota)
+{
+    mqi_handle_t h;
+    int          error;
+
+    MDB_CHECKARG(name && cdefs && quota, MQI_HANDLE_INVALID);
+
+    h = mqi_create_table(name, flags, index_columns, cdefs);
+
+    if (h != MQI_HANDLE_INVALID && mqi_set_table_quota(h, quota) < 0) {
+        error = errno;
+        mqi_drop_table(h);
+        errno = error;
+        h = MQI_HANDLE_INVALID;
+    }
+
+    return h;
+}
+
 
 int mqi_create_index(mqi_handle_t h, char **index_columns)
 {
@@ -611,13 +719,19 @@ int mqi_insert_into(mqi_handle_t         h,
 {
     mqi_db_functbl_t *ftb;
     void             *tbl;
+    mqi_query_op_t    op;
+    int               n;
 
     MDB_CHECKARG(h != MDB_HANDLE_INVALID && cds && data && data[0], -1);
     MDB_PREREQUISITE(dbs && ndb > 0, -1);
 
     GET_TABLE(tbl, ftb, h, -1);
 
-    return ftb->insert_into(tbl, ignore, cds, data);
+    query_op_begin(&op, h, "insert into", 0, ftb, tbl);
+    n = ftb->insert_into(tbl, ignore, cds, data);
+    query_op_end(&op, "insert", n, ftb, tbl);
+
+    return n;
 }
 
 int mqi_select(mqi_handle_t       h,
@@ -629,6 +743,8 @@ int mqi_select(mqi_handle_t       h,
 {
     mqi_db_functbl_t *ftb;
     void             *tbl;
+    mqi_query_op_t    op;
+    int               n;
 
     MDB_CHECKARG(h != MDB_HANDLE_INVALID && cds &&
                  rows && rowsize > 0 && dim > 0, -1);
@@ -636,7 +752,11 @@ int mqi_select(mqi_handle_t       h,
 
     GET_TABLE(tbl, ftb, h, -1);
 
-    return ftb->select(tbl, cond, cds, rows, rowsize, dim);
+    query_op_begin(&op, h, "select from", cond != NULL, ftb, tbl);
+    n = ftb->select(tbl, cond, cds, rows, rowsize, dim);
+    query_op_end(&op, cond ? "filtered scan" : "full scan", n, ftb, tbl);
+
+    return n;
 }
 
 int mqi_select_by_index(mqi_handle_t       h,
@@ -646,13 +766,19 @@ int mqi_select_by_index(mqi_handle_t       h,
 {
     mqi_db_functbl_t *ftb;
     void             *tbl;
+    mqi_query_op_t    op;
+    int               n;
 
     MDB_CHECKARG(h != MDB_HANDLE_INVALID && idxvars && cds && result, -1);
     MDB_PREREQUISITE(dbs && ndb > 0, -1);
 
     GET_TABLE(tbl, ftb, h, -1);
 
-    return ftb->select_by_index(tbl, idxvars, cds, result);
+    query_op_begin(&op, h, "select by index from", 0, ftb, tbl);
+    n = ftb->select_by_index(tbl, idxvars, cds, result);
+    query_op_end(&op, "index lookup", n, ftb, tbl);
+
+    return n;
 }
 
 int mqi_update(mqi_handle_t       h,
@@ -662,26 +788,38 @@ int mqi_update(mqi_handle_t       h,
 {
     mqi_db_functbl_t *ftb;
     void             *tbl;
+    mqi_query_op_t    op;
+    int               n;
 
     MDB_CHECKARG(h != MDB_HANDLE_INVALID && cds && data, -1);
     MDB_PREREQUISITE(dbs && ndb > 0, -1);
 
     GET_TABLE(tbl, ftb, h, -1);
 
-    return ftb->update(tbl, cond, cds, data);
+    query_op_begin(&op, h, "update", cond != NULL, ftb, tbl);
+    n = ftb->update(tbl, cond, cds, data);
+    query_op_end(&op, cond ? "filtered scan" : "full scan", n, ftb, tbl);
+
+    return n;
 }
 
 int mqi_delete_from(mqi_handle_t h, mqi_cond_entry_t *cond)
 {
     mqi_db_functbl_t *ftb;
     void             *tbl;
+    mqi_query_op_t    op;
+    int               n;
 
     MDB_CHECKARG(h != MDB_HANDLE_INVALID, -1);
     MDB_PREREQUISITE(dbs && ndb > 0, -1);
 
     GET_TABLE(tbl, ftb, h, -1);
 
-    return ftb->delete_from(tbl, cond);
+    query_op_begin(&op, h, "delete from", cond != NULL, ftb, tbl);
+    n = ftb->delete_from(tbl, cond);
+    query_op_end(&op, cond ? "filtered scan" : "full scan", n, ftb, tbl);
+
+    return n;
 }
 
 mqi_handle_t mqi_get_table_handle(char *table_name)
@@ -791,6 +929,273 @@ int mqi_print_rows(mqi_handle_t h, char *buf, int len)
     return ftb->print_rows(tbl, buf, len);
 }
 
+int mqi_set_table_quota(mqi_handle_t h, mqi_table_quota_t *quota)
+{
+    mqi_db_functbl_t *ftb;
+    void             *tbl;
+
+    MDB_CHECKARG(h != MDB_HANDLE_INVALID && quota, -1);
+    MDB_PREREQUISITE(dbs && ndb > 0, -1);
+
+    GET_TABLE(tbl, ftb, h, -1);
+
+    if (!ftb->set_table_quota) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+
+    return ftb->set_table_quota(tbl, quota);
+}
+
+int mqi_get_table_stats(mqi_handle_t h, mqi_table_stats_t *stats)
+{
+    mqi_db_functbl_t *ftb;
+    void             *tbl;
+
+    MDB_CHECKARG(h != MDB_HANDLE_INVALID && stats, -1);
+    MDB_PREREQUISITE(dbs && ndb > 0, -1);
+
+    GET_TABLE(tbl, ftb, h, -1);
+
+    if (!ftb->get_table_stats) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+
+    return ftb->get_table_stats(tbl, stats);
+}
+
+
+int mqi_query_begin(const char *text)
+{
+    if (!QUERY_TRACKED())
+        return 0;
+
+    if (query.depth++ > 0)
+        return 0;
+
+    snprintf(query.text, sizeof(query.text), "%s", text ? text : "<unknown>");
+
+    query.scanned  = 0;
+    query.returned = 0;
+    query.plan[0]  = '\0';
+    query.planlen  = 0;
+    query.start    = query_now();
+
+    return 0;
+}
+
+int mqi_query_end(void)
+{
+    mqi_query_stats_t *qs;
+    uint64_t           usecs;
+
+    if (!QUERY_TRACKED())
+        return 0;
+
+    MDB_PREREQUISITE(query.depth > 0, -1);
+
+    if (--query.depth > 0)
+        return 0;
+
+    usecs = query_now() - query.start;
+
+    if (query_stats && (qs = query_lookup(query.text)) != NULL) {
+        qs->calls++;
+        qs->total    += usecs;
+        qs->scanned  += query.scanned;
+        qs->returned += query.returned;
+
+        if (usecs > qs->max)
+            qs->max = usecs;
+    }
+
+    if (slowlog.threshold && usecs >= slowlog.threshold && slowlog.cb)
+        slowlog.cb(query.text, query.planlen ? query.plan : "no table access",
+                   usecs, slowlog.user_data);
+
+    return 0;
+}
+
+int mqi_get_query_stats(mqi_query_stats_t *stats, int dim)
+{
+    mqi_query_stats_t *qs;
+    void              *cursor;
+    int                n;
+
+    MDB_CHECKARG(stats && dim > 0, -1);
+
+    n = 0;
+
+    if (query_hash) {
+        MDB_HASH_TABLE_FOR_EACH(query_hash, qs, cursor) {
+            if (n >= dim)
+                break;
+
+            stats[n++] = *qs;
+        }
+    }
+
+    qsort(stats, n, sizeof(stats[0]), query_stats_cmp);
+
+    return n;
+}
+
+void mqi_reset_query_stats(void)
+{
+    mqi_query_stats_t *qs;
+    void              *cursor;
+
+    if (query_hash) {
+        MDB_HASH_TABLE_FOR_EACH(query_hash, qs, cursor) {
+            free((char *)qs->query);
+            free(qs);
+        }
+
+        MDB_HASH_TABLE_DESTROY(query_hash);
+        query_hash = NULL;
+    }
+
+    nquery = 0;
+}
+
+int mqi_enable_query_stats(int enable)
+{
+    int old = query_stats;
+
+    query_stats = enable ? 1 : 0;
+
+    return old;
+}
+
+int mqi_query_stats_enabled(void)
+{
+    return query_stats;
+}
+
+void mqi_set_slow_query_log(uint32_t            usecs,
+                            mqi_slow_query_cb_t cb,
+                            void               *user_data)
+{
+    slowlog.threshold = cb ? usecs : 0;
+    slowlog.cb        = cb;
+    slowlog.user_data = cb ? user_data : NULL;
+}
+
+uint32_t mqi_get_slow_query_threshold(void)
+{
+    return slowlog.threshold;
+}
+
+
+mqi_handle_t mqi_snapshot_create(mqi_handle_t *tables, int ntable)
+{
+    mqi_snapshot_t *snap;
+    mqi_handle_t    h;
+    void           *data;
+    void           *cursor;
+    int             i;
+
+    MDB_CHECKARG(tables ? ntable > 0 : ntable == 0, MQI_HANDLE_INVALID);
+    MDB_PREREQUISITE(dbs && ndb > 0 && snapshot_handle, MQI_HANDLE_INVALID);
+
+    if (!tables) {
+        MDB_HASH_TABLE_FOR_EACH(table_name_hash, data, cursor)
+            ntable++;
+    }
+
+    snap = calloc(1, sizeof(*snap) + ntable * sizeof(snap->tables[0]));
+
+    if (!snap) {
+        errno = ENOMEM;
+        return MQI_HANDLE_INVALID;
+    }
+
+    if (tables) {
+        for (i = 0;  i < ntable;  i++) {
+            if (snapshot_add(snap, tables[i]) < 0)
+                goto failed;
+        }
+    }
+    else {
+        MDB_HASH_TABLE_FOR_EACH(table_name_hash, data, cursor) {
+            if (snap->ntable >= ntable || snapshot_add(snap, data - NULL) < 0)
+                goto failed;
+        }
+    }
+
+    if ((h = mdb_handle_add(snapshot_handle, snap)) == MQI_HANDLE_INVALID)
+        goto failed;
+
+    return h;
+
+ failed:
+    for (i = 0;  i < snap->ntable;  i++)
+        snap->tables[i].ftb->release_table_snapshot(snap->tables[i].data);
+
+    free(snap);
+
+    return MQI_HANDLE_INVALID;
+}
+
+int mqi_snapshot_release(mqi_handle_t h)
+{
+    mqi_snapshot_t *snap;
+    int             i;
+
+    MDB_CHECKARG(h != MDB_HANDLE_INVALID, -1);
+    MDB_PREREQUISITE(dbs && ndb > 0 && snapshot_handle, -1);
+
+    if (!(snap = mdb_handle_delete(snapshot_handle, h)))
+        return -1;
+
+    for (i = 0;  i < snap->ntable;  i++)
+        snap->tables[i].ftb->release_table_snapshot(snap->tables[i].data);
+
+    free(snap);
+
+    return 0;
+}
+
+int mqi_snapshot_select(mqi_handle_t       s,
+                        mqi_handle_t       h,
+                        mqi_cond_entry_t  *cond,
+                        mqi_column_desc_t *cds,
+                        void              *rows,
+                        int                rowsize,
+                        int                dim)
+{
+    mqi_db_functbl_t *ftb;
+    void             *tbl;
+    mqi_query_op_t    op;
+    int               n;
+
+    MDB_CHECKARG(s != MDB_HANDLE_INVALID && h != MDB_HANDLE_INVALID &&
+                 cds && rows && rowsize > 0 && dim > 0, -1);
+    MDB_PREREQUISITE(dbs && ndb > 0 && snapshot_handle, -1);
+
+    GET_SNAPSHOT_TABLE(tbl, ftb, s, h, -1);
+
+    query_op_begin(&op, h, "select from", cond != NULL, ftb, tbl);
+    n = ftb->select(tbl, cond, cds, rows, rowsize, dim);
+    query_op_end(&op, cond ? "filtered snapshot scan" : "full snapshot scan",
+                 n, ftb, tbl);
+
+    return n;
+}
+
+int mqi_snapshot_get_table_size(mqi_handle_t s, mqi_handle_t h)
+{
+    mqi_db_functbl_t *ftb;
+    void             *tbl;
+
+    MDB_CHECKARG(s != MDB_HANDLE_INVALID && h != MDB_HANDLE_INVALID, -1);
+    MDB_PREREQUISITE(dbs && ndb > 0 && snapshot_handle, -1);
+
+    GET_SNAPSHOT_TABLE(tbl, ftb, s, h, -1);
+
+    return ftb->get_table_size(tbl);
+}
 
 
 static int db_register(const char       *engine,
@@ -824,6 +1229,152 @@ static int db_register(const char       *engine,
     return 0;
 }
 
+static uint64_t query_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static mqi_query_stats_t *query_lookup(const char *text)
+{
+    mqi_query_stats_t *qs;
+
+    if (!query_hash && !(query_hash = MDB_HASH_TABLE_CREATE(varchar, 64)))
+        return NULL;
+
+    if ((qs = mdb_hash_get_data(query_hash, 0,(void *)text)) != NULL)
+        return qs;
+
+    if (nquery >= QUERY_MAX) {
+        if ((qs = mdb_hash_get_data(query_hash, 0,QUERY_OTHER)) != NULL)
+            return qs;
+
+        text = QUERY_OTHER;
+    }
+
+    if (!(qs = calloc(1, sizeof(*qs))))
+        return NULL;
+
+    if (!(qs->query = strdup(text)) ||
+        mdb_hash_add(query_hash, 0,(void *)qs->query, qs) < 0)
+    {
+        free((char *)qs->query);
+        free(qs);
+        return NULL;
+    }
+
+    nquery++;
+
+    return qs;
+}
+
+static int query_stats_cmp(const void *a, const void *b)
+{
+    const mqi_query_stats_t *qa = a, *qb = b;
+
+    if (qa->total != qb->total)
+        return qa->total < qb->total ? 1 : -1;
+    else
+        return strcmp(qa->query, qb->query);
+}
+
+static void query_op_begin(mqi_query_op_t   *op,
+                           mqi_handle_t      h,
+                           const char       *verb,
+                           int               cond,
+                           mqi_db_functbl_t *ftb,
+                           void             *tbl)
+{
+    mqi_table_t       *t;
+    mqi_table_stats_t  stats;
+    char               text[QUERY_LEN];
+
+    if (!(op->active = QUERY_TRACKED()))
+        return;
+
+    t = mdb_handle_get_data(table_handle, h);
+
+    op->table   = t && t->name ? t->name : "<unknown>";
+    op->scanned = 0;
+
+    if (ftb->get_table_stats && ftb->get_table_stats(tbl, &stats) == 0)
+        op->scanned = stats.scanned;
+
+    if (query.depth > 0)
+        mqi_query_begin(NULL);
+    else {
+        snprintf(text, sizeof(text), "%s %s%s", verb, op->table,
+                 cond ? " where ?" : "");
+        mqi_query_begin(text);
+    }
+}
+
+static void query_op_end(mqi_query_op_t   *op,
+                         const char       *how,
+                         int               nrow,
+                         mqi_db_functbl_t *ftb,
+                         void             *tbl)
+{
+    mqi_table_stats_t  stats;
+    uint64_t           scanned;
+    int                error, l, n;
+
+    if (!op->active)
+        return;
+
+    error   = errno;
+    scanned = 0;
+
+    if (ftb->get_table_stats && ftb->get_table_stats(tbl, &stats) == 0)
+        scanned = stats.scanned - op->scanned;
+
+    query.scanned  += scanned;
+    query.returned += nrow > 0 ? nrow : 0;
+
+    if ((l = sizeof(query.plan) - query.planlen) > 1) {
+        n = snprintf(query.plan + query.planlen, l,
+                     "%s%s: %s, %llu scanned, %d %s",
+                     query.planlen ? "; " : "", op->table, how,
+                     (unsigned long long)scanned, nrow > 0 ? nrow : 0,
+                     nrow < 0 ? "(failed)" : "returned");
+        query.planlen += n < l ? n : l - 1;
+    }
+
+    mqi_query_end();
+
+    errno = error;
+}
+
+static int snapshot_add(mqi_snapshot_t *snap, mqi_handle_t h)
+{
+    mqi_table_t      *tbl;
+    mqi_db_functbl_t *ftb;
+    void             *data;
+
+    if (!(tbl = mdb_handle_get_data(table_handle, h)) || !tbl->db) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (!(ftb = tbl->db->functbl) || !ftb->snapshot_table) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+
+    if (!(data = ftb->snapshot_table(tbl->handle)))
+        return -1;
+
+    snap->tables[snap->ntable].handle = h;
+    snap->tables[snap->ntable].ftb    = ftb;
+    snap->tables[snap->ntable].data   = data;
+    snap->ntable++;
+
+    return 0;
+}
+
 /*
  * Local Variables:
  * c-basic-offset: 4
@@ -75,6 +75,7 @@ struct input_s {
 
 extern int yy_mql_lineno;
 extern int yy_mql_lex(void);
+extern int yy_mql_lex_destroy(void);
 
 
 void yy_mql_error(const char *);
@@ -82,9 +83,14 @@ void yy_mql_error(const char *);
 static int set_select_variables(int *, mqi_data_type_t *, int *, char *,int);
 static void print_query_result(mqi_column_desc_t *, mqi_data_type_t *,
                                int *, int, int, void *);
+static void normalize_query(const char *, char *, int);
+static int batch_collect(void);
+static int batch_reject(const char *);
+static void batch_free(void);
 
 static mqi_handle_t table;
 static uint32_t     table_flags;
+static mqi_table_quota_t table_quota;
 
 static char                  *trigger_name;
 static struct mql_callback_s *callback;
@@ -124,6 +130,13 @@ static mql_statement_t   *statement;
 static mql_result_type_t  rtype;
 static mql_result_t      *result;
 
+static bool               batch;      /* executing mql_exec_batch() */
+static bool               syntax_err; /* syntax error in the batch */
+static int                nbatched;   /* statements executed so far */
+static mql_result_t     **batchres;   /* results of the batch */
+static int                batchdim;   /* dimension of batchres */
+static int                nbatchres;  /* number of results in batchres */
+
 static char        *file;
 static const char  *mqlbuf;
 static int          mqlin;
@@ -174,6 +187,10 @@ static FILE        *mqlout;
 %token <string>   TKN_PERSISTENT
 %token <string>   TKN_TEMPORARY
 %token <string>   TKN_CALLBACK
+%token <string>   TKN_QUOTA
+%token <string>   TKN_BYTES
+%token <string>   TKN_EVICT
+%token <string>   TKN_REJECT
 %token <string>   TKN_VARCHAR
 %token <string>   TKN_INTEGER
 %token <string>   TKN_UNSIGNED
@@ -201,6 +218,8 @@ static FILE        *mqlout;
 %token <string>   TKN_IDENTIFIER
 %token <string>   TKN_QUOTED_STRING
 
+%type <string>    identifier
+
 %type <boolean>   optional_trigger_select
 
 %type <integer>   insert
@@ -295,12 +314,17 @@ static FILE        *mqlout;
 
 /*#toplevel#*/
 statement_list:
-  statement
-| statement_list semicolon statement
+  batch_statement
+| statement_list semicolon batch_statement
 ;
 
+batch_statement: statement {
+    if (batch && batch_collect() < 0)
+        YYABORT;
+};
+
 semicolon: TKN_SEMICOLON {
-    if (mode != mql_mode_parser) {
+    if (mode != mql_mode_parser && !batch) {
         result = mql_result_error_create(EINVAL, "multiple MQL statements");
         YYERROR;
     }
@@ -403,7 +427,11 @@ create_trigger_statement:
 /* create table */
 
 create_table: table_flags TKN_TABLE {
+    if (batch && batch_reject("CREATE TABLE") < 0)
+        YYABORT;
+
     coldef = coldefs;
+    memset(&table_quota, 0, sizeof(table_quota));
     
     if (table_flags == MQI_ANY)
         table_flags = MQI_TEMPORARY;
@@ -411,13 +439,43 @@ create_table: table_flags TKN_TABLE {
 
 
 
-table_definition: TKN_IDENTIFIER TKN_LEFT_PAREN column_defs TKN_RIGHT_PAREN {
-    if (mqi_create_table($1, table_flags, NULL, coldefs) == MQI_HANDLE_INVALID)
+table_definition:
+  identifier TKN_LEFT_PAREN column_defs TKN_RIGHT_PAREN table_quota {
+    mqi_handle_t h;
+
+    if (!table_quota.rows && !table_quota.bytes)
+        h = mqi_create_table($1, table_flags, NULL, coldefs);
+    else
+        h = mqi_create_table_with_quota($1, table_flags, NULL, coldefs,
+                                        &table_quota);
+
+    if (h == MQI_HANDLE_INVALID)
         MQL_ERROR(errno, "Can't create table: %s\n", strerror(errno));
     else
         MQL_SUCCESS;
 };
 
+table_quota:
+  /* no quota */
+| TKN_QUOTA quota_limits quota_policy
+;
+
+quota_limits:
+  quota_limit
+| quota_limits quota_limit
+;
+
+quota_limit:
+  TKN_NUMBER TKN_ROWS   { table_quota.rows  = (uint32_t)$1; }
+| TKN_NUMBER TKN_BYTES  { table_quota.bytes = (uint32_t)$1; }
+;
+
+quota_policy:
+  /* default */ { table_quota.policy = mqi_quota_reject;       }
+| TKN_REJECT    { table_quota.policy = mqi_quota_reject;       }
+| TKN_EVICT     { table_quota.policy = mqi_quota_evict_oldest; }
+;
+
 /*#toplevel#*/
 column_defs:
   column_def
@@ -429,7 +487,7 @@ column_def: column_name column_type {
     memset(++coldef, 0, sizeof(mqi_column_def_t));
 };
 
-column_name: TKN_IDENTIFIER {
+column_name: identifier {
     if ((coldef - coldefs) >= MQI_COLUMN_MAX) {
         MQL_ERROR(EOVERFLOW, "Too many columns. Max %d columns allowed\n",
                   MQI_COLUMN_MAX);
@@ -458,6 +516,9 @@ blob: TKN_BLOB TKN_LEFT_PAREN TKN_NUMBER TKN_RIGHT_PAREN {
 /* create index */
 
 create_index: TKN_INDEX {
+    if (batch && batch_reject("CREATE INDEX") < 0)
+        YYABORT;
+
     ncolnam = 0;
 };
 
@@ -490,7 +551,10 @@ create_row_trigger: TKN_CREATE create_trigger row_trigger
 create_column_trigger: TKN_CREATE create_trigger column_trigger
 ;
 
-create_trigger: TKN_TRIGGER TKN_IDENTIFIER TKN_ON {
+create_trigger: TKN_TRIGGER identifier TKN_ON {
+    if (batch && batch_reject("CREATE TRIGGER") < 0)
+        YYABORT;
+
     if (mode != mql_mode_exec)
         MQL_ERROR(EPERM, "only mql_exec_string() can create triggers");
     else {
@@ -546,7 +610,7 @@ row_trigger: TKN_ROWS TKN_IN table_name callback trigger_select {
         MQL_SUCCESS;
 };
 
-column_trigger: TKN_COLUMN TKN_IDENTIFIER TKN_IN table_name callback
+column_trigger: TKN_COLUMN identifier TKN_IN table_name callback
                 optional_trigger_select
 {
     int colidx;
@@ -588,7 +652,7 @@ column_trigger: TKN_COLUMN TKN_IDENTIFIER TKN_IN table_name callback
 };
 
 
-callback: TKN_CALLBACK TKN_IDENTIFIER {
+callback: TKN_CALLBACK identifier {
     if (!(callback = mql_find_callback($2))) {
         MQL_ERROR(ENOENT, "can't find callback '%s'", $2);
     }
@@ -617,6 +681,9 @@ drop_statement:
 
 /*#toplevel#*/
 drop_table_statement: TKN_DROP TKN_TABLE  table_name {
+    if (batch && batch_reject("DROP TABLE") < 0)
+        YYABORT;
+
     if (mqi_drop_table(table) < 0)
         MQL_ERROR(errno, "failed to drop table: %s", strerror(errno));
     else
@@ -638,7 +705,7 @@ drop_index_statement: TKN_DROP TKN_INDEX table_name {
  *
  */
 /*#toplevel#*/
-begin_statement: TKN_BEGIN transaction TKN_IDENTIFIER {
+begin_statement: TKN_BEGIN transaction identifier {
     if (mode == mql_mode_precompile)
         statement = mql_make_transaction_statement(mql_statement_begin, $3);
     else {
@@ -650,7 +717,7 @@ begin_statement: TKN_BEGIN transaction TKN_IDENTIFIER {
 };
 
 /*#toplevel#*/
-commit_statement: TKN_COMMIT transaction TKN_IDENTIFIER {
+commit_statement: TKN_COMMIT transaction identifier {
     if (mode == mql_mode_precompile)
         statement = mql_make_transaction_statement(mql_statement_commit, $3);
     else {
@@ -662,7 +729,7 @@ commit_statement: TKN_COMMIT transaction TKN_IDENTIFIER {
 };
 
 /*#toplevel#*/
-rollback_statement: TKN_ROLLBACK transaction TKN_IDENTIFIER {
+rollback_statement: TKN_ROLLBACK transaction identifier {
     if (mode == mql_mode_precompile)
         statement = mql_make_transaction_statement(mql_statement_rollback, $3);
     else {
@@ -883,7 +950,7 @@ assignment_list:
 ;
 
 /*#toplevel#*/
-assignment: TKN_IDENTIFIER TKN_EQUAL input_value {
+assignment: identifier TKN_EQUAL input_value {
     int                i   = ninput - 1;
     input_t           *inp = inputs + i;
     mqi_column_desc_t *cd  = coldescs + i;
@@ -1052,11 +1119,26 @@ transaction:
  * Table name
  *
  */
-table_name: TKN_IDENTIFIER {
+table_name: identifier {
     if ((table = mqi_get_table_handle($1)) == MQI_HANDLE_INVALID)
         MQL_ERROR(errno, "Do not know anything about '%s'", $1);
 };
 
+/***********************************
+ *
+ * Identifier
+ *
+ * The table quota keywords are not reserved, they can still be used
+ * to name tables, columns, triggers, callbacks and transactions.
+ */
+identifier:
+  TKN_IDENTIFIER { $$ = $1; }
+| TKN_QUOTA      { $$ = $1; }
+| TKN_BYTES      { $$ = $1; }
+| TKN_EVICT      { $$ = $1; }
+| TKN_REJECT     { $$ = $1; }
+;
+
 /***********************************
  *
  * Table flags
@@ -1079,7 +1161,7 @@ column_list:
 | column_list TKN_COMMA column
 ;
 
-column: TKN_IDENTIFIER {
+column: identifier {
     if (ncolnam < MQI_COLUMN_MAX)
         colnams[ncolnam++] = $1;
     else
@@ -1162,7 +1244,7 @@ value:
 | unary_operator value
 ;
 
-column_value: TKN_IDENTIFIER {
+column_value: identifier {
     int cx;
 
     if (cond - conds >= MQI_COND_MAX)
@@ -1360,6 +1442,9 @@ int mql_exec_file(const char *path)
 
 mql_result_t *mql_exec_string(mql_result_type_t result_type, const char *str)
 {
+    char query[256];
+    int tracked;
+
     if (result_type == mql_result_dontcare)
         result_type = mql_result_string;
 
@@ -1374,14 +1459,103 @@ mql_result_t *mql_exec_string(mql_result_type_t result_type, const char *str)
     rtype  = result_type;
     mqlbuf = str;
 
+    tracked = mqi_query_stats_enabled() || mqi_get_slow_query_threshold();
+
+    if (tracked) {
+        normalize_query(str, query, sizeof(query));
+        mqi_query_begin(query);
+    }
+
     if (yy_mql_parse() && !result) {
         result = mql_result_error_create(EIO, "Syntax error in '%s'", str);
     }
 
+    if (tracked)
+        mqi_query_end();
 
     return result;
 }
 
+mql_result_t *mql_exec_batch(mql_result_type_t result_type, const char *str,
+                             mql_result_t **results, int *nresult)
+{
+    char query[256];
+    mqi_handle_t tx;
+    mql_result_t *r;
+    int failed, tracked;
+
+    if (result_type == mql_result_dontcare)
+        result_type = mql_result_string;
+
+    MDB_CHECKARG((result_type == mql_result_event ||
+                  result_type == mql_result_columns  ||
+                  result_type == mql_result_rows ||
+                  result_type == mql_result_string  ) &&
+                 str && (!results || (nresult && *nresult >= 0)), NULL);
+
+    if ((tx = mqi_begin_transaction()) == MQI_HANDLE_INVALID) {
+        return mql_result_error_create(errno, "can't start transaction: %s",
+                                       strerror(errno));
+    }
+
+    mode       = mql_mode_exec;
+    batch      = true;
+    syntax_err = false;
+    result     = NULL;
+    rtype      = result_type;
+    mqlbuf     = str;
+    nbatched   = 0;
+    batchres   = results;
+    batchdim   = results ? *nresult : 0;
+    nbatchres  = 0;
+
+    tracked = mqi_query_stats_enabled() || mqi_get_slow_query_threshold();
+
+    if (tracked) {
+        normalize_query(str, query, sizeof(query));
+        mqi_query_begin(query);
+    }
+
+    failed = yy_mql_parse() || (result && !mql_result_is_success(result));
+
+    if (failed) {
+        /* we might have bailed out in the middle of the script */
+        yy_mql_lex_destroy();
+        mqi_rollback_transaction(tx);
+
+        if (!result)
+            r = mql_result_error_create(EIO, "Syntax error in '%s'", str);
+        else {
+            r = mql_result_error_create(mql_result_error_get_code(result),
+                                        "statement #%d: %s", nbatched,
+                                        mql_result_error_get_message(result));
+            mql_result_free(result);
+        }
+
+        batch_free();
+    }
+    else if (mqi_commit_transaction(tx) < 0) {
+        r = mql_result_error_create(errno, "can't commit transaction: %s",
+                                    strerror(errno));
+        batch_free();
+    }
+    else
+        r = mql_result_success_create();
+
+    if (tracked)
+        mqi_query_end();
+
+    if (nresult)
+        *nresult = nbatchres;
+
+    batch    = false;
+    batchres = NULL;
+    batchdim = 0;
+    result   = NULL;
+
+    return r;
+}
+
 mql_statement_t *mql_precompile(const char *str)
 {
     MDB_CHECKARG(str, NULL);
@@ -1412,6 +1586,7 @@ int yy_mql_input(void *dst, unsigned dstlen)
             else {
                 memcpy(dst, mqlbuf, dstlen);
                 mqlbuf += dstlen;
+                len = dstlen;
             }
         }
         else if (mqlin >= 0) {
@@ -1431,6 +1606,68 @@ void yy_mql_error(const char *msg)
 {
     if (mode == mql_mode_parser)
         fprintf(mqlout, "Error: '%s'\n", msg);
+
+    if (batch)
+        syntax_err = true;
+}
+
+
+static int batch_collect(void)
+{
+    mql_result_t *r = result;
+
+    nbatched++;
+
+    if (!r) {
+        if (syntax_err) {
+            result = mql_result_error_create(EIO, "syntax error");
+            return -1;
+        }
+
+        r = mql_result_success_create();
+    }
+    else if (!mql_result_is_success(r))
+        return -1;
+
+    result = NULL;
+
+    if (nbatchres < batchdim)
+        batchres[nbatchres++] = r;
+    else
+        mql_result_free(r);
+
+    return 0;
+}
+
+
+/*
+ * Schema changes and triggers are not undone by rolling back the
+ * transaction of a failed batch, so they are not allowed in one. They
+ * are rejected before being carried out, counting the statement for
+ * the error message the same way batch_collect() does.
+ */
+static int batch_reject(const char *what)
+{
+    nbatched++;
+
+    mql_result_free(result);
+    result = mql_result_error_create(EPERM, "%s is not allowed in a batch",
+                                     what);
+
+    return -1;
+}
+
+
+static void batch_free(void)
+{
+    int i;
+
+    for (i = 0;  i < nbatchres;  i++) {
+        mql_result_free(batchres[i]);
+        batchres[i] = NULL;
+    }
+
+    nbatchres = 0;
 }
 
 
@@ -1487,6 +1724,50 @@ static int set_select_variables(int *rowsize,
 }
 
 
+/*
+ * Reduce a statement to its shape for the query statistics: collapse
+ * whitespace and replace string and numeric literals with '?', so that
+ * statements differing only in their values are accounted together.
+ */
+static void normalize_query(const char *str, char *buf, int len)
+{
+    const char *s = str;
+    char       *p = buf;
+    char       *e = buf + len - 1;
+    char        quote;
+
+    while (*s && isspace((unsigned char)*s))
+        s++;
+
+    while (*s && p < e) {
+        if (isspace((unsigned char)*s)) {
+            while (isspace((unsigned char)*s))
+                s++;
+            if (*s)
+                *p++ = ' ';
+        }
+        else if (*s == '\'' || *s == '"') {
+            for (quote = *s++;  *s && *s != quote;  s++)
+                ;
+            if (*s)
+                s++;
+            *p++ = '?';
+        }
+        else if (isdigit((unsigned char)*s) &&
+                 (p == buf ||
+                  !(isalnum((unsigned char)p[-1]) || p[-1] == '_'))) {
+            while (isalnum((unsigned char)*s) || *s == '.')
+                s++;
+            *p++ = '?';
+        }
+        else
+            *p++ = *s++;
+    }
+
+    *p = '\0';
+}
+
+
 static void print_query_result(mqi_column_desc_t *coldescs,
                                mqi_data_type_t   *coltypes,
                                int               *colsizes,
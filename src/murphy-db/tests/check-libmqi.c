@@ -870,6 +870,298 @@ START_TEST(nested_transactions)
 END_TEST
 
 
+START_TEST(table_quota_reject)
+{
+    static mqi_table_quota_t quota = { 4, 0, mqi_quota_reject };
+    static record_t *first[] = { &chuck, &gary, &elvis, &tom, NULL };
+    static record_t *last[]  = { &greta, NULL };
+
+    mqi_table_stats_t stats;
+    mqi_handle_t      tbl, trh;
+    int               n, sts;
+
+    PREREQUISITE(open_db);
+
+    tbl = MQI_CREATE_TABLE_WITH_QUOTA("quota_reject", MQI_TEMPORARY,
+                                      persons_coldefs, persons_indexdef,
+                                      &quota);
+
+    fail_if(tbl == MQI_HANDLE_INVALID, "failed to create table: errno (%s)",
+            strerror(errno));
+
+    /* a rejected insert must not leave any of its rows in the table */
+    n = MQI_INSERT_INTO(tbl, persons_insert_columns, artists);
+
+    fail_unless(n < 0 && errno == ENOSPC, "managed to exceed the row quota");
+    fail_unless(mqi_get_table_size(tbl) == 0, "%d rows left by rejected insert",
+                mqi_get_table_size(tbl));
+
+    n = MQI_INSERT_INTO(tbl, persons_insert_columns, first);
+
+    fail_if(n != 4, "failed to fill the table up to its quota");
+
+    /* replacing rows does not grow the table */
+    trh = mqi_begin_transaction();
+    n   = MQI_REPLACE(tbl, persons_insert_columns, first);
+    sts = mqi_commit_transaction(trh);
+
+    fail_if(n < 0 || sts < 0, "failed to replace rows in a full table: "
+            "errno (%s)", strerror(errno));
+
+    n = MQI_INSERT_INTO(tbl, persons_insert_columns, last);
+
+    fail_unless(n < 0 && errno == ENOSPC, "managed to exceed the row quota");
+
+    sts = mqi_get_table_stats(tbl, &stats);
+
+    fail_if(sts < 0, "failed to get table stats: errno (%s)", strerror(errno));
+
+    fail_if(stats.rows != 4 || mqi_get_table_size(tbl) != 4,
+            "quota mismatch: %u rows in table, limit %u", stats.rows, 4);
+    fail_if(stats.rows_max != 4, "high-water mark %u instead of %u",
+            stats.rows_max, 4);
+    fail_if(stats.rejected != MQI_DIMENSION(artists)-1 + 1,
+            "%u rejected rows instead of %d", stats.rejected,
+            MQI_DIMENSION(artists)-1 + 1);
+
+    mqi_drop_table(tbl);
+}
+END_TEST
+
+START_TEST(table_quota_evict)
+{
+    static mqi_table_quota_t quota = { 3, 0, mqi_quota_evict_oldest };
+
+    mqi_table_stats_t stats;
+    mqi_handle_t      tbl;
+    query_t           rows[32];
+    int               n;
+
+    PREREQUISITE(open_db);
+
+    tbl = MQI_CREATE_TABLE_WITH_QUOTA("quota_evict", MQI_TEMPORARY,
+                                      persons_coldefs, persons_indexdef,
+                                      &quota);
+
+    fail_if(tbl == MQI_HANDLE_INVALID, "failed to create table: errno (%s)",
+            strerror(errno));
+
+    n = MQI_INSERT_INTO(tbl, persons_insert_columns, artists);
+
+    fail_if(n != MQI_DIMENSION(artists)-1, "some insertion failed. "
+            "Attempted %d succeeded %d", MQI_DIMENSION(artists)-1, n);
+
+    n = MQI_SELECT(persons_select_columns, tbl, MQI_ALL, rows);
+
+    fail_if(n != 3, "%d rows in table instead of 3", n);
+
+    mqi_get_table_stats(tbl, &stats);
+
+    fail_if(stats.evicted != MQI_DIMENSION(artists)-1 - 3,
+            "%u evicted rows instead of %d", stats.evicted,
+            MQI_DIMENSION(artists)-1 - 3);
+    fail_if(stats.bytes_max < stats.bytes || !stats.bytes,
+            "bogus memory statistics (%u bytes, high-water mark %u)",
+            stats.bytes, stats.bytes_max);
+
+    mqi_drop_table(tbl);
+}
+END_TEST
+
+START_TEST(query_stats)
+{
+    static uint32_t idlimit = 1000;
+
+    MQI_WHERE_CLAUSE(where,
+        MQI_GREATER( MQI_COLUMN(3), MQI_UNSIGNED_VAR(idlimit) )
+    );
+
+    mqi_query_stats_t  stats[16], *qs;
+    mqi_handle_t       tbl;
+    query_t            rows[32];
+    int                i, n;
+
+    PREREQUISITE(open_db);
+
+    tbl = MQI_CREATE_TABLE("query_stats", MQI_TEMPORARY,
+                           persons_coldefs, persons_indexdef);
+
+    fail_if(tbl == MQI_HANDLE_INVALID, "failed to create table: errno (%s)",
+            strerror(errno));
+
+    n = MQI_INSERT_INTO(tbl, persons_insert_columns, artists);
+
+    fail_if(n != MQI_DIMENSION(artists)-1, "some insertion failed. "
+            "Attempted %d succeeded %d", MQI_DIMENSION(artists)-1, n);
+
+    mqi_reset_query_stats();
+
+    fail_if(mqi_query_stats_enabled(), "query statistics enabled by default");
+
+    MQI_SELECT(persons_select_columns, tbl, where, rows);
+
+    n = mqi_get_query_stats(stats, MQI_DIMENSION(stats));
+
+    fail_if(n != 0, "%d queries accounted with statistics disabled", n);
+
+    mqi_enable_query_stats(1);
+
+    for (i = 0;  i < 2;  i++) {
+        n = MQI_SELECT(persons_select_columns, tbl, where, rows);
+        fail_if(n != 2, "selected %d rows instead of 2", n);
+    }
+
+    mqi_query_begin("two selects");
+    MQI_SELECT(persons_select_columns, tbl, where, rows);
+    MQI_SELECT(persons_select_columns, tbl, MQI_ALL, rows);
+    mqi_query_end();
+
+    n = mqi_get_query_stats(stats, MQI_DIMENSION(stats));
+
+    fail_if(n != 2, "%d queries instead of 2", n);
+
+    for (i = 0, qs = NULL;  i < n;  i++) {
+        if (!strcmp(stats[i].query, "select from query_stats where ?"))
+            qs = stats + i;
+    }
+
+    fail_if(!qs, "no statistics for the filtered select");
+    fail_if(qs->calls != 2, "%u calls instead of 2", qs->calls);
+    fail_if(qs->scanned != 12 || qs->returned != 4,
+            "%llu rows scanned, %llu returned instead of 12 and 4",
+            (unsigned long long)qs->scanned,
+            (unsigned long long)qs->returned);
+
+    qs = stats + (qs == stats ? 1 : 0);
+
+    fail_if(strcmp(qs->query, "two selects") || qs->calls != 1,
+            "nested queries not accounted to the outermost one");
+    fail_if(qs->scanned != 12 || qs->returned != 8,
+            "%llu rows scanned, %llu returned instead of 12 and 8",
+            (unsigned long long)qs->scanned,
+            (unsigned long long)qs->returned);
+
+    mqi_enable_query_stats(0);
+    mqi_reset_query_stats();
+    mqi_drop_table(tbl);
+}
+END_TEST
+
+START_TEST(snapshot_isolation)
+{
+    static uint32_t  idlimit = 1000;
+    static char     *newname = "Mapother";
+    static record_t  ava = {"female", "Ava", "Gardner", 3000, "aga@heaven.org"};
+    static record_t *newbies[] = { &ava, NULL };
+
+    MQI_WHERE_CLAUSE(where,
+        MQI_GREATER( MQI_COLUMN(3), MQI_UNSIGNED_VAR(idlimit) )
+    );
+
+    MQI_COLUMN_SELECTION_LIST(update_columns,
+        MQI_COLUMN_SELECTOR( 1, record_t, family_name )
+    );
+
+    record_t      update = { .family_name = newname };
+    mqi_handle_t  tbl, before, after, empty, tx;
+    query_t       rows[32];
+    int           i, n;
+
+    PREREQUISITE(open_db);
+
+    tbl = MQI_CREATE_TABLE("snapshot", MQI_TEMPORARY,
+                           persons_coldefs, persons_indexdef);
+
+    fail_if(tbl == MQI_HANDLE_INVALID, "failed to create table: errno (%s)",
+            strerror(errno));
+
+    n = MQI_INSERT_INTO(tbl, persons_insert_columns, artists);
+
+    fail_if(n != MQI_DIMENSION(artists)-1, "some insertion failed. "
+            "Attempted %d succeeded %d", MQI_DIMENSION(artists)-1, n);
+
+    before = mqi_snapshot_create(&tbl, 1);
+
+    fail_if(before == MQI_HANDLE_INVALID, "failed to create snapshot: "
+            "errno (%s)", strerror(errno));
+
+    n = MQI_DELETE(tbl, where);
+
+    fail_if(n != 2, "deleted %d rows instead of 2", n);
+
+    after = mqi_snapshot_create(NULL, 0);
+
+    fail_if(after == MQI_HANDLE_INVALID, "failed to create snapshot: "
+            "errno (%s)", strerror(errno));
+
+    n = MQI_UPDATE(tbl, update_columns, &update, MQI_ALL);
+
+    fail_if(n != 4, "updated %d rows instead of 4", n);
+
+    n = MQI_INSERT_INTO(tbl, persons_insert_columns, newbies);
+
+    fail_if(n != 1, "inserted %d rows instead of 1", n);
+
+    n = MQI_SNAPSHOT_SELECT(before, persons_select_columns, tbl, MQI_ALL, rows);
+
+    fail_if(n != 6, "%d rows in first snapshot instead of 6", n);
+
+    for (i = 0;  i < n;  i++) {
+        fail_if(!strcmp(rows[i].family_name, newname),
+                "update visible through the first snapshot");
+    }
+
+    n = MQI_SNAPSHOT_SELECT(before, persons_select_columns, tbl, where, rows);
+
+    fail_if(n != 2, "%d filtered rows in first snapshot instead of 2", n);
+
+    n = MQI_SNAPSHOT_SELECT(after, persons_select_columns, tbl, MQI_ALL, rows);
+
+    fail_if(n != 4 || mqi_snapshot_get_table_size(after, tbl) != 4,
+            "%d rows in second snapshot instead of 4", n);
+
+    for (i = 0;  i < n;  i++) {
+        fail_if(!strcmp(rows[i].family_name, newname),
+                "update visible through the second snapshot");
+    }
+
+    tx = mqi_begin_transaction();
+
+    n = MQI_DELETE(tbl, MQI_ALL);
+
+    fail_if(n != 5, "deleted %d rows instead of 5", n);
+
+    empty = mqi_snapshot_create(&tbl, 1);
+
+    mqi_rollback_transaction(tx);
+
+    n = MQI_SELECT(persons_select_columns, tbl, MQI_ALL, rows);
+
+    fail_if(n != 5, "%d rows in table after rollback instead of 5", n);
+
+    for (i = 0;  i < n;  i++) {
+        fail_if(rows[i].id != 3000 && strcmp(rows[i].family_name, newname),
+                "update lost in table");
+    }
+
+    n = MQI_SNAPSHOT_SELECT(empty, persons_select_columns, tbl, MQI_ALL, rows);
+
+    fail_if(n != 0, "rollback visible through the third snapshot");
+
+    fail_if(mqi_snapshot_release(before) < 0 ||
+            mqi_snapshot_release(after) < 0 ||
+            mqi_snapshot_release(empty) < 0,
+            "failed to release snapshots: errno (%s)", strerror(errno));
+
+    n = MQI_SNAPSHOT_SELECT(before, persons_select_columns, tbl, MQI_ALL, rows);
+
+    fail_unless(n < 0 && errno == ENOENT, "select from released snapshot");
+
+    mqi_drop_table(tbl);
+}
+END_TEST
+
+
 
 static Suite *libmqi_suite(void)
 {
@@ -904,6 +1196,10 @@ static TCase *basic_tests(void)
     tcase_add_test(tc, column_trigger);
     tcase_add_test(tc, sequential_transactions);
     tcase_add_test(tc, nested_transactions);
+    tcase_add_test(tc, table_quota_reject);
+    tcase_add_test(tc, table_quota_evict);
+    tcase_add_test(tc, query_stats);
+    tcase_add_test(tc, snapshot_isolation);
 
     return tc;
 }
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 #include <libgen.h>
 
 #include <check.h>
@@ -868,6 +869,242 @@ START_TEST(transaction_trigger)
 }
 END_TEST
 
+START_TEST(quota_keywords_as_names)
+{
+    static char *create = "CREATE TEMPORARY TABLE quota ("
+                          "   bytes  INTEGER,"
+                          "   evict  VARCHAR(16)"
+                          ") QUOTA 2 ROWS REJECT";
+    static char *insert = "INSERT INTO quota (bytes, evict)"
+                          " VALUES (%d, 'reject-%d')";
+    static char *select = "SELECT bytes, evict FROM quota"
+                          " WHERE evict = 'reject-2'";
+
+    mql_result_t *r;
+    char          mqlstr[128];
+    int           i;
+
+    PREREQUISITE(open_db);
+
+    r = mql_exec_string(mql_result_dontcare, create);
+
+    fail_unless(mql_result_is_success(r),"failed to exec '%s': (%d) %s",create,
+                mql_result_error_get_code(r), mql_result_error_get_message(r));
+
+    mql_result_free(r);
+
+    for (i = 1;  i <= 3;  i++) {
+        snprintf(mqlstr, sizeof(mqlstr), insert, i, i);
+        r = mql_exec_string(mql_result_dontcare, mqlstr);
+
+        fail_unless(mql_result_is_success(r) == (i <= 2),
+                    "insert #%d %s the quota", i,
+                    i <= 2 ? "failed within" : "exceeded");
+
+        mql_result_free(r);
+    }
+
+    r = mql_exec_string(mql_result_rows, select);
+
+    fail_unless(mql_result_is_success(r),"failed to exec '%s': (%d) %s",select,
+                mql_result_error_get_code(r), mql_result_error_get_message(r));
+    fail_unless(mql_result_rows_get_row_count(r) == 1 &&
+                mql_result_rows_get_integer(r, 0, 0) == 2,
+                "unexpected row selected");
+
+    mql_result_free(r);
+}
+END_TEST
+
+START_TEST(exec_batch)
+{
+    static char *create = "CREATE TEMPORARY TABLE batch ("
+                          "   name  VARCHAR(16),"
+                          "   value INTEGER     "
+                          ")";
+    static char *script = "INSERT INTO batch VALUES ('one', 1);"
+                          "INSERT INTO batch VALUES ('two', 2);"
+                          "SELECT name, value FROM batch WHERE name = 'two'";
+
+    mql_result_t *r, *results[8];
+    int i, n;
+
+    PREREQUISITE(open_db);
+
+    r = mql_exec_string(mql_result_dontcare, create);
+
+    fail_unless(mql_result_is_success(r),"failed to exec '%s': (%d) %s",create,
+                mql_result_error_get_code(r), mql_result_error_get_message(r));
+
+    mql_result_free(r);
+
+    n = MQI_DIMENSION(results);
+    r = mql_exec_batch(mql_result_rows, script, results, &n);
+
+    fail_unless(mql_result_is_success(r), "failed to exec batch: (%d) %s",
+                mql_result_error_get_code(r), mql_result_error_get_message(r));
+    fail_unless(n == 3, "unexpected number of results %d (expected 3)", n);
+
+    for (i = 0;  i < n;  i++)
+        fail_unless(mql_result_is_success(results[i]), "statement #%d failed",
+                    i + 1);
+
+    fail_unless(mql_result_rows_get_row_count(results[2]) == 1,
+                "unexpected row count %d (expected 1)",
+                mql_result_rows_get_row_count(results[2]));
+    fail_unless(!strcmp(mql_result_rows_get_string(results[2], 0, 0, NULL, 0),
+                        "two"), "unexpected row selected");
+
+    for (i = 0;  i < n;  i++)
+        mql_result_free(results[i]);
+
+    mql_result_free(r);
+}
+END_TEST
+
+
+START_TEST(exec_batch_rollback)
+{
+    static char *script = "INSERT INTO batch VALUES ('three', 3);"
+                          "INSERT INTO batch VALUES ('four', 4);"
+                          "INSERT INTO nonexistent VALUES ('five', 5);"
+                          "INSERT INTO batch VALUES ('six', 6)";
+
+    mql_result_t *r, *results[8];
+    int n;
+
+    PREREQUISITE(exec_batch);
+
+    n = MQI_DIMENSION(results);
+    r = mql_exec_batch(mql_result_string, script, results, &n);
+
+    fail_if(mql_result_is_success(r), "failing batch succeeded");
+    fail_unless(strstr(mql_result_error_get_message(r), "#3") != NULL,
+                "error not reported for the failing statement: %s",
+                mql_result_error_get_message(r));
+    fail_unless(n == 0, "results returned for failed batch");
+
+    mql_result_free(r);
+
+    fail_unless(mqi_get_table_size(mqi_get_table_handle("batch")) == 2,
+                "batch was not rolled back");
+
+    /* make sure a failed batch does not affect subsequent statements */
+    r = mql_exec_string(mql_result_string, "INSERT INTO batch VALUES ('x',9)");
+
+    fail_unless(mql_result_is_success(r), "insert after batch failed: %s",
+                mql_result_error_get_message(r));
+
+    mql_result_free(r);
+}
+END_TEST
+
+
+START_TEST(exec_batch_schema_change)
+{
+    static char *scripts[] = {
+        "INSERT INTO batch VALUES ('seven', 7);"
+        "CREATE TEMPORARY TABLE batch2 (name VARCHAR(16))",
+        "INSERT INTO batch VALUES ('seven', 7);"
+        "DROP TABLE batch",
+        "INSERT INTO batch VALUES ('seven', 7);"
+        "CREATE INDEX ON batch (name)",
+        NULL
+    };
+
+    mql_result_t *r;
+    int i, size;
+
+    PREREQUISITE(exec_batch);
+
+    size = mqi_get_table_size(mqi_get_table_handle("batch"));
+
+    for (i = 0;  scripts[i];  i++) {
+        r = mql_exec_batch(mql_result_string, scripts[i], NULL, NULL);
+
+        fail_if(mql_result_is_success(r), "schema change allowed in batch");
+        fail_unless(mql_result_error_get_code(r) == EPERM &&
+                    strstr(mql_result_error_get_message(r), "#2") != NULL,
+                    "unexpected error for schema change in batch: %s",
+                    mql_result_error_get_message(r));
+
+        mql_result_free(r);
+    }
+
+    fail_unless(mqi_get_table_handle("batch2") == MQI_HANDLE_INVALID,
+                "table created by a failed batch");
+    fail_unless(mqi_get_table_size(mqi_get_table_handle("batch")) == size,
+                "batch was not rolled back");
+}
+END_TEST
+
+
+START_TEST(exec_batch_vs_single)
+{
+#define NINSERT 10000
+    static char *create = "CREATE TEMPORARY TABLE %s ("
+                          "   name  VARCHAR(16),"
+                          "   value INTEGER     "
+                          ")";
+
+    mql_result_t *r;
+    struct timespec start, end;
+    double single, batched;
+    char stmnt[128], *script, *p;
+    int i, n;
+
+    PREREQUISITE(open_db);
+
+    snprintf(stmnt, sizeof(stmnt), create, "single");
+    mql_result_free(mql_exec_string(mql_result_string, stmnt));
+    snprintf(stmnt, sizeof(stmnt), create, "batched");
+    mql_result_free(mql_exec_string(mql_result_string, stmnt));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0;  i < NINSERT;  i++) {
+        snprintf(stmnt, sizeof(stmnt),
+                 "INSERT INTO single VALUES ('name-%d', %d)", i, i);
+        r = mql_exec_string(mql_result_string, stmnt);
+
+        fail_unless(mql_result_is_success(r), "insert #%d failed", i);
+
+        mql_result_free(r);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    single = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    fail_unless((script = malloc(NINSERT * 64)) != NULL, "out of memory");
+
+    for (i = 0, p = script;  i < NINSERT;  i++) {
+        n = sprintf(p, "%sINSERT INTO batched VALUES ('name-%d', %d)",
+                    i ? ";" : "", i, i);
+        p += n;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    r = mql_exec_batch(mql_result_string, script, NULL, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    batched = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    fail_unless(mql_result_is_success(r), "batch failed: %s",
+                mql_result_error_get_message(r));
+    fail_unless(mqi_get_table_size(mqi_get_table_handle("batched")) == NINSERT,
+                "wrong number of rows inserted by batch");
+
+    mql_result_free(r);
+    free(script);
+
+    if (verbose)
+        printf("%d inserts: %.3f msecs one by one, %.3f msecs batched\n",
+               NINSERT, single * 1000.0, batched * 1000.0);
+#undef NINSERT
+}
+END_TEST
+
 static Suite *libmql_suite(void)
 {
     Suite *s = suite_create("Murphy Query Language - libmql");
@@ -907,6 +1144,11 @@ static TCase *basic_tests(void)
     tcase_add_test(tc, row_trigger);
     tcase_add_test(tc, column_trigger);
     tcase_add_test(tc, transaction_trigger);
+    tcase_add_test(tc, quota_keywords_as_names);
+    tcase_add_test(tc, exec_batch);
+    tcase_add_test(tc, exec_batch_rollback);
+    tcase_add_test(tc, exec_batch_schema_change);
+    tcase_add_test(tc, exec_batch_vs_single);
 
     return tc;
 }
@@ -28,10 +28,14 @@
  */
 
 #include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
 #include <alloca.h>
 
 #include <murphy/common/mm.h>
 #include <murphy/common/log.h>
+#include <murphy/common/debug.h>
 #include <murphy/common/mainloop.h>
 #include <murphy/common/transport.h>
 
@@ -40,6 +44,10 @@
 #include "table.h"
 #include "client.h"
 
+#define RECONNECT_MIN   500              /* initial reconnection delay */
+#define RECONNECT_MAX   5000             /* default max. reconnection delay */
+#define RECONNECT_SLACK 100              /* reconnection timer slack */
+
 
 /*
  * mark an enforcement point busy (typically while executing a callback)
@@ -115,13 +123,16 @@ mrp_domctl_t *mrp_domctl_create(const char *name, mrp_mainloop_t *ml,
         mrp_list_init(&dc->pending);
         dc->ml = ml;
 
-        dc->name    = mrp_strdup(name);
-        dc->tables  = mrp_allocz_array(typeof(*dc->tables) , ntable);
-        dc->watches = mrp_allocz_array(typeof(*dc->watches), nwatch);
+        dc->name     = mrp_strdup(name);
+        dc->tables   = mrp_allocz_array(typeof(*dc->tables) , ntable);
+        dc->watches  = mrp_allocz_array(typeof(*dc->watches), nwatch);
+        dc->versions = mrp_allocz_array(typeof(*dc->versions), ntable);
+        dc->synced   = mrp_allocz_array(typeof(*dc->synced), ntable);
 
         if (dc->name != NULL &&
             (dc->tables  != NULL || ntable == 0) &&
-            (dc->watches != NULL || nwatch == 0)) {
+            (dc->watches != NULL || nwatch == 0) &&
+            ((dc->versions != NULL && dc->synced != NULL) || ntable == 0)) {
             for (i = 0; i < ntable; i++) {
                 st = tables + i;
                 dt = dc->tables + i;
@@ -155,6 +166,8 @@ mrp_domctl_t *mrp_domctl_create(const char *name, mrp_mainloop_t *ml,
             dc->watch_cb   = watch_cb;
             dc->user_data  = user_data;
             dc->seqno      = 1;
+            dc->cseed      = (unsigned int)getpid() ^ (unsigned int)time(NULL);
+            dc->cseed     ^= (unsigned int)(ptrdiff_t)dc;
 
             mrp_list_init(&dc->methods);
 
@@ -188,6 +201,8 @@ static void destroy_domctl(mrp_domctl_t *dc)
     }
     mrp_free(dc->watches);
 
+    mrp_free(dc->versions);
+    mrp_free(dc->synced);
     mrp_free(dc->name);
     mrp_free(dc);
 }
@@ -226,6 +241,8 @@ static void notify_disconnect(mrp_domctl_t *dc, uint32_t errcode,
 
 static void notify_connect(mrp_domctl_t *dc)
 {
+    dc->cdelay = 0;
+
     DOMCTL_MARK_BUSY(dc, {
             dc->connected = TRUE;
             dc->connect_cb(dc, TRUE, 0, NULL, dc->user_data);
@@ -247,6 +264,7 @@ static int domctl_register(mrp_domctl_t *dc)
     reg.ntable  = dc->ntable;
     reg.watches = dc->watches;
     reg.nwatch  = dc->nwatch;
+    reg.session = dc->session;
 
     msg = msg_encode_message((msg_t *)&reg);
 
@@ -261,6 +279,29 @@ static int domctl_register(mrp_domctl_t *dc)
 }
 
 
+static int domctl_unregister(mrp_domctl_t *dc)
+{
+    unregister_msg_t  ureg;
+    mrp_msg_t        *msg;
+    int               success;
+
+    mrp_clear(&ureg);
+    ureg.type = MSG_TYPE_UNREGISTER;
+    ureg.seq  = dc->seqno++;
+
+    msg = msg_encode_message((msg_t *)&ureg);
+
+    if (msg != NULL) {
+        success = mrp_transport_send(dc->t, msg);
+        mrp_msg_unref(msg);
+    }
+    else
+        success = FALSE;
+
+    return success;
+}
+
+
 static int try_connect(mrp_domctl_t *dc)
 {
     static mrp_transport_evt_t evt;
@@ -269,6 +310,11 @@ static int try_connect(mrp_domctl_t *dc)
     evt.recvmsg     = recv_cb;
     evt.recvmsgfrom = recvfrom_cb;
 
+    if (dc->t != NULL) {
+        mrp_transport_destroy(dc->t);
+        dc->t = NULL;
+    }
+
     dc->t = mrp_transport_create(dc->ml, dc->ttype, &evt, dc, 0);
 
     if (dc->t != NULL) {
@@ -291,24 +337,43 @@ static void stop_reconnect(mrp_domctl_t *dc)
 }
 
 
+static int start_reconnect(mrp_domctl_t *dc);
+
 static void reconnect_cb(mrp_timer_t *t, void *user_data)
 {
     mrp_domctl_t *dc = (mrp_domctl_t *)user_data;
 
     MRP_UNUSED(t);
 
-    if (try_connect(dc))
-        stop_reconnect(dc);
+    stop_reconnect(dc);
+
+    if (!try_connect(dc))
+        start_reconnect(dc);
 }
 
 
 static int start_reconnect(mrp_domctl_t *dc)
 {
-    int interval;
+    int max, delay;
 
     if (dc->ctmr == NULL && dc->cival >= 0) {
-        interval = dc->cival ? 1000 * dc->cival : 5000;
-        dc->ctmr = mrp_add_timer(dc->ml, interval, reconnect_cb, dc);
+        max = dc->cival ? 1000 * dc->cival : RECONNECT_MAX;
+
+        if (dc->cdelay < RECONNECT_MIN)
+            dc->cdelay = RECONNECT_MIN;
+        if (dc->cdelay > max)
+            dc->cdelay = max;
+
+        /*
+         * Back off exponentially, jittering within [delay / 2, delay], to
+         * keep enforcement points from hammering a restarted server in sync.
+         */
+        delay  = dc->cdelay / 2;
+        delay += rand_r(&dc->cseed) % (delay + 1);
+
+        dc->cdelay *= 2;
+        dc->ctmr    = mrp_add_timer_full(dc->ml, delay, RECONNECT_SLACK,
+                                         reconnect_cb, dc);
 
         if (dc->ctmr == NULL)
             return FALSE;
@@ -348,8 +413,13 @@ int mrp_domctl_connect(mrp_domctl_t *dc, const char *address, int interval)
 
 void mrp_domctl_disconnect(mrp_domctl_t *dc)
 {
+    stop_reconnect(dc);
+
     if (dc->t != NULL) {
-        stop_reconnect(dc);
+        /* let the server drop our tables instead of keeping them for us */
+        if (dc->connected)
+            domctl_unregister(dc);
+
         mrp_transport_destroy(dc->t);
         dc->t         = NULL;
         dc->connected = FALSE;
@@ -363,21 +433,30 @@ int mrp_domctl_set_data(mrp_domctl_t *dc, mrp_domctl_data_t *tables, int ntable,
     set_msg_t  set;
     mrp_msg_t *msg;
     uint32_t   seq = dc->seqno++;
+    uint32_t  *versions;
     int        success, i;
 
     if (!dc->connected)
         return FALSE;
 
+    versions = alloca(ntable * sizeof(versions[0]));
+
     for (i = 0; i < ntable; i++) {
         if (tables[i].id < 0 || tables[i].id >= dc->ntable)
             return FALSE;
+
+        versions[i] = dc->versions[tables[i].id] + 1;
+
+        if (versions[i] == 0)
+            versions[i] = 1;
     }
 
     mrp_clear(&set);
-    set.type   = MSG_TYPE_SET;
-    set.seq    = seq;
-    set.tables = tables;
-    set.ntable = ntable;
+    set.type     = MSG_TYPE_SET;
+    set.seq      = seq;
+    set.tables   = tables;
+    set.ntable   = ntable;
+    set.versions = versions;
 
     msg = msg_encode_message((msg_t *)&set);
 
@@ -385,8 +464,12 @@ int mrp_domctl_set_data(mrp_domctl_t *dc, mrp_domctl_data_t *tables, int ntable,
         success = mrp_transport_send(dc->t, msg);
         mrp_msg_unref(msg);
 
-        if (success)
+        if (success) {
+            for (i = 0; i < ntable; i++)
+                dc->versions[tables[i].id] = versions[i];
+
             queue_pending(dc, seq, cb, user_data);
+        }
 
         return success;
     }
@@ -395,6 +478,15 @@ int mrp_domctl_set_data(mrp_domctl_t *dc, mrp_domctl_data_t *tables, int ntable,
 }
 
 
+int mrp_domctl_is_synced(mrp_domctl_t *dc, int id)
+{
+    if (id < 0 || id >= dc->ntable)
+        return FALSE;
+
+    return dc->synced[id] == dc->versions[id];
+}
+
+
 int mrp_domctl_invoke(mrp_domctl_t *dc, const char *name, int narg,
                       mrp_domctl_arg_t *args, mrp_domctl_return_cb_t reply_cb,
                       void *user_data)
@@ -482,12 +574,30 @@ static method_t *find_method(mrp_domctl_t *dc, const char *name)
 }
 
 
+static void update_session(mrp_domctl_t *dc, ack_msg_t *ack)
+{
+    uint32_t i;
+
+    if (dc->session != 0 && dc->session == ack->session)
+        mrp_debug("resumed session 0x%x", dc->session);
+    else
+        mrp_debug("started new session 0x%x", ack->session);
+
+    dc->session = ack->session;
+
+    for (i = 0; i < (uint32_t)dc->ntable; i++)
+        dc->synced[i] = i < ack->nversion ? ack->versions[i] : 0;
+}
+
+
 static void process_ack(mrp_domctl_t *dc, ack_msg_t *ack)
 {
     if (ack->seq != 0)
         notify_pending(dc, (msg_t *)ack);
-    else
+    else {
+        update_session(dc, ack);
         notify_connect(dc);
+    }
 }
 
 
@@ -664,14 +774,13 @@ static void closed_cb(mrp_transport_t *t, int error, void *user_data)
     mrp_domctl_t *dc = (mrp_domctl_t *)user_data;
 
     MRP_UNUSED(t);
-    MRP_UNUSED(dc);
+
+    start_reconnect(dc);
 
     if (error)
         notify_disconnect(dc, error, strerror(error));
-    else {
+    else
         notify_disconnect(dc, ECONNRESET, "server has closed the connection");
-        start_reconnect(dc);
-    }
 }
 
 
@@ -150,17 +150,30 @@ void mrp_domctl_destroy(mrp_domctl_t *dc);
 /**
  * Connect and register the given controller to the server. If timeout
  * is non-negative, it will be used to automatically attempt re-connecting
- * to the server this often (in seconds) whenever the connection goes down.
+ * to the server at most this often (in seconds, 0 meaning the default of
+ * 5 seconds) whenever the connection goes down. Reconnection attempts back
+ * off exponentially with random jitter up to this interval.
  */
 int mrp_domctl_connect(mrp_domctl_t *dc, const char *address, int timeout);
 
 /** Close the connection to the server. */
 void mrp_domctl_disconnect(mrp_domctl_t *dc);
 
-/** Set the content of the given tables to the provided data. */
+/**
+ * Set the content of the given tables to the provided data. Any owned
+ * table not given is cleared, so all tables need to be set each time.
+ */
 int mrp_domctl_set_data(mrp_domctl_t *dc, mrp_domctl_data_t *tables, int ntable,
                         mrp_domctl_status_cb_t status_cb, void *user_data);
 
+/**
+ * Check whether the server holds the latest data set for the given table.
+ * Upon reconnection the server may still have the tables of a previous
+ * session (for instance after a transport blip). Calling this from the
+ * connection callback tells whether the tables need to be set again.
+ */
+int mrp_domctl_is_synced(mrp_domctl_t *dc, int table_id);
+
 /** Invoke a proxied method. */
 int mrp_domctl_invoke(mrp_domctl_t *dc, const char *method, int narg,
                       mrp_domctl_arg_t *args, mrp_domctl_return_cb_t return_cb,
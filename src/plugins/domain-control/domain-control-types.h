@@ -58,6 +58,8 @@ struct mrp_domctl_s {
     socklen_t                addrlen;    /* address length */
     mrp_timer_t             *ctmr;       /* connection timer */
     int                      cival;      /* connection attempt interval */
+    int                      cdelay;     /* next reconnection delay (msecs) */
+    unsigned int             cseed;      /* reconnection jitter seed */
     const char              *ttype;      /* transport type */
     mrp_transport_t         *t;          /* transport towards murphy */
     int                      connected;  /* transport is up */
@@ -73,6 +75,9 @@ struct mrp_domctl_s {
     uint32_t                 seqno;      /* request sequence number */
     mrp_list_hook_t          pending;    /* queue of outstanding requests */
     mrp_list_hook_t          methods;    /* registered proxied methods */
+    uint32_t                 session;    /* server-assigned session id */
+    uint32_t                *versions;   /* owned table versions */
+    uint32_t                *synced;     /* versions held by the server */
 };
 
 
@@ -92,6 +97,7 @@ struct pep_table_s {
     int                 idx_col;         /* column index of index column */
     mrp_list_hook_t     watches;         /* watches for this table */
     bool                changed;         /* whether has unsynced changes */
+    uint32_t            version;         /* client-assigned data version */
 };
 
 
@@ -143,6 +149,9 @@ struct pep_proxy_s {
     int                notify_ncolumn;   /* total columns in notification */
     int                notify_fail : 1;  /* notification failure */
     int                notify : 1;       /* whether has pending notifications */
+    int                settling : 1;     /* initial notification held back */
+    uint32_t           session;          /* session id, 0 if unregistered */
+    mrp_timer_t       *linger;           /* detached, kept for resumption */
 };
 
 
@@ -164,6 +173,9 @@ struct pdp_s {
     void            *reh;                /* resolver event handler */
     int              ractive;            /* resolver active */
     bool             rblocked;           /* resolver blocked update */
+    uint32_t         session;            /* last assigned session id */
+    mrp_timer_t     *settle;             /* registration settling timer */
+    uint64_t         settle_end;         /* max. end of settling period */
 };
 
 
@@ -28,6 +28,9 @@
  */
 
 #include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <alloca.h>
 
 #include <murphy/common/mm.h>
 #include <murphy/common/log.h>
@@ -42,6 +45,10 @@
 #include "notify.h"
 #include "domain-control.h"
 
+#define SETTLE_DELAY  50                 /* quiet period after registrations */
+#define SETTLE_MAX   500                 /* max. total settling period */
+#define BACKLOG      256                 /* pending connections on restart */
+
 static mrp_transport_t *create_transport(pdp_t *pdp, const char *address);
 static void destroy_transport(mrp_transport_t *t);
 
@@ -122,6 +129,7 @@ pdp_t *create_domain_control(mrp_context_t *ctx,
     if (pdp != NULL) {
         pdp->ctx     = ctx;
         pdp->address = extaddr;
+        pdp->session = ((uint32_t)getpid() << 16) ^ (uint32_t)time(NULL);
 
         if (init_proxies(pdp) && init_tables(pdp)) {
 
@@ -168,6 +176,8 @@ pdp_t *create_domain_control(mrp_context_t *ctx,
 void destroy_domain_control(pdp_t *pdp)
 {
     if (pdp != NULL) {
+        mrp_del_timer(pdp->settle);
+        mrp_del_deferred(pdp->notify);
         del_resolver_trigger(pdp);
         destroy_proxies(pdp);
         destroy_tables(pdp);
@@ -192,6 +202,10 @@ static void notify_cb(mrp_deferred_t *d, void *user_data)
 
 void schedule_notification(pdp_t *pdp)
 {
+    if (pdp->settle != NULL) {
+        mrp_debug("registrations settling, delaying client notification");
+        return;
+    }
 
     if (pdp->notify == NULL)
         pdp->notify = mrp_add_deferred(pdp->ctx->ml, notify_cb, pdp);
@@ -204,10 +218,67 @@ void schedule_notification(pdp_t *pdp)
 }
 
 
+static void settle_cb(mrp_timer_t *t, void *user_data)
+{
+    pdp_t           *pdp = (pdp_t *)user_data;
+    mrp_list_hook_t *p, *n;
+    pep_proxy_t     *proxy;
+
+    mrp_del_timer(t);
+    pdp->settle = NULL;
+
+    mrp_list_foreach(&pdp->proxies, p, n) {
+        proxy = mrp_list_entry(p, typeof(*proxy), hook);
+        proxy->settling = false;
+    }
+
+    schedule_notification(pdp);
+}
+
+
+static void settle_registration(pep_proxy_t *proxy)
+{
+    pdp_t           *pdp = proxy->pdp;
+    struct timespec  ts;
+    uint64_t         now;
+
+    /*
+     * Hold back the initial notification of freshly registered clients,
+     * and any other notification, until registrations have been quiet for
+     * a while. When the daemon is (re)started all enforcement points come
+     * in at once, creating and uploading their tables, and without this
+     * every arrival would trigger another round of notifications to all.
+     */
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+    proxy->settling = true;
+
+    if (pdp->settle == NULL) {
+        pdp->settle = mrp_add_timer(pdp->ctx->ml, SETTLE_DELAY,
+                                    settle_cb, pdp);
+
+        if (pdp->settle == NULL) {
+            proxy->settling = false;
+            schedule_notification(pdp);
+            return;
+        }
+
+        pdp->settle_end = now + SETTLE_MAX;
+    }
+    else if (now + SETTLE_DELAY < pdp->settle_end)
+        mrp_mod_timer(pdp->settle, SETTLE_DELAY);
+}
+
+
 static int msg_send_message(pep_proxy_t *proxy, msg_t *msg)
 {
     mrp_msg_t *tmsg;
 
+    if (proxy->t == NULL)
+        return FALSE;
+
     tmsg = msg_encode_message(msg);
 
     if (tmsg != NULL) {
@@ -233,6 +304,28 @@ static int msg_send_ack(pep_proxy_t *proxy, uint32_t seq)
 }
 
 
+static int msg_send_register_ack(pep_proxy_t *proxy, uint32_t seq)
+{
+    ack_msg_t  ack;
+    uint32_t  *versions;
+    int        i;
+
+    versions = alloca((proxy->ntable + 1) * sizeof(versions[0]));
+
+    for (i = 0; i < proxy->ntable; i++)
+        versions[i] = proxy->tables[i].version;
+
+    mrp_clear(&ack);
+    ack.type     = MSG_TYPE_ACK;
+    ack.seq      = seq;
+    ack.session  = proxy->session;
+    ack.versions = versions;
+    ack.nversion = proxy->ntable;
+
+    return proxy->ops->send_msg(proxy, (msg_t *)&ack);
+}
+
+
 static int msg_send_nak(pep_proxy_t *proxy, uint32_t seq,
                         int32_t error, const char *msg)
 {
@@ -249,24 +342,65 @@ static int msg_send_nak(pep_proxy_t *proxy, uint32_t seq,
 
 
 
+static uint32_t new_session(pdp_t *pdp)
+{
+    if (++pdp->session == 0)
+        ++pdp->session;
+
+    return pdp->session;
+}
+
+
 static void process_register(pep_proxy_t *proxy, register_msg_t *reg)
 {
-    int         error;
-    const char *errmsg;
+    pep_proxy_t *old;
+    int          error;
+    const char  *errmsg;
 
-    if (register_proxy(proxy, reg->name, reg->tables, reg->ntable,
-                       reg->watches, reg->nwatch, &error, &errmsg)) {
-        msg_send_ack(proxy, reg->seq);
-        schedule_notification(proxy->pdp);
+    /*
+     * If the client comes back within the lingering period of its previous
+     * session, take over the tables of that session so that the client does
+     * not need to upload data we are still holding. Otherwise the client has
+     * restarted (or changed its tables) and its old tables are stale.
+     */
+
+    old = find_detached_proxy(proxy->pdp, reg->name);
+
+    if (old != NULL) {
+        if (reg->session != 0 && reg->session == old->session &&
+            resume_proxy(proxy, old, reg->tables, reg->ntable,
+                         reg->watches, reg->nwatch))
+            goto registered;
+
+        mrp_log_info("Dropping previous session of client %s.", reg->name);
+        destroy_proxy(old);
     }
-    else
+
+    if (!register_proxy(proxy, reg->name, reg->tables, reg->ntable,
+                        reg->watches, reg->nwatch, &error, &errmsg)) {
         msg_send_nak(proxy, reg->seq, error, errmsg);
+        return;
+    }
+
+    proxy->session = new_session(proxy->pdp);
+
+ registered:
+    msg_send_register_ack(proxy, reg->seq);
+    settle_registration(proxy);
 }
 
 
 static void process_unregister(pep_proxy_t *proxy, unregister_msg_t *unreg)
 {
     msg_send_ack(proxy, unreg->seq);
+
+    /*
+     * The client is going away for good, so end its session. This makes
+     * us drop its tables as soon as the transport is closed instead of
+     * keeping them around for it to resume.
+     */
+
+    proxy->session = 0;
 }
 
 
@@ -275,7 +409,8 @@ static void process_set(pep_proxy_t *proxy, set_msg_t *set)
     int         error;
     const char *errmsg;
 
-    if (set_proxy_tables(proxy, set->tables, set->ntable, &error, &errmsg)) {
+    if (set_proxy_tables(proxy, set->tables, set->ntable, set->versions,
+                         &error, &errmsg)) {
         msg_send_ack(proxy, set->seq);
     }
     else
@@ -521,8 +656,12 @@ static void msg_closed_cb(mrp_transport_t *t, int error, void *user_data)
     else
         mrp_log_info("Transport to client %s closed.", name);
 
-    mrp_log_info("Destroying client %s.", name);
-    destroy_proxy(proxy);
+    if (detach_proxy(proxy))
+        mrp_log_info("Keeping tables of client %s for resumption.", name);
+    else {
+        mrp_log_info("Destroying client %s.", name);
+        destroy_proxy(proxy);
+    }
 }
 
 
@@ -762,7 +901,8 @@ static mrp_transport_t *create_transport(pdp_t *pdp, const char *address)
     t = mrp_transport_create(pdp->ctx->ml, type, e, pdp, flags);
 
     if (t != NULL) {
-        if (mrp_transport_bind(t, &addr, alen) && mrp_transport_listen(t, 4))
+        if (mrp_transport_bind(t, &addr, alen) &&
+            mrp_transport_listen(t, BACKLOG))
             return t;
         else {
             mrp_log_error("Failed to bind to transport address '%s'.", address);
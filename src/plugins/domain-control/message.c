@@ -92,6 +92,9 @@ mrp_msg_t *msg_encode_register(register_msg_t *reg)
         mrp_msg_append(msg, MSG_UINT16(MAXROWS, w->max_rows));
     }
 
+    if (reg->session != 0)
+        mrp_msg_append(msg, MSG_UINT32(SESSION, reg->session));
+
     return msg;
 }
 
@@ -104,7 +107,7 @@ msg_t *msg_decode_register(mrp_msg_t *msg)
     mrp_domctl_watch_t *w;
     char               *name, *table, *columns, *index, *where;
     uint16_t            ntable, nwatch, max_rows;
-    uint32_t            seqno;
+    uint32_t            seqno, session;
     int                 i;
 
     it = NULL;
@@ -165,6 +168,9 @@ msg_t *msg_decode_register(mrp_msg_t *msg)
 
     reg->nwatch = nwatch;
 
+    if (mrp_msg_iterate_get(msg, &it, MSG_UINT32(SESSION, &session), MSG_END))
+        reg->session = session;
+
     reg->wire       = mrp_msg_ref(msg);
     reg->unref_wire = msg_unref_wire;
 
@@ -236,9 +242,26 @@ void msg_free_ack(msg_t *msg)
 
 mrp_msg_t *msg_encode_ack(ack_msg_t *ack)
 {
-    return mrp_msg_create(MSG_UINT16(MSGTYPE, MSG_TYPE_ACK),
-                          MSG_UINT32(MSGSEQ , ack->seq),
-                          MSG_END);
+    mrp_msg_t *msg;
+    uint16_t   type;
+
+    msg = mrp_msg_create(MSG_UINT16(MSGTYPE, MSG_TYPE_ACK),
+                         MSG_UINT32(MSGSEQ , ack->seq),
+                         MSG_END);
+
+    if (msg == NULL || ack->session == 0)
+        return msg;
+
+    type = MRP_MSG_FIELD_ARRAY_OF(UINT32);
+
+    if (!mrp_msg_append(msg, MSG_UINT32(SESSION, ack->session)) ||
+        !mrp_msg_append(msg, MSG_ARRAY(VERSIONS, type,
+                                       ack->nversion, ack->versions))) {
+        mrp_msg_unref(msg);
+        return NULL;
+    }
+
+    return msg;
 }
 
 
@@ -246,7 +269,8 @@ msg_t *msg_decode_ack(mrp_msg_t *msg)
 {
     ack_msg_t *ack;
     void      *it;
-    uint32_t   seqno;
+    uint32_t   seqno, session, nversion, *versions;
+    uint16_t   type;
 
     ack = mrp_allocz(sizeof(*ack));
 
@@ -259,6 +283,20 @@ msg_t *msg_decode_ack(mrp_msg_t *msg)
             ack->type = MSG_TYPE_ACK;
             ack->seq  = seqno;
 
+            type = MRP_MSG_FIELD_ARRAY_OF(UINT32);
+
+            if (mrp_msg_iterate_get(msg, &it,
+                                    MSG_UINT32(SESSION, &session),
+                                    MSG_ARRAY(VERSIONS, type,
+                                              &nversion, &versions),
+                                    MSG_END)) {
+                ack->session    = session;
+                ack->versions   = versions;
+                ack->nversion   = nversion;
+                ack->wire       = mrp_msg_ref(msg);
+                ack->unref_wire = msg_unref_wire;
+            }
+
             return (msg_t *)ack;
         }
 
@@ -344,6 +382,7 @@ void msg_free_set(msg_t *msg)
         }
 
         mrp_free(set->tables);
+        unref_wire(msg);
         mrp_free(set);
     }
 }
@@ -407,6 +446,13 @@ mrp_msg_t *msg_encode_set(set_msg_t *set)
 
     mrp_msg_set(msg, MSG_UINT16(NTOTAL, utotal));
 
+    if (set->versions != NULL) {
+        if (!mrp_msg_append(msg, MSG_ARRAY(VERSIONS,
+                                           MRP_MSG_FIELD_ARRAY_OF(UINT32),
+                                           set->ntable, set->versions)))
+            goto fail;
+    }
+
     return msg;
 
  fail:
@@ -422,7 +468,7 @@ msg_t *msg_decode_set(mrp_msg_t *msg)
     mrp_domctl_data_t  *d;
     mrp_domctl_value_t *values, *v;
     uint64_t            columns_so_far;
-    uint32_t            seqno;
+    uint32_t            seqno, nversion, *versions;
     uint16_t            ntable, ntotal, nrow, ncol, tblid, type;
     int                 t, r, c;
     mrp_msg_value_t     value;
@@ -518,6 +564,16 @@ msg_t *msg_decode_set(mrp_msg_t *msg)
         d++;
     }
 
+    if (mrp_msg_iterate_get(msg, &it,
+                            MSG_ARRAY(VERSIONS, MRP_MSG_FIELD_ARRAY_OF(UINT32),
+                                      &nversion, &versions),
+                            MSG_END)) {
+        if (nversion != ntable)
+            goto fail;
+
+        set->versions = versions;
+    }
+
     set->ntable = ntable;
 
     set->wire       = mrp_msg_ref(msg);
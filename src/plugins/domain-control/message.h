@@ -82,6 +82,10 @@ typedef enum {
     MSGTAG_ARG     = 0x6,            /* argument */
     MSGTAG_ERROR   = 0x7,            /* invocation error */
     MSGTAG_RETVAL  = 0x8,            /* invocation return value */
+
+    /* optional trailing tags in registration, ACK and set messages */
+    MSGTAG_SESSION  = 0xc,           /* session id */
+    MSGTAG_VERSIONS = 0xd,           /* table versions */
 } msgtag_t;
 
 
@@ -117,6 +121,7 @@ typedef struct {
     int                 ntable;          /* number of tables */
     mrp_domctl_watch_t *watches;         /* watched tables */
     int                 nwatch;          /* number of watches */
+    uint32_t            session;         /* session to resume, or 0 */
 } register_msg_t;
 
 
@@ -129,6 +134,7 @@ typedef struct {
     COMMON_MSG_FIELDS;
     mrp_domctl_data_t  *tables;          /* data for tables to set */
     int                 ntable;          /* number of tables */
+    uint32_t           *versions;        /* table versions, or NULL */
 } set_msg_t;
 
 
@@ -141,6 +147,9 @@ typedef struct {
 
 typedef struct {
     COMMON_MSG_FIELDS;
+    uint32_t  session;                   /* session id (registration ACK) */
+    uint32_t *versions;                  /* table versions, or NULL */
+    uint32_t  nversion;                  /* number of table versions */
 } ack_msg_t;
 
 
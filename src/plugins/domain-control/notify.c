@@ -144,6 +144,9 @@ void notify_table_changes(pdp_t *pdp)
         mrp_debug("proxy %s needs %supdate", proxy->name,
                   proxy->notify ? "" : "no ");
 
+        if (proxy->settling || proxy->linger != NULL)
+            continue;
+
         if (proxy->notify) {
             mrp_list_foreach(&proxy->watches, wp, wn) {
                 w = mrp_list_entry(wp, typeof(*w), pep_hook);
@@ -37,6 +37,9 @@
 #include "table.h"
 #include "proxy.h"
 
+#define PROXY_LINGER 15000               /* msecs to keep detached proxies */
+#define PROXY_SLACK  1000                /* linger timer slack */
+
 
 /*
  * a pending proxied invocation
@@ -62,9 +65,22 @@ int init_proxies(pdp_t *pdp)
 
 void destroy_proxies(pdp_t *pdp)
 {
-    MRP_UNUSED(pdp);
+    mrp_list_hook_t *p, *n;
+    pep_proxy_t     *proxy;
 
-    return;
+    /* disconnect all clients, also dropping the ones kept for resumption */
+
+    mrp_list_foreach(&pdp->proxies, p, n) {
+        proxy = mrp_list_entry(p, typeof(*proxy), hook);
+
+        if (proxy->t != NULL) {
+            mrp_transport_disconnect(proxy->t);
+            mrp_transport_destroy(proxy->t);
+            proxy->t = NULL;
+        }
+
+        destroy_proxy(proxy);
+    }
 }
 
 
@@ -95,6 +111,7 @@ void destroy_proxy(pep_proxy_t *proxy)
 
     if (proxy != NULL) {
         mrp_list_delete(&proxy->hook);
+        mrp_del_timer(proxy->linger);
 
         for (i = 0; i < proxy->ntable; i++)
             destroy_proxy_table(proxy->tables + i);
@@ -103,18 +120,125 @@ void destroy_proxy(pep_proxy_t *proxy)
 
         purge_pending(proxy);
 
+        mrp_free(proxy->tables);
+        mrp_free(proxy->name);
         mrp_free(proxy);
     }
 }
 
 
+static void linger_cb(mrp_timer_t *t, void *user_data)
+{
+    pep_proxy_t *proxy = (pep_proxy_t *)user_data;
+
+    MRP_UNUSED(t);
+
+    mrp_log_info("Client %s did not come back, destroying it.", proxy->name);
+    destroy_proxy(proxy);
+}
+
+
+int detach_proxy(pep_proxy_t *proxy)
+{
+    mrp_mainloop_t *ml = proxy->pdp->ctx->ml;
+
+    if (proxy->session == 0 || proxy->name == NULL)
+        return FALSE;
+
+    proxy->linger = mrp_add_timer_full(ml, PROXY_LINGER, PROXY_SLACK,
+                                       linger_cb, proxy);
+
+    if (proxy->linger == NULL)
+        return FALSE;
+
+    proxy->t = NULL;
+    purge_pending(proxy);
+
+    return TRUE;
+}
+
+
+pep_proxy_t *find_detached_proxy(pdp_t *pdp, const char *name)
+{
+    mrp_list_hook_t *p, *n;
+    pep_proxy_t     *proxy;
+
+    mrp_list_foreach(&pdp->proxies, p, n) {
+        proxy = mrp_list_entry(p, typeof(*proxy), hook);
+
+        if (proxy->linger != NULL && !strcmp(proxy->name, name))
+            return proxy;
+    }
+
+    return NULL;
+}
+
+
+static void create_watches(pep_proxy_t *proxy,
+                           mrp_domctl_watch_t *watches, int nwatch)
+{
+    mrp_domctl_watch_t *w;
+    int                 error, i;
+    const char         *errmsg;
+
+    for (i = 0, w = watches; i < nwatch; i++, w++) {
+        if (create_proxy_watch(proxy, i, w->table, w->mql_columns,
+                               w->mql_where, w->max_rows, &error, &errmsg))
+            mrp_log_info("Client %s subscribed for table %s.", proxy->name,
+                         w->table);
+        else
+            mrp_log_error("Client %s failed to subscribe for table %s.",
+                          proxy->name, w->table);
+    }
+}
+
+
+int resume_proxy(pep_proxy_t *proxy, pep_proxy_t *old,
+                 mrp_domctl_table_t *tables, int ntable,
+                 mrp_domctl_watch_t *watches, int nwatch)
+{
+    pep_table_t *t;
+    int          i;
+
+    if (old->ntable != ntable)
+        return FALSE;
+
+    for (i = 0, t = old->tables; i < ntable; i++, t++) {
+        if (strcmp(t->name, tables[i].table) ||
+            strcmp(t->mql_columns, tables[i].mql_columns) ||
+            strcmp(t->mql_index, tables[i].mql_index))
+            return FALSE;
+    }
+
+    proxy->name = mrp_strdup(old->name);
+
+    if (proxy->name == NULL)
+        return FALSE;
+
+    proxy->tables  = old->tables;
+    proxy->ntable  = old->ntable;
+    proxy->session = old->session;
+    proxy->notify  = true;
+    old->tables    = NULL;
+    old->ntable    = 0;
+
+    destroy_proxy(old);
+
+    mrp_log_info("Client %s resumed session 0x%x.", proxy->name,
+                 proxy->session);
+
+    create_watches(proxy, watches, nwatch);
+
+    return TRUE;
+}
+
+
 int register_proxy(pep_proxy_t *proxy, char *name,
                    mrp_domctl_table_t *tables, int ntable,
                    mrp_domctl_watch_t *watches, int nwatch,
                    int *error, const char **errmsg)
 {
     pep_table_t        *t;
-    mrp_domctl_watch_t *w;
     int                 i;
 
     proxy->name   = mrp_strdup(name);
@@ -154,15 +278,7 @@ int register_proxy(pep_proxy_t *proxy, char *name,
         }
     }
 
-    for (i = 0, w = watches; i < nwatch; i++, w++) {
-        if (create_proxy_watch(proxy, i, w->table, w->mql_columns,
-                               w->mql_where, w->max_rows, error, errmsg))
-            mrp_log_info("Client %s subscribed for table %s.", proxy->name,
-                         w->table);
-        else
-            mrp_log_error("Client %s failed to subscribe for table %s.",
-                          proxy->name, w->table);
-    }
+    create_watches(proxy, watches, nwatch);
 
     return TRUE;
 }
@@ -184,7 +300,8 @@ pep_proxy_t *find_proxy(pdp_t *pdp, const char *name)
     mrp_list_foreach(&pdp->proxies, p, n) {
         proxy = mrp_list_entry(p, typeof(*proxy), hook);
 
-        if (!strcmp(proxy->name, name))
+        if (proxy->linger == NULL && proxy->name != NULL &&
+            !strcmp(proxy->name, name))
             return proxy;
     }
 
@@ -46,6 +46,12 @@ int register_proxy(pep_proxy_t *proxy, char *name,
                    int *error, const char **errmsg);
 int unregister_proxy(pep_proxy_t *proxy);
 
+int detach_proxy(pep_proxy_t *proxy);
+pep_proxy_t *find_detached_proxy(pdp_t *pdp, const char *name);
+int resume_proxy(pep_proxy_t *proxy, pep_proxy_t *old,
+                 mrp_domctl_table_t *tables, int ntable,
+                 mrp_domctl_watch_t *watches, int nwatch);
+
 pep_proxy_t *find_proxy(pdp_t *pdp, const char *name);
 
 uint32_t proxy_queue_pending(pep_proxy_t *proxy,
@@ -598,7 +598,7 @@ static int insert_into_table(pep_table_t *t,
 
 
 int set_proxy_tables(pep_proxy_t *proxy, mrp_domctl_data_t *tables, int ntable,
-                     int *error, const char **errmsg)
+                     uint32_t *versions, int *error, const char **errmsg)
 {
     mqi_handle_t    tx;
     pep_table_t    *t;
@@ -633,6 +633,19 @@ int set_proxy_tables(pep_proxy_t *proxy, mrp_domctl_data_t *tables, int ntable,
 
         mqi_commit_transaction(tx);
 
+        /*
+         * A set replaces the content of all tables of the client, so the
+         * ones it did not carry are now empty and no longer hold any data
+         * set by the client. Forget their versions, otherwise a resuming
+         * client would take them for being in sync.
+         */
+
+        for (i = 0; i < proxy->ntable; i++)
+            proxy->tables[i].version = 0;
+
+        for (i = 0; i < ntable; i++)
+            proxy->tables[tables[i].id].version = versions ? versions[i] : 0;
+
         return TRUE;
 
     fail:
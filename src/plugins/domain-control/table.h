@@ -53,7 +53,7 @@ void destroy_proxy_tables(pep_proxy_t *proxy);
 void destroy_proxy_watches(pep_proxy_t *proxy);
 
 int set_proxy_tables(pep_proxy_t *proxy, mrp_domctl_data_t *tables, int ntable,
-                     int *error, const char **errmsg);
+                     uint32_t *versions, int *error, const char **errmsg);
 
 int exec_mql(mql_result_type_t type, mql_result_t **resultp,
              const char *format, ...);
@@ -991,12 +991,15 @@ static void signal_handler(mrp_sighandler_t *h, int signum, void *user_data)
 static void connect_notify(mrp_domctl_t *dc, int connected, int errcode,
                            const char *errmsg, void *user_data)
 {
-    MRP_UNUSED(dc);
     MRP_UNUSED(user_data);
 
     if (connected) {
         info_msg("Successfully registered to server.");
-        export_data(client);
+
+        if (!mrp_domctl_is_synced(dc, 0) || !mrp_domctl_is_synced(dc, 1))
+            export_data(client);
+        else
+            info_msg("Server still has our latest data.");
     }
     else
         error_msg("No connection to server (%d: %s).", errcode, errmsg);
@@ -0,0 +1,467 @@
+/*
+ * Copyright (c) 2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Domain control restart test.
+ *
+ * Runs the domain control server and a herd of domain controllers within
+ * the same mainloop. Each controller owns two tables, uploads them once
+ * connected and watches the first table of the first controller. Once all
+ * controllers are up, the server is destroyed and recreated, the way a
+ * restarted murphyd comes back, and all controllers need to reconnect and
+ * upload their tables again. Their reconnection attempts should be spread
+ * out instead of coming in all at once, and each of them should get only
+ * a few notifications while the herd is coming back. Then a controller
+ * setting only one of its tables must have the other one cleared, and a
+ * controller going away must have its tables dropped at once instead of
+ * them being kept around for it to resume.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <murphy/common.h>
+#include <murphy/core.h>
+#include <murphy-db/mqi.h>
+
+#include <murphy/plugins/domain-control/domain-control.h>
+#include <murphy/domain-control/client.h>
+
+#define NCLIENT   200                    /* number of controllers */
+#define NTABLE    2                      /* tables per controller */
+#define MIN_SPREAD 100                   /* min. reconnection spread, msecs */
+#define MAX_NOTIFY 3                     /* max. notifications per restart */
+#define TIMEOUT   (20 * 1000)            /* test timeout */
+
+#define TABLE_COLUMNS "id integer, value integer"
+#define TABLE_INDEX   "id"
+
+typedef struct {
+    int                 id;
+    char                name[32];
+    char                tblnames[NTABLE][32];
+    mrp_domctl_table_t  tables[NTABLE];
+    mrp_domctl_watch_t  watch;
+    mrp_domctl_t       *dc;
+    bool                connected;
+    bool                uploaded;        /* whether ever uploaded */
+    uint64_t            connect_time;    /* when last (re)connected */
+    int                 nupload;         /* data uploads */
+    int                 nset;            /* data uploads acked */
+    int                 nnotify;         /* notifications received */
+} client_t;
+
+static mrp_context_t *ctx;
+static pdp_t         *pdp;
+static client_t       clients[NCLIENT];
+static char           address[64];
+
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+static void set_cb(mrp_domctl_t *dc, int errcode, const char *errmsg,
+                   void *user_data)
+{
+    client_t *c = (client_t *)user_data;
+
+    MRP_UNUSED(dc);
+
+    if (errcode != 0) {
+        mrp_log_error("Client %s failed to set data (%d: %s).", c->name,
+                      errcode, errmsg);
+        exit(1);
+    }
+
+    c->nset++;
+}
+
+
+static void upload(client_t *c, int ntable)
+{
+    mrp_domctl_data_t   data[NTABLE];
+    mrp_domctl_value_t  values[NTABLE][2];
+    mrp_domctl_value_t *rows[NTABLE];
+    int                 i;
+
+    for (i = 0; i < ntable; i++) {
+        values[i][0].type = MRP_DOMCTL_INTEGER;
+        values[i][0].s32  = c->id;
+        values[i][1].type = MRP_DOMCTL_INTEGER;
+        values[i][1].s32  = i;
+        rows[i]           = values[i];
+
+        data[i].id      = i;
+        data[i].coldefs = NULL;
+        data[i].ncolumn = 2;
+        data[i].rows    = rows + i;
+        data[i].nrow    = 1;
+    }
+
+    if (!mrp_domctl_set_data(c->dc, data, ntable, set_cb, c)) {
+        mrp_log_error("Client %s failed to send data.", c->name);
+        exit(1);
+    }
+
+    c->uploaded = true;
+    c->nupload++;
+}
+
+
+static void connect_cb(mrp_domctl_t *dc, int connected, int errcode,
+                       const char *errmsg, void *user_data)
+{
+    client_t *c = (client_t *)user_data;
+    int       i;
+
+    MRP_UNUSED(errcode);
+    MRP_UNUSED(errmsg);
+
+    c->connected = connected;
+
+    if (!connected)
+        return;
+
+    c->connect_time = now_ms();
+
+    /* empty tables are in sync, so check if we ever set them */
+    for (i = 0; i < NTABLE; i++) {
+        if (!c->uploaded || !mrp_domctl_is_synced(dc, i)) {
+            upload(c, NTABLE);
+            break;
+        }
+    }
+}
+
+
+static void watch_cb(mrp_domctl_t *dc, mrp_domctl_data_t *tables, int ntable,
+                     void *user_data)
+{
+    client_t *c = (client_t *)user_data;
+
+    MRP_UNUSED(dc);
+    MRP_UNUSED(tables);
+    MRP_UNUSED(ntable);
+
+    c->nnotify++;
+}
+
+
+static void start_server(void)
+{
+    pdp = create_domain_control(ctx, address, NULL, NULL, NULL);
+
+    if (pdp == NULL) {
+        mrp_log_error("Failed to create domain control on %s.", address);
+        exit(1);
+    }
+}
+
+
+static void start_clients(void)
+{
+    client_t *c;
+    int       i, j;
+
+    for (i = 0; i < NCLIENT; i++) {
+        c     = clients + i;
+        c->id = i;
+        snprintf(c->name, sizeof(c->name), "restart-test-%d", i);
+
+        for (j = 0; j < NTABLE; j++) {
+            snprintf(c->tblnames[j], sizeof(c->tblnames[j]),
+                     "restart_test_%d_%d", i, j);
+            c->tables[j].table       = c->tblnames[j];
+            c->tables[j].mql_columns = TABLE_COLUMNS;
+            c->tables[j].mql_index   = TABLE_INDEX;
+        }
+
+        c->watch.table       = clients[0].tblnames[0];
+        c->watch.mql_columns = "*";
+        c->watch.mql_where   = "";
+        c->watch.max_rows    = 0;
+
+        c->dc = mrp_domctl_create(c->name, ctx->ml, c->tables, NTABLE,
+                                  &c->watch, 1, connect_cb, watch_cb, c);
+
+        if (c->dc == NULL || !mrp_domctl_connect(c->dc, address, 0)) {
+            mrp_log_error("Failed to create client %s.", c->name);
+            exit(1);
+        }
+
+        /* connecting blocks, so let the server accept it */
+        mrp_mainloop_iterate(ctx->ml);
+    }
+}
+
+
+static void reset_counters(void)
+{
+    int i;
+
+    for (i = 0; i < NCLIENT; i++) {
+        clients[i].nupload = 0;
+        clients[i].nset    = 0;
+        clients[i].nnotify = 0;
+    }
+}
+
+
+static bool all_synced(void)
+{
+    int i;
+
+    for (i = 0; i < NCLIENT; i++)
+        if (!clients[i].connected || clients[i].nset < clients[i].nupload ||
+            clients[i].nupload == 0)
+            return false;
+
+    return true;
+}
+
+
+static void iterate_until_synced(void)
+{
+    while (!all_synced())
+        mrp_mainloop_iterate(ctx->ml);
+}
+
+
+static void timeout_cb(mrp_timer_t *t, void *user_data)
+{
+    int i, n;
+
+    MRP_UNUSED(t);
+    MRP_UNUSED(user_data);
+
+    for (i = n = 0; i < NCLIENT; i++)
+        n += clients[i].connected;
+
+    mrp_log_error("Timed out with %d of %d clients connected.", n, NCLIENT);
+    exit(1);
+}
+
+
+static void done_cb(mrp_timer_t *t, void *user_data)
+{
+    mrp_del_timer(t);
+    *(bool *)user_data = true;
+}
+
+
+static void iterate_for(int msecs)
+{
+    bool done = false;
+
+    if (mrp_add_timer(ctx->ml, msecs, done_cb, &done) == NULL) {
+        mrp_log_error("Failed to create timer.");
+        exit(1);
+    }
+
+    while (!done)
+        mrp_mainloop_iterate(ctx->ml);
+}
+
+
+static int table_size(const char *name)
+{
+    mqi_handle_t h = mqi_get_table_handle((char *)name);
+
+    return h == MQI_HANDLE_INVALID ? -1 : mqi_get_table_size(h);
+}
+
+
+static int check_tables(const char *phase)
+{
+    int i, j, n, failed;
+
+    failed = 0;
+
+    for (i = 0; i < NCLIENT; i++) {
+        for (j = 0; j < NTABLE; j++) {
+            n = table_size(clients[i].tblnames[j]);
+
+            if (n != 1) {
+                mrp_log_error("%s: table %s has %d rows.", phase,
+                              clients[i].tblnames[j], n);
+                failed++;
+            }
+        }
+    }
+
+    return failed ? 1 : 0;
+}
+
+
+static int check_herd(const char *phase, uint64_t start)
+{
+    uint64_t first, last;
+    int      maxnotify, failed, i;
+
+    first     = UINT64_MAX;
+    last      = 0;
+    maxnotify = 0;
+    failed    = 0;
+
+    for (i = 0; i < NCLIENT; i++) {
+        client_t *c = clients + i;
+
+        if (c->nupload != 1) {
+            mrp_log_error("%s: client %s uploaded %d times.", phase,
+                          c->name, c->nupload);
+            failed++;
+        }
+
+        if (c->connect_time < first)
+            first = c->connect_time;
+        if (c->connect_time > last)
+            last = c->connect_time;
+        if (c->nnotify > maxnotify)
+            maxnotify = c->nnotify;
+    }
+
+    if (maxnotify > MAX_NOTIFY) {
+        mrp_log_error("%s: up to %d notifications per client.", phase,
+                      maxnotify);
+        failed++;
+    }
+
+    mrp_log_info("%s: %d clients in %u msecs, spread over %u msecs, "
+                 "at most %d notifications per client", phase, NCLIENT,
+                 (unsigned int)(last - start), (unsigned int)(last - first),
+                 maxnotify);
+
+    return failed + check_tables(phase);
+}
+
+
+int main(int argc, char *argv[])
+{
+    uint64_t  start, first, last;
+    client_t *c;
+    int       failed, i, n;
+
+    MRP_UNUSED(argc);
+    MRP_UNUSED(argv);
+
+    mrp_log_set_mask(MRP_LOG_UPTO(MRP_LOG_WARNING));
+
+    snprintf(address, sizeof(address), "unxs:@murphy-restart-test.%u",
+             (unsigned int)getpid());
+
+    if ((ctx = mrp_context_create()) == NULL) {
+        mrp_log_error("Failed to create murphy context.");
+        exit(1);
+    }
+
+    mrp_add_timer(ctx->ml, TIMEOUT, timeout_cb, NULL);
+
+    /* bring up the server and the herd */
+    start_server();
+
+    start = now_ms();
+    start_clients();
+    iterate_until_synced();
+    iterate_for(100);
+
+    failed = check_herd("startup", start);
+
+    /* restart the server */
+    reset_counters();
+    destroy_domain_control(pdp);
+    start_server();
+
+    start = now_ms();
+    for (i = 0; i < NCLIENT; i++)
+        clients[i].connected = false;
+
+    iterate_until_synced();
+    iterate_for(100);
+
+    failed += check_herd("restart", start);
+
+    first = UINT64_MAX;
+    last  = 0;
+
+    for (i = 0; i < NCLIENT; i++) {
+        if (clients[i].connect_time < first)
+            first = clients[i].connect_time;
+        if (clients[i].connect_time > last)
+            last = clients[i].connect_time;
+    }
+
+    if (last - first < MIN_SPREAD) {
+        mrp_log_error("Reconnections spread over only %u msecs.",
+                      (unsigned int)(last - first));
+        failed++;
+    }
+
+    /* a set replaces all tables, clearing the ones not given */
+    c = clients;
+    upload(c, 1);
+    iterate_until_synced();
+
+    if ((n = table_size(c->tblnames[1])) != 0) {
+        mrp_log_error("Table %s not set has %d rows.", c->tblnames[1], n);
+        failed++;
+    }
+
+    /* a controller going away has its tables dropped right away */
+    c = clients + NCLIENT - 1;
+    mrp_domctl_destroy(c->dc);
+    c->dc = NULL;
+    iterate_for(100);
+
+    for (i = 0; i < NTABLE; i++) {
+        if (table_size(c->tblnames[i]) >= 0) {
+            mrp_log_error("Table %s of %s kept.", c->tblnames[i], c->name);
+            failed++;
+        }
+    }
+
+    for (i = 0; i < NCLIENT - 1; i++)
+        mrp_domctl_destroy(clients[i].dc);
+
+    destroy_domain_control(pdp);
+    mrp_context_destroy(ctx);
+
+    return failed ? 1 : 0;
+}
@@ -35,6 +35,8 @@
 
 #include <murphy/common/macros.h>
 #include <murphy/core/plugin.h>
+#include <murphy/core/lua-utils/budget.h>
+#include <murphy/core/lua-utils/profile.h>
 #include <murphy/core/lua-bindings/murphy.h>
 
 #define LUAR_INTERPRETER_NAME "lua"
@@ -50,7 +52,7 @@ static int load_config(lua_State *L, const char *path)
 {
     int success;
 
-    if (!luaL_loadfile(L, path) && !lua_pcall(L, 0, 0, 0))
+    if (!luaL_loadfile(L, path) && !mrp_lua_pcall(L, 0, 0, 0))
         success = TRUE;
     else {
         mrp_log_error("plugin-lua: failed to load config file %s.", path);
@@ -101,6 +103,7 @@ static int luaR_execute(mrp_scriptlet_t *script, mrp_context_tbl_t *ctbl)
     mrp_interpreter_t *i   = script->interpreter;
     lua_State         *L   = i->data;
     int                ref = (ptrdiff_t)script->data;
+    const char        *entry;
     int                top, success;
 
     MRP_UNUSED(ctbl);
@@ -111,8 +114,10 @@ static int luaR_execute(mrp_scriptlet_t *script, mrp_context_tbl_t *ctbl)
     lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
 
     if (lua_isfunction(L, -1)) {
-        if (!lua_pcall(L, 0, 0, 0))
+        entry = mrp_lua_profile_enter("resolver-target");
+        if (!mrp_lua_budget_pcall(L, 0, 0, NULL))
             success = TRUE;
+        mrp_lua_profile_leave(entry);
     }
     else {
         mrp_log_error("plugin-lua: failed to execute scriptlet.");
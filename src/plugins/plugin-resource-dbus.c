@@ -53,6 +53,7 @@
 
 #define MAX_PATH_LENGTH 64
 #define MAX_DBUS_SIG_LENGTH 8
+#define PREEMPT_MAX 64
 
 
 #define MANAGER_CREATE_RESOURCE_SET "createResourceSet"
@@ -63,6 +64,7 @@
 #define RSET_ADD_RESOURCE           "addResource"
 #define RSET_REQUEST                "request"
 #define RSET_RELEASE                "release"
+#define RSET_PROBE                  "probe"
 #define RSET_DELETE                 "delete"
 
 #define RESOURCE_SET_PROPERTY       "setProperty"
@@ -989,6 +991,8 @@ static void destroy_rset(resource_set_o_t *rset)
 
     mrp_dbus_remove_method(ctx->dbus, rset->path, RSET_IFACE, RSET_DELETE,
             rset_cb, ctx);
+    mrp_dbus_remove_method(ctx->dbus, rset->path, RSET_IFACE, RSET_PROBE,
+            rset_cb, ctx);
     mrp_dbus_remove_method(ctx->dbus, rset->path, RSET_IFACE, RSET_RELEASE,
             rset_cb, ctx);
     mrp_dbus_remove_method(ctx->dbus, rset->path, RSET_IFACE, RSET_REQUEST,
@@ -1890,6 +1894,72 @@ static int rset_cb(mrp_dbus_t *dbus, mrp_dbus_msg_t *msg, void *data)
         mrp_dbus_send_msg(dbus, reply);
         mrp_dbus_msg_unref(reply);
     }
+    else if (strcmp(member, RSET_PROBE) == 0) {
+        /* Reply with the status the set would get if it was requested
+         * now, followed by the ids of the sets that would lose resources.
+         * Nothing is changed in the resource library, but like a request
+         * this locks the set.
+         */
+        mrp_resource_mask_t grant, advice;
+        uint32_t preempted[PREEMPT_MAX];
+        const char *status;
+        int i, n;
+
+        mrp_log_info("Probing rset %s", path);
+
+        if (!rset->locked) {
+            if (!initialize_resource_set(rset)) {
+                error_msg = "Could not set up resource set; "
+                        "possibly an unknown resource or zone";
+                goto error_reply;
+            }
+        }
+
+        rset->locked = TRUE;
+
+        n = mrp_resource_set_probe_acquire(rset->set, &grant, &advice,
+                preempted, PREEMPT_MAX);
+
+        if (n < 0) {
+            error_msg = "Could not probe resource set";
+            goto error_reply;
+        }
+
+        if (n > PREEMPT_MAX)
+            n = PREEMPT_MAX;
+
+        if (grant)
+            status = "acquired";
+        else if (advice)
+            status = "available";
+        else
+            status = "lost";
+
+        reply = mrp_dbus_msg_method_return(dbus, msg);
+        if (!reply)
+            goto error;
+
+        if (!mrp_dbus_msg_append_basic(reply, MRP_DBUS_TYPE_STRING,
+                    (void *) status) ||
+            !mrp_dbus_msg_open_container(reply, MRP_DBUS_TYPE_ARRAY, "u")) {
+            mrp_dbus_msg_unref(reply);
+            goto error_reply;
+        }
+
+        for (i = 0; i < n; i++) {
+            if (!mrp_dbus_msg_append_basic(reply, MRP_DBUS_TYPE_UINT32,
+                        preempted + i)) {
+                mrp_dbus_msg_close_container(reply);
+                mrp_dbus_msg_unref(reply);
+                goto error_reply;
+            }
+        }
+
+        mrp_dbus_msg_close_container(reply);
+
+        mrp_dbus_send_msg(dbus, reply);
+        mrp_dbus_msg_unref(reply);
+    }
     else if (strcmp(member, RSET_DELETE) == 0) {
         mrp_log_info("Deleting rset %s", path);
 
@@ -2104,6 +2174,11 @@ static int mgr_cb(mrp_dbus_t *dbus, mrp_dbus_msg_t *msg, void *data)
             destroy_rset(rset);
             goto error_reply;
         }
+        if (!mrp_dbus_export_method(ctx->dbus, rset->path,
+                    RSET_IFACE, RSET_PROBE, rset_cb, ctx)) {
+            destroy_rset(rset);
+            goto error_reply;
+        }
         if (!mrp_dbus_export_method(ctx->dbus, rset->path,
                     RSET_IFACE, RSET_DELETE, rset_cb, ctx)) {
             destroy_rset(rset);
@@ -390,15 +390,16 @@ int main(int argc, char **argv)
 
     my_app_data app_data;
 
-    MRP_UNUSED(argc);
-    MRP_UNUSED(argv);
-
     if ((ml = mrp_mainloop_create()) == NULL)
         exit(1);
 
     app_data.rs = NULL;
     app_data.cx = mrp_res_create(ml, state_callback, &app_data);
 
+    /* '-r' keeps us reconnecting to (a restarted) Murphy */
+    if (app_data.cx && argc > 1 && !strcmp(argv[1], "-r"))
+        mrp_res_set_autoreconnect(TRUE, app_data.cx);
+
     mask = MRP_IO_EVENT_IN | MRP_IO_EVENT_HUP | MRP_IO_EVENT_ERR;
     watch = mrp_add_io_watch(ml, fileno(stdin), (mrp_io_event_t) mask,
             handle_input, &app_data);
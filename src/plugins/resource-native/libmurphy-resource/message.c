@@ -180,6 +180,34 @@ bool fetch_status(mrp_msg_t *msg, void **pcursor, int *pstatus)
 
 
 
+bool fetch_batch_header(mrp_msg_t *msg, void **pcursor,
+                        uint32_t *precalc, uint32_t *pdim)
+{
+    uint16_t tag;
+    uint16_t type;
+    mrp_msg_value_t value;
+    size_t size;
+
+    if (!mrp_msg_iterate(msg, pcursor, &tag, &type, &value, &size) ||
+        tag != RESPROTO_RECALC_SEQUENCE_NO || type != MRP_MSG_FIELD_UINT32)
+        goto malformed;
+
+    *precalc = value.u32;
+
+    if (!mrp_msg_iterate(msg, pcursor, &tag, &type, &value, &size) ||
+        tag != RESPROTO_ARRAY_DIMENSION || type != MRP_MSG_FIELD_UINT32)
+        goto malformed;
+
+    *pdim = value.u32;
+    return true;
+
+ malformed:
+    *precalc = 0;
+    *pdim = 0;
+    return false;
+}
+
+
 bool fetch_attribute_array(mrp_msg_t *msg, void **pcursor,
                                  size_t dim, mrp_res_attribute_t *arr,
                                  int *n_arr)
@@ -670,3 +698,30 @@ error:
     mrp_msg_unref(msg);
     return -1;
 }
+
+
+int enable_event_batching_request(mrp_res_context_t *cx)
+{
+    mrp_msg_t *msg = NULL;
+
+    if (!cx->priv->connected)
+        goto error;
+
+    msg = mrp_msg_create(RESPROTO_SEQUENCE_NO, MRP_MSG_FIELD_UINT32, 0,
+            RESPROTO_REQUEST_TYPE, MRP_MSG_FIELD_UINT16,
+                    RESPROTO_ENABLE_EVENT_BATCHING,
+            RESPROTO_MESSAGE_END);
+
+    if (!msg)
+        goto error;
+
+    if (!mrp_transport_send(cx->priv->transp, msg))
+        goto error;
+
+    mrp_msg_unref(msg);
+    return 0;
+
+error:
+    mrp_msg_unref(msg);
+    return -1;
+}
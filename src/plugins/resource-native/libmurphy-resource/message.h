@@ -54,6 +54,9 @@ bool fetch_request(mrp_msg_t *msg, void **pcursor, uint16_t *preqtype);
 
 bool fetch_status(mrp_msg_t *msg, void **pcursor, int *pstatus);
 
+bool fetch_batch_header(mrp_msg_t *msg, void **pcursor,
+                        uint32_t *precalc, uint32_t *pdim);
+
 bool fetch_attribute_array(mrp_msg_t *msg, void **pcursor,
                                  size_t dim, mrp_res_attribute_t *arr,
                                  int *n_arr);
@@ -89,4 +92,6 @@ int get_application_classes_request(mrp_res_context_t *cx);
 
 int get_available_resources_request(mrp_res_context_t *cx);
 
+int enable_event_batching_request(mrp_res_context_t *cx);
+
 #endif
@@ -158,6 +158,26 @@ mrp_res_context_t *mrp_res_create(mrp_mainloop_t *ml,
  */
 void mrp_res_destroy(mrp_res_context_t *cx);
 
+/**
+ * Set automatic reconnection mode to the context. This means that if the
+ * connection to Murphy is lost, the library keeps trying to reconnect in
+ * the background with a jittered exponential backoff. Once reconnected,
+ * all resource sets of the context are re-created on the server and the
+ * ones that were acquired are acquired again. The server-side ids of the
+ * resource sets change, but the sets themselves stay valid. Meanwhile the
+ * context state changes to disconnected and back to connected, which is
+ * reported to the state callback without an error, and acquired sets are
+ * reported as lost until they are re-acquired. Acquiring or releasing a
+ * set while disconnected is carried out once the connection is back. By
+ * default the automatic reconnection mode is off.
+ *
+ * @param status automatic reconnection status: TRUE means on, FALSE off
+ * @param cx murphy connection context.
+ *
+ * @return true if successful, false otherwise.
+ */
+bool mrp_res_set_autoreconnect(bool status, mrp_res_context_t *cx);
+
 /**
  * List possible application classes that you can assign yourself
  * when asking for resources. This info is cached to the client
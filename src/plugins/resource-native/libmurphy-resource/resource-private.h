@@ -100,6 +100,9 @@ struct mrp_res_resource_set_private_s {
 
     pending_operation_t waiting_for;
 
+    /* last operation requested by the client, redone after reconnecting */
+    pending_operation_t requested;
+
     mrp_list_hook_t hook;
 };
 
@@ -120,6 +123,11 @@ struct mrp_res_context_private_s {
     mrp_transport_t *transp;
     bool connected;
 
+    /* automatic reconnection to the server */
+    bool autoreconnect;
+    mrp_timer_t *reconnect;
+    uint32_t reconnect_delay;
+
     mrp_res_string_array_t *master_classes;
     mrp_res_resource_set_t *master_resource_set;
 
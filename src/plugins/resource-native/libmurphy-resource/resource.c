@@ -28,6 +28,9 @@
  */
 
 #include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
 
 #include <murphy/resource/protocol.h>
 #include "resource-api.h"
@@ -38,6 +41,12 @@
 #include "rset.h"
 #include "attribute.h"
 
+#define RECONNECT_MIN     250            /* initial reconnect delay, msecs */
+#define RECONNECT_MAX   30000            /* maximum reconnect delay, msecs */
+#define RECONNECT_SLACK   100            /* reconnect timer slack, msecs */
+
+static void reconnect_cb(mrp_timer_t *t, void *user_data);
+
 
 void *u_to_p(uint32_t u)
 {
@@ -83,12 +92,31 @@ uint32_t int_hash(const void *key)
 }
 
 
-static void resource_event(mrp_msg_t *msg,
+static void skip_resource_set_event(mrp_msg_t *msg, void **pcursor)
+{
+    uint16_t tag;
+    uint16_t type;
+    mrp_msg_value_t value;
+    size_t size;
+    void *next = *pcursor;
+
+    /* skip to the next entry of a batch, or the end of the message */
+
+    while (mrp_msg_iterate(msg, &next, &tag, &type, &value, &size)) {
+        if (tag == RESPROTO_RESOURCE_SET_ID)
+            break;
+
+        *pcursor = next;
+    }
+}
+
+
+static bool resource_set_event(mrp_msg_t *msg,
         mrp_res_context_t *cx,
+        uint32_t rset_id,
         int32_t seqno,
         void **pcursor)
 {
-    uint32_t rset_id;
     uint32_t grant, advice;
     mrp_resproto_state_t state;
     uint16_t tag;
@@ -102,15 +130,15 @@ static void resource_event(mrp_msg_t *msg,
     uint32_t mask, all = 0x0, mandatory = 0x0;
     uint32_t i;
     mrp_res_resource_set_t *rset;
+    void *next;
 
     mrp_res_info("Resource event (request no %u):", seqno);
 
-    if (!fetch_resource_set_id(msg, pcursor, &rset_id) ||
-        !fetch_resource_set_state(msg, pcursor, &state) ||
+    if (!fetch_resource_set_state(msg, pcursor, &state) ||
         !fetch_resource_set_mask(msg, pcursor, 0, &grant) ||
         !fetch_resource_set_mask(msg, pcursor, 1, &advice)) {
         mrp_res_error("failed to fetch data from message");
-        goto ignore;
+        goto malformed;
     }
 
     /* Update our "master copy" of the resource set. */
@@ -119,24 +147,33 @@ static void resource_event(mrp_msg_t *msg,
 
     if (!rset) {
         mrp_res_info("resource event outside the resource set lifecycle");
-        goto ignore;
+        mrp_res_info("ignoring resource event");
+        skip_resource_set_event(msg, pcursor);
+        return true;
     }
 
-    while (mrp_msg_iterate(msg, pcursor, &tag, &type, &value, &size)) {
+    /* the resources of the set run until the next entry of a batch */
+
+    next = *pcursor;
+
+    while (mrp_msg_iterate(msg, &next, &tag, &type, &value, &size) &&
+            tag != RESPROTO_RESOURCE_SET_ID) {
 
         mrp_res_resource_t *res = NULL;
 
+        *pcursor = next;
+
         if ((tag != RESPROTO_RESOURCE_ID || type != MRP_MSG_FIELD_UINT32) ||
                 !fetch_resource_name(msg, pcursor, &resnam)) {
             mrp_res_error("failed to read resource from message");
-            goto ignore;
+            goto malformed;
         }
 
         res = get_resource_by_name(rset, resnam);
 
         if (!res) {
             mrp_res_error("resource doesn't exist in resource set");
-            goto ignore;
+            goto malformed;
         }
 
         resid = value.u32;
@@ -146,7 +183,7 @@ static void resource_event(mrp_msg_t *msg,
         if (!fetch_attribute_array(msg, pcursor, ATTRIBUTE_MAX + 1, attrs,
                 &n_attrs)) {
             mrp_res_error("failed to read attributes from message");
-            goto ignore;
+            goto malformed;
         }
 
         /* copy the attributes */
@@ -180,6 +217,8 @@ static void resource_event(mrp_msg_t *msg,
                     break;
             }
         }
+
+        next = *pcursor;
     }
 
     /* go through all resources and see if they have been modified */
@@ -231,10 +270,63 @@ static void resource_event(mrp_msg_t *msg,
         }
     }
 
-    return;
+    return true;
 
- ignore:
+ malformed:
     mrp_res_info("ignoring resource event");
+    return false;
+}
+
+
+static void resource_event(mrp_msg_t *msg,
+        mrp_res_context_t *cx,
+        int32_t seqno,
+        void **pcursor)
+{
+    uint32_t rset_id;
+
+    if (!fetch_resource_set_id(msg, pcursor, &rset_id)) {
+        mrp_res_error("failed to fetch data from message");
+        mrp_res_info("ignoring resource event");
+        return;
+    }
+
+    resource_set_event(msg, cx, rset_id, seqno, pcursor);
+}
+
+
+static void batch_event(mrp_msg_t *msg,
+        mrp_res_context_t *cx,
+        void **pcursor)
+{
+    uint32_t recalc, dim, i;
+    uint32_t rset_id, seqno;
+
+    /*
+     * A batch carries the events of all resource sets of ours that
+     * changed in a single recalculation on the server. Each entry starts
+     * with the set id and the request number, followed by the same data
+     * as a single resource event.
+     */
+
+    if (!fetch_batch_header(msg, pcursor, &recalc, &dim)) {
+        mrp_res_error("failed to fetch batch header from message");
+        return;
+    }
+
+    mrp_res_info("Resource event batch (recalculation %u, %u events):",
+            recalc, dim);
+
+    for (i = 0; i < dim; i++) {
+        if (!fetch_resource_set_id(msg, pcursor, &rset_id) ||
+            !fetch_seqno(msg, pcursor, &seqno)) {
+            mrp_res_error("failed to fetch batch entry #%u from message", i);
+            return;
+        }
+
+        if (!resource_set_event(msg, cx, rset_id, seqno, pcursor))
+            return;
+    }
 }
 
 
@@ -367,6 +459,21 @@ static void recvfrom_msg(mrp_transport_t *transp, mrp_msg_t *msg,
 
             resource_event(msg, cx, seqno, &cursor);
             break;
+        case RESPROTO_RESOURCES_BATCH_EVENT:
+            mrp_res_info("received RESOURCES_BATCH_EVENT response");
+
+            batch_event(msg, cx, &cursor);
+            break;
+        case RESPROTO_ENABLE_EVENT_BATCHING:
+        {
+            int status;
+
+            if (!fetch_status(msg, &cursor, &status) || status != 0)
+                mrp_res_info("server refused to batch resource events");
+            else
+                mrp_res_info("server batches resource events");
+            break;
+        }
         case RESPROTO_DESTROY_RESOURCE_SET:
             mrp_res_info("received DESTROY_RESOURCE_SET response");
             /* TODO? */
@@ -396,6 +503,182 @@ static void recv_msg(mrp_transport_t *t, mrp_msg_t *msg, void *user_data)
 }
 
 
+static uint32_t reconnect_jitter(uint32_t range)
+{
+    static unsigned int seed;
+
+    /* seed per process so clients restarted together don't retry in sync */
+    if (seed == 0)
+        seed = (unsigned int)getpid() ^ (unsigned int)time(NULL);
+
+    return (uint32_t)rand_r(&seed) % (range + 1);
+}
+
+
+static void schedule_reconnect(mrp_res_context_t *cx)
+{
+    uint32_t delay = cx->priv->reconnect_delay;
+
+    if (delay < RECONNECT_MIN)
+        delay = RECONNECT_MIN;
+
+    /* back off exponentially, jittering within [delay / 2, delay] */
+    cx->priv->reconnect_delay = MRP_MIN(2 * delay, RECONNECT_MAX);
+    delay = delay / 2 + reconnect_jitter(delay / 2);
+
+    mrp_res_info("reconnecting %p in %u msecs", cx, delay);
+
+    if (cx->priv->reconnect)
+        mrp_del_timer(cx->priv->reconnect);
+
+    cx->priv->reconnect = mrp_add_timer_full(cx->priv->ml, delay,
+                                             RECONNECT_SLACK, reconnect_cb, cx);
+
+    if (!cx->priv->reconnect)
+        mrp_res_error("failed to create reconnection timer");
+}
+
+
+static int count_rset(void *key, void *object, void *user_data)
+{
+    MRP_UNUSED(key);
+    MRP_UNUSED(object);
+
+    (*(int *)user_data)++;
+
+    return MRP_HTBL_ITER_MORE;
+}
+
+
+static int collect_rset(void *key, void *object, void *user_data)
+{
+    mrp_res_resource_set_t ***rsetp = user_data;
+
+    MRP_UNUSED(key);
+
+    *(*rsetp)++ = object;
+
+    return MRP_HTBL_ITER_MORE;
+}
+
+
+static mrp_res_resource_set_t **collect_rsets(mrp_res_context_t *cx, int *nrset)
+{
+    mrp_res_resource_set_t **rsets, **rsetp;
+    int i, n;
+
+    n = 0;
+    mrp_htbl_foreach(cx->priv->internal_rset_mapping, count_rset, &n);
+
+    if (n == 0 || !(rsets = mrp_allocz_array(mrp_res_resource_set_t *, n))) {
+        *nrset = 0;
+        return NULL;
+    }
+
+    rsetp = rsets;
+    mrp_htbl_foreach(cx->priv->internal_rset_mapping, collect_rset, &rsetp);
+
+    /* keep the sets around while we might be calling back the client */
+    for (i = 0; i < n; i++)
+        increase_ref(cx, rsets[i]);
+
+    *nrset = n;
+    return rsets;
+}
+
+
+static void release_rsets(mrp_res_context_t *cx, mrp_res_resource_set_t **rsets,
+        int nrset)
+{
+    int i;
+
+    for (i = 0; i < nrset; i++)
+        decrease_ref(cx, rsets[i]);
+
+    mrp_free(rsets);
+}
+
+
+static void connection_lost(mrp_res_context_t *cx)
+{
+    mrp_res_resource_set_t **rsets, *rset;
+    uint32_t j;
+    int i, n;
+
+    /* detach the library resource sets from their stale server-side ids */
+
+    rsets = collect_rsets(cx, &n);
+
+    for (i = 0; i < n; i++) {
+        rset = rsets[i];
+
+        if (rset->priv->id)
+            mrp_htbl_remove(cx->priv->rset_mapping, u_to_p(rset->priv->id),
+                    FALSE);
+
+        rset->priv->id = 0;
+        rset->priv->seqno = 0;
+        rset->priv->waiting_for = MRP_RES_PENDING_OPERATION_NONE;
+
+        mrp_list_delete(&rset->priv->hook);
+        mrp_list_init(&rset->priv->hook);
+    }
+
+    cx->state = MRP_RES_DISCONNECTED;
+    cx->priv->cb(cx, MRP_RES_ERROR_NONE, cx->priv->user_data);
+
+    /* acquired sets are lost until they are re-acquired */
+
+    for (i = 0; i < n; i++) {
+        rset = rsets[i];
+
+        if (rset->state != MRP_RES_RESOURCE_ACQUIRED)
+            continue;
+
+        rset->state = MRP_RES_RESOURCE_LOST;
+
+        for (j = 0; j < rset->priv->num_resources; j++)
+            rset->priv->resources[j]->state = MRP_RES_RESOURCE_LOST;
+
+        if (rset->priv->cb)
+            rset->priv->cb(cx, rset, rset->priv->user_data);
+    }
+
+    release_rsets(cx, rsets, n);
+}
+
+
+static void resync_rsets(mrp_res_context_t *cx)
+{
+    mrp_res_resource_set_t **rsets, *rset;
+    int i, n;
+
+    /* re-create the sets on the server and redo the last requested operation */
+
+    rsets = collect_rsets(cx, &n);
+
+    for (i = 0; i < n; i++) {
+        rset = rsets[i];
+
+        if (rset->priv->requested == MRP_RES_PENDING_OPERATION_NONE)
+            continue;
+
+        mrp_list_append(&cx->priv->pending_sets, &rset->priv->hook);
+        rset->priv->waiting_for = rset->priv->requested;
+
+        if (create_resource_set_request(cx, rset) < 0) {
+            mrp_res_error("failed to re-create resource set %u",
+                    rset->priv->internal_id);
+            mrp_list_delete(&rset->priv->hook);
+            mrp_list_init(&rset->priv->hook);
+            rset->priv->waiting_for = MRP_RES_PENDING_OPERATION_NONE;
+        }
+    }
+
+    release_rsets(cx, rsets, n);
+}
+
+
 void closed_evt(mrp_transport_t *transp, int error, void *user_data)
 {
     mrp_res_context_t *cx = user_data;
@@ -405,6 +688,12 @@ void closed_evt(mrp_transport_t *transp, int error, void *user_data)
     mrp_res_error("connection closed for %p", cx);
     cx->priv->connected = FALSE;
 
+    if (cx->priv->autoreconnect && cx->state == MRP_RES_CONNECTED) {
+        schedule_reconnect(cx);
+        connection_lost(cx);
+        return;
+    }
+
     if (cx->state == MRP_RES_CONNECTED) {
         cx->state = MRP_RES_DISCONNECTED;
         cx->priv->cb(cx, MRP_RES_ERROR_CONNECTION_LOST, cx->priv->user_data);
@@ -419,6 +708,9 @@ static void destroy_context(mrp_res_context_t *cx)
 
     if (cx->priv) {
 
+        if (cx->priv->reconnect)
+            mrp_del_timer(cx->priv->reconnect);
+
         if (cx->priv->transp)
             mrp_transport_destroy(cx->priv->transp);
 
@@ -452,11 +744,7 @@ static void htbl_free_rset_mapping(void *key, void *object)
     free_resource_set(rset);
 }
 
-/* public API */
-
-mrp_res_context_t *mrp_res_create(mrp_mainloop_t *ml,
-                       mrp_res_state_callback_t cb,
-                       void *userdata)
+static int connect_to_server(mrp_res_context_t *cx)
 {
     static mrp_transport_evt_t evt = {
         { .recvmsg     = recv_msg },
@@ -467,6 +755,72 @@ mrp_res_context_t *mrp_res_create(mrp_mainloop_t *ml,
 
     int alen;
     const char *type;
+
+    alen = mrp_transport_resolve(NULL, mrp_resource_get_default_address(),
+            &cx->priv->saddr, sizeof(cx->priv->saddr), &type);
+
+    if (alen <= 0)
+        return -1;
+
+    cx->priv->transp = mrp_transport_create(cx->priv->ml, type,
+                                          &evt, cx, 0);
+
+    if (!cx->priv->transp)
+        return -1;
+
+    if (!mrp_transport_connect(cx->priv->transp, &cx->priv->saddr, alen)) {
+        mrp_transport_destroy(cx->priv->transp);
+        cx->priv->transp = NULL;
+        return -1;
+    }
+
+    cx->priv->connected = TRUE;
+
+    /* we can decode batched events, ask the server to send those */
+
+    if (enable_event_batching_request(cx) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static void reconnect_cb(mrp_timer_t *t, void *user_data)
+{
+    mrp_res_context_t *cx = user_data;
+
+    mrp_del_timer(t);
+    cx->priv->reconnect = NULL;
+
+    if (cx->priv->transp) {
+        mrp_transport_destroy(cx->priv->transp);
+        cx->priv->transp = NULL;
+    }
+
+    if (connect_to_server(cx) < 0) {
+        mrp_res_info("failed to reconnect %p to server", cx);
+        schedule_reconnect(cx);
+        return;
+    }
+
+    mrp_res_info("reconnected %p to server", cx);
+
+    cx->priv->reconnect_delay = 0;
+
+    resync_rsets(cx);
+
+    if (cx->priv->connected) {
+        cx->state = MRP_RES_CONNECTED;
+        cx->priv->cb(cx, MRP_RES_ERROR_NONE, cx->priv->user_data);
+    }
+}
+
+/* public API */
+
+mrp_res_context_t *mrp_res_create(mrp_mainloop_t *ml,
+                       mrp_res_state_callback_t cb,
+                       void *userdata)
+{
     mrp_htbl_config_t conf;
     mrp_res_context_t *cx = mrp_allocz(sizeof(mrp_res_context_t));
 
@@ -511,19 +865,9 @@ mrp_res_context_t *mrp_res_create(mrp_mainloop_t *ml,
 
     /* connect to Murphy */
 
-    alen = mrp_transport_resolve(NULL, mrp_resource_get_default_address(),
-            &cx->priv->saddr, sizeof(cx->priv->saddr), &type);
-
-    cx->priv->transp = mrp_transport_create(cx->priv->ml, type,
-                                          &evt, cx, 0);
-
-    if (!cx->priv->transp)
-        goto error;
-
-    if (!mrp_transport_connect(cx->priv->transp, &cx->priv->saddr, alen))
+    if (connect_to_server(cx) < 0)
         goto error;
 
-    cx->priv->connected = TRUE;
     cx->state = MRP_RES_DISCONNECTED;
 
     if (get_application_classes_request(cx) < 0 || get_available_resources_request(cx) < 0) {
@@ -550,3 +894,22 @@ void mrp_res_destroy(mrp_res_context_t *cx)
 {
     destroy_context(cx);
 }
+
+
+bool mrp_res_set_autoreconnect(bool status, mrp_res_context_t *cx)
+{
+    if (!cx || !cx->priv)
+        return FALSE;
+
+    cx->priv->autoreconnect = status;
+
+    if (!status && cx->priv->reconnect) {
+        mrp_del_timer(cx->priv->reconnect);
+        cx->priv->reconnect = NULL;
+
+        /* we're giving up, report the lost connection as usual */
+        cx->priv->cb(cx, MRP_RES_ERROR_CONNECTION_LOST, cx->priv->user_data);
+    }
+
+    return TRUE;
+}
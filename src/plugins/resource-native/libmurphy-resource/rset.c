@@ -586,7 +586,7 @@ int mrp_res_release_resource_set(mrp_res_resource_set_t *original)
     mrp_res_resource_set_t *internal_set = NULL;
     mrp_res_context_t *cx = original->priv->cx;
 
-    if (!cx || !cx->priv->connected)
+    if (!cx || (!cx->priv->connected && !cx->priv->reconnect))
         goto error;
 
     if (!original->priv->internal_id)
@@ -600,6 +600,13 @@ int mrp_res_release_resource_set(mrp_res_resource_set_t *original)
 
     update_library_resource_set(cx, original, internal_set);
 
+    internal_set->priv->requested = MRP_RES_PENDING_OPERATION_RELEASE;
+
+    if (!cx->priv->connected) {
+        /* carried out once we have reconnected */
+        return 0;
+    }
+
     if (internal_set->priv->id) {
         return release_resource_set_request(cx, internal_set);
     }
@@ -628,6 +635,11 @@ int mrp_res_release_resource_set(mrp_res_resource_set_t *original)
 
         internal_set->priv->waiting_for = MRP_RES_PENDING_OPERATION_RELEASE;
 
+        if (found && internal_set->priv->seqno) {
+            /* already being created, released once that is done */
+            return 0;
+        }
+
         if (create_resource_set_request(cx, internal_set) < 0) {
             mrp_res_error("creating resource set failed");
             mrp_list_delete(&internal_set->priv->hook);
@@ -794,7 +806,7 @@ int mrp_res_acquire_resource_set(
     mrp_res_resource_set_t *rset;
     mrp_res_context_t *cx = original->priv->cx;
 
-    if (!cx->priv->connected) {
+    if (!cx->priv->connected && !cx->priv->reconnect) {
         mrp_res_error("not connected to server");
         goto error;
     }
@@ -809,6 +821,12 @@ int mrp_res_acquire_resource_set(
 
     update_library_resource_set(cx, original, rset);
 
+    if (!cx->priv->connected) {
+        /* carried out once we have reconnected */
+        rset->priv->requested = MRP_RES_PENDING_OPERATION_ACQUIRE;
+        return 0;
+    }
+
 #if 0
     print_resource_set(rset);
 #endif
@@ -826,6 +844,7 @@ int mrp_res_acquire_resource_set(
         }
         else {
             /* re-acquire a lost or released set */
+            rset->priv->requested = MRP_RES_PENDING_OPERATION_ACQUIRE;
             return acquire_resource_set_request(cx, rset);
         }
     }
@@ -852,6 +871,12 @@ int mrp_res_acquire_resource_set(
         }
 
         rset->priv->waiting_for = MRP_RES_PENDING_OPERATION_ACQUIRE;
+        rset->priv->requested = MRP_RES_PENDING_OPERATION_ACQUIRE;
+
+        if (found && rset->priv->seqno) {
+            /* already being created, acquired once that is done */
+            return 0;
+        }
 
         if (create_resource_set_request(cx, rset) < 0) {
             mrp_res_error("creating resource set failed");
@@ -55,6 +55,7 @@
 #include <murphy/resource/resource-set.h>
 
 #define ATTRIBUTE_MAX MRP_ATTRIBUTE_MAX
+#define PREEMPT_MAX   64
 
 
 
@@ -70,6 +71,7 @@ enum {
 
 enum {
     ARG_ADDRESS,
+    ARG_BACKLOG,
 };
 
 
@@ -90,16 +92,27 @@ typedef struct {
     uint32_t               id;
     mrp_resource_client_t *rscli;
     mrp_transport_t       *transp;
+    bool                   batch;
+    mrp_list_hook_t        events;
 } client_t;
 
+typedef struct {
+    mrp_list_hook_t        list;
+    uint32_t               rsetid;
+    uint32_t               reqid;
+} pending_event_t;
+
 
 static void print_zones_cb(mrp_console_t *, void *, int, char **argv);
 static void print_classes_cb(mrp_console_t *, void *, int, char **argv);
 static void print_sets_cb(mrp_console_t *, void *, int, char **argv);
 static void print_owners_cb(mrp_console_t *, void *, int, char **argv);
 static void print_resources_cb(mrp_console_t *, void *, int, char **argv);
+static void print_stats_cb(mrp_console_t *, void *, int, char **argv);
 
 static void resource_event_handler(uint32_t, mrp_resource_set_t *, void *);
+static void resource_flush_handler(uint32_t, mrp_resource_client_t *, void *);
+static void purge_pending_events(client_t *);
 
 
 MRP_CONSOLE_GROUP(resource_group, "resource", NULL, NULL, {
@@ -131,6 +144,11 @@ MRP_CONSOLE_GROUP(resource_group, "resource", NULL, NULL, {
                           "all their attributes. The data sources for the "
                           "printout are the internal data structures of the "
                           "resource library"),
+        MRP_TOKENIZED_CMD("stats" , print_stats_cb , FALSE,
+                          "stats", "prints ownership update statistics",
+                          "prints the number of resource ownership updates "
+                          "and of the scratch buffer allocations they needed "
+                          "since startup, and the allocations per update."),
 
 });
 
@@ -193,6 +211,25 @@ static void print_sets_cb(mrp_console_t *c, void *user_data,
 }
 
 
+static void print_stats_cb(mrp_console_t *c, void *user_data,
+                           int argc, char **argv)
+{
+    mrp_resource_owner_stats_t stats;
+
+    MRP_UNUSED(c);
+    MRP_UNUSED(user_data);
+    MRP_UNUSED(argc);
+    MRP_UNUSED(argv);
+
+    mrp_resource_owner_get_stats(&stats);
+
+    printf("Ownership updates: %llu\n", (unsigned long long)stats.updates);
+    printf("Scratch allocations: %llu (%.4f per update)\n",
+           (unsigned long long)stats.allocs,
+           stats.updates ? (double)stats.allocs / stats.updates : 0.0);
+}
+
+
 static void print_owners_cb(mrp_console_t *c, void *user_data,
                             int argc, char **argv)
 {
@@ -760,6 +797,78 @@ static void acquire_resource_set_request(client_t *client, mrp_msg_t *req,
         mrp_resource_set_release(rset, seqno);
 }
 
+static void probe_resource_set_request(client_t *client, mrp_msg_t *req,
+                                       void **pcurs)
+{
+#define PUSH(m, tag, typ, val)    \
+    mrp_msg_append(m, MRP_MSG_TAG_##typ(RESPROTO_##tag, val))
+
+    resource_data_t    *data   = client->data;
+    mrp_plugin_t       *plugin = data->plugin;
+    uint16_t            tag;
+    uint16_t            type;
+    size_t              size;
+    mrp_msg_value_t     value;
+    uint32_t            rset_id;
+    mrp_resource_set_t *rset;
+    mrp_resource_mask_t grant;
+    mrp_resource_mask_t advice;
+    uint32_t            preempted[PREEMPT_MAX];
+    int                 n;
+
+    MRP_ASSERT(client, "invalid argument");
+    MRP_ASSERT(client->rscli, "confused with data structures");
+
+    if (!mrp_msg_iterate(req, pcurs, &tag, &type, &value, &size) ||
+        tag != RESPROTO_RESOURCE_SET_ID || type != MRP_MSG_FIELD_UINT32)
+    {
+        reply_with_status(client, req, EINVAL);
+        return;
+    }
+
+    rset_id = value.u32;
+
+    if (!(rset = mrp_resource_client_find_set(client->rscli, rset_id))) {
+        reply_with_status(client, req, ENOENT);
+        return;
+    }
+
+    n = mrp_resource_set_probe_acquire(rset, &grant, &advice,
+                                       preempted, PREEMPT_MAX);
+
+    if (n < 0) {
+        reply_with_status(client, req, EINVAL);
+        return;
+    }
+
+    if (n > PREEMPT_MAX)
+        n = PREEMPT_MAX;
+
+    if (!PUSH(req, REQUEST_STATUS , SINT16, 0     ) ||
+        !PUSH(req, RESOURCE_GRANT , UINT32, grant ) ||
+        !PUSH(req, RESOURCE_ADVICE, UINT32, advice) ||
+        !mrp_msg_append(req, MRP_MSG_TAG_UINT32_ARRAY(RESPROTO_PREEMPTED_SET_ID,
+                                                      n, preempted))      ||
+        !mrp_transport_send(client->transp, req))
+    {
+        mrp_log_error("%s: failed to create or send reply", plugin->instance);
+    }
+
+#undef PUSH
+}
+
+static void enable_event_batching_request(client_t *client, mrp_msg_t *req)
+{
+    MRP_ASSERT(client, "invalid argument");
+    MRP_ASSERT(client->rscli, "confused with data structures");
+
+    client->batch = true;
+    mrp_resource_client_set_flush_callback(client->rscli,
+                                           resource_flush_handler);
+
+    reply_with_status(client, req, 0);
+}
+
 static void connection_evt(mrp_transport_t *listen, void *user_data)
 {
     static uint32_t  id;
@@ -777,6 +886,7 @@ static void connection_evt(mrp_transport_t *listen, void *user_data)
     }
 
     client->data = data;
+    mrp_list_init(&client->events);
 
     snprintf(name, sizeof(name), "client%u", (client->id = ++id));
     client->rscli = mrp_resource_client_create(name, client);
@@ -808,6 +918,7 @@ static void closed_evt(mrp_transport_t *transp, int error, void *user_data)
         mrp_log_info("%s: peer closed connection", plugin->instance);
 
     mrp_resource_client_destroy(client->rscli);
+    purge_pending_events(client);
 
     mrp_list_delete(&client->list);
     mrp_free(client);
@@ -891,6 +1002,14 @@ static void recvfrom_msg(mrp_transport_t *transp, mrp_msg_t *msg,
         acquire_resource_set_request(client, msg, seqno, false, &cursor);
         break;
 
+    case RESPROTO_PROBE_RESOURCE_SET:
+        probe_resource_set_request(client, msg, &cursor);
+        break;
+
+    case RESPROTO_ENABLE_EVENT_BATCHING:
+        enable_event_batching_request(client, msg);
+        break;
+
     default:
         mrp_log_warning("%s: unsupported request type %d",
                         plugin->instance, reqtyp);
@@ -904,37 +1023,22 @@ static void recv_msg(mrp_transport_t *transp, mrp_msg_t *msg, void *user_data)
 }
 
 
-static void resource_event_handler(uint32_t reqid, mrp_resource_set_t *rset,
-                                   void *userdata)
+static bool write_resource_set_event(mrp_msg_t *msg, mrp_resource_set_t *rset)
 {
-#define FIELD(tag, typ, val)      \
-    RESPROTO_##tag, MRP_MSG_FIELD_##typ, val
 #define PUSH(m, tag, typ, val)    \
     mrp_msg_append(m, MRP_MSG_TAG_##typ(RESPROTO_##tag, val))
 
-    client_t           *client = (client_t *)userdata;
-    resource_data_t    *data;
-    mrp_plugin_t       *plugin;
-    uint16_t            reqtyp;
     uint16_t            state;
     mrp_resource_mask_t grant;
     mrp_resource_mask_t advice;
     mrp_resource_mask_t mask;
     mrp_resource_mask_t all;
-    mrp_msg_t          *msg;
     mrp_resource_t     *res;
     uint32_t            id;
     const char         *name;
     void               *curs;
     mrp_attr_t          attrs[ATTRIBUTE_MAX + 1];
 
-    MRP_ASSERT(rset && client, "invalid argument");
-
-    data   = client->data;
-    plugin = data->plugin;
-
-    reqtyp = RESPROTO_RESOURCES_EVENT;
-    id     = mrp_get_resource_set_id(rset);
     grant  = mrp_get_resource_set_grant(rset);
     advice = mrp_get_resource_set_advice(rset);
 
@@ -943,16 +1047,10 @@ static void resource_event_handler(uint32_t reqid, mrp_resource_set_t *rset,
     else
         state = RESPROTO_RELEASE;
 
-    msg = mrp_msg_create(FIELD( SEQUENCE_NO    , UINT32, reqid  ),
-                         FIELD( REQUEST_TYPE   , UINT16, reqtyp ),
-                         FIELD( RESOURCE_SET_ID, UINT32, id     ),
-                         FIELD( RESOURCE_STATE , UINT16, state  ),
-                         FIELD( RESOURCE_GRANT , UINT32, grant  ),
-                         FIELD( RESOURCE_ADVICE, UINT32, advice ),
-                         RESPROTO_MESSAGE_END                   );
-
-    if (!msg)
-        goto failed;
+    if (!PUSH(msg, RESOURCE_STATE , UINT16, state ) ||
+        !PUSH(msg, RESOURCE_GRANT , UINT32, grant ) ||
+        !PUSH(msg, RESOURCE_ADVICE, UINT32, advice)  )
+        return false;
 
     all = grant | advice;
     curs = NULL;
@@ -966,33 +1064,201 @@ static void resource_event_handler(uint32_t reqid, mrp_resource_set_t *rset,
         id = mrp_resource_get_id(res);
         name = mrp_resource_get_name(res);
 
-         if (!PUSH(msg, RESOURCE_ID  , UINT32, id  ) ||
-             !PUSH(msg, RESOURCE_NAME, STRING, name)  )
-             goto failed;
+        if (!PUSH(msg, RESOURCE_ID  , UINT32, id  ) ||
+            !PUSH(msg, RESOURCE_NAME, STRING, name)  )
+            return false;
+
+        if (!mrp_resource_read_all_attributes(res, ATTRIBUTE_MAX + 1, attrs))
+            return false;
+
+        if (!write_attributes(msg, attrs))
+            return false;
+    }
+
+    return true;
+
+#undef PUSH
+}
+
+static void send_resource_event(client_t *client, uint32_t reqid,
+                                mrp_resource_set_t *rset)
+{
+#define FIELD(tag, typ, val)      \
+    RESPROTO_##tag, MRP_MSG_FIELD_##typ, val
+
+    resource_data_t *data   = client->data;
+    mrp_plugin_t    *plugin = data->plugin;
+    uint16_t         reqtyp = RESPROTO_RESOURCES_EVENT;
+    uint32_t         id     = mrp_get_resource_set_id(rset);
+    mrp_msg_t       *msg;
+
+    msg = mrp_msg_create(FIELD( SEQUENCE_NO    , UINT32, reqid  ),
+                         FIELD( REQUEST_TYPE   , UINT16, reqtyp ),
+                         FIELD( RESOURCE_SET_ID, UINT32, id     ),
+                         RESPROTO_MESSAGE_END                   );
+
+    if (!msg || !write_resource_set_event(msg, rset) ||
+        !mrp_transport_send(client->transp, msg))
+    {
+        mrp_log_error("%s: failed to build/send message for resource event",
+                      plugin->instance);
+    }
+
+    mrp_msg_unref(msg);
+
+#undef FIELD
+}
+
+static void send_batch_event(client_t *client, uint32_t recalc)
+{
+#define FIELD(tag, typ, val)      \
+    RESPROTO_##tag, MRP_MSG_FIELD_##typ, val
+#define PUSH(m, tag, typ, val)    \
+    mrp_msg_append(m, MRP_MSG_TAG_##typ(RESPROTO_##tag, val))
+
+    resource_data_t    *data   = client->data;
+    mrp_plugin_t       *plugin = data->plugin;
+    uint32_t            seqno  = 0;
+    uint16_t            reqtyp = RESPROTO_RESOURCES_BATCH_EVENT;
+    mrp_list_hook_t    *p, *n;
+    pending_event_t    *ev;
+    mrp_resource_set_t *rset;
+    mrp_msg_t          *msg;
+    uint32_t            dim;
+
+    dim = 0;
 
-         if (!mrp_resource_read_all_attributes(res, ATTRIBUTE_MAX + 1, attrs))
-             goto failed;
+    mrp_list_foreach(&client->events, p, n) {
+        ev = mrp_list_entry(p, pending_event_t, list);
 
-         if (!write_attributes(msg, attrs))
-                 goto failed;
+        if (mrp_resource_client_find_set(client->rscli, ev->rsetid))
+            dim++;
+    }
+
+    if (!dim) {
+        purge_pending_events(client);
+        return;
+    }
+
+    msg = mrp_msg_create(FIELD( SEQUENCE_NO       , UINT32, seqno  ),
+                         FIELD( REQUEST_TYPE      , UINT16, reqtyp ),
+                         FIELD( RECALC_SEQUENCE_NO, UINT32, recalc ),
+                         FIELD( ARRAY_DIMENSION   , UINT32, dim    ),
+                         RESPROTO_MESSAGE_END                      );
+
+    if (!msg)
+        goto failed;
+
+    mrp_list_foreach(&client->events, p, n) {
+        ev = mrp_list_entry(p, pending_event_t, list);
+
+        if (!(rset = mrp_resource_client_find_set(client->rscli, ev->rsetid)))
+            continue;
+
+        if (!PUSH(msg, RESOURCE_SET_ID, UINT32, ev->rsetid) ||
+            !PUSH(msg, SEQUENCE_NO    , UINT32, ev->reqid ) ||
+            !write_resource_set_event(msg, rset))
+            goto failed;
     }
 
     if (!mrp_transport_send(client->transp, msg))
         goto failed;
 
     mrp_msg_unref(msg);
+    purge_pending_events(client);
 
     return;
 
-    failed:
-         mrp_log_error("%s: failed to build/send message for resource event",
-                       plugin->instance);
-         mrp_msg_unref(msg);
+ failed:
+    mrp_log_error("%s: failed to build/send message for resource events",
+                  plugin->instance);
+    mrp_msg_unref(msg);
+    purge_pending_events(client);
 
 #undef PUSH
 #undef FIELD
 }
 
+static bool queue_resource_event(client_t *client, uint32_t reqid,
+                                 mrp_resource_set_t *rset)
+{
+    uint32_t         id = mrp_get_resource_set_id(rset);
+    mrp_list_hook_t *p, *n;
+    pending_event_t *ev;
+
+    mrp_list_foreach(&client->events, p, n) {
+        ev = mrp_list_entry(p, pending_event_t, list);
+
+        if (ev->rsetid == id) {
+            if (reqid)
+                ev->reqid = reqid;
+            return true;
+        }
+    }
+
+    if (!(ev = mrp_allocz(sizeof(*ev))))
+        return false;
+
+    mrp_list_init(&ev->list);
+    ev->rsetid = id;
+    ev->reqid  = reqid;
+
+    mrp_list_append(&client->events, &ev->list);
+
+    return true;
+}
+
+static void purge_pending_events(client_t *client)
+{
+    mrp_list_hook_t *p, *n;
+    pending_event_t *ev;
+
+    mrp_list_foreach(&client->events, p, n) {
+        ev = mrp_list_entry(p, pending_event_t, list);
+
+        mrp_list_delete(&ev->list);
+        mrp_free(ev);
+    }
+}
+
+static void resource_event_handler(uint32_t reqid, mrp_resource_set_t *rset,
+                                   void *userdata)
+{
+    client_t *client = (client_t *)userdata;
+
+    MRP_ASSERT(rset && client, "invalid argument");
+
+    if (!client->batch) {
+        send_resource_event(client, reqid, rset);
+        return;
+    }
+
+    /*
+     * Events of batching clients are collected for the duration of the
+     * ongoing recalculation and sent as a single frame when it is over.
+     * Events outside of any recalculation go out as single entry frames.
+     */
+
+    if (!queue_resource_event(client, reqid, rset)) {
+        send_resource_event(client, reqid, rset);
+        return;
+    }
+
+    if (!mrp_resource_client_queue_flush(client->rscli))
+        send_batch_event(client, mrp_resource_client_get_recalc_seqno());
+}
+
+static void resource_flush_handler(uint32_t recalc,
+                                   mrp_resource_client_t *rscli,
+                                   void *userdata)
+{
+    client_t *client = (client_t *)userdata;
+
+    MRP_ASSERT(client && client->rscli == rscli, "invalid argument");
+
+    send_batch_event(client, recalc);
+}
+
 
 
 static int initiate_transport(mrp_plugin_t *plugin)
@@ -1008,6 +1274,7 @@ static int initiate_transport(mrp_plugin_t *plugin)
     mrp_plugin_arg_t *args  = plugin->args;
     resource_data_t  *data  = (resource_data_t *)plugin->data;
     const char       *addr  = args[ARG_ADDRESS].str;
+    int               blog  = args[ARG_BACKLOG].i32;
     int               flags = MRP_TRANSPORT_REUSEADDR;
     bool              stream;
 
@@ -1044,7 +1311,7 @@ static int initiate_transport(mrp_plugin_t *plugin)
         return -1;
     }
 
-    if (stream && !mrp_transport_listen(data->listen, 0)) {
+    if (stream && !mrp_transport_listen(data->listen, blog)) {
         mrp_log_error("%s: can't listen for connections", plugin->instance);
         return -1;
     }
@@ -1198,9 +1465,11 @@ static void resource_exit(mrp_plugin_t *plugin)
 
 #define DEF_CONFIG_FILE      "/etc/murphy/resource.conf"
 #define DEF_ADDRESS          NULL
+#define DEF_BACKLOG          0           /* use the system default */
 
 static mrp_plugin_arg_t args[] = {
     MRP_PLUGIN_ARGIDX( ARG_ADDRESS, STRING, "address", DEF_ADDRESS ),
+    MRP_PLUGIN_ARGIDX( ARG_BACKLOG, INT32 , "backlog", DEF_BACKLOG ),
 };
 
 
@@ -899,6 +899,56 @@ static void acquire_resource_set_response(client_t *client, uint32_t seqno,
 }
 
 
+static void probe_resource_set_response(client_t *client, uint32_t seqno,
+                                        mrp_msg_t *msg, void **pcursor)
+{
+    int status;
+    uint32_t rset_id;
+    uint32_t grant, advice;
+    uint16_t tag;
+    uint16_t type;
+    mrp_msg_value_t value;
+    size_t size;
+    size_t i;
+
+    if (!fetch_resource_set_id(msg, pcursor, &rset_id) ||
+        !fetch_status(msg, pcursor, &status))
+        goto malformed;
+
+    if (status) {
+        printf("\nprobing of resource set %u failed. request no %u "
+               "error code %u", rset_id, seqno, status);
+        print_prompt(client, true);
+        return;
+    }
+
+    if (!fetch_resource_set_mask(msg, pcursor, GRANT, &grant) ||
+        !fetch_resource_set_mask(msg, pcursor, ADVICE, &advice) ||
+        !mrp_msg_iterate(msg, pcursor, &tag, &type, &value, &size) ||
+        tag != RESPROTO_PREEMPTED_SET_ID ||
+        type != MRP_MSG_FIELD_ARRAY_OF(UINT32))
+        goto malformed;
+
+    printf("\nProbe of resource set %u (request no %u):\n", rset_id, seqno);
+    printf("   grant mask       : 0x%x\n", grant);
+    printf("   advice mask      : 0x%x\n", advice);
+    printf("   would preempt    :");
+
+    for (i = 0;  i < size;  i++)
+        printf(" %u", value.au32[i]);
+
+    printf("%s\n", size ? "" : " <none>");
+
+    client->prompt = true;
+    print_prompt(client, true);
+
+    return;
+
+ malformed:
+    mrp_log_error("ignoring malformed response to resource set probe");
+}
+
+
 static void resource_event(client_t *client, uint32_t seqno, mrp_msg_t *msg,
                            void **pcursor)
 {
@@ -1035,6 +1085,10 @@ static void recvfrom_msg(mrp_transport_t *transp, mrp_msg_t *msg,
         reqstamp_intermediate(seqno);
         acquire_resource_set_response(client, seqno, false, msg, &cursor);
         break;
+    case RESPROTO_PROBE_RESOURCE_SET:
+        reqstamp_end(seqno);
+        probe_resource_set_response(client, seqno, msg, &cursor);
+        break;
     case RESPROTO_RESOURCES_EVENT:
         reqstamp_end(seqno);
         resource_event(client, seqno, msg, &cursor);
@@ -1450,6 +1504,34 @@ static uint32_t acquire_resource_set(client_t *client, bool acquire)
 #undef PUSH
 }
 
+static uint32_t probe_resource_set(client_t *client)
+{
+#define PUSH(msg, tag, typ, val) \
+    mrp_msg_append(msg, MRP_MSG_TAG_##typ(RESPROTO_##tag, val))
+
+    uint32_t   reqno;
+    mrp_msg_t *req;
+
+    if (!client || client->rset_id == INVALID_ID)
+        return 0;
+
+    req = create_request((reqno = client->seqno++),
+                         RESPROTO_PROBE_RESOURCE_SET);
+
+    if (!PUSH(req, RESOURCE_SET_ID, UINT32, client->rset_id))
+        mrp_msg_unref(req);
+    else {
+        if (client->msgdump)
+            mrp_msg_dump(req, stdout);
+
+        send_message(client, req);
+    }
+
+    return reqno;
+
+#undef PUSH
+}
+
 static void print_prompt(client_t *client, bool startwith_lf)
 {
     if (client && client->prompt) {
@@ -1470,6 +1552,8 @@ static void print_command_help(void)
            "line options\n");
     printf("   release\treleases the resource-set specified by command "
            "line options\n");
+    printf("   probe\tchecks what acquiring the resource-set would "
+           "result in\n");
 }
 
 static void parse_line(client_t *client, char *buf, int len)
@@ -1529,6 +1613,17 @@ static void parse_line(client_t *client, char *buf, int len)
                        client->rset_id, acquire_resource_set(client, false));
             }
         }
+        else if (!strcmp(p, "probe")) {
+            if (client->rset_id == INVALID_ID) {
+                printf("   there is no resource set\n");
+                print_prompt(client, true);
+            }
+            else {
+                client->prompt = false;
+                printf("   probing resource set %u. request no %u\n",
+                       client->rset_id, probe_resource_set(client));
+            }
+        }
         else {
             printf("   unsupported command\n");
             print_prompt(client, true);
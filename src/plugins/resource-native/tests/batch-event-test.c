@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Resource event batching round-trip test.
+ *
+ * Runs the native resource plugin built in, configured with a single zone,
+ * two exclusive resources and two application classes, and connects two
+ * clients to it with the resource client library, both within the same
+ * mainloop. The first client holds both resources in two separate sets.
+ * When the second one acquires both resources, the first client loses
+ * them in a single recalculation, and again regains them in a single one
+ * when they are released. The library asks for batched events, so each
+ * of these changes needs to arrive as a single batch of two events,
+ * decoded into the right state for both sets.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <murphy/common.h>
+#include <murphy/core.h>
+#include <murphy/core/lua-bindings/murphy.h>
+#include <murphy/resource/config-api.h>
+#include <murphy/resource/manager-api.h>
+#include <murphy/resource/protocol.h>
+#include <murphy/plugins/resource-native/libmurphy-resource/resource-api.h>
+
+#define ZONE      "driver"               /* zone the library uses */
+#define PLAYBACK  "audio_playback"
+#define RECORDING "audio_recording"
+#define LOW       "player"               /* low priority class */
+#define HIGH      "phone"                /* high priority class */
+#define TIMEOUT   (10 * 1000)            /* test timeout */
+
+typedef struct {
+    const char             *name;
+    mrp_res_resource_set_t *rset;
+    mrp_res_resource_state_t state;      /* last state reported */
+    int                     nevent;      /* callbacks received */
+} rset_t;
+
+typedef struct {
+    mrp_res_context_t *cx;
+    bool               connected;
+} client_t;
+
+static mrp_context_t *ctx;
+static int            nbatch;            /* batches decoded */
+static uint32_t       maxdim;            /* largest batch decoded */
+
+
+static void res_logger(mrp_log_level_t level, const char *file, int line,
+                       const char *func, const char *format, va_list args)
+{
+    char     buf[256];
+    uint32_t recalc, dim;
+    va_list  ap;
+
+    MRP_UNUSED(file);
+    MRP_UNUSED(line);
+    MRP_UNUSED(func);
+
+    va_copy(ap, args);
+    vsnprintf(buf, sizeof(buf), format, ap);
+    va_end(ap);
+
+    if (sscanf(buf, "Resource event batch (recalculation %u, %u events)",
+               &recalc, &dim) == 2) {
+        nbatch++;
+        if (dim > maxdim)
+            maxdim = dim;
+    }
+
+    if (level != MRP_LOG_INFO)
+        mrp_log_msg(level, file, line, func, "%s", buf);
+}
+
+
+static void state_cb(mrp_res_context_t *cx, mrp_res_error_t err,
+                     void *user_data)
+{
+    client_t *c = (client_t *)user_data;
+
+    MRP_UNUSED(cx);
+
+    if (err != MRP_RES_ERROR_NONE) {
+        mrp_log_error("Resource client error %d.", err);
+        exit(1);
+    }
+
+    c->connected = (cx->state == MRP_RES_CONNECTED);
+}
+
+
+static void rset_cb(mrp_res_context_t *cx, const mrp_res_resource_set_t *rs,
+                    void *user_data)
+{
+    rset_t *r = (rset_t *)user_data;
+
+    MRP_UNUSED(cx);
+
+    r->state = rs->state;
+    r->nevent++;
+}
+
+
+static void timeout_cb(mrp_timer_t *t, void *user_data)
+{
+    MRP_UNUSED(t);
+    MRP_UNUSED(user_data);
+
+    mrp_log_error("Timed out after decoding %d event batches.", nbatch);
+    exit(1);
+}
+
+
+static void setup(void)
+{
+    static const char *resources[] = { PLAYBACK, RECORDING, NULL };
+
+    mrp_plugin_t *plugin;
+    uint32_t      rid;
+    char          addr[64];
+    int           i;
+
+    snprintf(addr, sizeof(addr), "unxs:@murphy-batch-test.%u",
+             (unsigned int)getpid());
+    setenv(RESPROTO_DEFAULT_ADDRVAR, addr, 1);
+
+    if ((ctx = mrp_context_create()) == NULL ||
+        mrp_lua_set_murphy_context(ctx) == NULL) {
+        mrp_log_error("Failed to create murphy context.");
+        exit(1);
+    }
+
+    mrp_resource_configuration_init();
+
+    if (mrp_zone_definition_create(NULL) < 0 ||
+        mrp_zone_create(ZONE, NULL) == MRP_ZONE_ID_INVALID) {
+        mrp_log_error("Failed to create zone '%s'.", ZONE);
+        exit(1);
+    }
+
+    for (i = 0; resources[i] != NULL; i++) {
+        rid = mrp_resource_definition_create(resources[i], false, NULL,
+                                             NULL, NULL);
+
+        if (rid == MRP_RESOURCE_ID_INVALID) {
+            mrp_log_error("Failed to create resource '%s'.", resources[i]);
+            exit(1);
+        }
+
+        mrp_lua_resclass_create_from_c(rid);
+    }
+
+    if (!mrp_application_class_create(LOW, 1, false, false,
+                                      MRP_RESOURCE_ORDER_FIFO) ||
+        !mrp_application_class_create(HIGH, 2, false, false,
+                                      MRP_RESOURCE_ORDER_FIFO)) {
+        mrp_log_error("Failed to create application classes.");
+        exit(1);
+    }
+
+    plugin = mrp_load_plugin(ctx, "resource", NULL, NULL, 0);
+
+    if (plugin == NULL || mrp_start_plugins(ctx) < 0) {
+        mrp_log_error("Failed to start the native resource plugin.");
+        exit(1);
+    }
+}
+
+
+static void connect_client(client_t *c)
+{
+    mrp_clear(c);
+
+    if ((c->cx = mrp_res_create(ctx->ml, state_cb, c)) == NULL) {
+        mrp_log_error("Failed to create resource client context.");
+        exit(1);
+    }
+
+    while (!c->connected)
+        mrp_mainloop_iterate(ctx->ml);
+}
+
+
+static void create_rset(rset_t *r, client_t *c, const char *class,
+                        const char **resources)
+{
+    int i;
+
+    r->rset = mrp_res_create_resource_set(c->cx, class, rset_cb, r);
+
+    if (r->rset == NULL) {
+        mrp_log_error("Failed to create %s resource set.", r->name);
+        exit(1);
+    }
+
+    for (i = 0; resources[i] != NULL; i++) {
+        if (!mrp_res_create_resource(r->rset, resources[i], true, false)) {
+            mrp_log_error("Failed to add %s to %s.", resources[i], r->name);
+            exit(1);
+        }
+    }
+}
+
+
+static void wait_state(rset_t *r, mrp_res_resource_state_t state)
+{
+    while (r->state != state)
+        mrp_mainloop_iterate(ctx->ml);
+}
+
+
+int main(int argc, char *argv[])
+{
+    static const char *playback[]  = { PLAYBACK, NULL };
+    static const char *recording[] = { RECORDING, NULL };
+    static const char *both[]      = { PLAYBACK, RECORDING, NULL };
+
+    client_t low, high;
+    rset_t   play = { .name = "playback"  };
+    rset_t   rec  = { .name = "recording" };
+    rset_t   call = { .name = "call"      };
+    int      failed, n;
+
+    MRP_UNUSED(argc);
+    MRP_UNUSED(argv);
+
+    mrp_log_set_mask(MRP_LOG_UPTO(MRP_LOG_INFO));
+    mrp_res_set_logger(res_logger);
+
+    setup();
+
+    mrp_add_timer(ctx->ml, TIMEOUT, timeout_cb, NULL);
+    failed = 0;
+
+    connect_client(&low);
+    connect_client(&high);
+
+    create_rset(&play, &low, LOW, playback);
+    create_rset(&rec, &low, LOW, recording);
+    create_rset(&call, &high, HIGH, both);
+
+    mrp_res_acquire_resource_set(play.rset);
+    mrp_res_acquire_resource_set(rec.rset);
+
+    wait_state(&play, MRP_RES_RESOURCE_ACQUIRED);
+    wait_state(&rec, MRP_RES_RESOURCE_ACQUIRED);
+
+    /* preempt both sets of the low priority client at once */
+    n      = nbatch;
+    maxdim = 0;
+
+    mrp_res_acquire_resource_set(call.rset);
+
+    wait_state(&call, MRP_RES_RESOURCE_ACQUIRED);
+    wait_state(&play, MRP_RES_RESOURCE_LOST);
+    wait_state(&rec, MRP_RES_RESOURCE_LOST);
+
+    if (maxdim != 2) {
+        mrp_log_error("Preemption decoded in batches of up to %u events.",
+                      maxdim);
+        failed++;
+    }
+
+    mrp_log_info("preemption: %d batches, largest with %u events",
+                 nbatch - n, maxdim);
+
+    /* and let them have the resources back at once */
+    n      = nbatch;
+    maxdim = 0;
+
+    mrp_res_release_resource_set(call.rset);
+
+    wait_state(&play, MRP_RES_RESOURCE_ACQUIRED);
+    wait_state(&rec, MRP_RES_RESOURCE_ACQUIRED);
+
+    if (maxdim != 2) {
+        mrp_log_error("Regrant decoded in batches of up to %u events.",
+                      maxdim);
+        failed++;
+    }
+
+    mrp_log_info("regrant: %d batches, largest with %u events",
+                 nbatch - n, maxdim);
+
+    mrp_res_delete_resource_set(call.rset);
+    mrp_res_delete_resource_set(rec.rset);
+    mrp_res_delete_resource_set(play.rset);
+    mrp_res_destroy(high.cx);
+    mrp_res_destroy(low.cx);
+
+    return failed ? 1 : 0;
+}
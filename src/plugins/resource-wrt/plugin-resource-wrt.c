@@ -57,6 +57,7 @@
 
 #define DEFAULT_ADDRESS "wsck:127.0.0.1:4000/murphy"
 #define ATTRIBUTE_MAX   MRP_ATTRIBUTE_MAX
+#define PREEMPT_MAX     64
 
 /*
  * plugin argument indices
@@ -969,6 +970,62 @@ static void release_set(wrt_client_t *c, mrp_json_t *req)
 }
 
 
+static void probe_set(wrt_client_t *c, mrp_json_t *req)
+{
+    const char          *type = RESWRT_PROBE_SET;
+    int                  seq;
+    mrp_json_t          *reply;
+    mrp_resource_set_t  *rset;
+    uint32_t             rsid;
+    mrp_resource_mask_t  grant, advice;
+    uint32_t             preempted[PREEMPT_MAX];
+    int                  n;
+
+    if (!mrp_json_get_integer(req, "seq", &seq)) {
+        ignore_invalid_request(c, req, "missing 'seq' field");
+        return;
+    }
+
+    /* get resource set id */
+    if (!mrp_json_get_integer(req, "id", &rsid)) {
+        error_reply(c, type, seq, EINVAL, "missing id");
+        return;
+    }
+
+    rset = mrp_resource_client_find_set(c->rsc, rsid);
+
+    if (rset == NULL) {
+        error_reply(c, type, seq, ENOENT, "resource set %d not found", rsid);
+        return;
+    }
+
+    n = mrp_resource_set_probe_acquire(rset, &grant, &advice,
+                                       preempted, PREEMPT_MAX);
+
+    if (n < 0) {
+        error_reply(c, type, seq, EINVAL, "failed to probe resource set %d",
+                    rsid);
+        return;
+    }
+
+    if (n > PREEMPT_MAX)
+        n = PREEMPT_MAX;
+
+    reply = alloc_reply(type, seq);
+
+    if (reply != NULL) {
+        if (mrp_json_add_integer  (reply, "status"   , 0            ) &&
+            mrp_json_add_integer  (reply, "id"       , (int)rsid    ) &&
+            mrp_json_add_integer  (reply, "grant"    , (int)grant   ) &&
+            mrp_json_add_integer  (reply, "advice"   , (int)advice  ) &&
+            mrp_json_add_int_array(reply, "preempted", preempted, n))
+            send_message(c, reply);
+
+        mrp_json_unref(reply);
+    }
+}
+
+
 static wrt_client_t *create_client(wrt_data_t *data, mrp_transport_t *lt)
 {
     wrt_client_t *c;
@@ -1098,6 +1155,8 @@ static void recv_evt(mrp_transport_t *t, void *data, void *user_data)
             acquire_set(c, req);
         else if (!strcmp(type, RESWRT_RELEASE_SET))
             release_set(c, req);
+        else if (!strcmp(type, RESWRT_PROBE_SET))
+            probe_set(c, req);
         else
             ignore_unknown_request(c, req, type);
     }
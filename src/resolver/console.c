@@ -1,3 +1,6 @@
+#include <errno.h>
+#include <string.h>
+
 #include <murphy/core/console.h>
 #include <murphy/resolver/resolver.h>
 #include <murphy/resolver/target.h>
@@ -29,6 +32,36 @@ static void dot(mrp_console_t *c, void *user_data, int argc, char **argv)
     }
 }
 
+
+static void reload(mrp_console_t *c, void *user_data, int argc, char **argv)
+{
+    mrp_context_t  *ctx = c->ctx;
+    mrp_resolver_t *r;
+    int             error;
+
+    MRP_UNUSED(user_data);
+    MRP_UNUSED(argc);
+    MRP_UNUSED(argv);
+
+    if (ctx->r == NULL || ctx->resolver_ruleset == NULL) {
+        fprintf(c->stdout, "No resolver ruleset to reload.\n");
+        return;
+    }
+
+    r     = mrp_resolver_reload(ctx->r, ctx->resolver_ruleset);
+    error = errno;
+
+    if (r != NULL) {
+        ctx->r = r;
+        fprintf(c->stdout, "Reloaded resolver ruleset '%s'.\n",
+                ctx->resolver_ruleset);
+    }
+    else
+        fprintf(c->stdout, "Failed to reload resolver ruleset '%s' (%d: %s), "
+                "keeping the old one.\n", ctx->resolver_ruleset,
+                error, strerror(error));
+}
+
 #define RESOLVER_DESCRIPTION                                              \
     "Resolver commands provide runtime diagnostics and debugging for\n"   \
     "the Murphy resolver.\n"
@@ -43,9 +76,19 @@ static void dot(mrp_console_t *c, void *user_data, int argc, char **argv)
 #define DOT_DESCRIPTION                        \
     "Dump the resolver facts and targets in DOT format.\n"
 
+#define RELOAD_SYNTAX  "reload"
+#define RELOAD_SUMMARY "reload the resolver ruleset"
+#define RELOAD_DESCRIPTION                                                \
+    "Reload the resolver ruleset from its configured path. The new\n"    \
+    "ruleset is parsed and prepared before it replaces the active one.\n" \
+    "If this fails, the active ruleset is left intact. Use 'lua reload'\n" \
+    "to reload the Lua configuration.\n"
+
 MRP_CORE_CONSOLE_GROUP(resolver_group, "resolver", RESOLVER_DESCRIPTION, NULL, {
         MRP_TOKENIZED_CMD("dump", dump, FALSE,
                           DUMP_SYNTAX, DUMP_SUMMARY, DUMP_DESCRIPTION),
         MRP_TOKENIZED_CMD("dot", dot, FALSE,
                           DOT_SYNTAX, DOT_SUMMARY, DOT_DESCRIPTION),
+        MRP_TOKENIZED_CMD("reload", reload, FALSE,
+                          RELOAD_SYNTAX, RELOAD_SUMMARY, RELOAD_DESCRIPTION),
 });
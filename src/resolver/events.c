@@ -36,7 +36,8 @@
 MRP_REGISTER_EVENTS(events,
              MRP_EVENT(MRP_RESOLVER_EVENT_STARTED, RESOLVER_UPDATE_STARTED),
              MRP_EVENT(MRP_RESOLVER_EVENT_FAILED , RESOLVER_UPDATE_FAILED ),
-             MRP_EVENT(MRP_RESOLVER_EVENT_DONE   , RESOLVER_UPDATE_DONE   ));
+             MRP_EVENT(MRP_RESOLVER_EVENT_DONE   , RESOLVER_UPDATE_DONE   ),
+             MRP_EVENT(MRP_RESOLVER_EVENT_RELOAD , RESOLVER_RELOADED      ));
 
 
 int emit_resolver_event(mrp_resolver_t *r, int event, const char *target,
@@ -50,3 +51,12 @@ int emit_resolver_event(mrp_resolver_t *r, int event, const char *target,
                               MRP_MSG_TAG_STRING(ttarget, target),
                               MRP_MSG_TAG_UINT32(tlevel , level));
 }
+
+
+int emit_resolver_reload_event(mrp_resolver_t *r)
+{
+    int flags = MRP_EVENT_SYNCHRONOUS;
+
+    return mrp_event_emit_msg(r->bus, events[RESOLVER_RELOADED].id, flags,
+                              MRP_MSG_END);
+}
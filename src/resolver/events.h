@@ -37,12 +37,14 @@
 enum {
     RESOLVER_UPDATE_STARTED = 0,
     RESOLVER_UPDATE_FAILED,
-    RESOLVER_UPDATE_DONE
+    RESOLVER_UPDATE_DONE,
+    RESOLVER_RELOADED
 };
 
 
 int emit_resolver_event(mrp_resolver_t *r, int event, const char *target,
                         int level);
+int emit_resolver_reload_event(mrp_resolver_t *r);
 
 
 #endif /* __MURPHY_RESOLVER_EVENTS_H__ */
@@ -39,8 +39,11 @@
 #include "target.h"
 #include "target-sorter.h"
 #include "fact.h"
+#include "events.h"
 #include "resolver.h"
 
+static void release_precompiled_scripts(mrp_resolver_t *r);
+
 
 mrp_resolver_t *mrp_resolver_create(mrp_context_t *ctx)
 {
@@ -113,6 +116,117 @@ void mrp_resolver_destroy(mrp_resolver_t *r)
 }
 
 
+mrp_resolver_t *mrp_resolver_reload(mrp_resolver_t *r, const char *path)
+{
+    mrp_resolver_t  *nr;
+    mrp_scriptlet_t *s;
+    target_t        *t;
+    const char      *auto_update;
+    int              i, error;
+
+    if (r == NULL || path == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (r->level > 0) {
+        mrp_log_error("Can't reload resolver ruleset during an update.");
+        errno = EBUSY;
+        return NULL;
+    }
+
+    errno = 0;
+    nr    = mrp_resolver_parse(NULL, r->ctx, path);
+
+    if (nr == NULL) {
+        error = errno ? errno : EINVAL;
+        mrp_log_error("Failed to parse resolver ruleset '%s'.", path);
+        errno = error;
+        return NULL;
+    }
+
+    errno = 0;
+
+    for (i = 0, t = r->targets; i < r->ntarget; i++, t++) {
+        if (!t->precompiled)
+            continue;
+
+        s = t->script;
+
+        if (!mrp_resolver_add_prepared_target(nr, t->name,
+                                              (const char **)t->depends,
+                                              t->ndepend,
+                                              s ? s->interpreter : NULL,
+                                              s ? s->compiled    : NULL,
+                                              s ? s->data        : NULL)) {
+            error = errno;
+            mrp_log_error("Failed to carry over resolver target '%s'.",
+                          t->name);
+            goto fail;
+        }
+    }
+
+    if (sort_targets(nr) != 0 || prepare_target_scripts(nr) != 0) {
+        error = errno;
+        mrp_log_error("Failed to prepare reloaded resolver ruleset.");
+        goto fail;
+    }
+
+    auto_update = r->auto_update ? r->auto_update->name : NULL;
+
+    if (auto_update != NULL && nr->auto_update == NULL) {
+        if (!generate_autoupdate_target(nr, auto_update)) {
+            error = errno;
+            mrp_log_error("Failed to enable resolver autoupdate.");
+            goto fail;
+        }
+    }
+
+    /* the precompiled scripts are owned by the new context from now on */
+    release_precompiled_scripts(r);
+
+    /* don't let reload event handlers see the destroyed context */
+    if (r->ctx != NULL && r->ctx->r == r)
+        r->ctx->r = nr;
+
+    mrp_resolver_destroy(r);
+
+    mrp_log_info("Reloaded resolver ruleset '%s'.", path);
+
+    emit_resolver_reload_event(nr);
+    schedule_target_autoupdate(nr);
+
+    return nr;
+
+ fail:
+    release_precompiled_scripts(nr);
+    mrp_resolver_destroy(nr);
+    errno = error ? error : EINVAL;
+
+    return NULL;
+}
+
+
+static void release_precompiled_scripts(mrp_resolver_t *r)
+{
+    target_t *t;
+    int       i;
+
+    /*
+     * Precompiled targets of the old and the new context share their
+     * interpreter data. Free only the scriptlet of one of them without
+     * invoking the interpreter cleanup, so the shared data stays alive.
+     */
+
+    for (i = 0, t = r->targets; i < r->ntarget; i++, t++) {
+        if (t->precompiled) {
+            mrp_free(t->script);
+            t->script = NULL;
+        }
+    }
+}
+
+
 int mrp_resolver_add_target(mrp_resolver_t *r, const char *target,
                             const char **depend, int ndepend,
                             const char *script_type,
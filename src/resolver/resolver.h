@@ -50,6 +50,7 @@ MRP_CDECL_BEGIN
 #define MRP_RESOLVER_EVENT_STARTED "resolver-update-start"
 #define MRP_RESOLVER_EVENT_FAILED  "resolver-update-failed"
 #define MRP_RESOLVER_EVENT_DONE    "resolver-update-done"
+#define MRP_RESOLVER_EVENT_RELOAD  "resolver-reloaded"
 
 #define MRP_RESOLVER_TAG_TARGET ((uint16_t)1)
 #define MRP_RESOLVER_TAG_LEVEL  ((uint16_t)2)
@@ -83,6 +84,15 @@ int mrp_resolver_enable_autoupdate(mrp_resolver_t *r, const char *name);
 /** Destroy the given resolver context, freeing all associated resources. */
 void mrp_resolver_destroy(mrp_resolver_t *r);
 
+/** Reload the ruleset of the given resolver context from path. A new
+    context is built and prepared from path and the precompiled targets of
+    r (the ones installed by Lua decision elements, sinks, etc.). If this
+    succeeds r is destroyed, the murphy context is switched over to the new
+    context if it was using r, and the new context is returned. Otherwise
+    NULL is returned with errno set and r is left intact. Only the ruleset
+    is reloaded, use mrp_lua_reload_config() for the Lua configuration. */
+mrp_resolver_t *mrp_resolver_reload(mrp_resolver_t *r, const char *path);
+
 /** Prepare the targets for resolution (link scriptlets, etc.). */
 int mrp_resolver_prepare(mrp_resolver_t *r);
 
@@ -0,0 +1,450 @@
+/*
+ * Copyright (c) 2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Resolver ruleset and Lua configuration reload test.
+ *
+ * Parses a ruleset, then reloads it first from a modified and then from
+ * a broken and a missing file. The modified ruleset must replace the old
+ * one, and the murphy context must already point to it when the single
+ * reload event is emitted. The failed reloads must leave the active
+ * ruleset intact, set errno and emit no events.
+ *
+ * Then loads a Lua configuration with a decision element and reloads it
+ * with a modified update function. The new function must only take
+ * effect once the reload is committed, a discarded reload must keep the
+ * old one. A configuration adding a new element must be rejected.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <lualib.h>
+#include <lauxlib.h>
+
+#include <murphy/common.h>
+#include <murphy-db/mqi.h>
+#include <murphy/core/context.h>
+#include <murphy/core/lua-utils/budget.h>
+#include <murphy/core/lua-bindings/murphy.h>
+#include <murphy/resolver/resolver.h>
+
+static int nreload;
+static int nluareload;
+static int nstale;
+
+
+static const char *ruleset_v1 =
+    "target all\n"
+    "    depends on first\n"
+    "\n"
+    "target first\n";
+
+static const char *ruleset_v2 =
+    "target all\n"
+    "    depends on first second\n"
+    "\n"
+    "target first\n"
+    "\n"
+    "target second\n";
+
+static const char *ruleset_broken =
+    "target all\n"
+    "    depends on\n"
+    "target\n";
+
+#define LUA_TABLES                                                      \
+    "mdb.table { name = 'reload_in', index = { 'id' }, create = true,\n"  \
+    "            columns = { { 'id', mdb.unsigned } } }\n"               \
+    "mdb.table { name = 'reload_out', index = { 'id' }, create = true,\n" \
+    "            columns = { { 'id', mdb.unsigned } } }\n"               \
+    "mdb.select { name = 'reload_sel', table = 'reload_in',\n"           \
+    "             columns = { 'id' } }\n"
+
+#define LUA_ELEMENT(_name, _version)                                    \
+    "element.lua { name = '" _name "',\n"                               \
+    "              inputs = { sel = mdb.select.reload_sel },\n"         \
+    "              outputs = { mdb.table.reload_out },\n"               \
+    "              update = function(self) version = " _version " end }\n"
+
+static const char *config_v1 =
+    LUA_TABLES
+    LUA_ELEMENT("reload_element", "1");
+
+static const char *config_v2 =
+    LUA_TABLES
+    LUA_ELEMENT("reload_element", "2");
+
+static const char *config_extended =
+    LUA_TABLES
+    LUA_ELEMENT("reload_element", "3")
+    LUA_ELEMENT("reload_new", "3");
+
+
+static void write_file(const char *path, const char *content)
+{
+    FILE *fp;
+
+    if ((fp = fopen(path, "w")) == NULL ||
+        fputs(content, fp) < 0 || fclose(fp) != 0) {
+        mrp_log_error("Failed to write '%s' (%d: %s).", path,
+                      errno, strerror(errno));
+        exit(1);
+    }
+}
+
+
+static int has_target(mrp_resolver_t *r, const char *name)
+{
+    char   *buf, pattern[128];
+    size_t  size;
+    FILE   *fp;
+    int     found;
+
+    buf  = NULL;
+    size = 0;
+
+    if ((fp = open_memstream(&buf, &size)) == NULL) {
+        mrp_log_error("Failed to open memory stream.");
+        exit(1);
+    }
+
+    mrp_resolver_dump_targets(r, fp);
+    fclose(fp);
+
+    snprintf(pattern, sizeof(pattern), ": %s (@", name);
+    found = (buf != NULL && strstr(buf, pattern) != NULL);
+
+    free(buf);
+
+    return found;
+}
+
+
+static void reload_cb(mrp_event_watch_t *w, uint32_t id, int format,
+                      void *data, void *user_data)
+{
+    mrp_context_t *ctx = (mrp_context_t *)user_data;
+
+    MRP_UNUSED(w);
+    MRP_UNUSED(id);
+    MRP_UNUSED(format);
+    MRP_UNUSED(data);
+
+    /* the context must already point to the reloaded ruleset */
+    if (!has_target(ctx->r, "second"))
+        nstale++;
+
+    nreload++;
+}
+
+
+static void lua_reload_cb(mrp_event_watch_t *w, uint32_t id, int format,
+                          void *data, void *user_data)
+{
+    MRP_UNUSED(w);
+    MRP_UNUSED(id);
+    MRP_UNUSED(format);
+    MRP_UNUSED(data);
+    MRP_UNUSED(user_data);
+
+    nluareload++;
+}
+
+
+static int element_version(mrp_context_t *ctx, lua_State *L)
+{
+    static int serial;
+    char       insert[128];
+    int        version;
+
+    /* change the input table, or the element won't be updated */
+    snprintf(insert, sizeof(insert),
+             "version = nil\n"
+             "mdb.table.reload_in:insert({ id = %d })\n", ++serial);
+
+    if (luaL_dostring(L, insert) != 0) {
+        mrp_log_error("Failed to update the element input (%s).",
+                      lua_tostring(L, -1));
+        lua_pop(L, 1);
+        return -1;
+    }
+
+    if (!mrp_resolver_update_targetl(ctx->r, "_table_reload_out", NULL)) {
+        mrp_log_error("Failed to update the element target.");
+        return -1;
+    }
+
+    lua_getglobal(L, "version");
+    version = lua_isnumber(L, -1) ? lua_tointeger(L, -1) : -1;
+    lua_pop(L, 1);
+
+    return version;
+}
+
+
+static int test_ruleset_reload(mrp_context_t *ctx, const char *path)
+{
+    mrp_resolver_t *nr;
+    char            missing[256];
+    int             failed = 0;
+
+    snprintf(missing, sizeof(missing), "%s.missing", path);
+
+    if (!has_target(ctx->r, "first") || has_target(ctx->r, "second")) {
+        mrp_log_error("Unexpected targets in initial ruleset.");
+        failed++;
+    }
+
+    /* a valid modified ruleset replaces the active one */
+    write_file(path, ruleset_v2);
+    nr = mrp_resolver_reload(ctx->r, path);
+
+    if (nr == NULL) {
+        mrp_log_error("Failed to reload modified ruleset (%d: %s).",
+                      errno, strerror(errno));
+        return failed + 1;
+    }
+
+    if (ctx->r != nr) {
+        mrp_log_error("Context not switched to the reloaded ruleset.");
+        failed++;
+    }
+
+    ctx->r = nr;
+
+    if (!has_target(ctx->r, "second")) {
+        mrp_log_error("Reloaded ruleset lacks new target.");
+        failed++;
+    }
+
+    if (!has_target(ctx->r, "_table_reload_out")) {
+        mrp_log_error("Element target not carried over to new ruleset.");
+        failed++;
+    }
+
+    if (nreload != 1 || nstale != 0) {
+        mrp_log_error("%d reload events (%d stale) instead of 1.",
+                      nreload, nstale);
+        failed++;
+    }
+
+    /* a broken ruleset is rejected, the active one is kept */
+    write_file(path, ruleset_broken);
+    nr = mrp_resolver_reload(ctx->r, path);
+
+    if (nr != NULL || errno == 0) {
+        mrp_log_error("Broken ruleset accepted or errno not set.");
+        failed++;
+    }
+
+    /* so is a missing one */
+    nr = mrp_resolver_reload(ctx->r, missing);
+
+    if (nr != NULL || errno == 0) {
+        mrp_log_error("Missing ruleset accepted or errno not set.");
+        failed++;
+    }
+
+    if (!has_target(ctx->r, "first") || !has_target(ctx->r, "second")) {
+        mrp_log_error("Active ruleset damaged by failed reload.");
+        failed++;
+    }
+
+    if (nreload != 1) {
+        mrp_log_error("%d reload events instead of 1.", nreload);
+        failed++;
+    }
+
+    return failed;
+}
+
+
+static int test_lua_reload(mrp_context_t *ctx, lua_State *L,
+                           const char *path)
+{
+    int version, failed = 0;
+
+    if ((version = element_version(ctx, L)) != 1) {
+        mrp_log_error("Initial element version %d instead of 1.", version);
+        failed++;
+    }
+
+    /* a reload is staged until it is finished */
+    write_file(path, config_v2);
+
+    if (mrp_lua_reload_config() < 0) {
+        mrp_log_error("Failed to reload Lua configuration (%d: %s).",
+                      errno, strerror(errno));
+        return failed + 1;
+    }
+
+    if ((version = element_version(ctx, L)) != 1) {
+        mrp_log_error("Staged element update already active (%d).", version);
+        failed++;
+    }
+
+    /* a discarded reload keeps the old update function */
+    mrp_lua_finish_reload(FALSE);
+
+    if ((version = element_version(ctx, L)) != 1) {
+        mrp_log_error("Discarded element update active (%d).", version);
+        failed++;
+    }
+
+    /* a committed one switches to the new function */
+    if (mrp_lua_reload_config() < 0) {
+        mrp_log_error("Failed to reload Lua configuration (%d: %s).",
+                      errno, strerror(errno));
+        return failed + 1;
+    }
+
+    mrp_lua_finish_reload(TRUE);
+
+    if ((version = element_version(ctx, L)) != 2) {
+        mrp_log_error("Element version %d instead of 2 after reload.",
+                      version);
+        failed++;
+    }
+
+    /* a configuration adding a new element is rejected as a whole */
+    write_file(path, config_extended);
+
+    if (mrp_lua_reload_config() == 0 || errno == 0) {
+        mrp_log_error("Reload adding a new element accepted.");
+        mrp_lua_finish_reload(FALSE);
+        failed++;
+    }
+
+    if ((version = element_version(ctx, L)) != 2) {
+        mrp_log_error("Element version %d instead of 2 after failed reload.",
+                      version);
+        failed++;
+    }
+
+    if (nluareload != 1) {
+        mrp_log_error("%d Lua reload events instead of 1.", nluareload);
+        failed++;
+    }
+
+    return failed;
+}
+
+
+int main(int argc, char *argv[])
+{
+    mrp_context_t   *ctx;
+    mrp_event_bus_t *bus;
+    lua_State       *L;
+    char             path[] = "/tmp/resolver-reload-XXXXXX";
+    char             config[] = "/tmp/lua-reload-XXXXXX";
+    int              fd, failed;
+
+    MRP_UNUSED(argc);
+    MRP_UNUSED(argv);
+
+    mrp_log_set_mask(MRP_LOG_UPTO(MRP_LOG_INFO));
+
+    if ((ctx = mrp_context_create()) == NULL) {
+        mrp_log_error("Failed to create murphy context.");
+        exit(1);
+    }
+
+    bus = mrp_event_bus_get(ctx->ml, MRP_RESOLVER_BUS);
+
+    if (bus == NULL ||
+        !mrp_event_add_watch(bus, mrp_event_id(MRP_RESOLVER_EVENT_RELOAD),
+                             reload_cb, ctx)) {
+        mrp_log_error("Failed to watch for resolver reload events.");
+        exit(1);
+    }
+
+    bus = mrp_event_bus_get(ctx->ml, MRP_LUA_BUS);
+
+    if (bus == NULL ||
+        !mrp_event_add_watch(bus, mrp_event_id(MRP_LUA_EVENT_RELOAD),
+                             lua_reload_cb, NULL)) {
+        mrp_log_error("Failed to watch for Lua reload events.");
+        exit(1);
+    }
+
+    if ((fd = mkstemp(path)) < 0) {
+        mrp_log_error("Failed to create temporary ruleset.");
+        exit(1);
+    }
+
+    close(fd);
+
+    if ((fd = mkstemp(config)) < 0) {
+        mrp_log_error("Failed to create temporary Lua configuration.");
+        unlink(path);
+        exit(1);
+    }
+
+    close(fd);
+
+    write_file(path, ruleset_v1);
+    write_file(config, config_v1);
+
+    if ((ctx->r = mrp_resolver_parse(NULL, ctx, path)) == NULL) {
+        mrp_log_error("Failed to parse initial ruleset.");
+        failed = 1;
+        goto out;
+    }
+
+    if (mqi_open() < 0 || (L = mrp_lua_set_murphy_context(ctx)) == NULL) {
+        mrp_log_error("Failed to set up Lua.");
+        failed = 1;
+        goto out;
+    }
+
+    mrp_lua_set_murphy_lua_config_file(config);
+
+    if (luaL_loadfile(L, config) || mrp_lua_pcall(L, 0, 0, 0)) {
+        mrp_log_error("Failed to load Lua configuration (%s).",
+                      lua_tostring(L, -1));
+        failed = 1;
+        goto out;
+    }
+
+    failed  = test_ruleset_reload(ctx, path);
+    failed += test_lua_reload(ctx, L, config);
+
+    if (!failed)
+        mrp_log_info("Resolver and Lua reload test passed.");
+
+ out:
+    unlink(path);
+    unlink(config);
+
+    return failed ? 1 : 0;
+}
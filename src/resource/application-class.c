@@ -100,6 +100,8 @@ static int  add_to_name_hash(mrp_application_class_t *);
 static void remove_from_name_hash(mrp_application_class_t *);
 #endif
 
+static uint32_t make_sorting_key(mrp_resource_set_t *, bool, uint32_t);
+
 static mqi_handle_t get_database_table(void);
 static void insert_into_application_class_table(const char *, uint32_t);
 
@@ -170,6 +172,14 @@ mrp_application_class_t *mrp_application_class_create(const char *name,
 }
 
 
+void mrp_application_class_set_grace(mrp_application_class_t *class,
+                                     uint32_t msecs)
+{
+    MRP_ASSERT(class, "invalid argument");
+
+    class->grace = msecs;
+}
+
 mrp_application_class_t *mrp_application_class_find(const char *name)
 {
     mrp_application_class_t *class = NULL;
@@ -338,33 +348,22 @@ void mrp_application_class_move_resource_set(mrp_resource_set_t *rset)
 
 uint32_t mrp_application_class_get_sorting_key(mrp_resource_set_t *rset)
 {
-    mrp_application_class_t *class;
-    bool     lifo;
-    uint32_t rqstamp;
-    uint32_t priority;
-    uint32_t usage;
-    uint32_t state;
-    uint32_t stamp;
-    uint32_t key;
-
     MRP_ASSERT(rset, "invalid argument");
 
-    class = rset->class.ptr;
-    lifo  = (class->order == MRP_RESOURCE_ORDER_LIFO);
-
-    rqstamp  = rset->request.stamp;
+    return make_sorting_key(rset, rset->state == mrp_resource_acquire,
+                            rset->request.stamp);
+}
 
-    priority = PRIORITY_KEY(rset->class.priority);
-    usage    = USAGE_KEY(rset->resource.share ? 1 : 0);
-    state    = STATE_KEY(rset->state == mrp_resource_acquire ? 1 : 0);
-    stamp    = STAMP_KEY(lifo ? rqstamp : STAMP_MAX - rqstamp);
+uint32_t mrp_application_class_get_acquire_key(mrp_resource_set_t *rset)
+{
+    /* the key rset would get if it was acquired right now, ie.
+       in acquiring state and with the most recent request stamp */
 
-    key = priority | usage | state | stamp;
+    MRP_ASSERT(rset, "invalid argument");
 
-    return key;
+    return make_sorting_key(rset, true, STAMP_MAX);
 }
 
-
 int mrp_application_class_print(char *buf, int len, bool with_rsets)
 {
 #define PRINT(fmt, args...) \
@@ -412,6 +411,8 @@ int mrp_application_class_print(char *buf, int len, bool with_rsets)
             PRINT(" modal");
         if (class->share)
             PRINT(" share");
+        if (class->grace)
+            PRINT(" grace=%ums", class->grace);
 
         PRINT("\n");
 
@@ -449,14 +450,39 @@ int mrp_application_class_print(char *buf, int len, bool with_rsets)
 }
 
 
+static uint32_t make_sorting_key(mrp_resource_set_t *rset,
+                                 bool acquire,
+                                 uint32_t rqstamp)
+{
+    mrp_application_class_t *class;
+    bool     lifo;
+    uint32_t priority;
+    uint32_t usage;
+    uint32_t state;
+    uint32_t stamp;
+    uint32_t key;
+
+    class = rset->class.ptr;
+    lifo  = (class->order == MRP_RESOURCE_ORDER_LIFO);
+
+    priority = PRIORITY_KEY(rset->class.priority);
+    usage    = USAGE_KEY(rset->resource.share ? 1 : 0);
+    state    = STATE_KEY(acquire ? 1 : 0);
+    stamp    = STAMP_KEY(lifo ? rqstamp : STAMP_MAX - rqstamp);
+
+    key = priority | usage | state | stamp;
+
+    return key;
+}
+
 static void init_name_hash(void)
 {
     mrp_htbl_config_t  cfg;
 
     if (!name_hash) {
         cfg.nentry  = CLASS_MAX;
-        cfg.comp    = mrp_string_comp;
-        cfg.hash    = mrp_string_hash;
+        cfg.comp    = mrp_string_casecomp;
+        cfg.hash    = mrp_string_casehash;
         cfg.free    = NULL;
         cfg.nbucket = cfg.nentry / 2;
 
@@ -43,6 +43,7 @@ struct mrp_application_class_s {
     bool                  share;
     bool                  modal;
     mrp_resource_order_t  order;
+    uint32_t              grace;  /* loss hold-down in ms, 0 if none */
     mrp_list_hook_t       resource_sets[MRP_ZONE_MAX];
 };
 
@@ -54,6 +55,7 @@ mrp_application_class_iterate_rsets(mrp_application_class_t*,uint32_t,void**);
 void mrp_application_class_move_resource_set(mrp_resource_set_t *);
 
 uint32_t mrp_application_class_get_sorting_key(mrp_resource_set_t *);
+uint32_t mrp_application_class_get_acquire_key(mrp_resource_set_t *);
 
 
 #endif  /* __MURPHY_APPLICATION_CLASS_H__ */
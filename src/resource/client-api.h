@@ -39,6 +39,11 @@ void mrp_resource_client_destroy(mrp_resource_client_t *client);
 mrp_resource_set_t *mrp_resource_client_find_set(mrp_resource_client_t *client,
                                                  uint32_t resource_set_id);
 
+void mrp_resource_client_set_flush_callback(mrp_resource_client_t *client,
+                                            mrp_resource_flush_cb_t flush_cb);
+bool mrp_resource_client_queue_flush(mrp_resource_client_t *client);
+uint32_t mrp_resource_client_get_recalc_seqno(void);
+
 
 const char **mrp_zone_get_all_names(uint32_t buflen, const char **buf);
 
@@ -111,6 +116,17 @@ void mrp_resource_set_acquire(mrp_resource_set_t *resource_set,
 void mrp_resource_set_release(mrp_resource_set_t *resource_set,
                               uint32_t request_id);
 
+/* Evaluate what acquiring the set would result in without acquiring it.
+ * The would-be grant and advice are returned in grant and advice and the
+ * ids of the resource sets that would lose granted resources are stored
+ * in preempted. Returns the number of such sets (which can be larger than
+ * npreempted) or -1 if the set is not in any application class. */
+int mrp_resource_set_probe_acquire(mrp_resource_set_t *resource_set,
+                                   mrp_resource_mask_t *grant,
+                                   mrp_resource_mask_t *advice,
+                                   uint32_t *preempted,
+                                   uint32_t npreempted);
+
 mrp_resource_t *
 mrp_resource_set_iterate_resources(mrp_resource_set_t *resource_set,void **it);
 
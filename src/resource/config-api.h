@@ -43,10 +43,20 @@ mrp_application_class_t *mrp_application_class_create(const char *name,
                                                   bool share,
                                                   mrp_resource_order_t order);
 
+void mrp_application_class_set_grace(mrp_application_class_t *class,
+                                     uint32_t msecs);
+
 int mrp_application_class_print(char *buf, int len, bool with_resource_sets);
 
 int mrp_resource_owner_print(char *buf, int len);
 
+typedef struct {
+    uint64_t updates;                    /* zone ownership recalculations */
+    uint64_t allocs;                     /* scratch buffer allocations */
+} mrp_resource_owner_stats_t;
+
+void mrp_resource_owner_get_stats(mrp_resource_owner_stats_t *stats);
+
 
 #endif  /* __MURPHY_RESOURCE_CONFIG_API_H__ */
 
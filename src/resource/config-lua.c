@@ -40,6 +40,9 @@
 #include <murphy/core/lua-bindings/murphy.h>
 #include <murphy/core/lua-utils/lua-compat.h>
 #include <murphy/core/lua-utils/object.h>
+#include <murphy/resolver/resolver.h>
+
+#include <murphy-db/mqi.h>
 
 #include "config-lua.h"
 #include "resource-lua.h"
@@ -89,6 +92,7 @@ enum field_e {
     OWNERS,
     RECALC,
     VETO,
+    GRACE,
     ID
 };
 
@@ -314,6 +318,76 @@ attr_def_t           *resource_attr_defs[MRP_RESOURCE_MAX];
 mrp_lua_resmethod_t  *resource_methods;
 
 
+static void recalc_zones_cb(mrp_deferred_t *d, void *user_data)
+{
+    uint32_t zoneid, nzone;
+    mqi_handle_t trh;
+
+    MRP_UNUSED(user_data);
+
+    mrp_disable_deferred(d);
+
+    nzone = mrp_zone_count();
+
+    mrp_log_info("configuration reloaded, recalculating %u zone(s)", nzone);
+
+    trh = mqi_begin_transaction();
+
+    for (zoneid = 0;  zoneid < nzone;  zoneid++)
+        mrp_resource_owner_recalc(zoneid);
+
+    mqi_commit_transaction(trh);
+}
+
+static void config_reloaded_cb(mrp_event_watch_t *w, uint32_t id,
+                               int format, void *data, void *user_data)
+{
+    static mrp_deferred_t *recalc;
+
+    mrp_context_t *ctx = mrp_lua_get_murphy_context();
+
+    MRP_UNUSED(w);
+    MRP_UNUSED(id);
+    MRP_UNUSED(format);
+    MRP_UNUSED(data);
+    MRP_UNUSED(user_data);
+
+    /*
+     * A SIGHUP reloads both the Lua configuration and the resolver
+     * ruleset. Recalculate only once, after both of them are in place.
+     */
+
+    if (recalc == NULL) {
+        if (!(recalc = mrp_add_deferred(ctx->ml, recalc_zones_cb, NULL)))
+            mrp_log_error("failed to schedule zone recalculation");
+    }
+    else
+        mrp_enable_deferred(recalc);
+}
+
+static void watch_config_reloads(void)
+{
+    mrp_context_t *ctx = mrp_lua_get_murphy_context();
+    mrp_event_bus_t *bus;
+
+    if (!ctx || !ctx->ml)
+        return;
+
+    if (!(bus = mrp_event_bus_get(ctx->ml, MRP_RESOLVER_BUS)) ||
+        !mrp_event_add_watch(bus, mrp_event_id(MRP_RESOLVER_EVENT_RELOAD),
+                             config_reloaded_cb, NULL))
+    {
+        mrp_log_error("failed to watch for resolver ruleset reloads");
+    }
+
+    if (!(bus = mrp_event_bus_get(ctx->ml, MRP_LUA_BUS)) ||
+        !mrp_event_add_watch(bus, mrp_event_id(MRP_LUA_EVENT_RELOAD),
+                             config_reloaded_cb, NULL))
+    {
+        mrp_log_error("failed to watch for Lua configuration reloads");
+    }
+}
+
 void mrp_resource_configuration_init(void)
 {
     static bool initialised = false;
@@ -322,6 +396,8 @@ void mrp_resource_configuration_init(void)
 
     if (!initialised && (L =  mrp_lua_get_lua_state())) {
 
+        watch_config_reloads();
+
         appclass_class_create(L);
         zone_class_create(L);
         resclass_class_create(L);
@@ -371,7 +447,7 @@ void mrp_lua_resclass_create_from_c(uint32_t id)
         nattr = rdef->nattr;
         attrs = mrp_allocz(sizeof(mrp_attr_def_t) * (nattr + 1));
 
-        if (!nattr)
+        if (nattr)
             mrp_attribute_copy_definitions(rdef->attrdefs, attrs);
 
         if (!resclass)
@@ -658,11 +734,16 @@ static int appclass_create(lua_State *L)
     int priority = 0;
     int modal = -1;
     int share = -1;
+    int grace = 0;
     mrp_resource_order_t order = 0;
     const char *name = NULL;
+    mrp_application_class_t *ac;
 
     MRP_LUA_ENTER;
 
+    if (mrp_lua_reload_object(L, APPCLASS_CLASS, 2))
+        MRP_LUA_LEAVE(1);
+
     MRP_LUA_FOREACH_FIELD(L, 2, fldnam, fldnamlen) {
 
         switch (field_name_to_type(fldnam, fldnamlen)) {
@@ -687,6 +768,10 @@ static int appclass_create(lua_State *L)
             order = check_order(L, -1);
             break;
 
+        case GRACE:
+            grace = luaL_checkinteger(L, -1);
+            break;
+
         default:
             luaL_error(L, "unexpected field '%s'", fldnam);
             break;
@@ -705,9 +790,13 @@ static int appclass_create(lua_State *L)
         luaL_error(L, "missing or wrong order field");
     if (priority < 0)
         luaL_error(L, "negative priority");
-    if (!mrp_application_class_create(name, priority, modal, share, order))
+    if (grace < 0)
+        luaL_error(L, "negative grace period");
+    if (!(ac = mrp_application_class_create(name,priority,modal,share,order)))
         luaL_error(L, "failed to create application class '%s'", name);
 
+    mrp_application_class_set_grace(ac, grace);
+
     appclass = (appclass_t *)mrp_lua_create_object(L, APPCLASS_CLASS, name,0);
 
     if (!appclass)
@@ -738,6 +827,7 @@ static int appclass_getfield(lua_State *L)
         case MODAL:      lua_pushboolean(L, ac->modal);       break;
         case SHARE:      lua_pushboolean(L, ac->share);       break;
         case ORDER:      push_order(L, ac->order);            break;
+        case GRACE:      lua_pushinteger(L, ac->grace);       break;
         default:         lua_pushnil(L);                      break;
         }
     }
@@ -794,6 +884,9 @@ static int zone_create(lua_State *L)
     if (!zone_attr_defs->attrs)
         luaL_error(L, "attempt to create zone before defining attributes");
 
+    if (mrp_lua_reload_object(L, ZONE_CLASS, 2))
+        MRP_LUA_LEAVE(1);
+
     MRP_LUA_FOREACH_FIELD(L, 2, fldnam, fldnamlen) {
 
         switch (field_name_to_type(fldnam, fldnamlen)) {
@@ -910,8 +1003,10 @@ static int zone_attr_create(lua_State *L)
 
     MRP_ASSERT(zone_attr_defs, "invocation prior to initialization");
 
-    if (zone_attr_defs->attrs)
-        luaL_error(L, "zone attributes already defined");
+    if (zone_attr_defs->attrs) {
+        if (!mrp_lua_config_reloading())
+            luaL_error(L, "zone attributes already defined");
+    }
     else {
         attrs = check_attrdefs(L, 2, &nattr);
 
@@ -1038,6 +1133,9 @@ static int resclass_create_from_lua(lua_State *L)
 
     MRP_LUA_ENTER;
 
+    if (mrp_lua_reload_object(L, RESCLASS_CLASS, 2))
+        MRP_LUA_LEAVE(1);
+
     MRP_LUA_FOREACH_FIELD(L, 2, fldnam, fldnamlen) {
 
         switch (field_name_to_type(fldnam, fldnamlen)) {
@@ -1322,6 +1420,54 @@ static int resmethod_getfield(lua_State *L)
     MRP_LUA_LEAVE(1);
 }
 
+typedef struct {
+    mrp_lua_resmethod_t *method;
+    int                  ref;
+} veto_reload_t;
+
+static void veto_reload_cb(lua_State *L, void *data, int commit)
+{
+    veto_reload_t *vr = (veto_reload_t *)data;
+
+    if (commit) {
+        mrp_lua_push_object(L, vr->method);
+        lua_pushstring(L, "veto");
+        lua_rawgeti(L, LUA_REGISTRYINDEX, vr->ref);
+        vr->method->veto = mrp_funcarray_check(L, -1);
+        lua_rawset(L, -3);
+        lua_pop(L, 1);
+    }
+
+    luaL_unref(L, LUA_REGISTRYINDEX, vr->ref);
+    mrp_free(vr);
+}
+
+static void stage_veto(lua_State *L, mrp_lua_resmethod_t *method, int idx)
+{
+    veto_reload_t *vr;
+    int type;
+
+    lua_pushvalue(L, idx);
+    type = lua_type(L, -1);
+
+    mrp_funcarray_check(L, -1);
+
+    if (type == LUA_TFUNCTION)
+        lua_remove(L, -2);
+
+    if (!(vr = mrp_allocz(sizeof(*vr))))
+        luaL_error(L, "failed to stage resource veto");
+
+    vr->method = method;
+    vr->ref    = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    if (mrp_lua_stage_reload(veto_reload_cb, vr) < 0) {
+        luaL_unref(L, LUA_REGISTRYINDEX, vr->ref);
+        mrp_free(vr);
+        luaL_error(L, "failed to stage resource veto");
+    }
+}
+
 static int resmethod_setfield(lua_State *L)
 {
     const char *name;
@@ -1333,6 +1479,10 @@ static int resmethod_setfield(lua_State *L)
     if (method) {
         switch (fld) {
         case VETO:
+            if (mrp_lua_config_reloading()) {
+                stage_veto(L, method, 3);
+                break;
+            }
             lua_pushstring(L, name);
             lua_pushvalue(L, 3);
             method->veto = mrp_funcarray_check(L, -1);
@@ -1688,6 +1838,8 @@ static field_t field_name_to_type(const char *name, size_t len)
             return GRANT;
         if (!strcmp(name, "order"))
             return ORDER;
+        if (!strcmp(name, "grace"))
+            return GRACE;
         break;
 
     case 6:
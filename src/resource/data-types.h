@@ -123,6 +123,8 @@ struct mrp_attr_s {
 
 
 typedef void (*mrp_resource_event_cb_t)(uint32_t, mrp_resource_set_t *, void*);
+typedef void (*mrp_resource_flush_cb_t)(uint32_t, mrp_resource_client_t *,
+                                        void *);
 
 enum mrp_resource_event_e {
     MRP_RESOURCE_EVENT_UNKNOWN = 0,
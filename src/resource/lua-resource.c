@@ -39,6 +39,7 @@
 #include <murphy/common/mainloop.h>
 #include <murphy/core/lua-utils/object.h>
 #include <murphy/core/lua-utils/funcbridge.h>
+#include <murphy/core/lua-utils/budget.h>
 #include <murphy/core/lua-bindings/murphy.h>
 
 #include <murphy/resource/client-api.h>
@@ -64,6 +65,8 @@ struct attribute_lua_s {
 
     int initialized;
     resource_lua_t *parent;
+
+    int cache; /* cached attribute value table */
 };
 
 struct resource_lua_s {
@@ -100,6 +103,11 @@ struct resource_set_lua_s {
     bool initialized; /* resource set was returned to the Lua user */
 
     mrp_htbl_t *resources;
+    int resource_tbl; /* cached resource table */
+    int delta_tbl; /* reused event delta table */
+
+    mrp_resource_mask_t grant; /* grant mask at last event */
+    mrp_resource_mask_t advice; /* advice mask at last event */
 };
 
 static mrp_resource_client_t *client = NULL;
@@ -232,6 +240,7 @@ static int attribute_lua_stringify(lua_State *L);
 static void attribute_lua_changed(void *data, lua_State *L, int member);
 static int attribute_lua_getfield(lua_State *L);
 static int attribute_lua_setfield(lua_State *L);
+static void attribute_cache_invalidate(attribute_lua_t *attribute, lua_State *L);
 
 #define A_OFFS(m)   MRP_OFFSET(attribute_lua_t, m)
 #define A_RDONLY    MRP_LUA_CLASS_READONLY
@@ -358,6 +367,7 @@ static int resource_set_add_resource(lua_State *L)
     resource->real_attributes->parent = resource;
     resource->real_attributes->resource_set = rset;
     resource->real_attributes->initialized = TRUE;
+    resource->real_attributes->cache = LUA_NOREF;
 
     attrs = mrp_resource_set_read_all_attributes(rset->resource_set,
             resource->resource_name, MAX_ATTRS-1, attribute_list);
@@ -371,6 +381,10 @@ static int resource_set_add_resource(lua_State *L)
     mrp_debug("inserted resource %s to %p", resource->resource_name, rset);
     mrp_htbl_insert(rset->resources, resource->resource_name, resource);
 
+    /* the cached resource table is now incomplete */
+    mrp_lua_object_unref_value(rset, L, rset->resource_tbl);
+    rset->resource_tbl = LUA_NOREF;
+
     return 0;
 
 error:
@@ -438,10 +452,95 @@ static int resource_set_release(lua_State *L)
 }
 
 
+/*
+ * Push the change delta of the last event for the resource set callback:
+ *
+ *   { grant = <mask>, advice = <mask>,
+ *     old_grant = <mask>, old_advice = <mask>,
+ *     changed = { <resource name> = <resource>, ... } }
+ *
+ * where changed lists (and refreshes the state of) only the resources whose
+ * grant or advice flipped, so the callback does not need to walk through and
+ * rebuild the full resource table on every event. The same tables are
+ * refilled for every event of the set instead of allocating new ones, so a
+ * callback that wants to keep the delta around needs to copy it.
+ */
+static void push_event_delta(resource_set_lua_t *rset, lua_State *L,
+                             mrp_resource_mask_t old_grant,
+                             mrp_resource_mask_t old_advice)
+{
+    mrp_resource_mask_t changed, mask;
+    mrp_resource_t *resource;
+    resource_lua_t *res;
+    const char *name;
+    void *iter = NULL;
+
+    changed = (rset->grant ^ old_grant) | (rset->advice ^ old_advice);
+
+    if (!mrp_lua_object_deref_value(rset, L, rset->delta_tbl, false)) {
+        lua_createtable(L, 0, 5);
+        rset->delta_tbl = mrp_lua_object_ref_value(rset, L, -1);
+    }
+
+    lua_pushinteger(L, rset->grant);
+    lua_setfield(L, -2, "grant");
+    lua_pushinteger(L, rset->advice);
+    lua_setfield(L, -2, "advice");
+    lua_pushinteger(L, old_grant);
+    lua_setfield(L, -2, "old_grant");
+    lua_pushinteger(L, old_advice);
+    lua_setfield(L, -2, "old_advice");
+
+    lua_getfield(L, -1, "changed");
+
+    if (lua_istable(L, -1)) {
+        /* clear the entries of the previous event */
+        lua_pushnil(L);
+
+        while (lua_next(L, -2)) {
+            lua_pop(L, 1);
+            lua_pushvalue(L, -1);
+            lua_pushnil(L);
+            lua_rawset(L, -4);
+        }
+    }
+    else {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, -3, "changed");
+    }
+
+    while (changed &&
+           (resource = mrp_resource_set_iterate_resources(rset->resource_set,
+                                                          &iter))) {
+        mask = mrp_resource_get_mask(resource);
+
+        if (!(mask & changed))
+            continue;
+
+        name = mrp_resource_get_name(resource);
+        res = (resource_lua_t *) mrp_htbl_lookup(rset->resources, (void *) name);
+
+        if (!res) {
+            mrp_log_error("resources out of sync: %s not found", name);
+            continue;
+        }
+
+        res->acquired = !!(mask & rset->grant);
+        res->available = !!(mask & rset->advice);
+
+        mrp_lua_push_object(L, res);
+        lua_setfield(L, -2, res->resource_name);
+    }
+
+    lua_pop(L, 1);
+}
+
 void event_cb(uint32_t request_id, mrp_resource_set_t *resource_set, void *user_data)
 {
     resource_set_lua_t *rset = (resource_set_lua_t *) user_data;
-    mrp_resource_mask_t grant, advice;
+    mrp_resource_mask_t old_grant, old_advice;
     int                 top;
 
     MRP_UNUSED(request_id);
@@ -451,17 +550,21 @@ void event_cb(uint32_t request_id, mrp_resource_set_t *resource_set, void *user_
 
     top = lua_gettop(rset->L);
 
-    grant = mrp_get_resource_set_grant(rset->resource_set);
-    advice = mrp_get_resource_set_advice(rset->resource_set);
+    old_grant = rset->grant;
+    old_advice = rset->advice;
+
+    rset->grant = mrp_get_resource_set_grant(rset->resource_set);
+    rset->advice = mrp_get_resource_set_advice(rset->resource_set);
 
     /* update resource set */
-    rset->acquired = !!grant;
-    rset->available = !!advice;
+    rset->acquired = !!rset->grant;
+    rset->available = !!rset->advice;
 
     if (mrp_lua_object_deref_value(rset, rset->L, rset->callback, false)) {
         mrp_lua_push_object(rset->L, rset);
+        push_event_delta(rset, rset->L, old_grant, old_advice);
 
-        if (lua_pcall(rset->L, 1, 0, 0) != 0)
+        if (mrp_lua_budget_pcall(rset->L, 2, 0, NULL) != 0)
             mrp_log_error("failed to invoke Lua resource set callback: %s",
                     lua_tostring(rset->L, -1));
     }
@@ -511,6 +614,10 @@ static int resource_set_lua_create(lua_State *L)
     rset->priority = 0;
     rset->committed = FALSE;
     rset->initialized = FALSE;
+    rset->resource_tbl = LUA_NOREF;
+    rset->delta_tbl = LUA_NOREF;
+    rset->grant = 0;
+    rset->advice = 0;
 
     switch (narg) {
     case 2:
@@ -593,12 +700,58 @@ static int resource_set_get_id(void *data, lua_State *L, int member,
     return 1;
 }
 
+/*
+ * Check whether the cached resource table at the top of the stack still
+ * holds exactly the resources of the set, ie. whether it has been left
+ * untouched by whoever we handed it out to.
+ */
+static bool resource_tbl_intact(resource_set_lua_t *rset, lua_State *L)
+{
+    void *iter = NULL;
+    mrp_resource_t *resource;
+    resource_lua_t *res;
+    int n = 0, same;
+
+    while ((resource = mrp_resource_set_iterate_resources(rset->resource_set, &iter))) {
+        res = (resource_lua_t *) mrp_htbl_lookup(rset->resources,
+                (void *) mrp_resource_get_name(resource));
+
+        if (!res)
+            continue;
+
+        lua_pushstring(L, res->resource_name);
+        lua_rawget(L, -2);
+        mrp_lua_push_object(L, res);
+        same = lua_rawequal(L, -1, -2);
+        lua_pop(L, 2);
+
+        if (!same)
+            return false;
+
+        n++;
+    }
+
+    lua_pushnil(L);
+
+    while (lua_next(L, -2)) {
+        lua_pop(L, 1);
+
+        if (--n < 0) {
+            lua_pop(L, 1);
+            return false;
+        }
+    }
+
+    return n == 0;
+}
+
 static int resource_set_get_resources(void *data, lua_State *L, int member, mrp_lua_value_t *v)
 {
     resource_set_lua_t *rset;
     void *iter = NULL;
     mrp_resource_t *resource;
     mrp_resource_mask_t grant, advice;
+    int cached;
 
     MRP_UNUSED(member);
     MRP_UNUSED(v);
@@ -613,7 +766,22 @@ static int resource_set_get_resources(void *data, lua_State *L, int member, mrp_
     grant = mrp_get_resource_set_grant(rset->resource_set);
     advice = mrp_get_resource_set_advice(rset->resource_set);
 
-    lua_newtable(L);
+    /* the set of resources only changes in addResource, so unless that has
+     * been called since the last access, reuse the table we handed out then
+     * and only refresh the resource states. If the table has been modified
+     * in the meantime, leave it to its modifier and hand out a fresh one. */
+
+    cached = mrp_lua_object_deref_value(rset, L, rset->resource_tbl, false);
+
+    if (cached && !resource_tbl_intact(rset, L)) {
+        lua_pop(L, 1);
+        mrp_lua_object_unref_value(rset, L, rset->resource_tbl);
+        rset->resource_tbl = LUA_NOREF;
+        cached = false;
+    }
+
+    if (!cached)
+        lua_newtable(L);
 
     /* push all resource objects to a table and return it */
 
@@ -637,7 +805,10 @@ static int resource_set_get_resources(void *data, lua_State *L, int member, mrp_
         res->acquired = !!(mask & grant);
         res->available = !!(mask & advice);
 
-        /* TODO: update attributes */
+        /* attributes are refreshed on demand, see attribute_cache_push */
+
+        if (cached)
+            continue;
 
         /* push the resource to the table */
         lua_pushstring(L, res->resource_name);
@@ -645,6 +816,9 @@ static int resource_set_get_resources(void *data, lua_State *L, int member, mrp_
         lua_settable(L, -3);
     }
 
+    if (!cached)
+        rset->resource_tbl = mrp_lua_object_ref_value(rset, L, -1);
+
     return 1;
 }
 
@@ -922,6 +1096,7 @@ static int resource_set_attributes(void *data, lua_State *L, int member, mrp_lua
 
     /* write the attributes back */
     mrp_resource_set_write_attributes(rset->resource_set, res->resource_name, orig);
+    attribute_cache_invalidate(res->real_attributes, L);
 
     return 1;
 }
@@ -931,6 +1106,70 @@ static inline attribute_lua_t *attribute_lua_check(lua_State *L, int idx)
     return (attribute_lua_t *) mrp_lua_check_object(L, ATTRIBUTE_LUA_CLASS, idx);
 }
 
+/*
+ * Attribute values are cached in a plain Lua table per resource. The cache
+ * is built on the first access and kept until the attributes are written,
+ * which for our resource sets can only happen through us. Values we can't
+ * represent are left out, so a cache miss falls back to the library lookup.
+ */
+static int attribute_cache_push(attribute_lua_t *attribute, lua_State *L)
+{
+    resource_lua_t *res = attribute->parent;
+    resource_set_lua_t *rset = res->parent;
+    mrp_attr_t attribute_list[MAX_ATTRS], *attrs;
+
+    if (mrp_lua_object_deref_value(attribute, L, attribute->cache, false))
+        return 1;
+
+    attrs = mrp_resource_set_read_all_attributes(rset->resource_set,
+            res->resource_name, MAX_ATTRS-1, attribute_list);
+
+    if (!attrs)
+        return 0;
+
+    lua_newtable(L);
+
+    while (attrs->name != NULL) {
+
+        switch (attrs->type) {
+            case mqi_string:
+                lua_pushstring(L, attrs->value.string);
+                break;
+            case mqi_integer:
+                lua_pushinteger(L, attrs->value.integer);
+                break;
+            case mqi_unsignd:
+                if (attrs->value.unsignd > INT_MAX)
+                    goto next;
+                lua_pushinteger(L, attrs->value.unsignd);
+                break;
+            case mqi_floating:
+                lua_pushnumber(L, attrs->value.floating);
+                break;
+            default:
+                goto next;
+        }
+
+        lua_setfield(L, -2, attrs->name);
+
+    next:
+        attrs++;
+    }
+
+    attribute->cache = mrp_lua_object_ref_value(attribute, L, -1);
+
+    return 1;
+}
+
+static void attribute_cache_invalidate(attribute_lua_t *attribute, lua_State *L)
+{
+    if (!attribute)
+        return;
+
+    mrp_lua_object_unref_value(attribute, L, attribute->cache);
+    attribute->cache = LUA_NOREF;
+}
+
 static int attribute_lua_create(lua_State *L)
 {
     mrp_debug("> attribute_create");
@@ -1078,6 +1317,16 @@ static int attribute_lua_getfield(lua_State *L)
 
     key = lua_tostring(L, 2);
 
+    if (attribute_cache_push(attribute, L)) {
+        lua_pushvalue(L, 2);
+        lua_rawget(L, -2);
+
+        if (!lua_isnil(L, -1))
+            return 1;
+
+        lua_pop(L, 2);
+    }
+
     attrs = mrp_resource_set_read_all_attributes(rset->resource_set,
             res->resource_name, MAX_ATTRS-1, attribute_list);
 
@@ -1153,10 +1402,20 @@ static int attribute_lua_setfield(lua_State *L)
 
             switch (attrs->type) {
                 case mqi_string:
+                {
+                    const char *str;
+
                     if (new_type != LUA_TSTRING)
                         return luaL_error(L, "type mismatch");
-                    attrs->value.string = lua_tostring(L, 3);
+
+                    str = lua_tostring(L, 3);
+
+                    if (attrs->value.string && !strcmp(attrs->value.string, str))
+                        return 1;
+
+                    attrs->value.string = str;
                     break;
+                }
                 case mqi_integer:
                 {
                     int32_t i;
@@ -1165,11 +1424,13 @@ static int attribute_lua_setfield(lua_State *L)
                     if (new_type != LUA_TNUMBER)
                         return luaL_error(L, "type mismatch");
 
-                    if ((i = lua_tointeger(L, 3)) == (dbl = lua_tonumber(L, 3)))
-                        attrs->value.integer = i;
-                    else
+                    if ((i = lua_tointeger(L, 3)) != (dbl = lua_tonumber(L, 3)))
                         return luaL_error(L, "type mismatch");
 
+                    if (attrs->value.integer == i)
+                        return 1;
+
+                    attrs->value.integer = i;
                     break;
                 }
                 case mqi_unsignd:
@@ -1180,18 +1441,26 @@ static int attribute_lua_setfield(lua_State *L)
                     if (new_type != LUA_TNUMBER)
                         return luaL_error(L, "type mismatch");
 
-                    if ((i = lua_tointeger(L, 3)) == (dbl = lua_tonumber(L, 3)) && i >= 0)
-                        attrs->value.unsignd = i;
-                    else
+                    if ((i = lua_tointeger(L, 3)) != (dbl = lua_tonumber(L, 3)) || i < 0)
                         return luaL_error(L, "type mismatch");
 
+                    if (attrs->value.unsignd == (uint32_t) i)
+                        return 1;
+
+                    attrs->value.unsignd = i;
                     break;
                 }
                 case mqi_floating:
                 {
+                    double dbl;
+
                     if (new_type != LUA_TNUMBER)
                         return luaL_error(L, "type mismatch");
-                    attrs->value.floating = lua_tonumber(L, 3);
+
+                    if ((dbl = lua_tonumber(L, 3)) == attrs->value.floating)
+                        return 1;
+
+                    attrs->value.floating = dbl;
                     break;
                 }
                 default:
@@ -1204,6 +1473,7 @@ static int attribute_lua_setfield(lua_State *L)
     }
 
     mrp_resource_set_write_attributes(rset->resource_set, res->resource_name, orig);
+    attribute_cache_invalidate(attribute, L);
 
     return 1;
 }
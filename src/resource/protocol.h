@@ -71,6 +71,8 @@
 #define RESPROTO_ATTRIBUTE_INDEX      RESPROTO_TAG(16)
 #define RESPROTO_ATTRIBUTE_NAME       RESPROTO_TAG(17)
 #define RESPROTO_ATTRIBUTE_VALUE      RESPROTO_TAG(18)
+#define RESPROTO_PREEMPTED_SET_ID     RESPROTO_TAG(19)
+#define RESPROTO_RECALC_SEQUENCE_NO   RESPROTO_TAG(20)
 
 typedef enum {
     RESPROTO_QUERY_RESOURCES,
@@ -81,6 +83,9 @@ typedef enum {
     RESPROTO_ACQUIRE_RESOURCE_SET,
     RESPROTO_RELEASE_RESOURCE_SET,
     RESPROTO_RESOURCES_EVENT,
+    RESPROTO_PROBE_RESOURCE_SET,
+    RESPROTO_ENABLE_EVENT_BATCHING,
+    RESPROTO_RESOURCES_BATCH_EVENT,
 } mrp_resproto_request_t;
 
 typedef enum {
@@ -32,15 +32,25 @@
 
 #include <murphy/common/mm.h>
 #include <murphy/common/log.h>
+#include <murphy/core/lua-bindings/murphy.h>
+#include <murphy/core/lua-utils/budget.h>
 
 #include <resource/client-api.h>
 
 #include "resource-client.h"
 #include "resource-set.h"
+#include "resource-owner.h"
 
 
 
 static MRP_LIST_HOOK(client_list);
+static MRP_LIST_HOOK(flush_list);
+static uint32_t recalc_seqno;
+static uint32_t recalc_depth;
+static bool recalc_unwind;
+
+static void flush_clients(void);
+static void unwind_recalc(void *);
 
 
 mrp_resource_client_t *mrp_resource_client_create(const char *name,
@@ -61,6 +71,7 @@ mrp_resource_client_t *mrp_resource_client_create(const char *name,
     client->name = dup_name;
     client->user_data = user_data;
     mrp_list_init(&client->resource_sets);
+    mrp_list_init(&client->flush.list);
 
     mrp_list_append(&client_list, &client->list);
 
@@ -69,16 +80,13 @@ mrp_resource_client_t *mrp_resource_client_create(const char *name,
 
 void mrp_resource_client_destroy(mrp_resource_client_t *client)
 {
-    mrp_list_hook_t *entry, *n;
-    mrp_resource_set_t *rset;
-
     if (client) {
         mrp_list_delete(&client->list);
 
-        mrp_list_foreach(&client->resource_sets, entry, n) {
-            rset = mrp_list_entry(entry, mrp_resource_set_t, client.list);
-            mrp_resource_set_destroy(rset);
-        }
+        client->flush.cb = NULL;
+        mrp_list_delete(&client->flush.list);
+
+        mrp_resource_set_destroy_client_sets(client);
 
         mrp_free((void *) client->name);
         mrp_free(client);
@@ -104,6 +112,104 @@ mrp_resource_set_t *mrp_resource_client_find_set(mrp_resource_client_t *client,
     return NULL;
 }
 
+void mrp_resource_client_set_flush_callback(mrp_resource_client_t *client,
+                                            mrp_resource_flush_cb_t flush_cb)
+{
+    MRP_ASSERT(client, "invalid argument");
+
+    client->flush.cb = flush_cb;
+
+    if (!flush_cb)
+        mrp_list_delete(&client->flush.list);
+}
+
+bool mrp_resource_client_queue_flush(mrp_resource_client_t *client)
+{
+    if (!client || !client->flush.cb || !recalc_depth)
+        return false;
+
+    if (mrp_list_empty(&client->flush.list))
+        mrp_list_append(&flush_list, &client->flush.list);
+
+    return true;
+}
+
+uint32_t mrp_resource_client_get_recalc_seqno(void)
+{
+    return recalc_seqno;
+}
+
+void mrp_resource_client_start_recalc(void)
+{
+    if (!recalc_depth++) {
+        recalc_seqno++;
+        recalc_unwind = mrp_lua_push_unwind(unwind_recalc, NULL);
+        mrp_lua_gc_pause();
+    }
+}
+
+void mrp_resource_client_end_recalc(void)
+{
+    MRP_ASSERT(recalc_depth > 0, "unbalanced recalculation");
+
+    if (--recalc_depth)
+        return;
+
+    if (recalc_unwind) {
+        mrp_lua_pop_unwind();
+        recalc_unwind = false;
+    }
+
+    mrp_lua_gc_resume();
+
+    flush_clients();
+}
+
+static void unwind_recalc(void *data)
+{
+    MRP_UNUSED(data);
+
+    /*
+     * A Lua error (most likely a failed allocation near the Lua heap
+     * limit) was raised within a recalculation and unwound it to the
+     * enclosing protected call. Close the recalculation, otherwise the
+     * garbage collector would stay paused and client flushes would be
+     * held back for good.
+     */
+
+    mrp_log_error("Resource recalculation aborted by a Lua error.");
+
+    recalc_depth  = 0;
+    recalc_unwind = false;
+
+    mrp_resource_owner_abort_updates();
+
+    mrp_lua_gc_resume();
+
+    flush_clients();
+}
+
+static void flush_clients(void)
+{
+    mrp_list_hook_t pending, *entry;
+    mrp_resource_client_t *client;
+
+    /*
+     * flush callbacks may trigger new recalculations or destroy clients,
+     * so detach the pending clients and always pick the first remaining
+     */
+    mrp_list_move(&pending, &flush_list);
+
+    while (!mrp_list_empty(&pending)) {
+        entry  = pending.next;
+        client = mrp_list_entry(entry, mrp_resource_client_t, flush.list);
+
+        mrp_list_delete(&client->flush.list);
+
+        client->flush.cb(recalc_seqno, client, client->user_data);
+    }
+}
+
 /*
  * Local Variables:
  * c-basic-offset: 4
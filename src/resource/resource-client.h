@@ -40,9 +40,16 @@ struct mrp_resource_client_s {
     const char      *name;
     void            *user_data;
     mrp_list_hook_t  resource_sets;
+    struct {
+        mrp_resource_flush_cb_t cb;
+        mrp_list_hook_t         list;
+    }                flush;
 };
 
 
+void mrp_resource_client_start_recalc(void);
+void mrp_resource_client_end_recalc(void);
+
 
 #endif  /* __MURPHY_RESOURCE_CLIENT_H__ */
 
@@ -41,6 +41,7 @@
 #include <murphy/core/lua-utils/lua-compat.h>
 #include <murphy/core/lua-utils/funcbridge.h>
 #include <murphy/core/lua-utils/object.h>
+#include <murphy/core/lua-utils/profile.h>
 
 #include "resource-lua.h"
 #include "config-lua.h"
@@ -68,7 +69,9 @@ enum field_e {
     DONT_WAIT,
     RESOURCE,
     STATE,
-    ID
+    PRIORITY,
+    ID,
+    FIELD_MAX
 };
 
 struct ownerref_s {
@@ -89,6 +92,7 @@ static mrp_resource_ownersref_t *owners_check(lua_State *, int);
 /* static mrp_resource_owners_s *to_owners(lua_State *, int); */
 
 static ownerref_t *ownerref_create(lua_State *, uint32_t, uint32_t);
+static void ownerref_push(lua_State *, uint32_t, uint32_t);
 static int ownerref_getfield(lua_State *);
 static int ownerref_setfield(lua_State *);
 static mrp_resource_owner_t *ownerref_check(lua_State *, int);
@@ -103,6 +107,7 @@ static int  add_to_id_hash(mrp_resource_setref_t *);
 static mrp_resource_setref_t *remove_from_id_hash(uint32_t);
 static mrp_resource_setref_t *find_in_id_hash(uint32_t);
 
+static void    field_intern(lua_State *);
 static field_t field_check(lua_State *, int, const char **);
 static field_t field_name_to_type(const char *, size_t);
 
@@ -156,6 +161,27 @@ MRP_LUA_CLASS_DEF (
 static mrp_resource_ownersref_t *resource_owners[MRP_ZONE_MAX];
 static mrp_htbl_t *id_hash;
 
+/*
+ * Field names are interned once in the Lua state. Lua strings of this
+ * length are unique within a state, so as long as we keep a reference to
+ * them, field lookups in the getters and setters below boil down to a few
+ * pointer comparisons instead of string comparisons.
+ */
+static const char *field_names[FIELD_MAX] = {
+    [APPLICATION_CLASS] = "application_class",
+    [AUTO_RELEASE]      = "auto_release",
+    [RESOURCE_SET]      = "resource_set",
+    [ATTRIBUTES]        = "attributes",
+    [DONT_WAIT]         = "dont_wait",
+    [RESOURCE]          = "resource",
+    [STATE]             = "state",
+    [PRIORITY]          = "priority",
+    [ID]                = "id",
+};
+static const char *field_keys[FIELD_MAX];
+static int field_tbl = LUA_NOREF;
+static int ownerref_tbl = LUA_NOREF;
+
 void mrp_resource_lua_init(lua_State *L)
 {
     static bool initialised = false;
@@ -165,7 +191,10 @@ void mrp_resource_lua_init(lua_State *L)
         ownerref_class_create(L);
         setref_class_create(L);
 
+        field_intern(L);
         init_id_hash();
+
+        initialised = true;
     }
 }
 
@@ -181,6 +210,7 @@ bool mrp_resource_lua_veto(mrp_zone_t *zone,
     mrp_resource_setref_t *sref, *rref;
     mrp_resource_ownersref_t *oref;
     mrp_funcbridge_value_t args[16];
+    const char *entry;
     int i, top;
     bool success;
 
@@ -204,7 +234,13 @@ bool mrp_resource_lua_veto(mrp_zone_t *zone,
             args[++i].pointer = oref;
             args[++i].pointer = rref;
 
+            /*
+             * Notes: a veto function failing or overrunning its execution
+             *   budget (see mrp_lua_budget_pcall) is taken as a veto.
+             */
+            entry   = mrp_lua_profile_enter("veto");
             success = mrp_funcarray_call_from_c(L, veto, "sodoo", args);
+            mrp_lua_profile_leave(entry);
 
             goto out;
         }
@@ -354,7 +390,7 @@ static int owners_getfield(lua_State *L)
         if (resid >= MRP_RESOURCE_MAX || !ref->owners[resid].class)
             lua_pushnil(L);
         else
-            ownerref_create(L, ref->zoneid, resid);
+            ownerref_push(L, ref->zoneid, resid);
         break;
 
     default:
@@ -421,6 +457,34 @@ static ownerref_t *ownerref_create(lua_State *L,uint32_t zoneid,uint32_t resid)
     return or;
 }
 
+static void ownerref_push(lua_State *L, uint32_t zoneid, uint32_t resid)
+{
+    int idx = zoneid * MRP_RESOURCE_MAX + resid + 1;
+
+    /*
+     * Owner references only carry the zone and resource ids, the actual
+     * owner is looked up on each access. Hence we can hand out the same
+     * reference for every access instead of creating a new one each time.
+     */
+
+    if (ownerref_tbl == LUA_NOREF) {
+        ownerref_create(L, zoneid, resid);
+        return;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, ownerref_tbl);
+    lua_rawgeti(L, -1, idx);
+
+    if (lua_isnil(L, -1)) {
+        lua_pop(L, 1);
+        ownerref_create(L, zoneid, resid);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, -3, idx);
+    }
+
+    lua_remove(L, -2);
+}
+
 static int ownerref_getfield(lua_State *L)
 {
     mrp_resource_owner_t *owner = ownerref_check(L, 1);
@@ -512,6 +576,10 @@ static int setref_getfield(lua_State *L)
             lua_pushstring(L, state);
             break;
 
+        case PRIORITY:
+            lua_pushinteger(L, rset->class.priority);
+            break;
+
         case DONT_WAIT:
             lua_pushboolean(L, rset->dont_wait.current);
             break;
@@ -636,14 +704,41 @@ static mrp_resource_setref_t *find_in_id_hash(uint32_t id)
 }
 
 
+static void field_intern(lua_State *L)
+{
+    int i;
+
+    lua_createtable(L, FIELD_MAX, 0);
+
+    for (i = 1; i < FIELD_MAX; i++) {
+        lua_pushstring(L, field_names[i]);
+        field_keys[i] = lua_tostring(L, -1);
+        lua_rawseti(L, -2, i);
+    }
+
+    field_tbl = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    lua_newtable(L);
+    ownerref_tbl = luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+
 static field_t field_check(lua_State *L, int idx, const char **ret_fldnam)
 {
     const char *fldnam;
     size_t fldnamlen;
     field_t fldtyp;
+    int i;
 
     if (!(fldnam = lua_tolstring(L, idx, &fldnamlen)))
         fldtyp = 0;
+    else if (field_tbl != LUA_NOREF) {
+        for (i = 1; i < FIELD_MAX; i++)
+            if (fldnam == field_keys[i])
+                break;
+
+        fldtyp = (i < FIELD_MAX) ? (field_t)i : 0;
+    }
     else
         fldtyp = field_name_to_type(fldnam, fldnamlen);
 
@@ -671,6 +766,8 @@ static field_t field_name_to_type(const char *name, size_t len)
     case 8:
         if (!strcmp(name, "resource"))
             return RESOURCE;
+        if (!strcmp(name, "priority"))
+            return PRIORITY;
         break;
 
     case 9:
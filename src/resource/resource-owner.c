@@ -43,6 +43,7 @@
 #include <murphy/resource/config-api.h>
 
 #include "resource-owner.h"
+#include "resource-client.h"
 #include "application-class.h"
 #include "resource-set.h"
 #include "resource.h"
@@ -57,6 +58,8 @@
 #define RSET_ID_IDX          3
 #define FIRST_ATTRIBUTE_IDX  4
 
+#define EVENT_SCRATCH_MIN    16
+
 typedef struct {
     uint32_t          zone_id;
     const char       *zone_name;
@@ -65,17 +68,45 @@ typedef struct {
     mrp_attr_value_t  attrs[MQI_COLUMN_MAX];
 } owner_row_t;
 
+typedef struct {
+    uint32_t replyid;
+    mrp_resource_set_t *rset;
+    bool move;
+} event_t;
+
+typedef struct {
+    event_t  *events;                    /* reusable event buffer */
+    uint32_t  size;                      /* allocated size of events */
+    bool      busy;                      /* in use by an ongoing update */
+} scratch_t;
+
 static mrp_resource_owner_t  resource_owners[MRP_ZONE_MAX * MRP_RESOURCE_MAX];
+static mrp_resource_owner_t  stored_owners[MRP_ZONE_MAX * MRP_RESOURCE_MAX];
 static mqi_handle_t          owner_tables[MRP_RESOURCE_MAX];
+static scratch_t             scratch[MRP_ZONE_MAX];
+static mrp_resource_owner_stats_t owner_stats;
 
 static mrp_resource_owner_t *get_owner(uint32_t, uint32_t);
-static void reset_owners(uint32_t, mrp_resource_owner_t *);
+static void reset_owners(uint32_t);
+static void reserve_owners(uint32_t, mrp_resource_owner_t *);
+static void drop_reservation(mrp_resource_owner_t *, mrp_resource_set_t *);
+static void hold_down_owners(uint32_t);
+static event_t *get_events(uint32_t, uint32_t);
+static void put_events(uint32_t, event_t *);
 static bool grant_ownership(mrp_resource_owner_t *, mrp_zone_t *,
                             mrp_application_class_t *, mrp_resource_set_t *,
-                            mrp_resource_t *);
+                            mrp_resource_t *, bool);
 static bool advice_ownership(mrp_resource_owner_t *, mrp_zone_t *,
                              mrp_application_class_t *, mrp_resource_set_t *,
-                             mrp_resource_t *);
+                             mrp_resource_t *, bool);
+static mrp_resource_mask_t update_resource_set(mrp_resource_owner_t *,
+                                               mrp_zone_t *,
+                                               mrp_application_class_t *,
+                                               mrp_resource_set_t *,
+                                               mrp_resource_state_t,
+                                               mrp_resource_set_t *,
+                                               mrp_resource_mask_t *, bool *,
+                                               bool);
 
 static void manager_start_transaction(mrp_zone_t *);
 static void manager_end_transaction(mrp_zone_t *);
@@ -166,26 +197,13 @@ void mrp_resource_owner_update_zone(uint32_t zoneid,
                                     mrp_resource_set_t *reqset,
                                     uint32_t reqid)
 {
-    typedef struct {
-        uint32_t replyid;
-        mrp_resource_set_t *rset;
-        bool move;
-    } event_t;
-
-    mrp_resource_owner_t oldowners[MRP_RESOURCE_MAX];
-    mrp_resource_owner_t backup[MRP_RESOURCE_MAX];
     mrp_zone_t *zone;
     mrp_application_class_t *class;
     mrp_resource_set_t *rset;
-    mrp_resource_t *res;
-    mrp_resource_def_t *rdef;
-    mrp_resource_mgr_ftbl_t *ftbl;
-    mrp_resource_owner_t *owner, *old, *owners;
-    mrp_resource_mask_t mask;
-    mrp_resource_mask_t mandatory;
+    mrp_resource_owner_t *owner, *old;
     mrp_resource_mask_t grant;
     mrp_resource_mask_t advice;
-    void *clc, *rsc, *rc;
+    void *clc, *rsc;
     uint32_t rid;
     uint32_t rcnt;
     bool force_release;
@@ -206,11 +224,14 @@ void mrp_resource_owner_update_zone(uint32_t zoneid,
         return;
 
     nevent = 0;
-    events = mrp_alloc(sizeof(event_t) * maxev);
+    events = get_events(zoneid, maxev);
 
     MRP_ASSERT(events, "Memory alloc failure. Can't update zone");
 
-    reset_owners(zoneid, oldowners);
+    mrp_resource_client_start_recalc();
+
+    reset_owners(zoneid);
+    reserve_owners(zoneid, get_owner(zoneid, 0));
     manager_start_transaction(zone);
 
     rcnt = mrp_resource_definition_count();
@@ -220,79 +241,9 @@ void mrp_resource_owner_update_zone(uint32_t zoneid,
         rsc = NULL;
 
         while ((rset=mrp_application_class_iterate_rsets(class,zoneid,&rsc))) {
-            force_release = false;
-            mandatory = rset->resource.mask.mandatory;
-            grant = 0;
-            advice = 0;
-            rc = NULL;
-
-            switch (rset->state) {
-
-            case mrp_resource_acquire:
-                while ((res = mrp_resource_set_iterate_resources(rset, &rc))) {
-                    rdef  = res->def;
-                    rid   = rdef->id;
-                    owner = get_owner(zoneid, rid);
-
-                    backup[rid] = *owner;
-
-                    if (grant_ownership(owner, zone, class, rset, res))
-                        grant |= ((mrp_resource_mask_t)1 << rid);
-                    else {
-                        if (owner->rset != rset)
-                            force_release |= owner->modal;
-                    }
-                }
-                owners = get_owner(zoneid, 0);
-                if ((grant & mandatory) == mandatory &&
-                    mrp_resource_lua_veto(zone, rset, owners, grant, reqset))
-                {
-                    advice = grant;
-                }
-                else {
-                    /* rollback, ie. restore the backed up state */
-                    rc = NULL;
-                    while ((res=mrp_resource_set_iterate_resources(rset,&rc))){
-                        rdef = res->def;
-                        rid = rdef->id;
-                        mask = (mrp_resource_mask_t)1 << rid;
-                        owner = get_owner(zoneid, rid);
-                        *owner = backup[rid];
-
-                        if ((grant & mask)) {
-                            if ((ftbl = rdef->manager.ftbl) && ftbl->free)
-                                ftbl->free(zone, res, rdef->manager.userdata);
-                        }
-
-                        if (advice_ownership(owner, zone, class, rset, res))
-                            advice |= mask;
-                    }
-
-                    grant = 0;
-
-                    if ((advice & mandatory) != mandatory)
-                        advice = 0;
-
-                    mrp_resource_lua_set_owners(zone, owners);
-                }
-                break;
-
-            case mrp_resource_release:
-                while ((res = mrp_resource_set_iterate_resources(rset, &rc))) {
-                    rdef  = res->def;
-                    rid   = rdef->id;
-                    owner = get_owner(zoneid, rid);
-
-                    if (advice_ownership(owner, zone, class, rset, res))
-                        advice |= ((mrp_resource_mask_t)1 << rid);
-                }
-                if ((advice & mandatory) != mandatory)
-                    advice = 0;
-                break;
-
-            default:
-                break;
-            }
+            grant = update_resource_set(get_owner(zoneid, 0), zone, class,
+                                        rset, rset->state, reqset, &advice,
+                                        &force_release, false);
 
             changed = false;
             move    = false;
@@ -355,6 +306,7 @@ void mrp_resource_owner_update_zone(uint32_t zoneid,
     } /* while class */
 
     manager_end_transaction(zone);
+    hold_down_owners(zoneid);
 
     for (lastev = (ev = events) + nevent;     ev < lastev;     ev++) {
         rset = ev->rset;
@@ -378,11 +330,17 @@ void mrp_resource_owner_update_zone(uint32_t zoneid,
             rset->event(ev->replyid, rset, rset->user_data);
     }
 
-    mrp_free(events);
+    put_events(zoneid, events);
 
+    /*
+     * Sync the owner tables in the database with the owners as they are
+     * stored there, not as they were at the start of this update. These
+     * can differ if a nested update of the zone has already synced them,
+     * or an update has been aborted by a Lua error before getting here.
+     */
     for (rid = 0;  rid < rcnt;  rid++) {
         owner = get_owner(zoneid, rid);
-        old   = oldowners + rid;
+        old   = stored_owners + (zoneid * MRP_RESOURCE_MAX + rid);
 
         if (owner->class != old->class ||
             owner->rset  != old->rset  ||
@@ -394,8 +352,142 @@ void mrp_resource_owner_update_zone(uint32_t zoneid,
                insert_resource_owner(zone,owner->class,owner->rset,owner->res);
             else
                update_resource_owner(zone,owner->class,owner->rset,owner->res);
+
+            *old = *owner;
+        }
+    }
+
+    mrp_resource_client_end_recalc();
+}
+
+void mrp_resource_owner_get_stats(mrp_resource_owner_stats_t *stats)
+{
+    if (stats)
+        *stats = owner_stats;
+}
+
+void mrp_resource_owner_abort_updates(void)
+{
+    uint32_t zoneid;
+
+    /* the updates using the scratch buffers are gone for good */
+    for (zoneid = 0;  zoneid < MRP_ZONE_MAX;  zoneid++)
+        scratch[zoneid].busy = false;
+}
+
+int mrp_resource_owner_probe_zone(uint32_t zoneid,
+                                  mrp_resource_set_t *reqset,
+                                  mrp_resource_mask_t *grantp,
+                                  mrp_resource_mask_t *advicep,
+                                  uint32_t *preempted,
+                                  uint32_t npreempted)
+{
+    /*
+     * Notes:
+     *   This is a dry-run of mrp_resource_owner_update_zone() as if
+     *   reqset had just been acquired. Ownership is resolved in a scratch
+     *   owner table on the stack, so resource_owners, the owner tables
+     *   in the database and the resource sets themselves are left intact
+     *   and no events are sent. Resource managers are not consulted, as
+     *   their allocate/free hooks are not free of side effects.
+     */
+
+    mrp_resource_owner_t owners[MRP_RESOURCE_MAX];
+    mrp_zone_t *zone;
+    mrp_application_class_t *class;
+    mrp_resource_set_t *rset;
+    mrp_resource_mask_t grant;
+    mrp_resource_mask_t advice;
+    mrp_resource_mask_t reqgrant;
+    mrp_resource_mask_t reqadvice;
+    mrp_resource_state_t reqstate;
+    void *clc, *rsc;
+    uint32_t reqkey;
+    uint32_t npreempt;
+    uint32_t i;
+    bool force_release;
+    bool probed;
+
+    MRP_ASSERT(zoneid < MRP_ZONE_MAX && reqset, "invalid argument");
+    MRP_ASSERT(!npreempted || preempted, "invalid argument");
+
+    if (!(zone = mrp_zone_find_by_id(zoneid)) || !reqset->class.ptr)
+        return -1;
+
+    memset(owners, 0, sizeof(owners));
+
+    for (i = 0;  i < MRP_RESOURCE_MAX;  i++)
+        owners[i].share = true;
+
+    reserve_owners(zoneid, owners);
+
+    /* the veto script should see the request set in the state it is
+       probed for; this is undone before returning */
+    reqstate = reqset->state;
+    reqset->state = mrp_resource_acquire;
+
+    reqkey    = mrp_application_class_get_acquire_key(reqset);
+    reqgrant  = 0;
+    reqadvice = 0;
+    npreempt  = 0;
+    probed    = false;
+    clc       = NULL;
+
+    while ((class = mrp_application_class_iterate_classes(&clc))) {
+        rsc = NULL;
+
+        while ((rset=mrp_application_class_iterate_rsets(class,zoneid,&rsc))) {
+            if (rset == reqset)
+                continue;
+
+            if (!probed && class == reqset->class.ptr &&
+                mrp_application_class_get_sorting_key(rset) <= reqkey)
+            {
+                reqgrant = update_resource_set(owners, zone, class, reqset,
+                                               mrp_resource_acquire, reqset,
+                                               &reqadvice, &force_release,
+                                               true);
+                if (force_release)
+                    reqgrant = 0;
+
+                probed = true;
+            }
+
+            grant = update_resource_set(owners, zone, class, rset,
+                                        rset->state, reqset, &advice,
+                                        &force_release, true);
+
+            if (force_release)
+                grant = 0;
+
+            if ((rset->resource.mask.grant & ~grant)) {
+                if (npreempt < npreempted)
+                    preempted[npreempt] = rset->id;
+                npreempt++;
+            }
+        }
+
+        if (!probed && class == reqset->class.ptr) {
+            reqgrant = update_resource_set(owners, zone, class, reqset,
+                                           mrp_resource_acquire, reqset,
+                                           &reqadvice, &force_release, true);
+            if (force_release)
+                reqgrant = 0;
+
+            probed = true;
         }
     }
+
+    reqset->state = reqstate;
+
+    mrp_resource_lua_set_owners(zone, get_owner(zoneid, 0));
+
+    if (grantp)
+        *grantp = reqgrant;
+    if (advicep)
+        *advicep = reqadvice;
+
+    return (int)npreempt;
 }
 
 int mrp_resource_owner_print(char *buf, int len)
@@ -476,26 +568,149 @@ static mrp_resource_owner_t *get_owner(uint32_t zone, uint32_t resid)
     return resource_owners + (zone * MRP_RESOURCE_MAX + resid);
 }
 
-static void reset_owners(uint32_t zone, mrp_resource_owner_t *oldowners)
+static void reset_owners(uint32_t zone)
 {
     mrp_resource_owner_t *owners = get_owner(zone, 0);
     size_t size = sizeof(mrp_resource_owner_t) * MRP_RESOURCE_MAX;
     size_t i;
 
-    if (oldowners)
-        memcpy(oldowners, owners, size);
-
     memset(owners, 0, size);
 
     for (i = 0;   i < MRP_RESOURCE_MAX;   i++)
         owners[i].share = true;
 }
 
+/*
+ * A resource set of a class with a grace period keeps the resources it
+ * has been granted while it stays acquiring: before the update they are
+ * reserved for it, so no set with a higher priority can be granted them
+ * in the meantime. Once the set itself is up for arbitration it drops
+ * its reservation and competes normally. A reservation that has denied
+ * a resource from some other set starts the grace period of the set it
+ * is held for. When the grace period expires the zone is recalculated
+ * without the reservation, and the set loses its resources as usual.
+ */
+static void reserve_owners(uint32_t zoneid, mrp_resource_owner_t *owners)
+{
+    mrp_application_class_t *class;
+    mrp_resource_set_t *rset;
+    mrp_resource_owner_t *owner;
+    mrp_resource_t *res;
+    mrp_resource_mask_t mask;
+    void *clc, *rsc, *rc;
+    uint32_t rid;
+
+    clc = NULL;
+
+    while ((class = mrp_application_class_iterate_classes(&clc))) {
+        if (!class->grace)
+            continue;
+
+        rsc = NULL;
+
+        while ((rset=mrp_application_class_iterate_rsets(class,zoneid,&rsc))) {
+            if (rset->state != mrp_resource_acquire ||
+                !rset->resource.mask.grant || rset->hold.expired)
+                continue;
+
+            rc = NULL;
+
+            while ((res = mrp_resource_set_iterate_resources(rset, &rc))) {
+                rid   = res->def->id;
+                mask  = (mrp_resource_mask_t)1 << rid;
+                owner = owners + rid;
+
+                if (!(rset->resource.mask.grant & mask) || owner->rset)
+                    continue;
+
+                owner->class    = class;
+                owner->rset     = rset;
+                owner->res      = res;
+                owner->share    = class->share && res->shared;
+                owner->reserved = true;
+            }
+        }
+    }
+}
+
+static void drop_reservation(mrp_resource_owner_t *owner,
+                             mrp_resource_set_t *rset)
+{
+    if (owner->reserved && owner->rset == rset) {
+        memset(owner, 0, sizeof(*owner));
+        owner->share = true;
+    }
+}
+
+static void hold_down_owners(uint32_t zoneid)
+{
+    mrp_application_class_t *class;
+    mrp_resource_set_t *rset;
+    void *clc, *rsc;
+
+    clc = NULL;
+
+    while ((class = mrp_application_class_iterate_classes(&clc))) {
+        if (!class->grace)
+            continue;
+
+        rsc = NULL;
+
+        while ((rset=mrp_application_class_iterate_rsets(class,zoneid,&rsc)))
+            mrp_resource_set_hold_down(rset);
+    }
+}
+
+/*
+ * Zone updates collect the resource sets to notify into a per-zone
+ * buffer that is grown geometrically and reused across updates. An
+ * update nested into another one of the same zone (from a resource set
+ * event callback) gets a buffer of its own.
+ */
+static event_t *get_events(uint32_t zoneid, uint32_t nevent)
+{
+    scratch_t *s = scratch + zoneid;
+    uint32_t   size;
+
+    owner_stats.updates++;
+
+    if (s->busy) {
+        owner_stats.allocs++;
+        return mrp_alloc(sizeof(event_t) * nevent);
+    }
+
+    if (s->size < nevent) {
+        for (size = s->size ? s->size : EVENT_SCRATCH_MIN; size < nevent; )
+            size *= 2;
+
+        if (!mrp_realloc(s->events, sizeof(event_t) * size))
+            return NULL;
+
+        s->size = size;
+        owner_stats.allocs++;
+    }
+
+    s->busy = true;
+
+    return s->events;
+}
+
+static void put_events(uint32_t zoneid, event_t *events)
+{
+    scratch_t *s = scratch + zoneid;
+
+    if (events == s->events)
+        s->busy = false;
+    else
+        mrp_free(events);
+}
+
 static bool grant_ownership(mrp_resource_owner_t    *owner,
                             mrp_zone_t              *zone,
                             mrp_application_class_t *class,
                             mrp_resource_set_t      *rset,
-                            mrp_resource_t          *res)
+                            mrp_resource_t          *res,
+                            bool                     dry_run)
 {
     mrp_resource_def_t      *rdef = res->def;
     mrp_resource_mgr_ftbl_t *ftbl = rdef->manager.ftbl;
@@ -531,7 +746,7 @@ static bool grant_ownership(mrp_resource_owner_t    *owner,
 
     } while(0);
 
-    if (ftbl && ftbl->allocate) {
+    if (!dry_run && ftbl && ftbl->allocate) {
         if (!ftbl->allocate(zone, res, rdef->manager.userdata))
             return false;
     }
@@ -552,7 +767,8 @@ static bool advice_ownership(mrp_resource_owner_t    *owner,
                              mrp_zone_t              *zone,
                              mrp_application_class_t *class,
                              mrp_resource_set_t      *rset,
-                             mrp_resource_t          *res)
+                             mrp_resource_t          *res,
+                             bool                     dry_run)
 {
     mrp_resource_def_t      *rdef = res->def;
     mrp_resource_mgr_ftbl_t *ftbl = rdef->manager.ftbl;
@@ -587,7 +803,7 @@ static bool advice_ownership(mrp_resource_owner_t    *owner,
 
     } while(0);
 
-    if (ftbl && ftbl->advice) {
+    if (!dry_run && ftbl && ftbl->advice) {
         if (!ftbl->advice(zone, res, rdef->manager.userdata))
             return false;
     }
@@ -595,6 +811,120 @@ static bool advice_ownership(mrp_resource_owner_t    *owner,
     return true;
 }
 
+/*
+ * Arbitrate a single resource set against the owners resolved so far.
+ * This is the per-set pass of both zone updates and ownership probes.
+ * With dry_run nothing but the given owner table is touched: resource
+ * managers are not consulted and no contention is recorded.
+ */
+static mrp_resource_mask_t update_resource_set(mrp_resource_owner_t *owners,
+                                               mrp_zone_t *zone,
+                                               mrp_application_class_t *class,
+                                               mrp_resource_set_t *rset,
+                                               mrp_resource_state_t state,
+                                               mrp_resource_set_t *reqset,
+                                               mrp_resource_mask_t *advicep,
+                                               bool *force_releasep,
+                                               bool dry_run)
+{
+    mrp_resource_owner_t backup[MRP_RESOURCE_MAX];
+    mrp_resource_owner_t *owner;
+    mrp_resource_t *res;
+    mrp_resource_def_t *rdef;
+    mrp_resource_mgr_ftbl_t *ftbl;
+    mrp_resource_mask_t mask;
+    mrp_resource_mask_t mandatory;
+    mrp_resource_mask_t grant;
+    mrp_resource_mask_t advice;
+    uint32_t rid;
+    void *rc;
+    bool force_release;
+
+    mandatory = rset->resource.mask.mandatory;
+    grant = 0;
+    advice = 0;
+    force_release = false;
+    rc = NULL;
+
+    switch (state) {
+
+    case mrp_resource_acquire:
+        while ((res = mrp_resource_set_iterate_resources(rset, &rc))) {
+            rid   = res->def->id;
+            owner = owners + rid;
+
+            drop_reservation(owner, rset);
+
+            backup[rid] = *owner;
+
+            if (grant_ownership(owner, zone, class, rset, res, dry_run))
+                grant |= ((mrp_resource_mask_t)1 << rid);
+            else {
+                if (owner->rset != rset) {
+                    force_release |= owner->modal;
+
+                    if (owner->reserved && !dry_run)
+                        owner->rset->hold.contended = true;
+                }
+            }
+        }
+        if ((grant & mandatory) == mandatory &&
+            mrp_resource_lua_veto(zone, rset, owners, grant, reqset))
+        {
+            advice = grant;
+        }
+        else {
+            /* rollback, ie. restore the backed up state */
+            rc = NULL;
+            while ((res = mrp_resource_set_iterate_resources(rset, &rc))) {
+                rdef  = res->def;
+                rid   = rdef->id;
+                mask  = (mrp_resource_mask_t)1 << rid;
+                owner = owners + rid;
+
+                *owner = backup[rid];
+
+                if ((grant & mask) && !dry_run) {
+                    if ((ftbl = rdef->manager.ftbl) && ftbl->free)
+                        ftbl->free(zone, res, rdef->manager.userdata);
+                }
+
+                if (advice_ownership(owner, zone, class, rset, res, dry_run))
+                    advice |= mask;
+            }
+
+            grant = 0;
+
+            if ((advice & mandatory) != mandatory)
+                advice = 0;
+
+            if (!dry_run)
+                mrp_resource_lua_set_owners(zone, owners);
+        }
+        break;
+
+    case mrp_resource_release:
+        while ((res = mrp_resource_set_iterate_resources(rset, &rc))) {
+            rid   = res->def->id;
+            owner = owners + rid;
+
+            if (advice_ownership(owner, zone, class, rset, res, dry_run))
+                advice |= ((mrp_resource_mask_t)1 << rid);
+        }
+        if ((advice & mandatory) != mandatory)
+            advice = 0;
+        break;
+
+    default:
+        break;
+    }
+
+    *advicep = advice;
+    *force_releasep = force_release;
+
+    return grant;
+}
+
 static void manager_start_transaction(mrp_zone_t *zone)
 {
     mrp_resource_def_t *rdef;
@@ -45,11 +45,16 @@ struct mrp_resource_owner_s {
     bool                     modal;
     bool                     share;
     bool                     release;
+    bool                     reserved; /* held for a set in grace period */
 };
 
 
 int  mrp_resource_owner_create_database_table(mrp_resource_def_t *);
 void mrp_resource_owner_update_zone(uint32_t, mrp_resource_set_t *, uint32_t);
+int  mrp_resource_owner_probe_zone(uint32_t, mrp_resource_set_t *,
+                                   mrp_resource_mask_t *, mrp_resource_mask_t *,
+                                   uint32_t *, uint32_t);
+void mrp_resource_owner_abort_updates(void);
 
 
 #endif  /* __MURPHY_RESOURCE_OWNER_H__ */
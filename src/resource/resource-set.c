@@ -35,6 +35,7 @@
 #include <murphy/common/utils.h>
 #include <murphy/common/log.h>
 #include <murphy/common/mainloop.h>
+#include <murphy/core/lua-bindings/murphy.h>
 
 #include <murphy-db/mqi.h>
 
@@ -66,6 +67,7 @@ static mrp_resource_t *find_resource_by_id(mrp_resource_set_t *, uint32_t);
 #endif
 
 static uint32_t get_request_stamp(void);
+static void hold_down_cb(mrp_timer_t *, void *);
 static const char *state_str(mrp_resource_state_t);
 static void send_rset_event(mrp_resource_set_t *rset,
         mrp_resource_event_t ev);
@@ -128,40 +130,126 @@ mrp_resource_set_t *mrp_resource_set_create(mrp_resource_client_t *client,
     return rset;
 }
 
-void mrp_resource_set_destroy(mrp_resource_set_t *rset)
+static void unregister_resource_set(mrp_resource_set_t *rset)
+{
+    send_rset_event(rset, MRP_RESOURCE_EVENT_DESTROYED);
+
+    mrp_resource_lua_unregister_resource_set(rset);
+    remove_from_id_hash(rset);
+}
+
+static void free_resource_set(mrp_resource_set_t *rset)
 {
-    mrp_resource_state_t state;
     mrp_list_hook_t *entry, *n;
     mrp_resource_t *res;
 
+    mrp_list_foreach(&rset->resource.list, entry, n) {
+        res = mrp_list_entry(entry, mrp_resource_t, list);
+        mrp_resource_notify(res, rset, MRP_RESOURCE_EVENT_DESTROYED);
+        mrp_resource_destroy(res);
+    }
+
+    mrp_list_delete(&rset->list);
+    mrp_list_delete(&rset->client.list);
+    mrp_list_delete(&rset->class.list);
+
+    mrp_free(rset);
+
+    if (resource_set_count > 0)
+        resource_set_count--;
+}
+
+void mrp_resource_set_destroy(mrp_resource_set_t *rset)
+{
+    mrp_resource_state_t state;
+
     if (rset) {
         state = rset->state;
 
         rset->event = NULL; /* make sure nothing is sent any more */
 
-        send_rset_event(rset, MRP_RESOURCE_EVENT_DESTROYED);
+        mrp_del_timer(rset->hold.timer);
+        rset->hold.timer = NULL;
 
-        mrp_resource_lua_unregister_resource_set(rset);
-        remove_from_id_hash(rset);
+        unregister_resource_set(rset);
 
         if (state == mrp_resource_acquire)
             mrp_resource_set_release(rset, MRP_RESOURCE_REQNO_INVALID);
 
-        mrp_list_foreach(&rset->resource.list, entry, n) {
-            res = mrp_list_entry(entry, mrp_resource_t, list);
-            mrp_resource_notify(res, rset, MRP_RESOURCE_EVENT_DESTROYED);
-            mrp_resource_destroy(res);
+        free_resource_set(rset);
+    }
+}
+
+void mrp_resource_set_destroy_client_sets(mrp_resource_client_t *client)
+{
+    mrp_list_hook_t *entry, *n;
+    mrp_resource_set_t *rset;
+    mrp_zone_mask_t zones;
+    uint32_t zone, nrset;
+    mqi_handle_t trh;
+
+    MRP_ASSERT(client, "invalid argument");
+
+    /*
+     * Releasing and destroying the sets one by one would recalculate
+     * their zone once for every acquired set. Instead, release all of
+     * them quietly first, then recalculate every affected zone exactly
+     * once and finally destroy the sets. The whole teardown is a single
+     * recalculation as far as event coalescing goes.
+     */
+
+    mrp_resource_client_start_recalc();
+
+    zones = 0;
+    nrset = 0;
+
+    mrp_list_foreach(&client->resource_sets, entry, n) {
+        rset = mrp_list_entry(entry, mrp_resource_set_t, client.list);
+
+        rset->event = NULL;
+
+        mrp_del_timer(rset->hold.timer);
+        rset->hold.timer = NULL;
+
+        if (rset->state == mrp_resource_acquire) {
+            rset->state = mrp_resource_release;
+
+            if (rset->class.ptr) {
+                rset->request.id = MRP_RESOURCE_REQNO_INVALID;
+                rset->request.stamp = get_request_stamp();
+
+                mrp_application_class_move_resource_set(rset);
+                mrp_resource_set_notify(rset, MRP_RESOURCE_EVENT_RELEASE);
+
+                zones |= ((mrp_zone_mask_t)1) << rset->zone;
+            }
         }
 
-        mrp_list_delete(&rset->list);
-        mrp_list_delete(&rset->client.list);
-        mrp_list_delete(&rset->class.list);
+        nrset++;
+    }
 
-        mrp_free(rset);
+    if (zones) {
+        trh = mqi_begin_transaction();
+
+        for (zone = 0; zone < MRP_ZONE_MAX; zone++) {
+            if (zones & (((mrp_zone_mask_t)1) << zone))
+                mrp_resource_owner_update_zone(zone, NULL, 0);
+        }
+
+        mqi_commit_transaction(trh);
+    }
+
+    mrp_list_foreach(&client->resource_sets, entry, n) {
+        rset = mrp_list_entry(entry, mrp_resource_set_t, client.list);
 
-        if (resource_set_count > 0)
-            resource_set_count--;
+        unregister_resource_set(rset);
+        free_resource_set(rset);
     }
+
+    mrp_debug("destroyed %u resource sets of client '%s', zone mask 0x%x",
+              nrset, client->name, zones);
+
+    mrp_resource_client_end_recalc();
 }
 
 mrp_resource_set_t *mrp_resource_set_find_by_id(uint32_t id)
@@ -350,6 +438,23 @@ void mrp_resource_set_acquire(mrp_resource_set_t *rset, uint32_t reqid)
     }
 }
 
+int mrp_resource_set_probe_acquire(mrp_resource_set_t *rset,
+                                   mrp_resource_mask_t *grant,
+                                   mrp_resource_mask_t *advice,
+                                   uint32_t *preempted,
+                                   uint32_t npreempted)
+{
+    MRP_ASSERT(rset, "invalid argument");
+
+    mrp_debug("probing acquisition of resource set #%d", rset->id);
+
+    if (!rset->class.ptr)
+        return -1;
+
+    return mrp_resource_owner_probe_zone(rset->zone, rset, grant, advice,
+                                         preempted, npreempted);
+}
+
 void mrp_resource_set_release(mrp_resource_set_t *rset, uint32_t reqid)
 {
     mqi_handle_t trh;
@@ -406,6 +511,50 @@ void mrp_resource_set_updated(mrp_resource_set_t *rset)
     }
 }
 
+void mrp_resource_set_hold_down(mrp_resource_set_t *rset)
+{
+    /*
+     * Notes:
+     *   Called after every update of the zone for the resource sets of
+     *   classes with a grace period. The resources granted to such a set
+     *   are reserved for it while it stays acquiring (see reserve_owners()
+     *   in resource-owner.c), so it keeps owning them. If the reservation
+     *   has kept them from some other set, the set is pending-loss and
+     *   the grace period is started. If nobody wants them any more by the
+     *   time it expires, nothing gets reported at all. Otherwise the zone
+     *   is recalculated without the reservation and the set loses them.
+     */
+
+    mrp_application_class_t *class     = rset->class.ptr;
+    bool                     contended = rset->hold.contended;
+    mrp_context_t           *ctx;
+
+    rset->hold.contended = false;
+
+    if (rset->hold.expired) {
+        rset->hold.expired = false;
+        return;
+    }
+
+    if (contended) {
+        if (!rset->hold.timer && (ctx = mrp_lua_get_murphy_context())) {
+            rset->hold.timer = mrp_add_timer(ctx->ml, class->grace,
+                                             hold_down_cb, rset);
+
+            if (rset->hold.timer != NULL)
+                mrp_debug("resource set #%u is pending-loss for %u msecs",
+                          rset->id, class->grace);
+        }
+    }
+    else if (rset->hold.timer) {
+        mrp_del_timer(rset->hold.timer);
+        rset->hold.timer = NULL;
+
+        mrp_debug("resource set #%u kept its resources over the grace "
+                  "period", rset->id);
+    }
+}
+
 
 MRP_REGISTER_EVENTS(resource_events,
        MRP_EVENT(MURPHY_RESOURCE_EVENT_CREATED  , MRP_RESOURCE_EVENT_CREATED  ),
@@ -500,7 +649,7 @@ int mrp_resource_set_print(mrp_resource_set_t *rset, size_t indent,
 
     mandatory = rset->resource.mask.mandatory;
 
-    PRINT("%s%3u - 0x%02x/0x%02x 0x%02x/0x%02x 0x%08x %d %s%s%s %s\n",
+    PRINT("%s%3u - 0x%02x/0x%02x 0x%02x/0x%02x 0x%08x %d %s%s%s %s%s\n",
           gap, rset->id,
           rset->resource.mask.all, mandatory,
           rset->resource.mask.grant, rset->resource.mask.advice,
@@ -508,7 +657,8 @@ int mrp_resource_set_print(mrp_resource_set_t *rset, size_t indent,
           rset->resource.share ? "shared   ":"exclusive",
           rset->auto_release.client ? ",autorelease" : "",
           rset->dont_wait.client ? ",dontwait" : "",
-          state_str(rset->state));
+          state_str(rset->state),
+          rset->hold.timer ? " (pending-loss)" : "");
 
     mrp_list_foreach(&rset->resource.list, resen, n) {
         res = mrp_list_entry(resen, mrp_resource_t, list);
@@ -634,6 +784,20 @@ static mrp_resource_t *find_resource_by_id(mrp_resource_set_t *rset,
 }
 #endif
 
+static void hold_down_cb(mrp_timer_t *t, void *user_data)
+{
+    mrp_resource_set_t *rset = (mrp_resource_set_t *)user_data;
+
+    mrp_del_timer(t);
+    rset->hold.timer = NULL;
+
+    mrp_debug("grace period of resource set #%u expired", rset->id);
+
+    rset->hold.expired = true;
+
+    mrp_resource_owner_update_zone(rset->zone, NULL, 0);
+}
+
 static uint32_t get_request_stamp(void)
 {
     static uint32_t  stamp;
@@ -31,6 +31,7 @@
 #define __MURPHY_RESOURCE_SET_H__
 
 #include <murphy/common/list.h>
+#include <murphy/common/mainloop.h>
 
 #include "data-types.h"
 
@@ -80,17 +81,25 @@ struct mrp_resource_set_s {
         uint32_t id;
         uint32_t stamp;
     }                               request;
+    struct {
+        mrp_timer_t *timer;         /* pending-loss hold-down timer */
+        bool contended;             /* reservation denied from another set */
+        bool expired;               /* grace period over, drop reservation */
+    }                               hold;
     mrp_resource_event_cb_t         event;
     void                           *user_data;
 };
 
 
 mrp_resource_set_t *mrp_resource_set_find_by_id(uint32_t);
+void                mrp_resource_set_destroy_client_sets(
+                                                     mrp_resource_client_t *);
 mrp_resource_t     *mrp_resource_set_find_resource(uint32_t, const char *);
 uint32_t            mrp_get_resource_set_count(void);
 void                mrp_resource_set_updated(mrp_resource_set_t *);
 void                mrp_resource_set_notify(mrp_resource_set_t *,
                                             mrp_resource_event_t);
+void                mrp_resource_set_hold_down(mrp_resource_set_t *);
 void                mrp_resource_set_request_auto_release(mrp_resource_set_t *,
                                                           bool);
 void                mrp_resource_set_request_dont_wait(mrp_resource_set_t *,
@@ -0,0 +1,748 @@
+/*
+ * Copyright (c) 2014, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Intel Corporation nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Resource library test.
+ *
+ * Sets up a single zone with a single exclusive resource and two
+ * application classes directly through the C configuration API, then
+ * drives resource sets of a few clients through the client API, counting
+ * the events they get.
+ *
+ *   - flapping: a higher priority set acquires and releases the resource
+ *     held by a low priority one over and over. With a grace period on
+ *     its class, the low priority set keeps the resource and none of this
+ *     is reported to it, only the final loss once the grace period
+ *     expires. Without a grace period every loss and regrant is reported.
+ *     Either way the resource has a single owner at any time.
+ *
+ *   - disconnect: a client with a bunch of acquired sets goes away. All
+ *     of its sets are torn down with a single zone recalculation, while
+ *     destroying the same sets one by one takes one for each of them.
+ *     Either way a set waiting for the resource gets a single event.
+ *
+ *   - churn: a high priority set is acquired and released over and over
+ *     on top of a zone full of waiting sets. Ownership updates reuse
+ *     per-zone scratch buffers, so once these have grown to fit the zone
+ *     no more allocations are needed, however many updates are done.
+ *
+ *   - probing: on top of the same zone full of waiting sets, probing an
+ *     acquisition tells the would-be grant and the sets it would preempt,
+ *     which then match what actually acquiring the set does.
+ *
+ *   - Lua heap limit: Lua policy code run from an event callback, ie. in
+ *     the middle of a recalculation with the garbage collector stopped,
+ *     churns through far more garbage than there is room for below the
+ *     heap limit. The collector is restarted instead of failing the
+ *     allocations. A Lua error raised within a recalculation started from
+ *     Lua does not leave the recalculation (and the collector pause) open.
+ *
+ * With -b [updates] only the churn and the probing are run, as a
+ * benchmark: they report the time and the number of scratch allocations
+ * per ownership update, and the time per probe against that per
+ * acquire/release pair.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include <murphy/common.h>
+#include <murphy/core.h>
+#include <murphy/core/lua-bindings/murphy.h>
+#include <murphy/core/lua-utils/budget.h>
+#include <murphy/resource/config-api.h>
+#include <murphy/resource/manager-api.h>
+#include <murphy/resource/client-api.h>
+
+#define ZONE      "driver"               /* the only zone */
+#define RESOURCE  "audio_playback"       /* the only resource */
+#define LOW       "player"               /* low priority class */
+#define HIGH      "phone"                /* high priority class */
+#define GRACE     100                    /* grace period, msecs */
+#define NFLAP     50                     /* preemptions to flap through */
+#define NSET      20                     /* sets of a disconnecting client */
+#define NCHURN    64                     /* waiting sets during churn */
+#define NUPDATE   2000                   /* updates to churn through */
+#define MAXALLOC  8                      /* max. allocations during churn */
+#define NBENCH    100000                 /* default updates to benchmark */
+#define TIMEOUT   (10 * 1000)            /* test timeout */
+
+#define GARBAGE "local t; for i = 1, 100000 do t = { i } end"
+
+
+typedef struct {
+    mrp_resource_set_t *rset;
+    int                 nevent;          /* events received */
+    mrp_resource_mask_t grant;           /* last grant reported */
+} rset_t;
+
+static mrp_context_t           *ctx;
+static mrp_application_class_t *low;
+static uint32_t                 zoneid;
+
+
+static void rset_event(uint32_t reqid, mrp_resource_set_t *rset,
+                       void *user_data)
+{
+    rset_t *r = (rset_t *)user_data;
+
+    MRP_UNUSED(reqid);
+
+    r->nevent++;
+    r->grant = mrp_get_resource_set_grant(rset);
+}
+
+
+static void setup(void)
+{
+    mrp_application_class_t *high;
+    uint32_t                 rid;
+
+    if ((ctx = mrp_context_create()) == NULL ||
+        mrp_lua_set_murphy_context(ctx) == NULL) {
+        mrp_log_error("Failed to create murphy context.");
+        exit(1);
+    }
+
+    mrp_resource_configuration_init();
+
+    if (mrp_zone_definition_create(NULL) < 0 ||
+        (zoneid = mrp_zone_create(ZONE, NULL)) == MRP_ZONE_ID_INVALID) {
+        mrp_log_error("Failed to create zone '%s'.", ZONE);
+        exit(1);
+    }
+
+    rid = mrp_resource_definition_create(RESOURCE, false, NULL, NULL, NULL);
+
+    if (rid == MRP_RESOURCE_ID_INVALID) {
+        mrp_log_error("Failed to create resource '%s'.", RESOURCE);
+        exit(1);
+    }
+
+    mrp_lua_resclass_create_from_c(rid);
+
+    low  = mrp_application_class_create(LOW, 1, false, false,
+                                        MRP_RESOURCE_ORDER_FIFO);
+    high = mrp_application_class_create(HIGH, 2, false, false,
+                                        MRP_RESOURCE_ORDER_FIFO);
+
+    if (low == NULL || high == NULL) {
+        mrp_log_error("Failed to create application classes.");
+        exit(1);
+    }
+}
+
+
+static void create_rset(rset_t *r, mrp_resource_client_t *client,
+                        const char *class)
+{
+    mrp_clear(r);
+
+    r->rset = mrp_resource_set_create(client, false, false, 0,
+                                      rset_event, r);
+
+    if (r->rset == NULL ||
+        mrp_resource_set_add_resource(r->rset, RESOURCE, false, NULL,
+                                      true) < 0 ||
+        mrp_application_class_add_resource_set(class, ZONE, r->rset, 0) < 0) {
+        mrp_log_error("Failed to create %s resource set.", class);
+        exit(1);
+    }
+
+    r->nevent = 0;                       /* ignore the creation event */
+}
+
+
+static mrp_resource_client_t *create_client(const char *name)
+{
+    mrp_resource_client_t *client;
+
+    if ((client = mrp_resource_client_create(name, NULL)) == NULL) {
+        mrp_log_error("Failed to create resource client '%s'.", name);
+        exit(1);
+    }
+
+    return client;
+}
+
+
+static void timeout_cb(mrp_timer_t *t, void *user_data)
+{
+    MRP_UNUSED(t);
+    MRP_UNUSED(user_data);
+
+    mrp_log_error("Test timed out.");
+    exit(1);
+}
+
+
+static void wait_timeout(mrp_timer_t *t, void *user_data)
+{
+    MRP_UNUSED(t);
+
+    *(bool *)user_data = true;
+}
+
+
+static void wait_events(rset_t *r, int nevent, int msecs)
+{
+    mrp_timer_t *t;
+    bool         expired = false;
+
+    t = mrp_add_timer(ctx->ml, msecs, wait_timeout, &expired);
+
+    while (r->nevent < nevent && !expired)
+        mrp_mainloop_iterate(ctx->ml);
+
+    mrp_del_timer(t);
+}
+
+
+static int check_owner(rset_t *l, rset_t *h, int i)
+{
+    mrp_resource_mask_t lgrant, hgrant;
+
+    lgrant = mrp_get_resource_set_grant(l->rset);
+    hgrant = mrp_get_resource_set_grant(h->rset);
+
+    if (lgrant != l->grant || hgrant != h->grant) {
+        mrp_log_error("Preemption #%d: grants 0x%x/0x%x, reported 0x%x/0x%x.",
+                      i, lgrant, hgrant, l->grant, h->grant);
+        return 1;
+    }
+
+    if (lgrant && hgrant) {
+        mrp_log_error("Preemption #%d: exclusive resource granted to both "
+                      "sets.", i);
+        return 1;
+    }
+
+    if (!lgrant && !hgrant) {
+        mrp_log_error("Preemption #%d: resource granted to neither set.", i);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+static int flap(uint32_t grace, int *neventp)
+{
+    mrp_resource_client_t *lc, *hc;
+    rset_t                 l, h;
+    int                    i, nevent, failed;
+
+    failed = 0;
+
+    mrp_application_class_set_grace(low, grace);
+
+    lc = create_client("low");
+    hc = create_client("high");
+
+    create_rset(&l, lc, LOW);
+    create_rset(&h, hc, HIGH);
+
+    mrp_resource_set_acquire(l.rset, 1);
+
+    if (l.nevent != 1 || l.grant == 0) {
+        mrp_log_error("Low priority set not granted.");
+        failed++;
+    }
+
+    for (i = 0; i < NFLAP; i++) {
+        mrp_resource_set_acquire(h.rset, 2 + 2 * i);
+        failed += check_owner(&l, &h, i);
+        mrp_resource_set_release(h.rset, 3 + 2 * i);
+    }
+
+    if (l.grant == 0) {
+        mrp_log_error("Low priority set left without its resource.");
+        failed++;
+    }
+
+    if (h.nevent != 2 * NFLAP) {
+        mrp_log_error("High priority set got %d events for %d requests.",
+                      h.nevent, 2 * NFLAP);
+        failed++;
+    }
+
+    mrp_resource_set_acquire(h.rset, 2 + 2 * NFLAP);
+    nevent = l.nevent;
+
+    wait_events(&l, nevent + 1, 2 * grace + 100);
+
+    if (l.grant != 0 || h.grant == 0) {
+        mrp_log_error("Low priority set not told about its final loss.");
+        failed++;
+    }
+
+    failed += check_owner(&l, &h, NFLAP);
+
+    nevent = l.nevent;
+
+    mrp_log_info("%d preemptions, grace period %u msecs: %d events to the "
+                 "preempted set", NFLAP, grace, nevent);
+
+    mrp_resource_client_destroy(hc);
+    mrp_resource_client_destroy(lc);
+
+    *neventp = nevent;
+
+    return failed;
+}
+
+
+static int disconnect(bool by_client, uint64_t *updatesp)
+{
+    mrp_resource_owner_stats_t before, after;
+    mrp_resource_client_t     *mc, *oc;
+    rset_t                     m[NSET], o;
+    uint32_t                   seqno;
+    int                        i, failed;
+
+    failed = 0;
+
+    mc = create_client("many");
+    oc = create_client("other");
+
+    for (i = 0; i < NSET; i++) {
+        create_rset(m + i, mc, LOW);
+        mrp_resource_set_acquire(m[i].rset, 1);
+    }
+
+    create_rset(&o, oc, LOW);
+    mrp_resource_set_acquire(o.rset, 1);
+
+    if (m[0].grant == 0) {
+        mrp_log_error("First set of the client not granted.");
+        failed++;
+    }
+
+    o.nevent = 0;
+
+    mrp_resource_owner_get_stats(&before);
+    seqno = mrp_resource_client_get_recalc_seqno();
+
+    if (by_client)
+        mrp_resource_client_destroy(mc);
+    else {
+        for (i = 0; i < NSET; i++)
+            mrp_resource_set_destroy(m[i].rset);
+    }
+
+    mrp_resource_owner_get_stats(&after);
+    seqno = mrp_resource_client_get_recalc_seqno() - seqno;
+
+    if (o.nevent != 1 || o.grant == 0) {
+        mrp_log_error("Waiting set got %d events, grant 0x%x.", o.nevent,
+                      o.grant);
+        failed++;
+    }
+
+    if (by_client && seqno != 1) {
+        mrp_log_error("%u recalculations for a disconnect.", seqno);
+        failed++;
+    }
+
+    mrp_log_info("destroying %d acquired sets %s: %llu zone updates, "
+                 "%u recalculations", NSET,
+                 by_client ? "with their client" : "one by one",
+                 (unsigned long long)(after.updates - before.updates), seqno);
+
+    if (!by_client)
+        mrp_resource_client_destroy(mc);
+    mrp_resource_client_destroy(oc);
+
+    *updatesp = after.updates - before.updates;
+
+    return failed;
+}
+
+
+static int churn(int nupdate, uint64_t *allocsp)
+{
+    mrp_resource_owner_stats_t before, after;
+    mrp_resource_client_t     *wc, *hc;
+    rset_t                    *w, h;
+    struct timespec            start, end;
+    uint64_t                   nsecs, updates, allocs;
+    int                        i, failed;
+
+    failed = 0;
+
+    wc = create_client("waiting");
+    hc = create_client("churning");
+
+    if ((w = mrp_allocz_array(rset_t, NCHURN)) == NULL) {
+        mrp_log_error("Failed to allocate resource sets.");
+        exit(1);
+    }
+
+    for (i = 0; i < NCHURN; i++) {
+        create_rset(w + i, wc, LOW);
+        mrp_resource_set_acquire(w[i].rset, 1);
+    }
+
+    create_rset(&h, hc, HIGH);
+
+    mrp_resource_owner_get_stats(&before);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < nupdate / 2; i++) {
+        mrp_resource_set_acquire(h.rset, 1);
+        mrp_resource_set_release(h.rset, 2);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    mrp_resource_owner_get_stats(&after);
+
+    nsecs   = (end.tv_sec - start.tv_sec) * 1000000000ULL +
+        end.tv_nsec - start.tv_nsec;
+    updates = after.updates - before.updates;
+    allocs  = after.allocs  - before.allocs;
+
+    mrp_log_info("%llu ownership updates with %d sets: %llu allocations "
+                 "(%.4f per update), %.2f usecs per update",
+                 (unsigned long long)updates, NCHURN + 1,
+                 (unsigned long long)allocs,
+                 updates ? (double)allocs / updates : 0.0,
+                 updates ? nsecs / 1000.0 / updates : 0.0);
+
+    if (updates < (uint64_t)nupdate) {
+        mrp_log_error("%llu ownership updates for %d requests.",
+                      (unsigned long long)updates, nupdate);
+        failed++;
+    }
+
+    mrp_resource_client_destroy(hc);
+    mrp_resource_client_destroy(wc);
+    mrp_free(w);
+
+    *allocsp = allocs;
+
+    return failed;
+}
+
+
+static int probe(int nprobe)
+{
+    mrp_resource_client_t *wc, *hc;
+    rset_t                *w, h;
+    mrp_resource_mask_t    grant, advice;
+    uint32_t               preempted[2];
+    struct timespec        start, mid, end;
+    uint64_t               pnsecs, ansecs;
+    int                    i, npreempt, failed;
+
+    failed = 0;
+
+    wc = create_client("waiting");
+    hc = create_client("probing");
+
+    if ((w = mrp_allocz_array(rset_t, NCHURN)) == NULL) {
+        mrp_log_error("Failed to allocate resource sets.");
+        exit(1);
+    }
+
+    for (i = 0; i < NCHURN; i++) {
+        create_rset(w + i, wc, LOW);
+        mrp_resource_set_acquire(w[i].rset, 1);
+    }
+
+    create_rset(&h, hc, HIGH);
+
+    npreempt = mrp_resource_set_probe_acquire(h.rset, &grant, &advice,
+                                              preempted,
+                                              MRP_ARRAY_SIZE(preempted));
+
+    if (grant == 0 || npreempt != 1 ||
+        preempted[0] != mrp_get_resource_set_id(w[0].rset)) {
+        mrp_log_error("Probe: grant 0x%x, %d sets preempted.", grant,
+                      npreempt);
+        failed++;
+    }
+
+    if (h.nevent != 0 || mrp_get_resource_set_grant(w[0].rset) == 0) {
+        mrp_log_error("Probing changed the zone.");
+        failed++;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < nprobe; i++)
+        mrp_resource_set_probe_acquire(h.rset, &grant, &advice, NULL, 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &mid);
+
+    for (i = 0; i < nprobe; i++) {
+        mrp_resource_set_acquire(h.rset, 1);
+        mrp_resource_set_release(h.rset, 2);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    mrp_resource_set_acquire(h.rset, 3);
+
+    if (mrp_get_resource_set_grant(h.rset) != grant ||
+        mrp_get_resource_set_grant(w[0].rset) != 0) {
+        mrp_log_error("Acquisition does not match the probe.");
+        failed++;
+    }
+
+    pnsecs = (mid.tv_sec - start.tv_sec) * 1000000000ULL +
+        mid.tv_nsec - start.tv_nsec;
+    ansecs = (end.tv_sec - mid.tv_sec) * 1000000000ULL +
+        end.tv_nsec - mid.tv_nsec;
+
+    mrp_log_info("%d probes with %d sets: %.2f usecs per probe, %.2f usecs "
+                 "per acquire/release", nprobe, NCHURN + 1,
+                 nprobe ? pnsecs / 1000.0 / nprobe : 0.0,
+                 nprobe ? ansecs / 1000.0 / nprobe : 0.0);
+
+    mrp_resource_client_destroy(hc);
+    mrp_resource_client_destroy(wc);
+    mrp_free(w);
+
+    return failed;
+}
+
+
+static void garbage_event(uint32_t reqid, mrp_resource_set_t *rset,
+                          void *user_data)
+{
+    lua_State *L = mrp_lua_get_lua_state();
+    int       *status = (int *)user_data;
+
+    MRP_UNUSED(reqid);
+    MRP_UNUSED(rset);
+
+    if (*status != 0)
+        return;
+
+    if (luaL_loadstring(L, GARBAGE) != 0 || mrp_lua_pcall(L, 0, 0, 0) != 0) {
+        mrp_log_error("Lua policy failed: %s", lua_tostring(L, -1));
+        lua_pop(L, 1);
+        *status = -1;
+    }
+    else
+        *status = 1;
+}
+
+
+static void error_event(uint32_t reqid, mrp_resource_set_t *rset,
+                        void *user_data)
+{
+    MRP_UNUSED(reqid);
+    MRP_UNUSED(rset);
+
+    if (*(bool *)user_data)
+        luaL_error(mrp_lua_get_lua_state(), "error within a recalculation");
+}
+
+
+static int acquire_from_lua(lua_State *L)
+{
+    mrp_resource_set_acquire((mrp_resource_set_t *)lua_touserdata(L, 1), 1);
+
+    return 0;
+}
+
+
+static int near_limit(void)
+{
+    lua_State              *L = mrp_lua_get_lua_state();
+    mrp_lua_memory_stats_t  st, after;
+    mrp_resource_client_t  *c;
+    mrp_resource_set_t     *rset;
+    uint32_t                seqno;
+    int                     status, failed;
+    bool                    armed;
+
+    failed = 0;
+    status = 1;                          /* ignore the creation event */
+    armed  = false;
+
+    c = create_client("near-limit");
+    lua_gc(L, LUA_GCCOLLECT, 0);
+    mrp_lua_get_memory_stats(&st);
+
+    /* leave room for the live heap, but not for the garbage */
+    mrp_lua_set_heap_limit(2 * st.used / 1024 + 256);
+
+    rset = mrp_resource_set_create(c, false, false, 0, garbage_event,
+                                   &status);
+
+    if (rset == NULL ||
+        mrp_resource_set_add_resource(rset, RESOURCE, false, NULL, true) < 0 ||
+        mrp_application_class_add_resource_set(LOW, ZONE, rset, 0) < 0) {
+        mrp_log_error("Failed to create resource set.");
+        exit(1);
+    }
+
+    status = 0;
+    mrp_resource_set_acquire(rset, 1);
+    mrp_lua_get_memory_stats(&after);
+
+    if (status != 1 || after.failed != st.failed) {
+        mrp_log_error("Lua policy within a recalculation failed near the "
+                      "heap limit (%u allocations failed).",
+                      after.failed - st.failed);
+        failed++;
+    }
+
+    if (after.pauses == st.pauses || after.skipped == st.skipped) {
+        mrp_log_error("Collector not paused and restarted at the limit.");
+        failed++;
+    }
+
+    mrp_log_info("recalculation near the Lua heap limit: %zu kB used, "
+                 "%zu kB peak, %zu kB limit, %u pauses cut short",
+                 after.used / 1024, after.peak / 1024, after.limit / 1024,
+                 after.skipped - st.skipped);
+
+    mrp_resource_set_release(rset, 2);
+    mrp_resource_set_destroy(rset);
+    mrp_lua_set_heap_limit(0);
+
+    rset = mrp_resource_set_create(c, false, false, 0, error_event, &armed);
+
+    if (rset == NULL ||
+        mrp_resource_set_add_resource(rset, RESOURCE, false, NULL, true) < 0 ||
+        mrp_application_class_add_resource_set(LOW, ZONE, rset, 0) < 0) {
+        mrp_log_error("Failed to create resource set.");
+        exit(1);
+    }
+
+    lua_pushcfunction(L, acquire_from_lua);
+    lua_pushlightuserdata(L, rset);
+
+    armed = true;
+
+    if (mrp_lua_pcall(L, 1, 0, 0) == 0) {
+        mrp_log_error("Lua error within a recalculation not raised.");
+        failed++;
+    }
+    else
+        lua_pop(L, 1);
+
+    armed = false;
+
+    mrp_lua_get_memory_stats(&st);
+    seqno = mrp_resource_client_get_recalc_seqno();
+
+    mrp_resource_owner_recalc(zoneid);
+
+    mrp_lua_get_memory_stats(&after);
+
+    if (mrp_resource_client_get_recalc_seqno() != seqno + 1 ||
+        after.pauses != st.pauses + 1) {
+        mrp_log_error("Recalculation left open by a Lua error.");
+        failed++;
+    }
+
+    mrp_resource_set_destroy(rset);
+    mrp_resource_client_destroy(c);
+
+    return failed;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int      held, raw, nupdate, failed;
+    uint64_t bulk, single, allocs;
+
+    mrp_log_set_mask(MRP_LOG_UPTO(MRP_LOG_INFO));
+
+    if (argc > 1 && !strcmp(argv[1], "-b")) {
+        nupdate = argc > 2 ? (int)strtol(argv[2], NULL, 10) : 0;
+
+        nupdate = nupdate > 0 ? nupdate : NBENCH;
+
+        setup();
+
+        failed  = churn(nupdate, &allocs);
+        failed += probe(nupdate / 2);
+
+        return failed ? 1 : 0;
+    }
+
+    setup();
+
+    if (mrp_add_timer(ctx->ml, TIMEOUT, timeout_cb, NULL) == NULL) {
+        mrp_log_error("Failed to create timeout timer.");
+        exit(1);
+    }
+
+    failed  = flap(GRACE, &held);
+    failed += flap(0, &raw);
+
+    if (held != 2) {
+        mrp_log_error("%d events with a grace period, expected 2.", held);
+        failed++;
+    }
+
+    if (raw != 2 + 2 * NFLAP) {
+        mrp_log_error("%d events without a grace period, expected %d.", raw,
+                      2 + 2 * NFLAP);
+        failed++;
+    }
+
+    failed += disconnect(true, &bulk);
+    failed += disconnect(false, &single);
+
+    if (bulk != 1) {
+        mrp_log_error("%llu zone updates for a disconnect, expected 1.",
+                      (unsigned long long)bulk);
+        failed++;
+    }
+
+    if (single != NSET) {
+        mrp_log_error("%llu zone updates for destroying %d sets, expected "
+                      "%d.", (unsigned long long)single, NSET, NSET);
+        failed++;
+    }
+
+    failed += churn(NUPDATE, &allocs);
+
+    if (allocs > MAXALLOC) {
+        mrp_log_error("%llu scratch allocations for %d updates.",
+                      (unsigned long long)allocs, NUPDATE);
+        failed++;
+    }
+
+    failed += probe(NUPDATE / 2);
+    failed += near_limit();
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+--
+-- Micro-benchmark for rset.resources and events of Lua resource sets.
+--
+-- Load it into a running daemon using the stock configuration, eg.
+--
+--     murphy-console 'lua source .../rset-resources-bench.lua'
+--
+-- It creates a resource set with three resources, then reads
+-- rset.resources 100k times with the collector stopped and prints the
+-- time and the Lua heap growth per read. With the resource table cached
+-- the growth should be close to zero. It also checks that a modified
+-- table is not handed out again.
+--
+-- Then it acquires and releases resource sets to get 1000 resource set
+-- events, each handled by a Lua callback, and prints the Lua heap growth
+-- per event with the collector stopped and the number of collection
+-- cycles with it running. It does this for a callback that walks through
+-- rset.resources and reads the attributes of every resource, as policies
+-- written against the one-argument callback do, and for one that only
+-- looks at the resources listed in the change delta. The latter is
+-- skipped if the callback gets no delta. A callback doing nothing gives
+-- the baseline cost of acquiring and releasing. Callbacks run with the
+-- collector paused, so the cycle count follows the recalculations rather
+-- than the callbacks; their garbage is left to idle-time collection.
+--
+
+local N = 100000
+
+local m = murphy.get()
+local rset = m:ResourceSet({ application_class = 'player', zone = 'driver' })
+
+for _, name in ipairs({ 'audio_playback', 'audio_recording',
+                        'video_playback' }) do
+    rset:addResource({ resource_name = name, mandatory = false })
+end
+
+local t, kb, r
+
+collectgarbage("collect")
+collectgarbage("stop")
+
+kb = collectgarbage("count")
+t  = os.clock()
+
+for i = 1, N do
+    r = rset.resources
+end
+
+t  = os.clock() - t
+kb = collectgarbage("count") - kb
+
+collectgarbage("restart")
+
+print(string.format("rset.resources: %.3f s, %.1f ns/read, %.1f bytes/read",
+                    t, t * 1e9 / N, kb * 1024 / N))
+
+-- a modified table must not be handed out again
+r = rset.resources
+r.audio_playback = nil
+r.bogus = true
+
+r = rset.resources
+
+if r.audio_playback == nil or r.bogus ~= nil then
+    print("ERROR: modified resource table handed out again")
+end
+
+-- resource set events handled by a Lua callback
+local NEVENT = 1000
+
+local RESOURCES = { 'audio_playback', 'audio_recording', 'video_playback' }
+
+local nevent, ndelta
+
+local function read_resource(r)
+    local a = r.attributes
+
+    if r.acquired and a then
+        return a.role, a.pid, a.policy
+    end
+end
+
+local function noop_cb(rset, delta)
+    nevent = nevent + 1
+end
+
+local function walk_cb(rset, delta)
+    nevent = nevent + 1
+
+    for _, r in pairs(rset.resources) do
+        read_resource(r)
+    end
+end
+
+local function delta_cb(rset, delta)
+    nevent = nevent + 1
+
+    if delta then
+        ndelta = ndelta + 1
+
+        for _, r in pairs(delta.changed) do
+            read_resource(r)
+        end
+    end
+end
+
+-- count completed collection cycles with a finalizer that rearms itself,
+-- counters armed for earlier runs retire at their next collection
+local ncycle, generation = 0, 0
+
+local function arm_cycle_counter(gen)
+    local p = newproxy(true)
+
+    getmetatable(p).__gc = function ()
+        if gen == generation then
+            ncycle = ncycle + 1
+            arm_cycle_counter(gen)
+        end
+    end
+end
+
+local function run_events(s, stopped)
+    for i = 1, NEVENT / 2 do
+        s:acquire()
+        if stopped then collectgarbage("stop") end
+        s:release()
+        if stopped then collectgarbage("stop") end
+    end
+end
+
+local function bench_events(name, cb)
+    local s, kb, cycles
+
+    s = m:ResourceSet({ application_class = 'player', zone = 'driver',
+                        callback = cb })
+
+    for _, rname in ipairs(RESOURCES) do
+        s:addResource({ resource_name = rname, mandatory = false })
+    end
+
+    nevent, ndelta = 0, 0
+    s:release()                         -- commit the set, settle its state
+
+    -- the end of a recalculation restarts the collector, so stop it again
+    -- after each of them to get the full heap growth of the events
+    collectgarbage("collect")
+    collectgarbage("stop")
+
+    nevent, ndelta = 0, 0
+    kb = collectgarbage("count")
+    run_events(s, true)
+    kb = collectgarbage("count") - kb
+
+    collectgarbage("restart")
+
+    if nevent ~= NEVENT then
+        print(string.format("ERROR: %s: %d events instead of %d", name,
+                            nevent, NEVENT))
+    end
+
+    if cb == delta_cb and ndelta == 0 then
+        print(string.format("%s: no change delta passed, skipped", name))
+        return
+    end
+
+    collectgarbage("collect")
+    ncycle, generation = 0, generation + 1
+    arm_cycle_counter(generation)
+
+    run_events(s, false)
+    cycles = ncycle
+
+    print(string.format("%s: %d events, %.1f bytes/event, %d GC cycles",
+                        name, NEVENT, kb * 1024 / NEVENT, cycles))
+end
+
+bench_events("no-op callback", noop_cb)
+bench_events("rset.resources walk", walk_cb)
+bench_events("change delta", delta_cb)
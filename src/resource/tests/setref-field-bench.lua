@@ -0,0 +1,67 @@
+--
+-- Micro-benchmark for field reads of resource set and owner references,
+-- the objects veto functions get passed in mrp_resource_lua_veto.
+--
+-- Load it into a running daemon with at least one resource set, eg.
+--
+--     murphy-console 'lua source .../setref-field-bench.lua'
+--
+-- and it will time 1M reads of each field of the first resource set it
+-- finds and of the owner of the first resource in the default zone.
+--
+
+local N = 1000000
+
+local function bench(label, obj, field)
+    local v
+    local t = os.clock()
+
+    for i = 1, N do
+        v = obj[field]
+    end
+
+    t = os.clock() - t
+
+    print(string.format("%-24s %8.3f s, %6.1f ns/read (%s)",
+                        label .. "." .. field, t, t * 1e9 / N, tostring(v)))
+end
+
+local rset = nil
+
+-- the class tables index their objects by id and name, but missing ones
+-- can't be looked up through the class metamethods, hence the rawget()s
+for id = 0, 1024 do
+    rset = rawget(resource.sets, id)
+    if rset ~= nil then
+        break
+    end
+end
+
+if rset == nil then
+    print("no resource sets found, nothing to benchmark")
+    return
+end
+
+for _, field in ipairs({ "id", "priority", "state", "dont_wait",
+                         "auto_release", "application_class" }) do
+    bench("rset", rset, field)
+end
+
+-- read-only fields must not be overwritable from Lua
+local id, prio = rset.id, rset.priority
+
+rset.id       = -1
+rset.priority = -1
+
+if rset.id ~= id or rset.priority ~= prio then
+    print("ERROR: read-only resource set fields were overwritten")
+end
+
+local zone = resource.owners and rawget(resource.owners, "default")
+local owner = zone and zone[1]
+
+if owner ~= nil then
+    bench("owner", owner, "application_class")
+    bench("owner", owner, "resource_set")
+    bench("owners", zone, 1)
+end